@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include "come_array.h"
 #include "mem/talloc.h"
 
@@ -41,57 +42,127 @@ void* come_array_realloc(void* arr, size_t elem_size, uint32_t new_size) {
     return new_arr;
 }
 
-void* come_int_array_resize(come_int_array_t* a, uint32_t n) {
-    return (come_int_array_t*)come_array_realloc(a, sizeof(int), n);
+void* come_array_new(TALLOC_CTX* ctx, size_t hdr, size_t elem_size, uint32_t count) {
+    void* arr = mem_talloc_alloc(ctx, hdr + elem_size * count);
+    if (!arr) return NULL;
+
+    uint32_t* h = (uint32_t*)arr;
+    h[0] = count; // size
+    h[1] = count; // count
+    memset((char*)arr + hdr, 0, elem_size * count);
+    return arr;
 }
 
-void* come_byte_array_resize(come_byte_array_t* a, uint32_t n) {
-    return (come_byte_array_t*)come_array_realloc(a, sizeof(uint8_t), n);
+// Dynamic arrays
+// The header is [uint32 size, uint32 count] followed, after any padding, by the items.
+
+#define ARRAY_MIN_CAPACITY 4
+
+uint32_t come_array_capacity(uint32_t size, uint32_t count, uint32_t extra) {
+    if (extra > UINT32_MAX - count) {
+        errno = ENOMEM;
+        return 0;
+    }
+    uint64_t need = (uint64_t)count + extra;
+    uint64_t cap = size ? (uint64_t)size * 2 : ARRAY_MIN_CAPACITY;
+    if (cap < need) cap = need;
+    if (cap > UINT32_MAX) cap = UINT32_MAX;
+    return (uint32_t)cap;
 }
 
-void* come_string_list_resize(come_string_list_t* a, uint32_t n) {
-    return (come_string_list_t*)come_array_realloc(a, sizeof(void*), n);
+void* come_array_grow(void* arr, size_t hdr, size_t elem_size, uint32_t extra) {
+    uint32_t size = arr ? ((uint32_t*)arr)[0] : 0;
+    uint32_t count = arr ? ((uint32_t*)arr)[1] : 0;
+    if (arr && extra <= size - count) return arr;
+
+    uint32_t cap = come_array_capacity(size, count, extra);
+    if (!cap) return NULL;
+    void* grown = mem_talloc_realloc(NULL, arr, hdr + elem_size * cap);
+    if (!grown) return NULL;
+
+    uint32_t* h = (uint32_t*)grown;
+    h[0] = cap;
+    h[1] = count;
+    return grown;
 }
 
-come_int_array_t* come_int_array_slice(come_int_array_t* a, uint32_t start, uint32_t end) {
-    if (!a) {
-        return (come_int_array_t*)come_array_alloc(NULL, sizeof(int), 0);
-    }
-    
-    if (start >= a->count || start >= end) {
-        return (come_int_array_t*)come_array_alloc((void*)a, sizeof(int), 0);
-    }
-    if (end > a->count) end = a->count;
-    uint32_t n = end - start;
-    come_int_array_t* res = (come_int_array_t*)come_array_alloc((void*)a, sizeof(int), n);
-    if (res) {
-        memcpy(res->items, &a->items[start], n * sizeof(int));
-    }
-    return res;
+// Struct-of-arrays: a zeroed header whose columns are its talloc children, so the header
+// never moves and freeing it frees every column
+void* come_soa_new(TALLOC_CTX* ctx, size_t size) {
+    void* soa = mem_talloc_alloc(ctx, size);
+    if (soa) memset(soa, 0, size);
+    return soa;
 }
 
-come_byte_array_t* come_byte_array_slice(come_byte_array_t* a, uint32_t start, uint32_t end) {
-    if (!a || start >= a->count || start >= end) {
-        return (come_byte_array_t*)come_array_alloc((void*)a, sizeof(uint8_t), 0);
+void* come_soa_column(void* soa, void* column, size_t bytes) {
+    return mem_talloc_realloc(soa, column, bytes);
+}
+
+void* come_array_set_count(void* arr, size_t hdr, size_t elem_size, uint32_t count) {
+    uint32_t old = arr ? ((uint32_t*)arr)[1] : 0;
+    if (count > old) {
+        arr = come_array_grow(arr, hdr, elem_size, count - old);
+        if (!arr) return NULL;
+        memset((char*)arr + hdr + old * elem_size, 0, (count - old) * elem_size);
     }
-    if (end > a->count) end = a->count;
-    uint32_t n = end - start;
-    come_byte_array_t* res = (come_byte_array_t*)come_array_alloc((void*)a, sizeof(uint8_t), n);
-    if (res) {
-        memcpy(res->items, &a->items[start], n * sizeof(uint8_t));
+    if (arr) ((uint32_t*)arr)[1] = count;
+    return arr;
+}
+
+void* come_array_shrink(void* arr, size_t hdr, size_t elem_size) {
+    if (!arr) return NULL;
+    uint32_t* h = (uint32_t*)arr;
+    if (h[0] == h[1]) return arr;
+    void* fit = mem_talloc_realloc(NULL, arr, hdr + elem_size * h[1]);
+    if (!fit) return arr; // Still valid, just larger than needed
+    h = (uint32_t*)fit;
+    h[0] = h[1];
+    return fit;
+}
+
+void* come_array_insert_items(void* arr, size_t hdr, size_t elem_size, uint32_t at, const void* items, uint32_t n) {
+    uint32_t count = arr ? ((uint32_t*)arr)[1] : 0;
+    if (at > count) at = count;
+
+    // items may point into arr itself (a.append(a)), which growing can move
+    ptrdiff_t self = -1;
+    if (arr && items && (const char*)items >= (const char*)arr &&
+        (const char*)items < (const char*)arr + hdr + elem_size * ((uint32_t*)arr)[0]) {
+        self = (const char*)items - (const char*)arr;
     }
-    return res;
+    arr = come_array_grow(arr, hdr, elem_size, n);
+    if (!arr) return NULL;
+    if (self >= 0) items = (const char*)arr + self;
+
+    char* base = (char*)arr + hdr;
+    memmove(base + (at + n) * elem_size, base + at * elem_size, (count - at) * elem_size);
+    if (self >= 0 && (const char*)items >= base + at * elem_size) items = (const char*)items + n * elem_size;
+    if (items) memcpy(base + at * elem_size, items, n * elem_size);
+    else memset(base + at * elem_size, 0, n * elem_size);
+    ((uint32_t*)arr)[1] = count + n;
+    return arr;
+}
+
+void come_array_remove_items(void* arr, size_t hdr, size_t elem_size, uint32_t at, uint32_t n) {
+    if (!arr) return;
+    uint32_t count = ((uint32_t*)arr)[1];
+    if (at >= count) return;
+    if (n > count - at) n = count - at;
+    char* base = (char*)arr + hdr;
+    memmove(base + at * elem_size, base + (at + n) * elem_size, (count - at - n) * elem_size);
+    ((uint32_t*)arr)[1] = count - n;
 }
 
-come_string_list_t* come_string_list_slice(come_string_list_t* a, uint32_t start, uint32_t end) {
-    if (!a || start >= a->count || start >= end) {
-        return (come_string_list_t*)come_array_alloc((void*)a, sizeof(void*), 0);
+void* come_array_slice_items(const void* arr, size_t hdr, size_t elem_size, uint32_t start, uint32_t end) {
+    uint32_t count = arr ? ((const uint32_t*)arr)[1] : 0;
+    if (start >= count || start >= end) {
+        return come_array_new((void*)arr, hdr, elem_size, 0);
     }
-    if (end > a->count) end = a->count;
+    if (end > count) end = count;
     uint32_t n = end - start;
-    come_string_list_t* res = (come_string_list_t*)come_array_alloc((void*)a, sizeof(void*), n);
+    void* res = come_array_new((void*)arr, hdr, elem_size, n);
     if (res) {
-        memcpy(res->items, &a->items[start], n * sizeof(void*));
+        memcpy((char*)res + hdr, (const char*)arr + hdr + start * elem_size, n * elem_size);
     }
     return res;
 }
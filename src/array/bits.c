@@ -0,0 +1,143 @@
+#include <string.h>
+#include <errno.h>
+#include "come_array.h"
+#include "mem/talloc.h"
+
+// Packed bool[]
+// Bits live in 64-bit words and every operation works a word at a time. The bits of the
+// last word at or past count are kept zero (resize and pop clear them, and/or/xor mask
+// them), so count and next_set can read whole words. count uses the POPCNT instruction
+// when the CPU has it; next_set finds bits with count-trailing-zeros (BSF/TZCNT).
+
+#define BITS_WORDS(n) (((uint64_t)(n) + 63) / 64)
+#define BITS_HDR offsetof(come_bool_array_t, items)
+#define BITS_SIZE(words) ((uint64_t)(words) * 64 > UINT32_MAX ? UINT32_MAX : (uint32_t)((words) * 64))
+
+come_bool_array_t* come_bool_array_new(TALLOC_CTX* ctx, uint32_t n) {
+    come_bool_array_t* a = come_array_new(ctx, BITS_HDR, sizeof(uint64_t), (uint32_t)BITS_WORDS(n));
+    if (!a) return NULL;
+    a->size = BITS_SIZE(BITS_WORDS(n));
+    a->count = n;
+    return a;
+}
+
+come_bool_array_t* come_bool_array_resize(come_bool_array_t* a, uint32_t n) {
+    uint32_t old = a ? a->count : 0;
+    uint64_t words = BITS_WORDS(old);
+    if (n > (a ? a->size : 0)) {
+        // Grow in words, doubling like the other arrays
+        uint32_t cap = come_array_capacity((uint32_t)BITS_WORDS(a ? a->size : 0), (uint32_t)words,
+                                           (uint32_t)(BITS_WORDS(n) - words));
+        if (!cap) return NULL;
+        come_bool_array_t* grown = mem_talloc_realloc(NULL, a, BITS_HDR + sizeof(uint64_t) * cap);
+        if (!grown) return NULL;
+        memset(grown->items + words, 0, sizeof(uint64_t) * (cap - words));
+        grown->size = BITS_SIZE(cap);
+        grown->count = old;
+        a = grown;
+    }
+    if (!a) return NULL;
+    if (n < old) {
+        // Zero the dropped bits so the tail invariant holds
+        uint64_t keep = BITS_WORDS(n);
+        if (n & 63) a->items[n / 64] &= ((uint64_t)1 << (n & 63)) - 1;
+        memset(a->items + keep, 0, sizeof(uint64_t) * (words - keep));
+    }
+    a->count = n;
+    return a;
+}
+
+come_bool_array_t* come_bool_array_push(come_bool_array_t* a, bool v) {
+    uint32_t i = a ? a->count : 0;
+    if (i == UINT32_MAX) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    a = come_bool_array_resize(a, i + 1);
+    if (a) come_bool_array_put(a, i, v);
+    return a;
+}
+
+bool come_bool_array_pop(come_bool_array_t* a) {
+    if (!a || !a->count) return false;
+    uint32_t i = a->count - 1;
+    bool v = come_bool_array_test(a, i);
+    come_bool_array_clear(a, i);
+    a->count = i;
+    return v;
+}
+
+// a = a OP b over the first min(a->count, b->count) bits; a's later bits are unchanged
+#define BITS_COMBINE(name, OP) \
+    void come_bool_array_##name(come_bool_array_t* a, const come_bool_array_t* b) { \
+        if (!a || !b) return; \
+        uint32_t n = a->count < b->count ? a->count : b->count; \
+        uint32_t full = n / 64; \
+        for (uint32_t w = 0; w < full; w++) a->items[w] = a->items[w] OP b->items[w]; \
+        if (n & 63) { \
+            uint64_t mask = ((uint64_t)1 << (n & 63)) - 1; \
+            uint64_t x = a->items[full]; \
+            a->items[full] = (x & ~mask) | ((x OP b->items[full]) & mask); \
+        } \
+    }
+
+BITS_COMBINE(and, &)
+BITS_COMBINE(or, |)
+BITS_COMBINE(xor, ^)
+
+void come_bool_array_fill(come_bool_array_t* a, bool v) {
+    if (!a || !a->count) return;
+    uint64_t words = BITS_WORDS(a->count);
+    memset(a->items, v ? 0xff : 0, sizeof(uint64_t) * words);
+    if (v && (a->count & 63)) a->items[words - 1] = ((uint64_t)1 << (a->count & 63)) - 1;
+}
+
+static uint32_t popcount_words_scalar(const uint64_t* p, uint64_t n) {
+    uint32_t c = 0;
+    for (uint64_t i = 0; i < n; i++) c += (uint32_t)__builtin_popcountll(p[i]);
+    return c;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("popcnt")))
+static uint32_t popcount_words_popcnt(const uint64_t* p, uint64_t n) {
+    // Four accumulators so the popcnt latency overlaps
+    uint64_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+    uint64_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        c0 += (uint64_t)__builtin_popcountll(p[i]);
+        c1 += (uint64_t)__builtin_popcountll(p[i + 1]);
+        c2 += (uint64_t)__builtin_popcountll(p[i + 2]);
+        c3 += (uint64_t)__builtin_popcountll(p[i + 3]);
+    }
+    for (; i < n; i++) c0 += (uint64_t)__builtin_popcountll(p[i]);
+    return (uint32_t)(c0 + c1 + c2 + c3);
+}
+#endif
+
+uint32_t come_bool_array_count(const come_bool_array_t* a) {
+    static int has_popcnt = -1;
+    if (!a) return 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (has_popcnt < 0) {
+        __builtin_cpu_init();
+        has_popcnt = __builtin_cpu_supports("popcnt") != 0;
+    }
+    if (has_popcnt) return popcount_words_popcnt(a->items, BITS_WORDS(a->count));
+#else
+    (void)has_popcnt;
+#endif
+    return popcount_words_scalar(a->items, BITS_WORDS(a->count));
+}
+
+long come_bool_array_next_set(const come_bool_array_t* a, uint32_t i) {
+    if (!a || i >= a->count) return -1;
+    uint64_t words = BITS_WORDS(a->count);
+    uint64_t w = i / 64;
+    uint64_t x = a->items[w] & (~(uint64_t)0 << (i & 63));
+    while (!x) {
+        if (++w == words) return -1;
+        x = a->items[w];
+    }
+    return (long)(w * 64 + (uint64_t)__builtin_ctzll(x));
+}
@@ -0,0 +1,1007 @@
+#include <string.h>
+#include "come_array.h"
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#include <immintrin.h>
+#define COME_KERNELS_X86 1
+#endif
+
+// Numeric kernels
+// sum, min, max, dot, fill, scale, add, count, index_of and prefix_sum over int, long,
+// float, double and byte arrays. Each kernel has a scalar version and, where the
+// instruction set has the operation, SSE4.2 and AVX2 versions that process whole
+// vectors and leave the tail to the scalar loop.
+//
+// Integer arithmetic wraps like unsigned arithmetic; sums and dot products widen to 64
+// bits (float ones accumulate in double), so they only wrap past 2^63. Vector float
+// reductions add in a different order than the scalar loop, so their last bits may
+// differ. min/max of an array containing NaN is unspecified.
+
+// 0 scalar, 1 SSE4.2, 2 AVX2
+static int kernel_level = -1;
+
+static int array_kernel_level(void) {
+    if (kernel_level < 0) {
+        int level = 0;
+#ifdef COME_KERNELS_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) level = 2;
+        else if (__builtin_cpu_supports("sse4.2")) level = 1;
+#endif
+        kernel_level = level;
+    }
+    return kernel_level;
+}
+
+// Scalar kernels, also used for the tails. T is the element type, U the type its
+// element-wise arithmetic is done in (unsigned for integers, so overflow wraps), W the
+// accumulator type of sum/dot and S their result type.
+#define SCALAR_KERNELS(sfx, T, U, W, S) \
+    static inline S sum_##sfx##_scalar(const T* p, size_t n, W s) { \
+        for (size_t i = 0; i < n; i++) s += (W)(S)p[i]; \
+        return (S)s; \
+    } \
+    static inline void minmax_##sfx##_scalar(const T* p, size_t n, T* lo, T* hi) { \
+        for (size_t i = 0; i < n; i++) { \
+            if (p[i] < *lo) *lo = p[i]; \
+            if (p[i] > *hi) *hi = p[i]; \
+        } \
+    } \
+    static inline S dot_##sfx##_scalar(const T* p, const T* q, size_t n, W s) { \
+        for (size_t i = 0; i < n; i++) s += (W)(S)p[i] * (W)(S)q[i]; \
+        return (S)s; \
+    } \
+    static inline void fill_##sfx##_scalar(T* p, size_t n, T v) { \
+        for (size_t i = 0; i < n; i++) p[i] = v; \
+    } \
+    static inline void scale_##sfx##_scalar(T* p, size_t n, T k) { \
+        for (size_t i = 0; i < n; i++) p[i] = (T)((U)p[i] * (U)k); \
+    } \
+    static inline void add_##sfx##_scalar(T* p, const T* q, size_t n) { \
+        for (size_t i = 0; i < n; i++) p[i] = (T)((U)p[i] + (U)q[i]); \
+    } \
+    static inline size_t count_##sfx##_scalar(const T* p, size_t n, T v) { \
+        size_t c = 0; \
+        for (size_t i = 0; i < n; i++) c += p[i] == v; \
+        return c; \
+    } \
+    static inline size_t index_##sfx##_scalar(const T* p, size_t n, T v) { \
+        for (size_t i = 0; i < n; i++) { \
+            if (p[i] == v) return i; \
+        } \
+        return n; \
+    } \
+    static inline void prefix_##sfx##_scalar(T* p, size_t n, U run) { \
+        for (size_t i = 0; i < n; i++) { \
+            run += (U)p[i]; \
+            p[i] = (T)run; \
+        } \
+    }
+
+SCALAR_KERNELS(i32, int, uint32_t, uint64_t, int64_t)
+SCALAR_KERNELS(i64, int64_t, uint64_t, uint64_t, int64_t)
+SCALAR_KERNELS(f32, float, float, double, double)
+SCALAR_KERNELS(f64, double, double, double, double)
+SCALAR_KERNELS(u8, uint8_t, unsigned, uint64_t, uint64_t)
+
+#ifdef COME_KERNELS_X86
+
+// Horizontal helpers
+
+__attribute__((target("sse4.2")))
+static inline uint64_t hsum_epi64_sse(__m128i v) {
+    return (uint64_t)_mm_cvtsi128_si64(v) + (uint64_t)_mm_extract_epi64(v, 1);
+}
+
+__attribute__((target("avx2")))
+static inline uint64_t hsum_epi64_avx2(__m256i v) {
+    return hsum_epi64_sse(_mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+}
+
+__attribute__((target("sse4.2")))
+static inline double hsum_pd_sse(__m128d v) {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+__attribute__((target("avx2")))
+static inline double hsum_pd_avx2(__m256d v) {
+    return hsum_pd_sse(_mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1)));
+}
+
+// Sum
+
+__attribute__((target("sse4.2")))
+static int64_t sum_i32_sse(const int* p, size_t n) {
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(v));
+        acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(_mm_srli_si128(v, 8)));
+    }
+    return sum_i32_scalar(p + i, n - i, hsum_epi64_sse(acc));
+}
+
+__attribute__((target("avx2")))
+static int64_t sum_i32_avx2(const int* p, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+    return sum_i32_scalar(p + i, n - i, hsum_epi64_avx2(acc));
+}
+
+__attribute__((target("sse4.2")))
+static int64_t sum_i64_sse(const int64_t* p, size_t n) {
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) acc = _mm_add_epi64(acc, _mm_loadu_si128((const __m128i*)(p + i)));
+    return sum_i64_scalar(p + i, n - i, hsum_epi64_sse(acc));
+}
+
+__attribute__((target("avx2")))
+static int64_t sum_i64_avx2(const int64_t* p, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) acc = _mm256_add_epi64(acc, _mm256_loadu_si256((const __m256i*)(p + i)));
+    return sum_i64_scalar(p + i, n - i, hsum_epi64_avx2(acc));
+}
+
+__attribute__((target("sse4.2")))
+static double sum_f32_sse(const float* p, size_t n) {
+    __m128d acc = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(p + i);
+        acc = _mm_add_pd(acc, _mm_cvtps_pd(v));
+        acc = _mm_add_pd(acc, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+    }
+    return sum_f32_scalar(p + i, n - i, hsum_pd_sse(acc));
+}
+
+__attribute__((target("avx2")))
+static double sum_f32_avx2(const float* p, size_t n) {
+    __m256d acc = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_add_pd(acc, _mm256_cvtps_pd(_mm_loadu_ps(p + i)));
+        acc = _mm256_add_pd(acc, _mm256_cvtps_pd(_mm_loadu_ps(p + i + 4)));
+    }
+    return sum_f32_scalar(p + i, n - i, hsum_pd_avx2(acc));
+}
+
+__attribute__((target("sse4.2")))
+static double sum_f64_sse(const double* p, size_t n) {
+    __m128d acc = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) acc = _mm_add_pd(acc, _mm_loadu_pd(p + i));
+    return sum_f64_scalar(p + i, n - i, hsum_pd_sse(acc));
+}
+
+__attribute__((target("avx2")))
+static double sum_f64_avx2(const double* p, size_t n) {
+    __m256d acc = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) acc = _mm256_add_pd(acc, _mm256_loadu_pd(p + i));
+    return sum_f64_scalar(p + i, n - i, hsum_pd_avx2(acc));
+}
+
+// Bytes: psadbw against zero adds 8 bytes into each 64-bit lane
+__attribute__((target("sse4.2")))
+static uint64_t sum_u8_sse(const uint8_t* p, size_t n) {
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(p + i)), _mm_setzero_si128()));
+    }
+    return sum_u8_scalar(p + i, n - i, hsum_epi64_sse(acc));
+}
+
+__attribute__((target("avx2")))
+static uint64_t sum_u8_avx2(const uint8_t* p, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_loadu_si256((const __m256i*)(p + i)), _mm256_setzero_si256()));
+    }
+    return sum_u8_scalar(p + i, n - i, hsum_epi64_avx2(acc));
+}
+
+// Min/max: both in one pass, the vector lanes are folded into *lo/*hi
+
+__attribute__((target("sse4.2")))
+static void minmax_i32_sse(const int* p, size_t n, int* lo, int* hi) {
+    if (n < 4) {
+        minmax_i32_scalar(p, n, lo, hi);
+        return;
+    }
+    __m128i vlo = _mm_set1_epi32(*lo), vhi = _mm_set1_epi32(*hi);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        vlo = _mm_min_epi32(vlo, v);
+        vhi = _mm_max_epi32(vhi, v);
+    }
+    int l[4], h[4];
+    _mm_storeu_si128((__m128i*)l, vlo);
+    _mm_storeu_si128((__m128i*)h, vhi);
+    minmax_i32_scalar(l, 4, lo, hi);
+    minmax_i32_scalar(h, 4, lo, hi);
+    minmax_i32_scalar(p + i, n - i, lo, hi);
+}
+
+__attribute__((target("avx2")))
+static void minmax_i32_avx2(const int* p, size_t n, int* lo, int* hi) {
+    if (n < 8) {
+        minmax_i32_scalar(p, n, lo, hi);
+        return;
+    }
+    __m256i vlo = _mm256_set1_epi32(*lo), vhi = _mm256_set1_epi32(*hi);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+        vlo = _mm256_min_epi32(vlo, v);
+        vhi = _mm256_max_epi32(vhi, v);
+    }
+    int l[8], h[8];
+    _mm256_storeu_si256((__m256i*)l, vlo);
+    _mm256_storeu_si256((__m256i*)h, vhi);
+    minmax_i32_scalar(l, 8, lo, hi);
+    minmax_i32_scalar(h, 8, lo, hi);
+    minmax_i32_scalar(p + i, n - i, lo, hi);
+}
+
+// No 64-bit min/max instructions below AVX-512: compare and blend
+__attribute__((target("sse4.2")))
+static void minmax_i64_sse(const int64_t* p, size_t n, int64_t* lo, int64_t* hi) {
+    if (n < 2) {
+        minmax_i64_scalar(p, n, lo, hi);
+        return;
+    }
+    __m128i vlo = _mm_set1_epi64x(*lo), vhi = _mm_set1_epi64x(*hi);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        vlo = _mm_blendv_epi8(vlo, v, _mm_cmpgt_epi64(vlo, v));
+        vhi = _mm_blendv_epi8(vhi, v, _mm_cmpgt_epi64(v, vhi));
+    }
+    int64_t l[2], h[2];
+    _mm_storeu_si128((__m128i*)l, vlo);
+    _mm_storeu_si128((__m128i*)h, vhi);
+    minmax_i64_scalar(l, 2, lo, hi);
+    minmax_i64_scalar(h, 2, lo, hi);
+    minmax_i64_scalar(p + i, n - i, lo, hi);
+}
+
+__attribute__((target("avx2")))
+static void minmax_i64_avx2(const int64_t* p, size_t n, int64_t* lo, int64_t* hi) {
+    if (n < 4) {
+        minmax_i64_scalar(p, n, lo, hi);
+        return;
+    }
+    __m256i vlo = _mm256_set1_epi64x(*lo), vhi = _mm256_set1_epi64x(*hi);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+        vlo = _mm256_blendv_epi8(vlo, v, _mm256_cmpgt_epi64(vlo, v));
+        vhi = _mm256_blendv_epi8(vhi, v, _mm256_cmpgt_epi64(v, vhi));
+    }
+    int64_t l[4], h[4];
+    _mm256_storeu_si256((__m256i*)l, vlo);
+    _mm256_storeu_si256((__m256i*)h, vhi);
+    minmax_i64_scalar(l, 4, lo, hi);
+    minmax_i64_scalar(h, 4, lo, hi);
+    minmax_i64_scalar(p + i, n - i, lo, hi);
+}
+
+__attribute__((target("sse4.2")))
+static void minmax_f32_sse(const float* p, size_t n, float* lo, float* hi) {
+    if (n < 4) {
+        minmax_f32_scalar(p, n, lo, hi);
+        return;
+    }
+    __m128 vlo = _mm_set1_ps(*lo), vhi = _mm_set1_ps(*hi);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(p + i);
+        vlo = _mm_min_ps(vlo, v);
+        vhi = _mm_max_ps(vhi, v);
+    }
+    float l[4], h[4];
+    _mm_storeu_ps(l, vlo);
+    _mm_storeu_ps(h, vhi);
+    minmax_f32_scalar(l, 4, lo, hi);
+    minmax_f32_scalar(h, 4, lo, hi);
+    minmax_f32_scalar(p + i, n - i, lo, hi);
+}
+
+__attribute__((target("avx2")))
+static void minmax_f32_avx2(const float* p, size_t n, float* lo, float* hi) {
+    if (n < 8) {
+        minmax_f32_scalar(p, n, lo, hi);
+        return;
+    }
+    __m256 vlo = _mm256_set1_ps(*lo), vhi = _mm256_set1_ps(*hi);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(p + i);
+        vlo = _mm256_min_ps(vlo, v);
+        vhi = _mm256_max_ps(vhi, v);
+    }
+    float l[8], h[8];
+    _mm256_storeu_ps(l, vlo);
+    _mm256_storeu_ps(h, vhi);
+    minmax_f32_scalar(l, 8, lo, hi);
+    minmax_f32_scalar(h, 8, lo, hi);
+    minmax_f32_scalar(p + i, n - i, lo, hi);
+}
+
+__attribute__((target("sse4.2")))
+static void minmax_f64_sse(const double* p, size_t n, double* lo, double* hi) {
+    if (n < 2) {
+        minmax_f64_scalar(p, n, lo, hi);
+        return;
+    }
+    __m128d vlo = _mm_set1_pd(*lo), vhi = _mm_set1_pd(*hi);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(p + i);
+        vlo = _mm_min_pd(vlo, v);
+        vhi = _mm_max_pd(vhi, v);
+    }
+    double l[2], h[2];
+    _mm_storeu_pd(l, vlo);
+    _mm_storeu_pd(h, vhi);
+    minmax_f64_scalar(l, 2, lo, hi);
+    minmax_f64_scalar(h, 2, lo, hi);
+    minmax_f64_scalar(p + i, n - i, lo, hi);
+}
+
+__attribute__((target("avx2")))
+static void minmax_f64_avx2(const double* p, size_t n, double* lo, double* hi) {
+    if (n < 4) {
+        minmax_f64_scalar(p, n, lo, hi);
+        return;
+    }
+    __m256d vlo = _mm256_set1_pd(*lo), vhi = _mm256_set1_pd(*hi);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(p + i);
+        vlo = _mm256_min_pd(vlo, v);
+        vhi = _mm256_max_pd(vhi, v);
+    }
+    double l[4], h[4];
+    _mm256_storeu_pd(l, vlo);
+    _mm256_storeu_pd(h, vhi);
+    minmax_f64_scalar(l, 4, lo, hi);
+    minmax_f64_scalar(h, 4, lo, hi);
+    minmax_f64_scalar(p + i, n - i, lo, hi);
+}
+
+__attribute__((target("sse4.2")))
+static void minmax_u8_sse(const uint8_t* p, size_t n, uint8_t* lo, uint8_t* hi) {
+    if (n < 16) {
+        minmax_u8_scalar(p, n, lo, hi);
+        return;
+    }
+    __m128i vlo = _mm_set1_epi8((char)*lo), vhi = _mm_set1_epi8((char)*hi);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        vlo = _mm_min_epu8(vlo, v);
+        vhi = _mm_max_epu8(vhi, v);
+    }
+    uint8_t l[16], h[16];
+    _mm_storeu_si128((__m128i*)l, vlo);
+    _mm_storeu_si128((__m128i*)h, vhi);
+    minmax_u8_scalar(l, 16, lo, hi);
+    minmax_u8_scalar(h, 16, lo, hi);
+    minmax_u8_scalar(p + i, n - i, lo, hi);
+}
+
+__attribute__((target("avx2")))
+static void minmax_u8_avx2(const uint8_t* p, size_t n, uint8_t* lo, uint8_t* hi) {
+    if (n < 32) {
+        minmax_u8_sse(p, n, lo, hi);
+        return;
+    }
+    __m256i vlo = _mm256_set1_epi8((char)*lo), vhi = _mm256_set1_epi8((char)*hi);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+        vlo = _mm256_min_epu8(vlo, v);
+        vhi = _mm256_max_epu8(vhi, v);
+    }
+    uint8_t l[32], h[32];
+    _mm256_storeu_si256((__m256i*)l, vlo);
+    _mm256_storeu_si256((__m256i*)h, vhi);
+    minmax_u8_scalar(l, 32, lo, hi);
+    minmax_u8_scalar(h, 32, lo, hi);
+    minmax_u8_scalar(p + i, n - i, lo, hi);
+}
+
+// Dot product
+// pmuldq multiplies the low (sign-extended) 32 bits of each 64-bit lane, so even and odd
+// elements are multiplied separately into exact 64-bit products.
+
+__attribute__((target("sse4.2")))
+static int64_t dot_i32_sse(const int* p, const int* q, size_t n) {
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(p + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(q + i));
+        acc = _mm_add_epi64(acc, _mm_mul_epi32(a, b));
+        acc = _mm_add_epi64(acc, _mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32)));
+    }
+    return dot_i32_scalar(p + i, q + i, n - i, hsum_epi64_sse(acc));
+}
+
+__attribute__((target("avx2")))
+static int64_t dot_i32_avx2(const int* p, const int* q, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(p + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(q + i));
+        acc = _mm256_add_epi64(acc, _mm256_mul_epi32(a, b));
+        acc = _mm256_add_epi64(acc, _mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32)));
+    }
+    return dot_i32_scalar(p + i, q + i, n - i, hsum_epi64_avx2(acc));
+}
+
+__attribute__((target("sse4.2")))
+static double dot_f32_sse(const float* p, const float* q, size_t n) {
+    __m128d acc = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 a = _mm_loadu_ps(p + i), b = _mm_loadu_ps(q + i);
+        acc = _mm_add_pd(acc, _mm_mul_pd(_mm_cvtps_pd(a), _mm_cvtps_pd(b)));
+        acc = _mm_add_pd(acc, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(a, a)), _mm_cvtps_pd(_mm_movehl_ps(b, b))));
+    }
+    return dot_f32_scalar(p + i, q + i, n - i, hsum_pd_sse(acc));
+}
+
+__attribute__((target("avx2")))
+static double dot_f32_avx2(const float* p, const float* q, size_t n) {
+    __m256d acc = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_cvtps_pd(_mm_loadu_ps(p + i)), _mm256_cvtps_pd(_mm_loadu_ps(q + i))));
+    }
+    return dot_f32_scalar(p + i, q + i, n - i, hsum_pd_avx2(acc));
+}
+
+__attribute__((target("sse4.2")))
+static double dot_f64_sse(const double* p, const double* q, size_t n) {
+    __m128d acc = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) acc = _mm_add_pd(acc, _mm_mul_pd(_mm_loadu_pd(p + i), _mm_loadu_pd(q + i)));
+    return dot_f64_scalar(p + i, q + i, n - i, hsum_pd_sse(acc));
+}
+
+__attribute__((target("avx2")))
+static double dot_f64_avx2(const double* p, const double* q, size_t n) {
+    __m256d acc = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(p + i), _mm256_loadu_pd(q + i)));
+    return dot_f64_scalar(p + i, q + i, n - i, hsum_pd_avx2(acc));
+}
+
+// Bytes: widen to 16 bits and pmaddwd into 32-bit lanes. A lane gains at most
+// 2 * 255 * 255 per step, so lanes are flushed to 64 bits every 4096 steps.
+#define DOT_U8_BLOCK 4096
+
+__attribute__((target("sse4.2")))
+static uint64_t dot_u8_sse(const uint8_t* p, const uint8_t* q, size_t n) {
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    while (i + 8 <= n) {
+        __m128i lanes = _mm_setzero_si128();
+        for (size_t k = 0; k < DOT_U8_BLOCK && i + 8 <= n; k++, i += 8) {
+            __m128i a = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(p + i)));
+            __m128i b = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(q + i)));
+            lanes = _mm_add_epi32(lanes, _mm_madd_epi16(a, b));
+        }
+        acc = _mm_add_epi64(acc, _mm_cvtepu32_epi64(lanes));
+        acc = _mm_add_epi64(acc, _mm_cvtepu32_epi64(_mm_srli_si128(lanes, 8)));
+    }
+    return dot_u8_scalar(p + i, q + i, n - i, hsum_epi64_sse(acc));
+}
+
+__attribute__((target("avx2")))
+static uint64_t dot_u8_avx2(const uint8_t* p, const uint8_t* q, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    while (i + 16 <= n) {
+        __m256i lanes = _mm256_setzero_si256();
+        for (size_t k = 0; k < DOT_U8_BLOCK && i + 16 <= n; k++, i += 16) {
+            __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p + i)));
+            __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(q + i)));
+            lanes = _mm256_add_epi32(lanes, _mm256_madd_epi16(a, b));
+        }
+        acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(lanes)));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(lanes, 1)));
+    }
+    return dot_u8_scalar(p + i, q + i, n - i, hsum_epi64_avx2(acc));
+}
+
+// Fill: broadcast an 8-byte pattern (the element repeated) and store it
+
+__attribute__((target("sse4.2")))
+static void fill_bits_sse(void* dst, size_t bytes, uint64_t pattern) {
+    __m128i v = _mm_set1_epi64x((long long)pattern);
+    char* d = dst;
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16) _mm_storeu_si128((__m128i*)(d + i), v);
+    if (i < bytes) memcpy(d + i, &v, bytes - i);
+}
+
+__attribute__((target("avx2")))
+static void fill_bits_avx2(void* dst, size_t bytes, uint64_t pattern) {
+    __m256i v = _mm256_set1_epi64x((long long)pattern);
+    char* d = dst;
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32) _mm256_storeu_si256((__m256i*)(d + i), v);
+    if (i < bytes) memcpy(d + i, &v, bytes - i);
+}
+
+// Scale
+
+__attribute__((target("sse4.2")))
+static void scale_i32_sse(int* p, size_t n, int k) {
+    __m128i vk = _mm_set1_epi32(k);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i* d = (__m128i*)(p + i);
+        _mm_storeu_si128(d, _mm_mullo_epi32(_mm_loadu_si128(d), vk));
+    }
+    scale_i32_scalar(p + i, n - i, k);
+}
+
+__attribute__((target("avx2")))
+static void scale_i32_avx2(int* p, size_t n, int k) {
+    __m256i vk = _mm256_set1_epi32(k);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i* d = (__m256i*)(p + i);
+        _mm256_storeu_si256(d, _mm256_mullo_epi32(_mm256_loadu_si256(d), vk));
+    }
+    scale_i32_scalar(p + i, n - i, k);
+}
+
+__attribute__((target("sse4.2")))
+static void scale_f32_sse(float* p, size_t n, float k) {
+    __m128 vk = _mm_set1_ps(k);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm_storeu_ps(p + i, _mm_mul_ps(_mm_loadu_ps(p + i), vk));
+    scale_f32_scalar(p + i, n - i, k);
+}
+
+__attribute__((target("avx2")))
+static void scale_f32_avx2(float* p, size_t n, float k) {
+    __m256 vk = _mm256_set1_ps(k);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) _mm256_storeu_ps(p + i, _mm256_mul_ps(_mm256_loadu_ps(p + i), vk));
+    scale_f32_scalar(p + i, n - i, k);
+}
+
+__attribute__((target("sse4.2")))
+static void scale_f64_sse(double* p, size_t n, double k) {
+    __m128d vk = _mm_set1_pd(k);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(p + i, _mm_mul_pd(_mm_loadu_pd(p + i), vk));
+    scale_f64_scalar(p + i, n - i, k);
+}
+
+__attribute__((target("avx2")))
+static void scale_f64_avx2(double* p, size_t n, double k) {
+    __m256d vk = _mm256_set1_pd(k);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(p + i, _mm256_mul_pd(_mm256_loadu_pd(p + i), vk));
+    scale_f64_scalar(p + i, n - i, k);
+}
+
+// Add: integer lanes wrap the same way for any signedness
+
+#define ADD_KERNELS(sfx, T, add128, add256) \
+    __attribute__((target("sse4.2"))) \
+    static void add_##sfx##_sse(T* p, const T* q, size_t n) { \
+        size_t i = 0, step = 16 / sizeof(T); \
+        for (; i + step <= n; i += step) { \
+            __m128i* d = (__m128i*)(p + i); \
+            _mm_storeu_si128(d, add128(_mm_loadu_si128(d), _mm_loadu_si128((const __m128i*)(q + i)))); \
+        } \
+        add_##sfx##_scalar(p + i, q + i, n - i); \
+    } \
+    __attribute__((target("avx2"))) \
+    static void add_##sfx##_avx2(T* p, const T* q, size_t n) { \
+        size_t i = 0, step = 32 / sizeof(T); \
+        for (; i + step <= n; i += step) { \
+            __m256i* d = (__m256i*)(p + i); \
+            _mm256_storeu_si256(d, add256(_mm256_loadu_si256(d), _mm256_loadu_si256((const __m256i*)(q + i)))); \
+        } \
+        add_##sfx##_scalar(p + i, q + i, n - i); \
+    }
+
+ADD_KERNELS(i32, int, _mm_add_epi32, _mm256_add_epi32)
+ADD_KERNELS(i64, int64_t, _mm_add_epi64, _mm256_add_epi64)
+ADD_KERNELS(u8, uint8_t, _mm_add_epi8, _mm256_add_epi8)
+
+__attribute__((target("sse4.2")))
+static void add_f32_sse(float* p, const float* q, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm_storeu_ps(p + i, _mm_add_ps(_mm_loadu_ps(p + i), _mm_loadu_ps(q + i)));
+    add_f32_scalar(p + i, q + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void add_f32_avx2(float* p, const float* q, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) _mm256_storeu_ps(p + i, _mm256_add_ps(_mm256_loadu_ps(p + i), _mm256_loadu_ps(q + i)));
+    add_f32_scalar(p + i, q + i, n - i);
+}
+
+__attribute__((target("sse4.2")))
+static void add_f64_sse(double* p, const double* q, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(p + i, _mm_add_pd(_mm_loadu_pd(p + i), _mm_loadu_pd(q + i)));
+    add_f64_scalar(p + i, q + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void add_f64_avx2(double* p, const double* q, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(p + i, _mm256_add_pd(_mm256_loadu_pd(p + i), _mm256_loadu_pd(q + i)));
+    add_f64_scalar(p + i, q + i, n - i);
+}
+
+// Count and index_of: compare a vector against the broadcast value and take the lane
+// mask. Floats compare as floats (0.0 == -0.0, NaN matches nothing), like the scalar loop.
+
+#define EQ_KERNELS(sfx, T, target_, V, STEP, BROADCAST, MASK) \
+    __attribute__((target(target_))) \
+    static size_t count_##sfx##_##V(const T* p, size_t n, T v) { \
+        BROADCAST; \
+        size_t i = 0, c = 0; \
+        for (; i + STEP <= n; i += STEP) c += __builtin_popcount(MASK); \
+        return c + count_##sfx##_scalar(p + i, n - i, v); \
+    } \
+    __attribute__((target(target_))) \
+    static size_t index_##sfx##_##V(const T* p, size_t n, T v) { \
+        BROADCAST; \
+        size_t i = 0; \
+        for (; i + STEP <= n; i += STEP) { \
+            unsigned m = MASK; \
+            if (m) return i + __builtin_ctz(m); \
+        } \
+        return i + index_##sfx##_scalar(p + i, n - i, v); \
+    }
+
+EQ_KERNELS(i32, int, "sse4.2", sse, 4, __m128i vv = _mm_set1_epi32(v),
+           _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(p + i)), vv))))
+EQ_KERNELS(i32, int, "avx2", avx2, 8, __m256i vv = _mm256_set1_epi32(v),
+           _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(p + i)), vv))))
+EQ_KERNELS(i64, int64_t, "sse4.2", sse, 2, __m128i vv = _mm_set1_epi64x(v),
+           _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(_mm_loadu_si128((const __m128i*)(p + i)), vv))))
+EQ_KERNELS(i64, int64_t, "avx2", avx2, 4, __m256i vv = _mm256_set1_epi64x(v),
+           _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(p + i)), vv))))
+EQ_KERNELS(f32, float, "sse4.2", sse, 4, __m128 vv = _mm_set1_ps(v),
+           _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(p + i), vv)))
+EQ_KERNELS(f32, float, "avx2", avx2, 8, __m256 vv = _mm256_set1_ps(v),
+           _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(p + i), vv, _CMP_EQ_OQ)))
+EQ_KERNELS(f64, double, "sse4.2", sse, 2, __m128d vv = _mm_set1_pd(v),
+           _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(p + i), vv)))
+EQ_KERNELS(f64, double, "avx2", avx2, 4, __m256d vv = _mm256_set1_pd(v),
+           _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(p + i), vv, _CMP_EQ_OQ)))
+EQ_KERNELS(u8, uint8_t, "sse4.2", sse, 16, __m128i vv = _mm_set1_epi8((char)v),
+           (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + i)), vv)))
+EQ_KERNELS(u8, uint8_t, "avx2", avx2, 32, __m256i vv = _mm256_set1_epi8((char)v),
+           (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + i)), vv)))
+
+// Prefix sum: log-step scan inside a vector, then add the running total carried over
+// from the previous vector (broadcast of its last lane)
+
+__attribute__((target("sse4.2")))
+static void prefix_i32_sse(int* p, size_t n) {
+    __m128i carry = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i* d = (__m128i*)(p + i);
+        __m128i x = _mm_loadu_si128(d);
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi32(x, carry);
+        _mm_storeu_si128(d, x);
+        carry = _mm_shuffle_epi32(x, 0xFF);
+    }
+    prefix_i32_scalar(p + i, n - i, (uint32_t)_mm_cvtsi128_si32(carry));
+}
+
+__attribute__((target("avx2")))
+static void prefix_i32_avx2(int* p, size_t n) {
+    __m256i carry = _mm256_setzero_si256();
+    const __m256i last = _mm256_set1_epi32(7);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i* d = (__m256i*)(p + i);
+        __m256i x = _mm256_loadu_si256(d);
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4)); // Within each 128-bit half
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+        // Upper half += last lane of the lower half
+        __m256i low_total = _mm256_permute2x128_si256(_mm256_shuffle_epi32(x, 0xFF), x, 0x08);
+        x = _mm256_add_epi32(x, low_total);
+        x = _mm256_add_epi32(x, carry);
+        _mm256_storeu_si256(d, x);
+        carry = _mm256_permutevar8x32_epi32(x, last);
+    }
+    prefix_i32_scalar(p + i, n - i, (uint32_t)_mm256_cvtsi256_si32(carry));
+}
+
+#endif // COME_KERNELS_X86
+
+// Dispatch
+
+static int64_t sum_i32(const int* p, size_t n) {
+#ifdef COME_KERNELS_X86
+    int level = array_kernel_level();
+    if (level == 2) return sum_i32_avx2(p, n);
+    if (level == 1) return sum_i32_sse(p, n);
+#endif
+    return sum_i32_scalar(p, n, 0);
+}
+
+static int64_t sum_i64(const int64_t* p, size_t n) {
+#ifdef COME_KERNELS_X86
+    int level = array_kernel_level();
+    if (level == 2) return sum_i64_avx2(p, n);
+    if (level == 1) return sum_i64_sse(p, n);
+#endif
+    return sum_i64_scalar(p, n, 0);
+}
+
+static double sum_f32(const float* p, size_t n) {
+#ifdef COME_KERNELS_X86
+    int level = array_kernel_level();
+    if (level == 2) return sum_f32_avx2(p, n);
+    if (level == 1) return sum_f32_sse(p, n);
+#endif
+    return sum_f32_scalar(p, n, 0);
+}
+
+static double sum_f64(const double* p, size_t n) {
+#ifdef COME_KERNELS_X86
+    int level = array_kernel_level();
+    if (level == 2) return sum_f64_avx2(p, n);
+    if (level == 1) return sum_f64_sse(p, n);
+#endif
+    return sum_f64_scalar(p, n, 0);
+}
+
+static uint64_t sum_u8(const uint8_t* p, size_t n) {
+#ifdef COME_KERNELS_X86
+    int level = array_kernel_level();
+    if (level == 2) return sum_u8_avx2(p, n);
+    if (level == 1) return sum_u8_sse(p, n);
+#endif
+    return sum_u8_scalar(p, n, 0);
+}
+
+#ifdef COME_KERNELS_X86
+#define KERNEL_DISPATCH(call_avx2, call_sse, call_scalar) \
+    do { \
+        int level_ = array_kernel_level(); \
+        if (level_ == 2) { call_avx2; } \
+        else if (level_ == 1) { call_sse; } \
+        else { call_scalar; } \
+    } while (0)
+#else
+#define KERNEL_DISPATCH(call_avx2, call_sse, call_scalar) do { call_scalar; } while (0)
+#endif
+
+// Typed entry points. The read-only kernels take views; the array versions view the
+// whole array. min/max of an empty array is 0; dot and add stop at the shorter array;
+// index_of returns -1 when the value is absent.
+#define ARRAY_KERNELS(name, A, T, S, sfx) \
+    S name##_view_sum(name##_view_t a) { \
+        return (S)sum_##sfx(a.items, a.count); \
+    } \
+    T name##_view_min(name##_view_t a) { \
+        if (!a.count) return 0; \
+        T lo = a.items[0], hi = a.items[0]; \
+        KERNEL_DISPATCH(minmax_##sfx##_avx2(a.items, a.count, &lo, &hi), \
+                        minmax_##sfx##_sse(a.items, a.count, &lo, &hi), \
+                        minmax_##sfx##_scalar(a.items, a.count, &lo, &hi)); \
+        return lo; \
+    } \
+    T name##_view_max(name##_view_t a) { \
+        if (!a.count) return 0; \
+        T lo = a.items[0], hi = a.items[0]; \
+        KERNEL_DISPATCH(minmax_##sfx##_avx2(a.items, a.count, &lo, &hi), \
+                        minmax_##sfx##_sse(a.items, a.count, &lo, &hi), \
+                        minmax_##sfx##_scalar(a.items, a.count, &lo, &hi)); \
+        return hi; \
+    } \
+    uint32_t name##_view_count(name##_view_t a, T v) { \
+        size_t c; \
+        KERNEL_DISPATCH(c = count_##sfx##_avx2(a.items, a.count, v), \
+                        c = count_##sfx##_sse(a.items, a.count, v), \
+                        c = count_##sfx##_scalar(a.items, a.count, v)); \
+        return (uint32_t)c; \
+    } \
+    long name##_view_index_of(name##_view_t a, T v) { \
+        size_t i; \
+        KERNEL_DISPATCH(i = index_##sfx##_avx2(a.items, a.count, v), \
+                        i = index_##sfx##_sse(a.items, a.count, v), \
+                        i = index_##sfx##_scalar(a.items, a.count, v)); \
+        return i < a.count ? (long)i : -1; \
+    } \
+    S name##_sum(const A* a) { return name##_view_sum(name##_view(a, 0, UINT32_MAX)); } \
+    T name##_min(const A* a) { return name##_view_min(name##_view(a, 0, UINT32_MAX)); } \
+    T name##_max(const A* a) { return name##_view_max(name##_view(a, 0, UINT32_MAX)); } \
+    S name##_dot(const A* a, const A* b) { \
+        return name##_view_dot(name##_view(a, 0, UINT32_MAX), name##_view(b, 0, UINT32_MAX)); \
+    } \
+    uint32_t name##_count(const A* a, T v) { return name##_view_count(name##_view(a, 0, UINT32_MAX), v); } \
+    long name##_index_of(const A* a, T v) { return name##_view_index_of(name##_view(a, 0, UINT32_MAX), v); } \
+    void name##_add(A* a, const A* b) { \
+        if (!a || !b) return; \
+        size_t n = a->count < b->count ? a->count : b->count; \
+        KERNEL_DISPATCH(add_##sfx##_avx2(a->items, b->items, n), \
+                        add_##sfx##_sse(a->items, b->items, n), \
+                        add_##sfx##_scalar(a->items, b->items, n)); \
+    }
+
+ARRAY_KERNELS(come_int_array, come_int_array_t, int, int64_t, i32)
+ARRAY_KERNELS(come_long_array, come_long_array_t, int64_t, int64_t, i64)
+ARRAY_KERNELS(come_float_array, come_float_array_t, float, double, f32)
+ARRAY_KERNELS(come_double_array, come_double_array_t, double, double, f64)
+ARRAY_KERNELS(come_byte_array, come_byte_array_t, uint8_t, uint64_t, u8)
+
+// dot: no 64-bit multiply below AVX-512, so long stays scalar
+
+int64_t come_int_array_view_dot(come_int_array_view_t a, come_int_array_view_t b) {
+    size_t n = a.count < b.count ? a.count : b.count;
+    int64_t s;
+    KERNEL_DISPATCH(s = dot_i32_avx2(a.items, b.items, n),
+                    s = dot_i32_sse(a.items, b.items, n),
+                    s = dot_i32_scalar(a.items, b.items, n, 0));
+    return s;
+}
+
+int64_t come_long_array_view_dot(come_long_array_view_t a, come_long_array_view_t b) {
+    return dot_i64_scalar(a.items, b.items, a.count < b.count ? a.count : b.count, 0);
+}
+
+double come_float_array_view_dot(come_float_array_view_t a, come_float_array_view_t b) {
+    size_t n = a.count < b.count ? a.count : b.count;
+    double s;
+    KERNEL_DISPATCH(s = dot_f32_avx2(a.items, b.items, n),
+                    s = dot_f32_sse(a.items, b.items, n),
+                    s = dot_f32_scalar(a.items, b.items, n, 0));
+    return s;
+}
+
+double come_double_array_view_dot(come_double_array_view_t a, come_double_array_view_t b) {
+    size_t n = a.count < b.count ? a.count : b.count;
+    double s;
+    KERNEL_DISPATCH(s = dot_f64_avx2(a.items, b.items, n),
+                    s = dot_f64_sse(a.items, b.items, n),
+                    s = dot_f64_scalar(a.items, b.items, n, 0));
+    return s;
+}
+
+uint64_t come_byte_array_view_dot(come_byte_array_view_t a, come_byte_array_view_t b) {
+    size_t n = a.count < b.count ? a.count : b.count;
+    uint64_t s;
+    KERNEL_DISPATCH(s = dot_u8_avx2(a.items, b.items, n),
+                    s = dot_u8_sse(a.items, b.items, n),
+                    s = dot_u8_scalar(a.items, b.items, n, 0));
+    return s;
+}
+
+// fill
+
+static inline uint64_t fill_pattern32(const void* v) {
+    uint32_t bits;
+    memcpy(&bits, v, 4);
+    return (uint64_t)bits << 32 | bits;
+}
+
+static inline uint64_t fill_pattern64(const void* v) {
+    uint64_t bits;
+    memcpy(&bits, v, 8);
+    return bits;
+}
+
+void come_int_array_fill(come_int_array_t* a, int v) {
+    if (!a) return;
+    KERNEL_DISPATCH(fill_bits_avx2(a->items, a->count * sizeof(int), fill_pattern32(&v)),
+                    fill_bits_sse(a->items, a->count * sizeof(int), fill_pattern32(&v)),
+                    fill_i32_scalar(a->items, a->count, v));
+}
+
+void come_long_array_fill(come_long_array_t* a, int64_t v) {
+    if (!a) return;
+    KERNEL_DISPATCH(fill_bits_avx2(a->items, a->count * sizeof(int64_t), fill_pattern64(&v)),
+                    fill_bits_sse(a->items, a->count * sizeof(int64_t), fill_pattern64(&v)),
+                    fill_i64_scalar(a->items, a->count, v));
+}
+
+void come_float_array_fill(come_float_array_t* a, float v) {
+    if (!a) return;
+    KERNEL_DISPATCH(fill_bits_avx2(a->items, a->count * sizeof(float), fill_pattern32(&v)),
+                    fill_bits_sse(a->items, a->count * sizeof(float), fill_pattern32(&v)),
+                    fill_f32_scalar(a->items, a->count, v));
+}
+
+void come_double_array_fill(come_double_array_t* a, double v) {
+    if (!a) return;
+    KERNEL_DISPATCH(fill_bits_avx2(a->items, a->count * sizeof(double), fill_pattern64(&v)),
+                    fill_bits_sse(a->items, a->count * sizeof(double), fill_pattern64(&v)),
+                    fill_f64_scalar(a->items, a->count, v));
+}
+
+void come_byte_array_fill(come_byte_array_t* a, uint8_t v) {
+    if (a) memset(a->items, v, a->count);
+}
+
+// scale: long and byte multiplies have no vector form worth having here
+
+void come_int_array_scale(come_int_array_t* a, int k) {
+    if (!a) return;
+    KERNEL_DISPATCH(scale_i32_avx2(a->items, a->count, k),
+                    scale_i32_sse(a->items, a->count, k),
+                    scale_i32_scalar(a->items, a->count, k));
+}
+
+void come_long_array_scale(come_long_array_t* a, int64_t k) {
+    if (a) scale_i64_scalar(a->items, a->count, k);
+}
+
+void come_float_array_scale(come_float_array_t* a, float k) {
+    if (!a) return;
+    KERNEL_DISPATCH(scale_f32_avx2(a->items, a->count, k),
+                    scale_f32_sse(a->items, a->count, k),
+                    scale_f32_scalar(a->items, a->count, k));
+}
+
+void come_double_array_scale(come_double_array_t* a, double k) {
+    if (!a) return;
+    KERNEL_DISPATCH(scale_f64_avx2(a->items, a->count, k),
+                    scale_f64_sse(a->items, a->count, k),
+                    scale_f64_scalar(a->items, a->count, k));
+}
+
+void come_byte_array_scale(come_byte_array_t* a, uint8_t k) {
+    if (a) scale_u8_scalar(a->items, a->count, k);
+}
+
+// prefix_sum: in place, inclusive. Only the int scan is vectorised; a float scan would
+// change the rounding of every element, and the others are dependency bound anyway.
+
+void come_int_array_prefix_sum(come_int_array_t* a) {
+    if (!a) return;
+    KERNEL_DISPATCH(prefix_i32_avx2(a->items, a->count),
+                    prefix_i32_sse(a->items, a->count),
+                    prefix_i32_scalar(a->items, a->count, 0));
+}
+
+void come_long_array_prefix_sum(come_long_array_t* a) {
+    if (a) prefix_i64_scalar(a->items, a->count, 0);
+}
+
+void come_float_array_prefix_sum(come_float_array_t* a) {
+    if (a) prefix_f32_scalar(a->items, a->count, 0);
+}
+
+void come_double_array_prefix_sum(come_double_array_t* a) {
+    if (a) prefix_f64_scalar(a->items, a->count, 0);
+}
+
+void come_byte_array_prefix_sum(come_byte_array_t* a) {
+    if (a) prefix_u8_scalar(a->items, a->count, 0);
+}
@@ -0,0 +1,444 @@
+#include <string.h>
+#include <errno.h>
+#include "come_array.h"
+#include "come_string.h"
+#include "mem/talloc.h"
+
+// Sorting
+// Comparison sorts are pdqsort (sort_template.h). Numeric arrays past RADIX_MIN elements
+// are LSD radix sorted instead: 8-bit digits, all histograms counted in one pass, digits
+// that are the same for every element skipped. Keys are mapped to unsigned integers that
+// order the same way (sign bit flipped for signed types, IEEE total order for floats), so
+// -NaN < -inf < -0.0 < 0.0 < inf < NaN. Byte arrays are counting sorted.
+//
+// String lists sort bytewise. Each string is keyed by its first 8 bytes as a big-endian
+// integer, so most comparisons are a single integer compare and never touch the string.
+
+// Below this many elements pdqsort beats radix sort's fixed passes
+#define RADIX_MIN 256
+
+// Order-preserving unsigned keys
+static inline uint32_t key_i32(int v) { return (uint32_t)v ^ 0x80000000u; }
+static inline int unkey_i32(uint32_t k) { return (int)(k ^ 0x80000000u); }
+static inline uint64_t key_i64(int64_t v) { return (uint64_t)v ^ 0x8000000000000000ull; }
+static inline int64_t unkey_i64(uint64_t k) { return (int64_t)(k ^ 0x8000000000000000ull); }
+
+static inline uint32_t key_f32(float v) {
+    uint32_t u;
+    memcpy(&u, &v, sizeof(u));
+    return (u & 0x80000000u) ? ~u : u | 0x80000000u;
+}
+static inline float unkey_f32(uint32_t k) {
+    uint32_t u = (k & 0x80000000u) ? k & 0x7fffffffu : ~k;
+    float v;
+    memcpy(&v, &u, sizeof(v));
+    return v;
+}
+static inline uint64_t key_f64(double v) {
+    uint64_t u;
+    memcpy(&u, &v, sizeof(u));
+    return (u & 0x8000000000000000ull) ? ~u : u | 0x8000000000000000ull;
+}
+static inline double unkey_f64(uint64_t k) {
+    uint64_t u = (k & 0x8000000000000000ull) ? k & 0x7fffffffffffffffull : ~k;
+    double v;
+    memcpy(&v, &u, sizeof(v));
+    return v;
+}
+
+#define SORT_T int
+#define SORT_SFX i32
+#define SORT_LESS(x, y) ((x) < (y))
+#include "sort_template.h"
+
+#define SORT_T int64_t
+#define SORT_SFX i64
+#define SORT_LESS(x, y) ((x) < (y))
+#include "sort_template.h"
+
+#define SORT_T float
+#define SORT_SFX f32
+#define SORT_LESS(x, y) (key_f32(x) < key_f32(y))
+#include "sort_template.h"
+
+#define SORT_T double
+#define SORT_SFX f64
+#define SORT_LESS(x, y) (key_f64(x) < key_f64(y))
+#include "sort_template.h"
+
+#define SORT_T uint8_t
+#define SORT_SFX u8
+#define SORT_LESS(x, y) ((x) < (y))
+#include "sort_template.h"
+
+#define SORT_T uint32_t
+#define SORT_SFX u32
+#define SORT_LESS(x, y) ((x) < (y))
+#include "sort_template.h"
+
+#define SORT_T uint64_t
+#define SORT_SFX u64
+#define SORT_LESS(x, y) ((x) < (y))
+#include "sort_template.h"
+
+// String keys
+typedef struct {
+    uint64_t prefix; // First 8 bytes, big-endian, zero-padded
+    come_string_t* s;
+} string_key;
+
+static inline uint64_t string_prefix(const come_string_t* s) {
+    uint64_t p = 0;
+    uint32_t n = s ? (s->count < 8 ? s->count : 8) : 0;
+    for (uint32_t i = 0; i < 8; i++) {
+        p = (p << 8) | (i < n ? (uint8_t)s->data[i] : 0);
+    }
+    return p;
+}
+
+static inline int string_key_cmp(const string_key* a, const string_key* b) {
+    if (a->prefix != b->prefix) return a->prefix < b->prefix ? -1 : 1;
+    uint32_t la = a->s ? a->s->count : 0;
+    uint32_t lb = b->s ? b->s->count : 0;
+    uint32_t min = la < lb ? la : lb;
+    // Equal prefixes: a string of at most 8 bytes is a prefix of the other
+    if (min > 8) {
+        int c = memcmp(a->s->data + 8, b->s->data + 8, min - 8);
+        if (c) return c;
+    }
+    return (la > lb) - (la < lb);
+}
+
+#define SORT_T string_key
+#define SORT_SFX skey
+#define SORT_LESS(x, y) ((x).prefix < (y).prefix || ((x).prefix == (y).prefix && string_key_cmp(&(x), &(y)) < 0))
+#include "sort_template.h"
+
+static inline int string_cmp(const come_string_t* a, const come_string_t* b) {
+    string_key ka = { string_prefix(a), (come_string_t*)a };
+    string_key kb = { string_prefix(b), (come_string_t*)b };
+    return string_key_cmp(&ka, &kb);
+}
+
+// Uncached fallback when the key array cannot be allocated
+#define SORT_T come_string_t*
+#define SORT_SFX str
+#define SORT_LESS(x, y) (string_cmp((x), (y)) < 0)
+#include "sort_template.h"
+
+// User comparators; ctx points to the comparator. Elements of 4, 8 and 16 bytes are
+// sorted by value, anything else through pointers to the elements.
+#define USER_LESS(x, y) ((*(const come_array_cmp_t*)ctx)(&(x), &(y)) < 0)
+
+typedef struct { char b[4]; } elem4;
+typedef struct { char b[8]; } elem8;
+typedef struct { char b[16]; } elem16;
+
+#define SORT_T elem4
+#define SORT_SFX e4
+#define SORT_LESS USER_LESS
+#include "sort_template.h"
+
+#define SORT_T elem8
+#define SORT_SFX e8
+#define SORT_LESS USER_LESS
+#include "sort_template.h"
+
+#define SORT_T elem16
+#define SORT_SFX e16
+#define SORT_LESS USER_LESS
+#include "sort_template.h"
+
+#define SORT_T char*
+#define SORT_SFX ptr
+#define SORT_LESS(x, y) ((*(const come_array_cmp_t*)ctx)((x), (y)) < 0)
+#include "sort_template.h"
+
+// LSD radix sort of unsigned keys; tmp holds n keys. Returns the buffer holding the result.
+#define RADIX_SORT(sfx, K) \
+    static K* radix_##sfx(K* a, K* tmp, size_t n) { \
+        enum { DIGITS = sizeof(K) }; \
+        size_t counts[DIGITS][256]; \
+        memset(counts, 0, sizeof(counts)); \
+        for (size_t i = 0; i < n; i++) { \
+            K k = a[i]; \
+            for (int d = 0; d < DIGITS; d++) counts[d][(k >> (8 * d)) & 0xff]++; \
+        } \
+        K* src = a; \
+        K* dst = tmp; \
+        for (int d = 0; d < DIGITS; d++) { \
+            size_t* c = counts[d]; \
+            if (c[(src[0] >> (8 * d)) & 0xff] == n) continue; /* Same digit everywhere */ \
+            size_t sum = 0; \
+            for (int b = 0; b < 256; b++) { \
+                size_t t = c[b]; \
+                c[b] = sum; \
+                sum += t; \
+            } \
+            for (size_t i = 0; i < n; i++) { \
+                K k = src[i]; \
+                dst[c[(k >> (8 * d)) & 0xff]++] = k; \
+            } \
+            K* t = src; \
+            src = dst; \
+            dst = t; \
+        } \
+        return src; \
+    }
+
+RADIX_SORT(u32, uint32_t)
+RADIX_SORT(u64, uint64_t)
+
+// Sorts the n keys at keys (which alias the items), radix sorted when large enough
+#define KEY_SORT(sfx, K) \
+    static void key_sort_##sfx(K* keys, size_t n) { \
+        if (n >= RADIX_MIN) { \
+            K* tmp = mem_talloc_alloc(NULL, n * sizeof(K)); \
+            if (tmp) { \
+                K* out = radix_##sfx(keys, tmp, n); \
+                if (out != keys) memcpy(keys, out, n * sizeof(K)); \
+                mem_talloc_free(tmp); \
+                return; \
+            } \
+        } \
+        pdqsort_##sfx(keys, n, NULL); \
+    }
+
+KEY_SORT(u32, uint32_t)
+KEY_SORT(u64, uint64_t)
+
+// Already ascending, or strictly descending and reversed here: radix sort would still
+// make every pass. Random input stops at its first few elements.
+#define SORTED_RUN(sfx, T, LESS) \
+    static bool sorted_run_##sfx(T* a, size_t n) { \
+        size_t i = 1; \
+        while (i < n && !LESS(a[i], a[i - 1])) i++; \
+        if (i == n) return true; \
+        if (i > 1) return false; \
+        while (i < n && LESS(a[i], a[i - 1])) i++; \
+        if (i < n) return false; \
+        for (size_t lo = 0, hi = n - 1; lo < hi; lo++, hi--) swap_##sfx(a + lo, a + hi); \
+        return true; \
+    }
+
+// Keys are written over the items they replace
+typedef uint32_t __attribute__((may_alias)) alias_u32;
+typedef uint64_t __attribute__((may_alias)) alias_u64;
+
+// Typed sort, partial_sort, binary_search and unique. K is the key type, key/unkey map
+// elements to and from keys, LESS orders elements consistently with their keys.
+#define ARRAY_SORTING(name, A, T, sfx, K, ksfx, key, unkey, LESS) \
+    void name##_sort(A* a) { \
+        if (!a || a->count < 2) return; \
+        size_t n = a->count; \
+        if (n < RADIX_MIN) { \
+            pdqsort_##sfx(a->items, n, NULL); \
+            return; \
+        } \
+        if (sorted_run_##sfx(a->items, n)) return; \
+        K* keys = (K*)a->items; \
+        for (size_t i = 0; i < n; i++) keys[i] = key(a->items[i]); \
+        key_sort_##ksfx((void*)keys, n); \
+        for (size_t i = 0; i < n; i++) a->items[i] = unkey(keys[i]); \
+    } \
+    void name##_partial_sort(A* a, uint32_t k) { \
+        if (!a || a->count < 2 || k == 0) return; \
+        if (k >= a->count) { \
+            name##_sort(a); \
+            return; \
+        } \
+        select_##sfx(a->items, a->count, k - 1, NULL); \
+        pdqsort_##sfx(a->items, k - 1, NULL); \
+    } \
+    long name##_view_binary_search(name##_view_t a, T v) { \
+        size_t lo = 0, hi = a.count; \
+        while (lo < hi) { \
+            size_t mid = lo + (hi - lo) / 2; \
+            if (LESS(a.items[mid], v)) lo = mid + 1; \
+            else hi = mid; \
+        } \
+        return lo < a.count && !LESS(v, a.items[lo]) ? (long)lo : -1; \
+    } \
+    long name##_binary_search(const A* a, T v) { \
+        return name##_view_binary_search(name##_view(a, 0, UINT32_MAX), v); \
+    } \
+    uint32_t name##_unique(A* a) { \
+        if (!a || a->count < 2) return a ? a->count : 0; \
+        uint32_t out = 1; \
+        for (uint32_t i = 1; i < a->count; i++) { \
+            if (LESS(a->items[out - 1], a->items[i]) || LESS(a->items[i], a->items[out - 1])) { \
+                a->items[out++] = a->items[i]; \
+            } \
+        } \
+        a->count = out; \
+        return out; \
+    }
+
+#define NUM_LESS(x, y) ((x) < (y))
+#define F32_LESS(x, y) (key_f32(x) < key_f32(y))
+#define F64_LESS(x, y) (key_f64(x) < key_f64(y))
+
+SORTED_RUN(i32, int, NUM_LESS)
+SORTED_RUN(i64, int64_t, NUM_LESS)
+SORTED_RUN(f32, float, F32_LESS)
+SORTED_RUN(f64, double, F64_LESS)
+
+ARRAY_SORTING(come_int_array, come_int_array_t, int, i32, alias_u32, u32, key_i32, unkey_i32, NUM_LESS)
+ARRAY_SORTING(come_long_array, come_long_array_t, int64_t, i64, alias_u64, u64, key_i64, unkey_i64, NUM_LESS)
+ARRAY_SORTING(come_float_array, come_float_array_t, float, f32, alias_u32, u32, key_f32, unkey_f32, F32_LESS)
+ARRAY_SORTING(come_double_array, come_double_array_t, double, f64, alias_u64, u64, key_f64, unkey_f64, F64_LESS)
+
+// Bytes: counting sort
+
+void come_byte_array_sort(come_byte_array_t* a) {
+    if (!a || a->count < 2) return;
+    if (a->count < 64) {
+        pdqsort_u8(a->items, a->count, NULL);
+        return;
+    }
+    size_t counts[256] = {0};
+    for (uint32_t i = 0; i < a->count; i++) counts[a->items[i]]++;
+    uint8_t* p = a->items;
+    for (int b = 0; b < 256; b++) {
+        memset(p, b, counts[b]);
+        p += counts[b];
+    }
+}
+
+void come_byte_array_partial_sort(come_byte_array_t* a, uint32_t k) {
+    if (!a || a->count < 2 || k == 0) return;
+    if (k >= a->count / 4) { // Counting sort of everything is cheaper than selecting
+        come_byte_array_sort(a);
+        return;
+    }
+    select_u8(a->items, a->count, k - 1, NULL);
+    pdqsort_u8(a->items, k - 1, NULL);
+}
+
+long come_byte_array_view_binary_search(come_byte_array_view_t a, uint8_t v) {
+    size_t lo = 0, hi = a.count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (a.items[mid] < v) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < a.count && a.items[lo] == v ? (long)lo : -1;
+}
+
+long come_byte_array_binary_search(const come_byte_array_t* a, uint8_t v) {
+    return come_byte_array_view_binary_search(come_byte_array_view(a, 0, UINT32_MAX), v);
+}
+
+uint32_t come_byte_array_unique(come_byte_array_t* a) {
+    if (!a || a->count < 2) return a ? a->count : 0;
+    uint32_t out = 1;
+    for (uint32_t i = 1; i < a->count; i++) {
+        if (a->items[i] != a->items[out - 1]) a->items[out++] = a->items[i];
+    }
+    a->count = out;
+    return out;
+}
+
+// Strings
+void come_string_list_sort(come_string_list_t* a) {
+    if (!a || a->count < 2) return;
+    size_t n = a->count;
+    string_key* keys = mem_talloc_alloc(NULL, n * sizeof(string_key));
+    if (!keys) {
+        pdqsort_str(a->items, n, NULL);
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        keys[i].prefix = string_prefix(a->items[i]);
+        keys[i].s = a->items[i];
+    }
+    pdqsort_skey(keys, n, NULL);
+    for (size_t i = 0; i < n; i++) a->items[i] = keys[i].s;
+    mem_talloc_free(keys);
+}
+
+void come_string_list_partial_sort(come_string_list_t* a, uint32_t k) {
+    if (!a || a->count < 2 || k == 0) return;
+    if (k >= a->count) {
+        come_string_list_sort(a);
+        return;
+    }
+    select_str(a->items, a->count, k - 1, NULL);
+    pdqsort_str(a->items, k - 1, NULL);
+}
+
+long come_string_list_view_binary_search(come_string_list_view_t a, come_string_t* v) {
+    size_t lo = 0, hi = a.count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (string_cmp(a.items[mid], v) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < a.count && string_cmp(a.items[lo], v) == 0 ? (long)lo : -1;
+}
+
+long come_string_list_binary_search(const come_string_list_t* a, come_string_t* v) {
+    return come_string_list_view_binary_search(come_string_list_view(a, 0, UINT32_MAX), v);
+}
+
+uint32_t come_string_list_unique(come_string_list_t* a) {
+    if (!a || a->count < 2) return a ? a->count : 0;
+    uint32_t out = 1;
+    for (uint32_t i = 1; i < a->count; i++) {
+        if (string_cmp(a->items[i], a->items[out - 1]) != 0) a->items[out++] = a->items[i];
+    }
+    a->count = out;
+    return out;
+}
+
+// Any element type, ordered by cmp
+#define SORT_BY_VALUE(sfx, E) \
+    static int sort_by_##sfx(E* items, uint32_t n, come_array_cmp_t cmp, bool stable) { \
+        if (!stable) { \
+            pdqsort_##sfx(items, n, &cmp); \
+            return 0; \
+        } \
+        E* tmp = mem_talloc_alloc(NULL, ((size_t)n / 2 + 1) * sizeof(E)); \
+        if (!tmp) return -1; \
+        merge_sort_##sfx(items, tmp, n, &cmp); \
+        mem_talloc_free(tmp); \
+        return 0; \
+    }
+
+SORT_BY_VALUE(e4, elem4)
+SORT_BY_VALUE(e8, elem8)
+SORT_BY_VALUE(e16, elem16)
+
+// Larger elements: sorts pointers to them, then moves each element once into its place
+static int sort_by_pointer(void* items, uint32_t n, size_t elem_size, come_array_cmp_t cmp, bool stable) {
+    char** ptrs = mem_talloc_alloc(NULL, (size_t)n * sizeof(char*) + (size_t)n * elem_size);
+    char** tmp = stable ? mem_talloc_alloc(NULL, ((size_t)n / 2 + 1) * sizeof(char*)) : NULL;
+    if (!ptrs || (stable && !tmp)) {
+        mem_talloc_free(ptrs);
+        mem_talloc_free(tmp);
+        return -1;
+    }
+    for (uint32_t i = 0; i < n; i++) ptrs[i] = (char*)items + (size_t)i * elem_size;
+    if (stable) merge_sort_ptr(ptrs, tmp, n, &cmp);
+    else pdqsort_ptr(ptrs, n, &cmp);
+
+    char* sorted = (char*)(ptrs + n);
+    for (uint32_t i = 0; i < n; i++) memcpy(sorted + (size_t)i * elem_size, ptrs[i], elem_size);
+    memcpy(items, sorted, (size_t)n * elem_size);
+    mem_talloc_free(tmp);
+    mem_talloc_free(ptrs);
+    return 0;
+}
+
+int come_array_sort_items(void* items, uint32_t n, size_t elem_size, come_array_cmp_t cmp, bool stable) {
+    if (n < 2) return 0;
+    int rc;
+    switch (elem_size) {
+    case 4: rc = sort_by_e4(items, n, cmp, stable); break;
+    case 8: rc = sort_by_e8(items, n, cmp, stable); break;
+    case 16: rc = sort_by_e16(items, n, cmp, stable); break;
+    default: rc = sort_by_pointer(items, n, elem_size, cmp, stable); break;
+    }
+    if (rc < 0) errno = ENOMEM;
+    return rc;
+}
@@ -0,0 +1,311 @@
+// Comparison sorts over SORT_T, instantiated once per element type by sort.c:
+//
+//     #define SORT_T int
+//     #define SORT_SFX i32
+//     #define SORT_LESS(x, y) ((x) < (y))
+//     #include "sort_template.h"
+//
+// SORT_LESS may use ctx, the opaque argument every function passes along, and may
+// evaluate its arguments more than once (they never have side effects). Defines
+// pdqsort_<sfx> (unstable, O(n log n) worst case), select_<sfx> (nth element) and
+// merge_sort_<sfx> (stable); the macros are undefined at the end.
+//
+// pdqsort is Orson Peters' pattern-defeating quicksort: median-of-3 (ninther for large
+// ranges) pivots, a partition that reports whether the range was already partitioned so
+// sorted runs finish with a bounded insertion sort, equal-key partitioning when the pivot
+// equals its predecessor, element shuffles after unbalanced partitions and a heapsort
+// fallback once too many partitions were bad.
+
+#define SORT_CAT2(a, b) a##_##b
+#define SORT_CAT(a, b) SORT_CAT2(a, b)
+#define SORT_FN(name) SORT_CAT(name, SORT_SFX)
+
+#ifndef SORT_TEMPLATE_CONSTANTS
+#define SORT_TEMPLATE_CONSTANTS
+#define PDQ_INSERTION_SORT 24  // Ranges below this are insertion sorted
+#define PDQ_NINTHER 128        // Ranges above this use the ninther as pivot
+#define PDQ_PARTIAL_LIMIT 8    // Moves allowed when finishing a sorted-looking range
+#define MERGE_RUN 16           // Merge sort insertion sorts runs of this size
+
+static inline int sort_log2(size_t n) {
+    int log = 0;
+    while (n >>= 1) log++;
+    return log;
+}
+#endif
+
+static inline void SORT_FN(swap)(SORT_T* a, SORT_T* b) {
+    SORT_T t = *a;
+    *a = *b;
+    *b = t;
+}
+
+static inline void SORT_FN(sort2)(SORT_T* a, SORT_T* b, const void* ctx) {
+    if (SORT_LESS(*b, *a)) SORT_FN(swap)(a, b);
+}
+
+static inline void SORT_FN(sort3)(SORT_T* a, SORT_T* b, SORT_T* c, const void* ctx) {
+    SORT_FN(sort2)(a, b, ctx);
+    SORT_FN(sort2)(b, c, ctx);
+    SORT_FN(sort2)(a, b, ctx);
+}
+
+// Stable: an element only moves past strictly greater ones
+static void SORT_FN(insertion_sort)(SORT_T* begin, SORT_T* end, const void* ctx) {
+    if (begin == end) return;
+    for (SORT_T* cur = begin + 1; cur != end; cur++) {
+        SORT_T* sift = cur;
+        SORT_T* sift_1 = cur - 1;
+        if (SORT_LESS(*sift, *sift_1)) {
+            SORT_T tmp = *sift;
+            do {
+                *sift-- = *sift_1;
+            } while (sift != begin && (--sift_1, SORT_LESS(tmp, *sift_1)));
+            *sift = tmp;
+        }
+    }
+}
+
+// As above, for a range whose predecessor is no greater than any of its elements
+static void SORT_FN(unguarded_insertion_sort)(SORT_T* begin, SORT_T* end, const void* ctx) {
+    if (begin == end) return;
+    for (SORT_T* cur = begin + 1; cur != end; cur++) {
+        SORT_T* sift = cur;
+        SORT_T* sift_1 = cur - 1;
+        if (SORT_LESS(*sift, *sift_1)) {
+            SORT_T tmp = *sift;
+            do {
+                *sift-- = *sift_1;
+            } while ((--sift_1, SORT_LESS(tmp, *sift_1)));
+            *sift = tmp;
+        }
+    }
+}
+
+// Insertion sort that gives up (false) after PDQ_PARTIAL_LIMIT element moves
+static bool SORT_FN(partial_insertion_sort)(SORT_T* begin, SORT_T* end, const void* ctx) {
+    if (begin == end) return true;
+    size_t moves = 0;
+    for (SORT_T* cur = begin + 1; cur != end; cur++) {
+        SORT_T* sift = cur;
+        SORT_T* sift_1 = cur - 1;
+        if (SORT_LESS(*sift, *sift_1)) {
+            SORT_T tmp = *sift;
+            do {
+                *sift-- = *sift_1;
+            } while (sift != begin && (--sift_1, SORT_LESS(tmp, *sift_1)));
+            *sift = tmp;
+            moves += (size_t)(cur - sift);
+        }
+        if (moves > PDQ_PARTIAL_LIMIT) return false;
+    }
+    return true;
+}
+
+static void SORT_FN(sift_down)(SORT_T* a, size_t i, size_t n, const void* ctx) {
+    SORT_T v = a[i];
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= n) break;
+        if (child + 1 < n && SORT_LESS(a[child], a[child + 1])) child++;
+        if (!SORT_LESS(v, a[child])) break;
+        a[i] = a[child];
+        i = child;
+    }
+    a[i] = v;
+}
+
+static void SORT_FN(heapsort)(SORT_T* begin, SORT_T* end, const void* ctx) {
+    size_t n = (size_t)(end - begin);
+    for (size_t i = n / 2; i-- > 0;) SORT_FN(sift_down)(begin, i, n, ctx);
+    for (size_t i = n; i-- > 1;) {
+        SORT_FN(swap)(begin, begin + i);
+        SORT_FN(sift_down)(begin, 0, i, ctx);
+    }
+}
+
+// Partitions around the pivot *begin, equal elements to the right. Requires an element
+// no less than the pivot after it (the median-of-3 leaves one at end - 1). Returns the
+// pivot's final position; *already is set if no elements had to be swapped.
+static SORT_T* SORT_FN(partition_right)(SORT_T* begin, SORT_T* end, bool* already, const void* ctx) {
+    SORT_T pivot = *begin;
+    SORT_T* first = begin;
+    SORT_T* last = end;
+
+    while ((++first, SORT_LESS(*first, pivot)));
+    if (first - 1 == begin) {
+        while (first < last && !(--last, SORT_LESS(*last, pivot)));
+    } else {
+        while (!(--last, SORT_LESS(*last, pivot)));
+    }
+
+    *already = first >= last;
+    while (first < last) {
+        SORT_FN(swap)(first, last);
+        while ((++first, SORT_LESS(*first, pivot)));
+        while (!(--last, SORT_LESS(*last, pivot)));
+    }
+
+    SORT_T* pivot_pos = first - 1;
+    *begin = *pivot_pos;
+    *pivot_pos = pivot;
+    return pivot_pos;
+}
+
+// Partitions around *begin with equal elements to the left; used when the pivot equals
+// the element before the range, so everything equal to it is already in place
+static SORT_T* SORT_FN(partition_left)(SORT_T* begin, SORT_T* end, const void* ctx) {
+    SORT_T pivot = *begin;
+    SORT_T* first = begin;
+    SORT_T* last = end;
+
+    while ((--last, SORT_LESS(pivot, *last)));
+    if (last + 1 == end) {
+        while (first < last && !(++first, SORT_LESS(pivot, *first)));
+    } else {
+        while (!(++first, SORT_LESS(pivot, *first)));
+    }
+
+    while (first < last) {
+        SORT_FN(swap)(first, last);
+        while ((--last, SORT_LESS(pivot, *last)));
+        while (!(++first, SORT_LESS(pivot, *first)));
+    }
+
+    SORT_T* pivot_pos = last;
+    *begin = *pivot_pos;
+    *pivot_pos = pivot;
+    return pivot_pos;
+}
+
+// Moves the median of begin, middle and end - 1 (ninther for large ranges) to *begin
+static void SORT_FN(choose_pivot)(SORT_T* begin, SORT_T* end, const void* ctx) {
+    size_t size = (size_t)(end - begin);
+    size_t s2 = size / 2;
+    if (size > PDQ_NINTHER) {
+        SORT_FN(sort3)(begin, begin + s2, end - 1, ctx);
+        SORT_FN(sort3)(begin + 1, begin + (s2 - 1), end - 2, ctx);
+        SORT_FN(sort3)(begin + 2, begin + (s2 + 1), end - 3, ctx);
+        SORT_FN(sort3)(begin + (s2 - 1), begin + s2, begin + (s2 + 1), ctx);
+        SORT_FN(swap)(begin, begin + s2);
+    } else {
+        SORT_FN(sort3)(begin + s2, begin, end - 1, ctx);
+    }
+}
+
+static void SORT_FN(pdq_loop)(SORT_T* begin, SORT_T* end, int bad_allowed, bool leftmost, const void* ctx) {
+    for (;;) {
+        size_t size = (size_t)(end - begin);
+        if (size < PDQ_INSERTION_SORT) {
+            if (leftmost) SORT_FN(insertion_sort)(begin, end, ctx);
+            else SORT_FN(unguarded_insertion_sort)(begin, end, ctx);
+            return;
+        }
+
+        SORT_FN(choose_pivot)(begin, end, ctx);
+
+        // Pivot equal to the predecessor: this range holds nothing smaller, so only the
+        // elements greater than it still need sorting
+        if (!leftmost && !SORT_LESS(*(begin - 1), *begin)) {
+            begin = SORT_FN(partition_left)(begin, end, ctx) + 1;
+            continue;
+        }
+
+        bool already;
+        SORT_T* pivot_pos = SORT_FN(partition_right)(begin, end, &already, ctx);
+        size_t l_size = (size_t)(pivot_pos - begin);
+        size_t r_size = (size_t)(end - (pivot_pos + 1));
+
+        if (l_size < size / 8 || r_size < size / 8) {
+            if (--bad_allowed == 0) {
+                SORT_FN(heapsort)(begin, end, ctx);
+                return;
+            }
+            // Break up the pattern that made the pivot bad
+            if (l_size >= PDQ_INSERTION_SORT) {
+                SORT_FN(swap)(begin, begin + l_size / 4);
+                SORT_FN(swap)(pivot_pos - 1, pivot_pos - l_size / 4);
+                if (l_size > PDQ_NINTHER) {
+                    SORT_FN(swap)(begin + 1, begin + (l_size / 4 + 1));
+                    SORT_FN(swap)(begin + 2, begin + (l_size / 4 + 2));
+                    SORT_FN(swap)(pivot_pos - 2, pivot_pos - (l_size / 4 + 1));
+                    SORT_FN(swap)(pivot_pos - 3, pivot_pos - (l_size / 4 + 2));
+                }
+            }
+            if (r_size >= PDQ_INSERTION_SORT) {
+                SORT_FN(swap)(pivot_pos + 1, pivot_pos + (1 + r_size / 4));
+                SORT_FN(swap)(end - 1, end - r_size / 4);
+                if (r_size > PDQ_NINTHER) {
+                    SORT_FN(swap)(pivot_pos + 2, pivot_pos + (2 + r_size / 4));
+                    SORT_FN(swap)(pivot_pos + 3, pivot_pos + (3 + r_size / 4));
+                    SORT_FN(swap)(end - 2, end - (1 + r_size / 4));
+                    SORT_FN(swap)(end - 3, end - (2 + r_size / 4));
+                }
+            }
+        } else if (already && SORT_FN(partial_insertion_sort)(begin, pivot_pos, ctx) &&
+                   SORT_FN(partial_insertion_sort)(pivot_pos + 1, end, ctx)) {
+            return;
+        }
+
+        // Recurse into the left part, loop on the right
+        SORT_FN(pdq_loop)(begin, pivot_pos, bad_allowed, leftmost, ctx);
+        begin = pivot_pos + 1;
+        leftmost = false;
+    }
+}
+
+static inline void SORT_FN(pdqsort)(SORT_T* a, size_t n, const void* ctx) {
+    if (n > 1) SORT_FN(pdq_loop)(a, a + n, sort_log2(n), true, ctx);
+}
+
+// Rearranges a so that a[k] holds the element a sorted array would, with nothing greater
+// before it and nothing smaller after it. Quickselect with pdqsort's pivots; ranges that
+// keep partitioning badly are sorted instead.
+static inline void SORT_FN(select)(SORT_T* a, size_t n, size_t k, const void* ctx) {
+    SORT_T* begin = a;
+    SORT_T* end = a + n;
+    SORT_T* kth = a + k;
+    int bad_allowed = sort_log2(n) + 1;
+    while ((size_t)(end - begin) >= PDQ_INSERTION_SORT) {
+        size_t size = (size_t)(end - begin);
+        SORT_FN(choose_pivot)(begin, end, ctx);
+        bool already;
+        SORT_T* pivot_pos = SORT_FN(partition_right)(begin, end, &already, ctx);
+        if (pivot_pos == kth) return;
+        size_t l_size = (size_t)(pivot_pos - begin);
+        if ((l_size < size / 8 || size - l_size - 1 < size / 8) && --bad_allowed == 0) {
+            SORT_FN(heapsort)(begin, end, ctx);
+            return;
+        }
+        if (kth < pivot_pos) end = pivot_pos;
+        else begin = pivot_pos + 1;
+    }
+    SORT_FN(insertion_sort)(begin, end, ctx);
+}
+
+// Stable; tmp holds at least n / 2 + 1 elements
+static inline void SORT_FN(merge_sort)(SORT_T* a, SORT_T* tmp, size_t n, const void* ctx) {
+    if (n <= MERGE_RUN) {
+        SORT_FN(insertion_sort)(a, a + n, ctx);
+        return;
+    }
+    size_t h = n / 2;
+    SORT_FN(merge_sort)(a, tmp, h, ctx);
+    SORT_FN(merge_sort)(a + h, tmp, n - h, ctx);
+    if (!SORT_LESS(a[h], a[h - 1])) return; // Already in order
+
+    memcpy(tmp, a, h * sizeof(SORT_T));
+    size_t i = 0, j = h, k = 0;
+    while (i < h && j < n) {
+        if (SORT_LESS(a[j], tmp[i])) a[k++] = a[j++];
+        else a[k++] = tmp[i++];
+    }
+    while (i < h) a[k++] = tmp[i++];
+}
+
+#undef SORT_FN
+#undef SORT_CAT
+#undef SORT_CAT2
+#undef SORT_T
+#undef SORT_SFX
+#undef SORT_LESS
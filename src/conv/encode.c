@@ -0,0 +1,605 @@
+#include "come_conv.h"
+#include "mem/talloc.h"
+#include <errno.h>
+#include <string.h>
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#include <immintrin.h>
+#define COME_ENCODE_X86 1
+#endif
+
+// Binary-to-text encodings
+// Base64 follows RFC 4648: the standard alphabet is padded, base64url is not (as in JWT
+// and most URL uses); both decoders accept input with or without padding. Percent
+// encoding escapes everything outside the RFC 3986 unreserved set and never maps '+'.
+//
+// The SIMD kernels are Muła and Lemire's ("Faster Base64 Encoding and Decoding Using AVX2
+// Instructions"): encoding spreads 3 bytes over 4 lanes with one shuffle and two
+// multiplies; decoding validates and translates with range compares, then packs with
+// multiply-adds. Hex uses a shuffle as a 16-entry table. Each kernel handles whole
+// blocks and leaves the tail to the scalar code.
+
+static const char b64_std[64] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char b64_url[64] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+static const char hex_digits[16] = "0123456789abcdef";
+
+// 0 scalar, 1 SSSE3, 2 AVX2
+static int encode_level = -1;
+
+static int conv_encode_level(void) {
+    if (encode_level < 0) {
+        int level = 0;
+#ifdef COME_ENCODE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) level = 2;
+        else if (__builtin_cpu_supports("ssse3")) level = 1;
+#endif
+        encode_level = level;
+    }
+    return encode_level;
+}
+
+// Base64
+
+static size_t b64_encode_scalar(char* out, const uint8_t* in, size_t n, const char* alphabet, bool pad) {
+    char* p = out;
+    size_t i = 0;
+    for (; i + 3 <= n; i += 3) {
+        uint32_t v = ((uint32_t)in[i] << 16) | ((uint32_t)in[i + 1] << 8) | in[i + 2];
+        p[0] = alphabet[v >> 18];
+        p[1] = alphabet[(v >> 12) & 63];
+        p[2] = alphabet[(v >> 6) & 63];
+        p[3] = alphabet[v & 63];
+        p += 4;
+    }
+    if (i < n) {
+        uint32_t v = (uint32_t)in[i] << 16;
+        if (i + 1 < n) v |= (uint32_t)in[i + 1] << 8;
+        *p++ = alphabet[v >> 18];
+        *p++ = alphabet[(v >> 12) & 63];
+        if (i + 1 < n) *p++ = alphabet[(v >> 6) & 63];
+        else if (pad) *p++ = '=';
+        if (pad) *p++ = '=';
+    }
+    return (size_t)(p - out);
+}
+
+// Sextet values, 0xFF for characters outside the alphabet
+static uint8_t b64_std_values[256];
+static uint8_t b64_url_values[256];
+static bool b64_values_ready = false;
+
+static void b64_init_values(void) {
+    memset(b64_std_values, 0xFF, sizeof(b64_std_values));
+    memset(b64_url_values, 0xFF, sizeof(b64_url_values));
+    for (int i = 0; i < 64; i++) {
+        b64_std_values[(uint8_t)b64_std[i]] = (uint8_t)i;
+        b64_url_values[(uint8_t)b64_url[i]] = (uint8_t)i;
+    }
+    b64_values_ready = true;
+}
+
+// Decodes whole 4-character groups plus a final partial group of 2 or 3 characters
+static size_t b64_decode_scalar(uint8_t* out, const char* in, size_t n, const uint8_t* values) {
+    uint8_t* p = out;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t a = values[(uint8_t)in[i]], b = values[(uint8_t)in[i + 1]];
+        uint32_t c = values[(uint8_t)in[i + 2]], d = values[(uint8_t)in[i + 3]];
+        if ((a | b | c | d) & 0x80) break;
+        uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+        p[0] = (uint8_t)(v >> 16);
+        p[1] = (uint8_t)(v >> 8);
+        p[2] = (uint8_t)v;
+        p += 3;
+    }
+    size_t rest = n - i;
+    if (rest == 0) return (size_t)(p - out);
+    if (rest == 1) return COME_CONV_INVALID;
+
+    uint32_t v = 0;
+    size_t k = 0;
+    for (; k < rest && k < 4; k++) {
+        uint8_t x = values[(uint8_t)in[i + k]];
+        if (x & 0x80) break;
+        v |= (uint32_t)x << (18 - 6 * k);
+    }
+    // A group may end early only in the last group, followed by padding to its end
+    if (k < 2 || i + 4 < n) return COME_CONV_INVALID;
+    for (size_t j = k; j < rest; j++) {
+        if (in[i + j] != '=') return COME_CONV_INVALID;
+    }
+    *p++ = (uint8_t)(v >> 16);
+    if (k == 3) *p++ = (uint8_t)(v >> 8);
+    return (size_t)(p - out);
+}
+
+#ifdef COME_ENCODE_X86
+
+// 12 input bytes in the low three quarters of in, 16 output characters
+__attribute__((target("ssse3")))
+static inline __m128i b64_enc_sse(__m128i in, __m128i shift_lut) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+    __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+    __m128i idx = _mm_or_si128(t0, t1);
+    // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12; then add the offset
+    __m128i r = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+    r = _mm_or_si128(r, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), idx), _mm_set1_epi8(13)));
+    return _mm_add_epi8(_mm_shuffle_epi8(shift_lut, r), idx);
+}
+
+__attribute__((target("ssse3")))
+static inline __m128i b64_shift_lut_sse(const char* alphabet) {
+    return _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                         '0' - 52, '0' - 52, '0' - 52, (char)(alphabet[62] - 62), (char)(alphabet[63] - 63),
+                         'A', 0, 0);
+}
+
+__attribute__((target("ssse3")))
+static size_t b64_encode_ssse3(char* out, const uint8_t* in, size_t n, const char* alphabet) {
+    const __m128i lut = b64_shift_lut_sse(alphabet);
+    size_t i = 0, o = 0;
+    for (; i + 16 <= n; i += 12, o += 16) {
+        _mm_storeu_si128((__m128i*)(out + o), b64_enc_sse(_mm_loadu_si128((const __m128i*)(in + i)), lut));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t b64_encode_avx2(char* out, const uint8_t* in, size_t n, const char* alphabet) {
+    const __m256i lut = _mm256_broadcastsi128_si256(b64_shift_lut_sse(alphabet));
+    const __m256i shuf = _mm256_broadcastsi128_si256(
+        _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    size_t i = 0, o = 0;
+    for (; i + 28 <= n; i += 24, o += 32) {
+        __m256i x = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(in + i))),
+            _mm_loadu_si128((const __m128i*)(in + i + 12)), 1);
+        x = _mm256_shuffle_epi8(x, shuf);
+        __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(x, _mm256_set1_epi32(0x0fc0fc00)),
+                                        _mm256_set1_epi32(0x04000040));
+        __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(x, _mm256_set1_epi32(0x003f03f0)),
+                                        _mm256_set1_epi32(0x01000010));
+        __m256i idx = _mm256_or_si256(t0, t1);
+        __m256i r = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+        r = _mm256_or_si256(r, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx),
+                                                _mm256_set1_epi8(13)));
+        _mm256_storeu_si256((__m256i*)(out + o), _mm256_add_epi8(_mm256_shuffle_epi8(lut, r), idx));
+    }
+    return i + b64_encode_ssse3(out + o, in + i, n - i, alphabet);
+}
+
+// Sextets of 16 characters; *bad is nonzero if any is outside the alphabet
+static inline __m128i b64_values_sse(__m128i c, char c62, char c63, int* bad) {
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('A' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), c));
+    __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), c));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), c));
+    __m128i s62 = _mm_cmpeq_epi8(c, _mm_set1_epi8(c62));
+    __m128i s63 = _mm_cmpeq_epi8(c, _mm_set1_epi8(c63));
+    __m128i shift = _mm_or_si128(
+        _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')), _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))),
+        _mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(52 - '0')),
+                     _mm_or_si128(_mm_and_si128(s62, _mm_set1_epi8((char)(62 - c62))),
+                                  _mm_and_si128(s63, _mm_set1_epi8((char)(63 - c63))))));
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(s62, s63)));
+    *bad = _mm_movemask_epi8(valid) != 0xFFFF;
+    return _mm_add_epi8(c, shift);
+}
+
+// Stores 16 bytes of which the first 12 are output; stopping 8 characters early keeps the
+// other 4 inside the output buffer
+__attribute__((target("ssse3")))
+static size_t b64_decode_ssse3(uint8_t* out, const char* in, size_t n, const char* alphabet) {
+    size_t i = 0, o = 0;
+    for (; i + 24 <= n; i += 16, o += 12) {
+        int bad;
+        __m128i v = b64_values_sse(_mm_loadu_si128((const __m128i*)(in + i)), alphabet[62], alphabet[63], &bad);
+        if (bad) break;
+        v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+        v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+        v = _mm_shuffle_epi8(v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        _mm_storeu_si128((__m128i*)(out + o), v);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t b64_decode_avx2(uint8_t* out, const char* in, size_t n, const char* alphabet) {
+    const __m256i c62 = _mm256_set1_epi8(alphabet[62]), c63 = _mm256_set1_epi8(alphabet[63]);
+    size_t i = 0, o = 0;
+    for (; i + 48 <= n; i += 32, o += 24) {
+        __m256i c = _mm256_loadu_si256((const __m256i*)(in + i));
+        __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('A' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), c));
+        __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('a' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), c));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+        __m256i s62 = _mm256_cmpeq_epi8(c, c62);
+        __m256i s63 = _mm256_cmpeq_epi8(c, c63);
+        __m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+                                        _mm256_or_si256(digit, _mm256_or_si256(s62, s63)));
+        if ((uint32_t)_mm256_movemask_epi8(valid) != 0xFFFFFFFFu) break;
+        __m256i shift = _mm256_or_si256(
+            _mm256_or_si256(_mm256_and_si256(upper, _mm256_set1_epi8(-'A')),
+                            _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a'))),
+            _mm256_or_si256(_mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')),
+                            _mm256_or_si256(_mm256_and_si256(s62, _mm256_set1_epi8((char)(62 - alphabet[62]))),
+                                            _mm256_and_si256(s63, _mm256_set1_epi8((char)(63 - alphabet[63]))))));
+        __m256i v = _mm256_add_epi8(c, shift);
+        v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+        v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+        v = _mm256_shuffle_epi8(v, _mm256_broadcastsi128_si256(
+            _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)));
+        v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+        _mm256_storeu_si256((__m256i*)(out + o), v);
+    }
+    return i + b64_decode_ssse3(out + o, in + i, n - i, alphabet);
+}
+
+#endif // COME_ENCODE_X86
+
+static size_t b64_encode(char* out, const uint8_t* in, size_t n, const char* alphabet, bool pad) {
+    size_t done = 0;
+#ifdef COME_ENCODE_X86
+    int level = conv_encode_level();
+    if (level == 2) done = b64_encode_avx2(out, in, n, alphabet);
+    else if (level == 1) done = b64_encode_ssse3(out, in, n, alphabet);
+#endif
+    return done / 3 * 4 + b64_encode_scalar(out + done / 3 * 4, in + done, n - done, alphabet, pad);
+}
+
+static size_t b64_decode(uint8_t* out, const char* in, size_t n, const char* alphabet, const uint8_t* values) {
+    size_t done = 0;
+#ifdef COME_ENCODE_X86
+    int level = conv_encode_level();
+    if (level == 2) done = b64_decode_avx2(out, in, n, alphabet);
+    else if (level == 1) done = b64_decode_ssse3(out, in, n, alphabet);
+#endif
+    size_t rest = b64_decode_scalar(out + done / 4 * 3, in + done, n - done, values);
+    if (rest == COME_CONV_INVALID) {
+        errno = EINVAL;
+        return COME_CONV_INVALID;
+    }
+    return done / 4 * 3 + rest;
+}
+
+size_t come_conv_format_base64(char* out, const void* in, size_t n) {
+    return b64_encode(out, in, n, b64_std, true);
+}
+
+size_t come_conv_format_base64url(char* out, const void* in, size_t n) {
+    return b64_encode(out, in, n, b64_url, false);
+}
+
+size_t come_conv_parse_base64(uint8_t* out, const char* s, size_t n) {
+    if (!b64_values_ready) b64_init_values();
+    return b64_decode(out, s, n, b64_std, b64_std_values);
+}
+
+size_t come_conv_parse_base64url(uint8_t* out, const char* s, size_t n) {
+    if (!b64_values_ready) b64_init_values();
+    return b64_decode(out, s, n, b64_url, b64_url_values);
+}
+
+// Hex
+
+static inline int hex_value(uint8_t c) {
+    if ((unsigned)(c - '0') < 10) return c - '0';
+    c |= 0x20;
+    if ((unsigned)(c - 'a') < 6) return c - 'a' + 10;
+    return -1;
+}
+
+#ifdef COME_ENCODE_X86
+
+__attribute__((target("ssse3")))
+static size_t hex_encode_ssse3(char* out, const uint8_t* in, size_t n) {
+    const __m128i lut = _mm_loadu_si128((const __m128i*)hex_digits);
+    const __m128i low4 = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(x, 4), low4));
+        __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(x, low4));
+        _mm_storeu_si128((__m128i*)(out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i*)(out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t hex_encode_avx2(char* out, const uint8_t* in, size_t n) {
+    const __m256i lut = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)hex_digits));
+    const __m256i low4 = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(in + i));
+        __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), low4));
+        __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(x, low4));
+        __m256i a = _mm256_unpacklo_epi8(hi, lo); // Bytes 0-7 | 16-23
+        __m256i b = _mm256_unpackhi_epi8(hi, lo); // Bytes 8-15 | 24-31
+        _mm256_storeu_si256((__m256i*)(out + 2 * i), _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256((__m256i*)(out + 2 * i + 32), _mm256_permute2x128_si256(a, b, 0x31));
+    }
+    return i + hex_encode_ssse3(out + 2 * i, in + i, n - i);
+}
+
+// Nibble values of 16 hex digits; *bad is nonzero if any is not a hex digit
+static inline __m128i hex_values_sse(__m128i c, int* bad) {
+    __m128i l = _mm_or_si128(c, _mm_set1_epi8(0x20));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), c));
+    __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(l, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('f' + 1), l));
+    *bad = _mm_movemask_epi8(_mm_or_si128(digit, alpha)) != 0xFFFF;
+    return _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(c, _mm_set1_epi8('0'))),
+                        _mm_and_si128(alpha, _mm_sub_epi8(l, _mm_set1_epi8('a' - 10))));
+}
+
+__attribute__((target("ssse3")))
+static size_t hex_decode_ssse3(uint8_t* out, const char* in, size_t n) {
+    const __m128i weights = _mm_set1_epi16(0x0110); // High nibble * 16 + low nibble
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        int bad0, bad1;
+        __m128i a = hex_values_sse(_mm_loadu_si128((const __m128i*)(in + i)), &bad0);
+        __m128i b = hex_values_sse(_mm_loadu_si128((const __m128i*)(in + i + 16)), &bad1);
+        if (bad0 | bad1) break;
+        __m128i r = _mm_packus_epi16(_mm_maddubs_epi16(a, weights), _mm_maddubs_epi16(b, weights));
+        _mm_storeu_si128((__m128i*)(out + i / 2), r);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t hex_decode_avx2(uint8_t* out, const char* in, size_t n) {
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m256i v[2];
+        uint32_t valid = 0xFFFFFFFFu;
+        for (int k = 0; k < 2; k++) {
+            __m256i c = _mm256_loadu_si256((const __m256i*)(in + i + 32 * k));
+            __m256i l = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+            __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+                                             _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+            __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(l, _mm256_set1_epi8('a' - 1)),
+                                             _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), l));
+            valid &= (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(digit, alpha));
+            v[k] = _mm256_maddubs_epi16(
+                _mm256_or_si256(_mm256_and_si256(digit, _mm256_sub_epi8(c, _mm256_set1_epi8('0'))),
+                                _mm256_and_si256(alpha, _mm256_sub_epi8(l, _mm256_set1_epi8('a' - 10)))),
+                weights);
+        }
+        if (valid != 0xFFFFFFFFu) break;
+        // packus works per lane: restore byte order across lanes
+        __m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi16(v[0], v[1]), 0xD8);
+        _mm256_storeu_si256((__m256i*)(out + i / 2), r);
+    }
+    return i + hex_decode_ssse3(out + i / 2, in + i, n - i);
+}
+
+#endif // COME_ENCODE_X86
+
+size_t come_conv_format_hex(char* out, const void* in, size_t n) {
+    const uint8_t* p = in;
+    size_t i = 0;
+#ifdef COME_ENCODE_X86
+    int level = conv_encode_level();
+    if (level == 2) i = hex_encode_avx2(out, p, n);
+    else if (level == 1) i = hex_encode_ssse3(out, p, n);
+#endif
+    for (; i < n; i++) {
+        out[2 * i] = hex_digits[p[i] >> 4];
+        out[2 * i + 1] = hex_digits[p[i] & 15];
+    }
+    return 2 * n;
+}
+
+size_t come_conv_parse_hex(uint8_t* out, const char* s, size_t n) {
+    if (n & 1) {
+        errno = EINVAL;
+        return COME_CONV_INVALID;
+    }
+    size_t i = 0;
+#ifdef COME_ENCODE_X86
+    int level = conv_encode_level();
+    if (level == 2) i = hex_decode_avx2(out, s, n);
+    else if (level == 1) i = hex_decode_ssse3(out, s, n);
+#endif
+    for (; i < n; i += 2) {
+        int hi = hex_value((uint8_t)s[i]), lo = hex_value((uint8_t)s[i + 1]);
+        if (hi < 0 || lo < 0) {
+            errno = EINVAL;
+            return COME_CONV_INVALID;
+        }
+        out[i / 2] = (uint8_t)(hi << 4 | lo);
+    }
+    return n / 2;
+}
+
+// Percent encoding
+
+static inline bool url_unreserved(uint8_t c) {
+    return (unsigned)(c - '0') < 10 || (unsigned)((c | 0x20) - 'a') < 26 ||
+           c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+#ifdef COME_ENCODE_X86
+
+// Bit per byte of in[0..16) that passes through unescaped
+static inline uint32_t url_unreserved_sse2(const uint8_t* in) {
+    __m128i c = _mm_loadu_si128((const __m128i*)in);
+    __m128i l = _mm_or_si128(c, _mm_set1_epi8(0x20));
+    __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(l, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), l));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), c));
+    __m128i mark = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('-')), _mm_cmpeq_epi8(c, _mm_set1_epi8('.'))),
+                                _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('_')), _mm_cmpeq_epi8(c, _mm_set1_epi8('~'))));
+    return (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), mark));
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t url_unreserved_avx2(const uint8_t* in) {
+    __m256i c = _mm256_loadu_si256((const __m256i*)in);
+    __m256i l = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+    __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(l, _mm256_set1_epi8('a' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), l));
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+    __m256i mark = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('-')), _mm256_cmpeq_epi8(c, _mm256_set1_epi8('.'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('_')), _mm256_cmpeq_epi8(c, _mm256_set1_epi8('~'))));
+    return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(alpha, digit), mark));
+}
+
+// Length of the unreserved run at in[0..n), 16 or 32 bytes per step
+__attribute__((target("avx2")))
+static size_t url_run_avx2(const uint8_t* in, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        uint32_t m = ~url_unreserved_avx2(in + i);
+        if (m) return i + (size_t)__builtin_ctz(m);
+    }
+    for (; i + 16 <= n; i += 16) {
+        uint32_t m = ~url_unreserved_sse2(in + i) & 0xFFFF;
+        if (m) return i + (size_t)__builtin_ctz(m);
+    }
+    while (i < n && url_unreserved(in[i])) i++;
+    return i;
+}
+
+static size_t url_run_sse2(const uint8_t* in, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint32_t m = ~url_unreserved_sse2(in + i) & 0xFFFF;
+        if (m) return i + (size_t)__builtin_ctz(m);
+    }
+    while (i < n && url_unreserved(in[i])) i++;
+    return i;
+}
+
+#endif // COME_ENCODE_X86
+
+static size_t url_run(const uint8_t* in, size_t n) {
+#ifdef COME_ENCODE_X86
+    return conv_encode_level() == 2 ? url_run_avx2(in, n) : url_run_sse2(in, n);
+#else
+    size_t i = 0;
+    while (i < n && url_unreserved(in[i])) i++;
+    return i;
+#endif
+}
+
+size_t come_conv_format_percent(char* out, const void* in, size_t n) {
+    static const char upper_hex[16] = "0123456789ABCDEF";
+    const uint8_t* p = in;
+    char* w = out;
+    size_t i = 0;
+    while (i < n) {
+        size_t run = url_run(p + i, n - i);
+        memcpy(w, p + i, run);
+        w += run;
+        i += run;
+        if (i == n) break;
+        w[0] = '%';
+        w[1] = upper_hex[p[i] >> 4];
+        w[2] = upper_hex[p[i] & 15];
+        w += 3;
+        i++;
+    }
+    return (size_t)(w - out);
+}
+
+size_t come_conv_parse_percent(uint8_t* out, const char* s, size_t n) {
+    uint8_t* w = out;
+    size_t i = 0;
+    while (i < n) {
+        // memchr is vectorised in libc; runs between escapes are copied whole
+        const char* pct = memchr(s + i, '%', n - i);
+        size_t run = pct ? (size_t)(pct - (s + i)) : n - i;
+        memmove(w, s + i, run);
+        w += run;
+        i += run;
+        if (i == n) break;
+        int hi = i + 2 < n ? hex_value((uint8_t)s[i + 1]) : -1;
+        int lo = hi >= 0 ? hex_value((uint8_t)s[i + 2]) : -1;
+        if (lo < 0) {
+            errno = EINVAL;
+            return COME_CONV_INVALID;
+        }
+        *w++ = (uint8_t)(hi << 4 | lo);
+        i += 3;
+    }
+    return (size_t)(w - out);
+}
+
+// Allocating forms
+
+typedef size_t (*conv_format_fn)(char*, const void*, size_t);
+typedef size_t (*conv_parse_fn)(uint8_t*, const char*, size_t);
+
+static const struct {
+    conv_format_fn format;
+    conv_parse_fn parse;
+} conv_encodings[] = {
+    [COME_CONV_BASE64] = {come_conv_format_base64, come_conv_parse_base64},
+    [COME_CONV_BASE64URL] = {come_conv_format_base64url, come_conv_parse_base64url},
+    [COME_CONV_HEX] = {come_conv_format_hex, come_conv_parse_hex},
+    [COME_CONV_PERCENT] = {come_conv_format_percent, come_conv_parse_percent},
+};
+
+static size_t conv_encoded_max(come_conv_encoding_t enc, size_t n) {
+    switch (enc) {
+    case COME_CONV_BASE64: return COME_CONV_BASE64_LEN(n);
+    case COME_CONV_BASE64URL: return COME_CONV_BASE64URL_LEN(n);
+    case COME_CONV_HEX: return COME_CONV_HEX_LEN(n);
+    default: return COME_CONV_PERCENT_MAX(n);
+    }
+}
+
+come_string_t* come_conv_append_encoded(come_string_t* sb, come_conv_encoding_t enc, const void* p, size_t n) {
+    sb = come_string_reserve(sb, conv_encoded_max(enc, n));
+    if (!sb) return NULL;
+    sb->count += conv_encodings[enc].format(sb->data + sb->count, p, n);
+    sb->data[sb->count] = '\0';
+    sb->flags = 0;
+    return sb;
+}
+
+come_string_t* come_conv_encode(TALLOC_CTX* ctx, come_conv_encoding_t enc, const void* p, size_t n) {
+    come_string_t* s = come_string_new_len(ctx, NULL, conv_encoded_max(enc, n));
+    if (!s) return NULL;
+    s->count = conv_encodings[enc].format(s->data, p, n);
+    s->data[s->count] = '\0';
+    // Every encoding here produces ASCII
+    s->flags = COME_STRING_SCANNED | COME_STRING_ASCII | COME_STRING_UTF8_KNOWN | COME_STRING_UTF8;
+    s->nchars = s->count;
+    return s;
+}
+
+come_byte_array_t* come_conv_decode(TALLOC_CTX* ctx, come_conv_encoding_t enc, const char* s, size_t n) {
+    // Decoded data is never longer than its encoding
+    come_byte_array_t* a = mem_talloc_alloc(ctx, sizeof(come_byte_array_t) + n);
+    if (!a) return NULL;
+    size_t len = conv_encodings[enc].parse(a->items, s, n);
+    if (len == COME_CONV_INVALID) {
+        mem_talloc_free(a);
+        return NULL;
+    }
+    a->size = (uint32_t)n;
+    a->count = (uint32_t)len;
+    return a;
+}
+
+come_string_t* come_conv_decode_string(TALLOC_CTX* ctx, come_conv_encoding_t enc, const char* s, size_t n) {
+    come_string_t* out = come_string_new_len(ctx, NULL, n);
+    if (!out) return NULL;
+    size_t len = conv_encodings[enc].parse((uint8_t*)out->data, s, n);
+    if (len == COME_CONV_INVALID) {
+        mem_talloc_free(out);
+        return NULL;
+    }
+    out->count = (uint32_t)len;
+    out->data[len] = '\0';
+    return out;
+}
@@ -0,0 +1,561 @@
+#define _GNU_SOURCE // strtod_l
+#include "come_conv.h"
+#include "mem/talloc.h"
+#include <errno.h>
+#include <limits.h>
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Digit scanning
+
+static inline unsigned conv_digit(unsigned char c) {
+    if ((unsigned)(c - '0') < 10) return c - '0';
+    c |= 0x20;
+    if ((unsigned)(c - 'a') < 26) return c - 'a' + 10;
+    return 36;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define COME_CONV_SWAR 1
+
+// Eight ASCII digits per step (first digit in the low byte)
+static inline bool swar_is_8digits(uint64_t x) {
+    return ((x & 0xF0F0F0F0F0F0F0F0ULL) |
+            (((x + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL;
+}
+
+static inline uint32_t swar_parse_8digits(uint64_t x) {
+    const uint64_t mask = 0x000000FF000000FFULL;
+    const uint64_t mul1 = 100 + (1000000ULL << 32);
+    const uint64_t mul2 = 1 + (10000ULL << 32);
+    x -= 0x3030303030303030ULL;
+    x = (x * 10) + (x >> 8); // Pairs
+    return (uint32_t)((((x & mask) * mul1) + (((x >> 16) & mask) * mul2)) >> 32);
+}
+#endif
+
+// Up to max_digits decimal digits into *v (which must stay below 10^19); returns the count
+static size_t conv_dec_digits(const char* s, size_t n, uint64_t* v, size_t max_digits) {
+    size_t i = 0;
+    uint64_t acc = *v;
+#ifdef COME_CONV_SWAR
+    while (i + 8 <= n && i + 8 <= max_digits) {
+        uint64_t x;
+        memcpy(&x, s + i, 8);
+        if (!swar_is_8digits(x)) break;
+        acc = acc * 100000000 + swar_parse_8digits(x);
+        i += 8;
+    }
+#endif
+    for (; i < n && i < max_digits; i++) {
+        unsigned d = (unsigned char)s[i] - '0';
+        if (d > 9) break;
+        acc = acc * 10 + d;
+    }
+    *v = acc;
+    return i;
+}
+
+// Unsigned magnitude in the given base, prefix handling as in C23 strtoul
+static size_t conv_parse_u64(const char* s, size_t n, int base, uint64_t* out, bool* overflow) {
+    size_t i = 0;
+    *out = 0;
+    *overflow = false;
+    if (base != 0 && (base < 2 || base > 36)) {
+        errno = EINVAL;
+        return 0;
+    }
+
+    // 0x / 0b only count when a digit follows, otherwise "0x" reads as "0"
+    if (n >= 3 && s[0] == '0') {
+        char p = s[1] | 0x20;
+        if (p == 'x' && (base == 0 || base == 16) && conv_digit(s[2]) < 16) { base = 16; i = 2; }
+        else if (p == 'b' && (base == 0 || base == 2) && conv_digit(s[2]) < 2) { base = 2; i = 2; }
+    }
+    if (base == 0) base = (n && s[0] == '0') ? 8 : 10;
+
+    uint64_t v = 0;
+    size_t start = i;
+    if (base == 10) {
+        // 19 digits cannot overflow
+        i += conv_dec_digits(s + i, n - i, &v, 19);
+    }
+    for (; i < n; i++) {
+        unsigned d = conv_digit((unsigned char)s[i]);
+        if (d >= (unsigned)base) break;
+        if (!*overflow && (__builtin_mul_overflow(v, (uint64_t)base, &v) || __builtin_add_overflow(v, d, &v))) {
+            *overflow = true;
+        }
+    }
+    if (i == start) return 0;
+    *out = *overflow ? UINT64_MAX : v;
+    return i;
+}
+
+size_t come_conv_parse_long(const char* s, size_t n, int base, long* out) {
+    size_t i = 0;
+    bool neg = false;
+    if (n && (s[0] == '+' || s[0] == '-')) {
+        neg = s[0] == '-';
+        i = 1;
+    }
+
+    uint64_t mag;
+    bool overflow;
+    size_t used = conv_parse_u64(s + i, n - i, base, &mag, &overflow);
+    *out = 0;
+    if (!used) return 0;
+
+    uint64_t limit = neg ? (uint64_t)LONG_MAX + 1 : (uint64_t)LONG_MAX;
+    if (overflow || mag > limit) {
+        errno = ERANGE;
+        *out = neg ? LONG_MIN : LONG_MAX;
+    } else {
+        *out = neg ? (long)(0 - mag) : (long)mag;
+    }
+    return i + used;
+}
+
+size_t come_conv_parse_ulong(const char* s, size_t n, int base, unsigned long* out) {
+    size_t i = (n && s[0] == '+') ? 1 : 0;
+    uint64_t mag;
+    bool overflow;
+    size_t used = conv_parse_u64(s + i, n - i, base, &mag, &overflow);
+    *out = 0;
+    if (!used) return 0;
+    if (overflow || mag > ULONG_MAX) {
+        errno = ERANGE;
+        *out = ULONG_MAX;
+    } else {
+        *out = (unsigned long)mag;
+    }
+    return i + used;
+}
+
+// Case-insensitive prefix match of a lowercase word
+static bool conv_word(const char* s, size_t n, const char* word) {
+    size_t len = strlen(word);
+    if (n < len) return false;
+    for (size_t i = 0; i < len; i++) {
+        if ((s[i] | 0x20) != word[i]) return false;
+    }
+    return true;
+}
+
+// Correctly rounded slow path for what the fast path cannot do exactly. strtod_l with the
+// C locale, so a ',' decimal point locale cannot change the result.
+static size_t conv_strtod_c(const char* s, size_t n, double* out) {
+    static locale_t c_locale = (locale_t)0;
+    if (!c_locale) c_locale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+
+    // Only absurdly long literals need the heap
+    char stack[512];
+    char* buf = n < sizeof(stack) ? stack : malloc(n + 1);
+    if (!buf) return 0;
+    memcpy(buf, s, n);
+    buf[n] = '\0';
+    char* end;
+    *out = c_locale ? strtod_l(buf, &end, c_locale) : strtod(buf, &end);
+    if (buf != stack) free(buf);
+    return (size_t)(end - buf);
+}
+
+static const double conv_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static const uint64_t conv_pow10_u64[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL,
+};
+
+size_t come_conv_parse_double(const char* s, size_t n, double* out) {
+    size_t i = 0;
+    bool neg = false;
+    *out = 0;
+    if (n && (s[0] == '+' || s[0] == '-')) {
+        neg = s[0] == '-';
+        i = 1;
+    }
+
+    if (conv_word(s + i, n - i, "inf")) {
+        *out = neg ? -__builtin_inf() : __builtin_inf();
+        return i + (conv_word(s + i, n - i, "infinity") ? 8 : 3);
+    }
+    if (conv_word(s + i, n - i, "nan")) {
+        *out = neg ? -__builtin_nan("") : __builtin_nan("");
+        return i + 3;
+    }
+    if (n - i >= 3 && s[i] == '0' && (s[i + 1] | 0x20) == 'x') {
+        // Hex floats are rare enough to leave to the C library
+        return conv_strtod_c(s, n - i < 128 ? n : i + 128, out);
+    }
+
+    // Mantissa: up to 19 significant digits, exact in a uint64_t
+    uint64_t mant = 0;
+    size_t nd = 0;      // Significant digits in mant
+    int exp10 = 0;
+    bool digits = false, inexact = false;
+
+    while (i < n && s[i] == '0') { i++; digits = true; }
+    size_t used = conv_dec_digits(s + i, n - i, &mant, 19);
+    nd += used;
+    i += used;
+    while (i < n && (unsigned)(s[i] - '0') < 10) { i++; exp10++; inexact = true; }
+    digits |= used > 0;
+
+    if (i < n && s[i] == '.') {
+        i++;
+        if (!mant) {
+            while (i < n && s[i] == '0') { i++; exp10--; digits = true; }
+        }
+        used = conv_dec_digits(s + i, n - i, &mant, 19 - nd);
+        nd += used;
+        i += used;
+        exp10 -= (int)used;
+        digits |= used > 0;
+        while (i < n && (unsigned)(s[i] - '0') < 10) { i++; inexact = true; digits = true; }
+    }
+    if (!digits) return 0;
+
+    if (i < n && (s[i] | 0x20) == 'e') {
+        size_t j = i + 1;
+        bool eneg = false;
+        if (j < n && (s[j] == '+' || s[j] == '-')) {
+            eneg = s[j] == '-';
+            j++;
+        }
+        if (j < n && (unsigned)(s[j] - '0') < 10) {
+            int e = 0;
+            for (; j < n && (unsigned)(s[j] - '0') < 10; j++) {
+                if (e < 100000) e = e * 10 + (s[j] - '0');
+            }
+            exp10 += eneg ? -e : e;
+            i = j;
+        }
+    }
+
+    // Clinger's fast path: mant and 10^|exp10| are both exact doubles, so one IEEE
+    // multiply or divide rounds correctly
+    const uint64_t two53 = 1ULL << 53;
+    if (!inexact) {
+        if (!mant) {
+            *out = neg ? -0.0 : 0.0;
+            return i;
+        }
+        double d = -1;
+        if (mant <= two53 && exp10 >= -22 && exp10 <= 22) {
+            d = exp10 < 0 ? (double)mant / conv_pow10[-exp10] : (double)mant * conv_pow10[exp10];
+        } else if (mant <= two53 && exp10 > 22 && exp10 <= 22 + 15) {
+            // 1.5e30: move the excess into the mantissa while it stays exact
+            uint64_t m;
+            if (!__builtin_mul_overflow(mant, conv_pow10_u64[exp10 - 22], &m) && m <= two53) {
+                d = (double)m * 1e22;
+            }
+        }
+        if (d >= 0) {
+            *out = neg ? -d : d;
+            return i;
+        }
+    }
+
+    conv_strtod_c(s, i, out);
+    return i;
+}
+
+// Integer formatting: two digits per division
+
+static const char conv_digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static inline size_t conv_count_digits(uint64_t v) {
+    size_t n = 1;
+    for (;;) {
+        if (v < 10) return n;
+        if (v < 100) return n + 1;
+        if (v < 1000) return n + 2;
+        if (v < 10000) return n + 3;
+        v /= 10000;
+        n += 4;
+    }
+}
+
+static size_t conv_format_u64(char* out, uint64_t v) {
+    size_t len = conv_count_digits(v);
+    char* p = out + len;
+    while (v >= 100) {
+        unsigned r = (unsigned)(v % 100);
+        v /= 100;
+        p -= 2;
+        memcpy(p, conv_digit_pairs + 2 * r, 2);
+    }
+    if (v >= 10) {
+        p -= 2;
+        memcpy(p, conv_digit_pairs + 2 * v, 2);
+    } else {
+        *--p = (char)('0' + v);
+    }
+    return len;
+}
+
+size_t come_conv_format_ulong(char* out, unsigned long v) {
+    return conv_format_u64(out, v);
+}
+
+size_t come_conv_format_long(char* out, long v) {
+    if (v >= 0) return conv_format_u64(out, (uint64_t)v);
+    out[0] = '-';
+    return 1 + conv_format_u64(out + 1, 0 - (uint64_t)v);
+}
+
+// Double formatting: Grisu2 (Loitsch, "Printing Floating-Point Numbers Quickly and
+// Accurately with Integers"). Always round-trips; the digits are the shortest possible
+// for all but a tiny fraction of inputs.
+
+typedef struct {
+    uint64_t f;
+    int e;
+} conv_diyfp_t;
+
+// Normalised 10^k for k = -348, -340, ..., 340
+static const uint64_t conv_cached_f[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+    0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+    0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+    0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+    0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+    0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+    0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+    0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+    0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+    0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+    0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+    0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+    0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+    0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+    0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+
+static const int16_t conv_cached_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927, -901, -874,
+    -847, -821, -794, -768, -741, -715, -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3,
+    30, 56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348, 375, 402, 428, 455, 481, 508, 534,
+    561, 588, 614, 641, 667, 694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986, 1013, 1039,
+    1066,
+};
+
+static conv_diyfp_t diyfp_mul(conv_diyfp_t a, conv_diyfp_t b) {
+    unsigned __int128 p = (unsigned __int128)a.f * b.f;
+    uint64_t h = (uint64_t)(p >> 64);
+    if ((uint64_t)p & (1ULL << 63)) h++; // Round
+    return (conv_diyfp_t){ h, a.e + b.e + 64 };
+}
+
+static conv_diyfp_t diyfp_normalize(conv_diyfp_t v) {
+    int s = __builtin_clzll(v.f);
+    return (conv_diyfp_t){ v.f << s, v.e - s };
+}
+
+static conv_diyfp_t diyfp_from_double(double d) {
+    uint64_t u;
+    memcpy(&u, &d, sizeof(u));
+    int be = (int)(u >> 52 & 0x7FF);
+    uint64_t sig = u & ((1ULL << 52) - 1);
+    if (be) return (conv_diyfp_t){ sig | 1ULL << 52, be - 1075 };
+    return (conv_diyfp_t){ sig, -1074 };
+}
+
+// Scaled digit generation; *k is the decimal exponent of the last digit
+static void grisu_round(char* buf, size_t len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w) {
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static size_t grisu_digits(conv_diyfp_t w, conv_diyfp_t mp, uint64_t delta, char* buf, int* k) {
+    conv_diyfp_t one = { 1ULL << -mp.e, mp.e };
+    uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+    uint64_t p2 = mp.f & (one.f - 1);
+    int kappa = (int)conv_count_digits(p1);
+    size_t len = 0;
+
+    while (kappa > 0) {
+        uint32_t div = (uint32_t)conv_pow10_u64[kappa - 1];
+        uint32_t d = p1 / div;
+        p1 %= div;
+        if (d || len) buf[len++] = (char)('0' + d);
+        kappa--;
+        uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+        if (rest <= delta) {
+            *k += kappa;
+            grisu_round(buf, len, delta, rest, conv_pow10_u64[kappa] << -one.e, wp_w);
+            return len;
+        }
+    }
+    for (;;) {
+        p2 *= 10;
+        delta *= 10;
+        char d = (char)(p2 >> -one.e);
+        if (d || len) buf[len++] = (char)('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta) {
+            *k += kappa;
+            int index = -kappa;
+            grisu_round(buf, len, delta, p2, one.f, wp_w * (index < 20 ? conv_pow10_u64[index] : 0));
+            return len;
+        }
+    }
+}
+
+// Shortest digits of v > 0: v ~= digits * 10^k
+static size_t grisu2(double v, char* buf, int* k) {
+    conv_diyfp_t w = diyfp_from_double(v);
+
+    // Boundaries halfway to the neighbouring doubles; the lower one is closer at a power of two
+    conv_diyfp_t plus = diyfp_normalize((conv_diyfp_t){ (w.f << 1) + 1, w.e - 1 });
+    conv_diyfp_t minus = (w.f == 1ULL << 52) ? (conv_diyfp_t){ (w.f << 2) - 1, w.e - 2 }
+                                              : (conv_diyfp_t){ (w.f << 1) - 1, w.e - 1 };
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    // Cached 10^-mk brings the exponent into [-60, -32]
+    double dk = (-61 - plus.e) * 0.30102999566398114 + 347;
+    int ki = (int)dk;
+    if (dk - ki > 0.0) ki++;
+    unsigned index = (unsigned)((ki >> 3) + 1);
+    *k = -(-348 + (int)(index << 3));
+    conv_diyfp_t c = { conv_cached_f[index], conv_cached_e[index] };
+
+    conv_diyfp_t W = diyfp_mul(diyfp_normalize(w), c);
+    conv_diyfp_t Wp = diyfp_mul(plus, c);
+    conv_diyfp_t Wm = diyfp_mul(minus, c);
+    Wm.f++;
+    Wp.f--;
+    return grisu_digits(W, Wp, Wp.f - Wm.f, buf, k);
+}
+
+size_t come_conv_format_double(char* out, double v) {
+    char* p = out;
+    if (__builtin_signbit(v) && !__builtin_isnan(v)) {
+        *p++ = '-';
+        v = -v;
+    }
+    if (__builtin_isnan(v)) {
+        memcpy(p, "nan", 3);
+        return (size_t)(p - out) + 3;
+    }
+    if (__builtin_isinf(v)) {
+        memcpy(p, "inf", 3);
+        return (size_t)(p - out) + 3;
+    }
+    if (v == 0) {
+        memcpy(p, "0.0", 3);
+        return (size_t)(p - out) + 3;
+    }
+
+    char digits[20];
+    int k;
+    size_t len = grisu2(v, digits, &k);
+    int dp = (int)len + k; // Digits before the decimal point
+    int exp = dp - 1;
+
+    if (exp < -4 || exp >= 16) {
+        // d.ddde+XX
+        *p++ = digits[0];
+        if (len > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, len - 1);
+            p += len - 1;
+        }
+        *p++ = 'e';
+        *p++ = exp < 0 ? '-' : '+';
+        unsigned e = (unsigned)(exp < 0 ? -exp : exp);
+        if (e >= 100) {
+            *p++ = (char)('0' + e / 100);
+            e %= 100;
+        }
+        memcpy(p, conv_digit_pairs + 2 * e, 2);
+        p += 2;
+    } else if (dp <= 0) {
+        // 0.000ddd
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', (size_t)-dp);
+        p += -dp;
+        memcpy(p, digits, len);
+        p += len;
+    } else if ((size_t)dp >= len) {
+        // ddd000.0
+        memcpy(p, digits, len);
+        p += len;
+        memset(p, '0', (size_t)dp - len);
+        p += (size_t)dp - len;
+        memcpy(p, ".0", 2);
+        p += 2;
+    } else {
+        // ddd.ddd
+        memcpy(p, digits, (size_t)dp);
+        p += dp;
+        *p++ = '.';
+        memcpy(p, digits + dp, len - (size_t)dp);
+        p += len - (size_t)dp;
+    }
+    return (size_t)(p - out);
+}
+
+// Builder and string output
+
+come_string_t* come_conv_append_long(come_string_t* sb, long v) {
+    sb = come_string_reserve(sb, COME_CONV_LONG_MAX);
+    if (!sb) return NULL;
+    sb->count += come_conv_format_long(sb->data + sb->count, v);
+    sb->data[sb->count] = '\0';
+    sb->flags = 0;
+    return sb;
+}
+
+come_string_t* come_conv_append_ulong(come_string_t* sb, unsigned long v) {
+    sb = come_string_reserve(sb, COME_CONV_LONG_MAX);
+    if (!sb) return NULL;
+    sb->count += come_conv_format_ulong(sb->data + sb->count, v);
+    sb->data[sb->count] = '\0';
+    sb->flags = 0;
+    return sb;
+}
+
+come_string_t* come_conv_append_double(come_string_t* sb, double v) {
+    sb = come_string_reserve(sb, COME_CONV_DOUBLE_MAX);
+    if (!sb) return NULL;
+    sb->count += come_conv_format_double(sb->data + sb->count, v);
+    sb->data[sb->count] = '\0';
+    sb->flags = 0;
+    return sb;
+}
+
+come_string_t* come_conv_ltos(TALLOC_CTX* ctx, long v) {
+    char buf[COME_CONV_LONG_MAX];
+    return come_string_new_len(ctx, buf, come_conv_format_long(buf, v));
+}
+
+come_string_t* come_conv_dtos(TALLOC_CTX* ctx, double v) {
+    char buf[COME_CONV_DOUBLE_MAX];
+    return come_string_new_len(ctx, buf, come_conv_format_double(buf, v));
+}
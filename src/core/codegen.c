@@ -6,6 +6,7 @@
 #include <ctype.h>
 #include "codegen.h"
 #include "ast.h"
+#include "come_phf.h"
 
 typedef void* map;
 
@@ -26,6 +27,7 @@ static void emit_c_string_literal(FILE* f, const char* s) {
 static const char* source_filename = NULL;
 static int last_emitted_line = -1;
 static int g_gen_line_map = 1;
+static int g_mem_sites = 0; // Mark each statement as the allocation site for mem statistics
 
 // Track current function return type for correct return statement generation
 static char current_function_return_type[128] = "";
@@ -33,6 +35,354 @@ static char current_module[256] = "main"; // Default to main if unspecified
 static char* current_imports[256];
 static int current_import_count = 0;
 
+// Regex patterns given as string literals are compiled once at module init
+// and referenced as come_<module>__re[slot] at the call site.
+static char* regex_literals[256];
+static int regex_literal_count = 0;
+static int regex_hoisting = 0;
+
+// Body of the function being generated, for checks over a local's uses
+static ASTNode* current_function_body = NULL;
+
+// Scope blocks get numbered context variables _come_outer_N / _come_scope_N; a return
+// inside moves its object out of the outermost one (0 outside any scope)
+static int scope_count = 0;
+static int scope_outer_id = 0;
+
+static int find_regex_literal(const char* text) {
+    for (int i = 0; i < regex_literal_count; i++) {
+        if (strcmp(regex_literals[i], text) == 0) return i;
+    }
+    return -1;
+}
+
+static int is_regex_method(const char* method) {
+    return strcmp(method, "regex") == 0 || strcmp(method, "regex_split") == 0 ||
+           strcmp(method, "regex_groups") == 0 || strcmp(method, "regex_replace") == 0;
+}
+
+// C array type (come_<name>_array_t) and element type for a COME element type; anything
+// that is not a primitive is taken to be a user struct, whose array type the struct
+// declaration emits
+static const struct { const char* names[3]; const char* array; const char* elem; } array_types[] = {
+    {{"int", "i32", "var"}, "come_int_array_t", "int"},
+    {{"byte", "i8"}, "come_byte_array_t", "uint8_t"},
+    {{"ubyte", "u8"}, "come_ubyte_array_t", "uint8_t"},
+    {{"short", "i16"}, "come_short_array_t", "int16_t"},
+    {{"ushort", "u16"}, "come_ushort_array_t", "uint16_t"},
+    {{"uint", "u32"}, "come_uint_array_t", "uint32_t"},
+    {{"long", "i64"}, "come_long_array_t", "int64_t"},
+    {{"ulong", "u64"}, "come_ulong_array_t", "uint64_t"},
+    {{"float", "f32"}, "come_float_array_t", "float"},
+    {{"double", "f64"}, "come_double_array_t", "double"},
+    {{"bool"}, "come_bool_array_t", "bool"},
+    {{"wchar"}, "come_wchar_array_t", "int32_t"},
+    {{"string"}, "come_string_list_t", "come_string_t*"},
+};
+
+static void array_type_names(const char* raw, char* arr_type, size_t arr_len, char* elem_type, size_t elem_len) {
+    for (size_t i = 0; i < sizeof(array_types) / sizeof(array_types[0]); i++) {
+        for (int j = 0; j < 3 && array_types[i].names[j]; j++) {
+            if (strcmp(raw, array_types[i].names[j]) == 0) {
+                snprintf(arr_type, arr_len, "%s", array_types[i].array);
+                if (elem_type) snprintf(elem_type, elem_len, "%s", array_types[i].elem);
+                return;
+            }
+        }
+    }
+    if (strncmp(raw, "struct ", 7) == 0) raw += 7;
+    snprintf(arr_type, arr_len, "come_%s_array_t", raw);
+    if (elem_type) snprintf(elem_type, elem_len, "%s", raw);
+}
+
+// come_X_array_t -> come_X_array_view_t
+static void array_view_name(const char* arr_type, char* view_type, size_t view_len) {
+    snprintf(view_type, view_len, "%.*s_view_t", (int)strlen(arr_type) - 2, arr_type);
+}
+
+// "soa T[]" / "soa T[N]" -> T; 0 if text is not struct-of-arrays storage
+static int soa_struct_name(const char* text, char* name, size_t len) {
+    if (!text || strncmp(text, "soa ", 4) != 0) return 0;
+    const char* lbracket = strchr(text, '[');
+    if (!lbracket) return 0;
+    snprintf(name, len, "%.*s", (int)(lbracket - text - 4), text + 4);
+    return 1;
+}
+
+// "[const ]map<K,V>" or "ordered_map<K,V>" (bare "map" is map<string,string>): whether K
+// is string, V's C type and the array type of V; 0 if text is not a map type
+static int map_types(const char* text, int* string_key, char* val_type, char* val_array, size_t len) {
+    if (text && strncmp(text, "const map", 9) == 0) text += 6;
+    else if (text && strncmp(text, "ordered_map", 11) == 0) text += 8;
+    if (!text || strncmp(text, "map", 3) != 0 || (text[3] != '\0' && text[3] != '<')) return 0;
+    char key[64] = "string";
+    char val[64] = "string";
+    if (text[3] == '<') {
+        const char* comma = strchr(text, ',');
+        const char* close = strrchr(text, '>');
+        if (!comma || !close || close < comma || close[1] != '\0') return 0;
+        snprintf(key, sizeof(key), "%.*s", (int)(comma - text - 4), text + 4);
+        snprintf(val, sizeof(val), "%.*s", (int)(close - comma - 1), comma + 1);
+    }
+    if (string_key) *string_key = strcmp(key, "string") == 0;
+    if (val_type) array_type_names(val, val_array, len, val_type, len);
+    return 1;
+}
+
+// "name<T>": T's C type and the array type of T; 0 if text is not that type
+static int elem_types(const char* text, const char* name, char* elem_type, char* elem_array, size_t len) {
+    size_t n = strlen(name);
+    if (!text || strncmp(text, name, n) != 0 || text[n] != '<' || text[strlen(text) - 1] != '>') return 0;
+    char elem[64];
+    snprintf(elem, sizeof(elem), "%.*s", (int)(strlen(text) - n - 2), text + n + 1);
+    if (elem_type) array_type_names(elem, elem_array, len, elem_type, len);
+    return 1;
+}
+
+// "deque<T>": fills as elem_types
+static int deque_types(const char* text, char* elem_type, char* elem_array, size_t len) {
+    return elem_types(text, "deque", elem_type, elem_array, len);
+}
+
+// "heap<T>": fills as elem_types
+static int heap_types(const char* text, char* elem_type, char* elem_array, size_t len) {
+    return elem_types(text, "heap", elem_type, elem_array, len);
+}
+
+// "lru<K,V>": fills as map_types
+static int lru_types(const char* text, int* string_key, char* val_type, char* val_array, size_t len) {
+    char as_map[128];
+    if (!text || strncmp(text, "lru<", 4) != 0) return 0;
+    snprintf(as_map, sizeof(as_map), "map%s", text + 3);
+    return map_types(as_map, string_key, val_type, val_array, len);
+}
+
+// "T[]" or "T[N]" -> C array pointer type, "T[:]" -> view type, "soa T[]" -> come_T_soa_t*,
+// "map<K,V>" -> come_map_t*, "const map<K,V>" -> const come_map_const_t*,
+// "ordered_map<K,V>" -> come_ordered_map_t*, "deque<T>" -> come_deque_t*, "heap<T>" ->
+// come_heap_t*, "lru<K,V>" -> come_lru_t*; 0 if text is not an array, map or queue type
+static int array_c_type(const char* text, char* c_type, size_t c_len) {
+    if (map_types(text, NULL, NULL, NULL, 0)) {
+        snprintf(c_type, c_len, strncmp(text, "const ", 6) == 0 ? "const come_map_const_t*" :
+                                strncmp(text, "ordered_", 8) == 0 ? "come_ordered_map_t*" : "come_map_t*");
+        return 1;
+    }
+    if (deque_types(text, NULL, NULL, 0)) {
+        snprintf(c_type, c_len, "come_deque_t*");
+        return 1;
+    }
+    if (heap_types(text, NULL, NULL, 0)) {
+        snprintf(c_type, c_len, "come_heap_t*");
+        return 1;
+    }
+    if (lru_types(text, NULL, NULL, NULL, 0)) {
+        snprintf(c_type, c_len, "come_lru_t*");
+        return 1;
+    }
+    const char* lbracket = strchr(text, '[');
+    if (!lbracket) return 0;
+    char soa[64];
+    if (soa_struct_name(text, soa, sizeof(soa))) {
+        snprintf(c_type, c_len, "come_%s_soa_t*", soa);
+        return 1;
+    }
+    char raw[64];
+    char arr_type[128];
+    snprintf(raw, sizeof(raw), "%.*s", (int)(lbracket - text), text);
+    array_type_names(raw, arr_type, sizeof(arr_type), NULL, 0);
+    if (lbracket[1] == ':') array_view_name(arr_type, c_type, c_len);
+    else snprintf(c_type, c_len, "%s*", arr_type);
+    return 1;
+}
+
+// Array type name prefix for the typed functions: come_X_array_t -> come_X_array
+static int array_func_prefix(const char* text, char* prefix, size_t len) {
+    const char* lbracket = strchr(text, '[');
+    if (!lbracket) return 0;
+    char raw[64];
+    char arr_type[128];
+    snprintf(raw, sizeof(raw), "%.*s", (int)(lbracket - text), text);
+    array_type_names(raw, arr_type, sizeof(arr_type), NULL, 0);
+    snprintf(prefix, len, "%.*s", (int)strlen(arr_type) - 2, arr_type);
+    return 1;
+}
+
+// Receiver declared as T[] / T[N]
+static int is_array_variable(ASTNode* node) {
+    if (node->type != AST_IDENTIFIER) return 0;
+    const char* type = get_local_variable_type(node->text);
+    return type && strchr(type, '[') != NULL && strstr(type, "[:]") == NULL && strncmp(type, "soa ", 4) != 0;
+}
+
+// Receiver declared as soa T[]; fills its struct name
+static int is_soa_variable(ASTNode* node, char* name, size_t len) {
+    if (node->type != AST_IDENTIFIER) return 0;
+    return soa_struct_name(get_local_variable_type(node->text), name, len);
+}
+
+// Receiver declared bool[] / bool[N], a packed bitset
+static int is_bits_variable(ASTNode* node) {
+    if (node->type != AST_IDENTIFIER) return 0;
+    const char* type = get_local_variable_type(node->text);
+    return type && strncmp(type, "bool[", 5) == 0 && strcmp(type, "bool[:]") != 0;
+}
+
+// Receiver declared as a view T[:]
+static int is_view_variable(ASTNode* node) {
+    if (node->type != AST_IDENTIFIER) return 0;
+    const char* type = get_local_variable_type(node->text);
+    return type && strstr(type, "[:]") != NULL;
+}
+
+// Receiver declared as a map; fills as map_types
+static int is_map_variable(ASTNode* node, int* string_key, char* val_type, char* val_array, size_t len) {
+    if (node->type != AST_IDENTIFIER) return 0;
+    return map_types(get_local_variable_type(node->text), string_key, val_type, val_array, len);
+}
+
+// Receiver declared as a deque; fills as deque_types
+static int is_deque_variable(ASTNode* node, char* elem_type, char* elem_array, size_t len) {
+    if (node->type != AST_IDENTIFIER) return 0;
+    return deque_types(get_local_variable_type(node->text), elem_type, elem_array, len);
+}
+
+// Receiver declared as a heap; fills as heap_types
+static int is_heap_variable(ASTNode* node, char* elem_type, char* elem_array, size_t len) {
+    if (node->type != AST_IDENTIFIER) return 0;
+    return heap_types(get_local_variable_type(node->text), elem_type, elem_array, len);
+}
+
+// Receiver declared as an lru cache; fills as map_types
+static int is_lru_variable(ASTNode* node, int* string_key, char* val_type, char* val_array, size_t len) {
+    if (node->type != AST_IDENTIFIER) return 0;
+    return lru_types(get_local_variable_type(node->text), string_key, val_type, val_array, len);
+}
+
+// C function prefix of a map receiver's type: come_map, come_map_const or come_ordered_map
+static const char* map_func_prefix(ASTNode* node) {
+    const char* type = node->type == AST_IDENTIFIER ? get_local_variable_type(node->text) : NULL;
+    if (type && strncmp(type, "const map", 9) == 0) return "come_map_const";
+    if (type && strncmp(type, "ordered_map", 11) == 0) return "come_ordered_map";
+    return "come_map";
+}
+
+// Declared map<string, string> (or const / ordered)
+static int is_string_map_variable(ASTNode* node) {
+    int string_key = 0;
+    char val_type[64];
+    char val_array[64];
+    return is_map_variable(node, &string_key, val_type, val_array, sizeof(val_type)) && string_key &&
+           strcmp(val_type, "come_string_t*") == 0;
+}
+
+// Such a map as its keys and values lists, allocated on ctx (for replace_many(map) and
+// matcher.replacer(map))
+static void generate_string_map_lists(FILE* f, ASTNode* node, const char* ctx) {
+    const char* prefix = map_func_prefix(node);
+    fprintf(f, "(come_string_list_t*)%s_keys(%s, %s), %s_values_of(%s, %s, come_string_list_t)",
+            prefix, ctx, node->text, prefix, ctx, node->text);
+}
+
+// Receiver declared as an ordered_map cursor ("ordered_map_iter<K,V>", the type given to
+// var it = m.first() / m.lower_bound(k) / m.range(lo, hi)); fills as map_types
+static int is_ordered_iter_variable(ASTNode* node, int* string_key, char* val_type, char* val_array, size_t len) {
+    const char* type = node->type == AST_IDENTIFIER ? get_local_variable_type(node->text) : NULL;
+    if (!type || strncmp(type, "ordered_map_iter<", 17) != 0) return 0;
+    char map_type[128];
+    snprintf(map_type, sizeof(map_type), "map%s", type + 16);
+    return map_types(map_type, string_key, val_type, val_array, len);
+}
+
+// Numeric array kernels (come_array_sum etc.)
+static int is_array_kernel(const char* method) {
+    static const char* names[] = {"sum", "min", "max", "dot", "fill", "scale", "add", "count", "index_of", "prefix_sum"};
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(method, names[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+// Fixed-width integer readers of byte[] and byte[:] (come_bytes_u16be etc)
+static int is_byte_reader(const char* method) {
+    static const char* names[] = {"u16be", "u32be", "u64be", "u16le", "u32le", "u64le"};
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(method, names[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+// conv.base64(x), conv.hex_decode(s), ...: results are allocated on the module context
+static int is_conv_encoding(const char* c_func) {
+    static const char* names[] = {"base64", "base64url", "hex", "percent"};
+    if (strncmp(c_func, "come_conv_", 10) != 0) return 0;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        size_t len = strlen(names[i]);
+        if (strncmp(c_func + 10, names[i], len) == 0 &&
+            (c_func[10 + len] == '\0' || strcmp(c_func + 10 + len, "_decode") == 0)) return 1;
+    }
+    return 0;
+}
+
+static void collect_regex_literals(ASTNode* node) {
+    if (!node) return;
+    if (node->type == AST_METHOD_CALL && is_regex_method(node->text) &&
+        node->child_count > 1 && node->children[1] && node->children[1]->type == AST_STRING_LITERAL) {
+        if (find_regex_literal(node->children[1]->text) < 0 && regex_literal_count < 256) {
+            regex_literals[regex_literal_count++] = strdup(node->children[1]->text);
+        }
+    }
+    for (int i = 0; i < node->child_count; i++) {
+        collect_regex_literals(node->children[i]);
+    }
+}
+
+// Structs named inside an array or container type (X[], X[N], X[:], map<K,X>, ...) and
+// inside a soa X[] type; only those get the come_X_array and come_X_soa definitions
+static char* array_structs[256];
+static int array_struct_count = 0;
+static char* soa_structs[256];
+static int soa_struct_count = 0;
+
+static int is_listed_struct(char** list, int count, const char* name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(list[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+// Whether type text mentions name as a whole identifier
+static int type_names_struct(const char* text, const char* name) {
+    size_t len = strlen(name);
+    for (const char* p = strstr(text, name); p; p = strstr(p + 1, name)) {
+        int before = p == text || !(isalnum((unsigned char)p[-1]) || p[-1] == '_');
+        int after = !(isalnum((unsigned char)p[len]) || p[len] == '_');
+        if (before && after) return 1;
+    }
+    return 0;
+}
+
+static void collect_struct_arrays(ASTNode* node, ASTNode* ast) {
+    if (!node) return;
+    if (strchr(node->text, '[') || strchr(node->text, '<')) {
+        char soa[64];
+        int is_soa = soa_struct_name(node->text, soa, sizeof(soa));
+        for (int i = 0; i < ast->child_count; i++) {
+            ASTNode* decl = ast->children[i];
+            if (decl->type != AST_STRUCT_DECL || !type_names_struct(node->text, decl->text)) continue;
+            if (is_soa && strcmp(soa, decl->text) == 0) {
+                if (!is_listed_struct(soa_structs, soa_struct_count, decl->text) && soa_struct_count < 256) {
+                    soa_structs[soa_struct_count++] = strdup(decl->text);
+                }
+            } else if (!is_listed_struct(array_structs, array_struct_count, decl->text) && array_struct_count < 256) {
+                array_structs[array_struct_count++] = strdup(decl->text);
+            }
+        }
+    }
+    for (int i = 0; i < node->child_count; i++) {
+        collect_struct_arrays(node->children[i], ast);
+    }
+}
+
 
 
 // Emit #line directive if needed
@@ -42,6 +392,8 @@ static void emit_line_directive(FILE* f, ASTNode* node) {
     // Only emit if line changed to avoid clutter
     if (node->source_line != last_emitted_line) {
         fprintf(f, "\n#line %d \"%s\"\n", node->source_line, source_filename);
+        // On the statement's own line, so __LINE__ is its source line
+        if (g_mem_sites && current_function_body) fprintf(f, "COME_MEM_SITE();");
         last_emitted_line = node->source_line;
     }
 }
@@ -52,6 +404,351 @@ static void emit_line_directive(FILE* f, ASTNode* node) {
 static void generate_node(FILE* f, ASTNode* node, int indent);
 static void generate_expression(FILE* f, ASTNode* node);
 
+// A map value: string literals become strings owned by the map
+static void generate_map_value(FILE* f, const char* map_name, ASTNode* value, const char* val_type) {
+    if (value->type == AST_STRING_LITERAL && strcmp(val_type, "come_string_t*") == 0) {
+        fprintf(f, "come_string_new(%s, ", map_name);
+        generate_expression(f, value);
+        fprintf(f, ")");
+    } else {
+        generate_expression(f, value);
+    }
+}
+
+// Bytes of a string literal token (with its quotes) into out; -1 for an escape it does
+// not decode or if out is too small
+static int decode_string_literal(const char* lit, char* out, int cap) {
+    static const char* simple = "n\nt\tr\ra\007b\bf\fv\v\\\\''\"\"??";
+    int n = 0;
+    for (const char* p = lit + 1; *p && *p != '"'; p++) {
+        if (n >= cap) return -1;
+        if (*p != '\\') {
+            out[n++] = *p;
+            continue;
+        }
+        p++;
+        if (*p == 'x' && isxdigit((unsigned char)p[1])) {
+            int v = 0;
+            while (isxdigit((unsigned char)p[1])) {
+                p++;
+                v = v * 16 + (isdigit((unsigned char)*p) ? *p - '0' : tolower((unsigned char)*p) - 'a' + 10);
+            }
+            out[n++] = (char)v;
+            continue;
+        }
+        if (*p >= '0' && *p <= '7') {
+            int v = 0;
+            for (int i = 0; i < 3 && *p >= '0' && *p <= '7'; i++, p++) v = v * 8 + (*p - '0');
+            p--;
+            out[n++] = (char)v;
+            continue;
+        }
+        const char* e = *p ? strchr(simple, *p) : NULL;
+        if (!e || (e - simple) % 2 != 0) return -1;
+        out[n++] = e[1];
+    }
+    return n;
+}
+
+// Integer literal key: n or -n
+static int int_key_literal(ASTNode* node, int64_t* value) {
+    int negate = 0;
+    if (node->type == AST_UNARY_OP && strcmp(node->text, "-") == 0 && node->child_count == 1) {
+        negate = 1;
+        node = node->children[0];
+    }
+    if (node->type != AST_NUMBER || node->text[0] == '\'' || strpbrk(node->text, ".")) return 0;
+    char* end;
+    long long v = strtoll(node->text, &end, 0);
+    if (end == node->text || strspn(end, "uUlL") != strlen(end)) return 0;
+    *value = negate ? -(int64_t)v : (int64_t)v;
+    return 1;
+}
+
+// A value that can sit in a static table of val_type
+static int is_static_value(ASTNode* node, const char* val_type) {
+    if (strcmp(val_type, "come_string_t*") == 0) return node->type == AST_STRING_LITERAL;
+    if (node->type == AST_UNARY_OP && strcmp(node->text, "-") == 0 && node->child_count == 1) node = node->children[0];
+    return node->type == AST_NUMBER || node->type == AST_BOOL_LITERAL;
+}
+
+// 1 if every use of name under node only reads the map declared by decl: the receiver of
+// get/has/size/keys/values, an index read or the entries of s.replace_many(m) and
+// matcher.replacer(m). Stores, reassignment, shadowing and passing the map on otherwise
+// all count as changes.
+static int map_read_only(ASTNode* node, ASTNode* decl, const char* name) {
+    static const char* reads[] = {"get", "has", "size", "len", "length", "keys", "values"};
+    if (!node) return 1;
+    if (node->type == AST_IDENTIFIER) return strcmp(node->text, name) != 0;
+    if (node->type == AST_VAR_DECL && node != decl && strcmp(node->text, name) == 0) return 0;
+    ASTNode* base = node->child_count > 0 ? node->children[0] : NULL;
+    if (node->type == AST_METHOD_CALL && node->child_count == 2 && node->children[1]->type == AST_IDENTIFIER &&
+        strcmp(node->children[1]->text, name) == 0 &&
+        (strcmp(node->text, "replace_many") == 0 || strcmp(node->text, "replacer") == 0)) {
+        return map_read_only(base, decl, name);
+    }
+    // m[k] = v, m[k] += v, m[k]++ and --m[k] store into the map
+    int store = node->type == AST_ASSIGN || node->type == AST_POST_INC || node->type == AST_POST_DEC ||
+                (node->type == AST_UNARY_OP && (strcmp(node->text, "++") == 0 || strcmp(node->text, "--") == 0));
+    if (store && base && base->type == AST_ARRAY_ACCESS && !map_read_only(base->children[0], decl, name)) return 0;
+    int first = 0;
+    if (base && base->type == AST_IDENTIFIER && strcmp(base->text, name) == 0) {
+        if (node->type == AST_ARRAY_ACCESS) first = 1;
+        for (size_t i = 0; node->type == AST_METHOD_CALL && i < sizeof(reads) / sizeof(reads[0]); i++) {
+            if (strcmp(node->text, reads[i]) == 0) first = 1;
+        }
+    }
+    for (int i = first; i < node->child_count; i++) {
+        if (!map_read_only(node->children[i], decl, name)) return 0;
+    }
+    return 1;
+}
+
+// Only-read map literals with literal keys and values become constant maps (emit_const_map);
+// a map declared const must only be read. String values would be static strings, which
+// cannot be freed or grown, so those need the explicit const
+static int is_const_map(ASTNode* decl, int declared_const, int string_key, const char* val_type) {
+    char key[4096];
+    int64_t ikey;
+    int read_only = current_function_body && map_read_only(current_function_body, decl, decl->text);
+    if (declared_const && current_function_body && !read_only) {
+        fprintf(stderr, "Error: const map '%.64s' may only be read (get, has, size, keys, values, m[k], replace_many)\n", decl->text);
+        exit(1);
+    }
+    ASTNode* lit = decl->children[0];
+    if (!read_only || !lit || lit->type != AST_AGGREGATE_INIT || lit->child_count == 0) return 0;
+    if (!declared_const && strcmp(val_type, "come_string_t*") == 0) return 0;
+    for (int i = 0; i < lit->child_count; i++) {
+        ASTNode* pair = lit->children[i];
+        if (pair->type != AST_ASSIGN || strcmp(pair->text, ":") != 0) return 0;
+        if (string_key ? pair->children[0]->type != AST_STRING_LITERAL ||
+                         decode_string_literal(pair->children[0]->text, key, sizeof(key)) < 0
+                       : !int_key_literal(pair->children[0], &ikey)) return 0;
+        if (!is_static_value(pair->children[1], val_type)) return 0;
+    }
+    return 1;
+}
+
+// Hash-and-displace perfect hash: keys go to buckets by hash, buckets are placed largest
+// first and each takes the first displacement that sends all its keys to free slots.
+// Fills disp and slot_of; 0 if some bucket found no displacement
+static int phf_place(const uint64_t* hashes, int n, uint32_t shift, uint32_t bucket_mask,
+                     uint32_t* disp, uint32_t* slot_of) {
+    uint32_t slots = (uint32_t)1 << (32 - shift);
+    uint32_t buckets = bucket_mask + 1;
+    int* start = calloc(buckets + 1, sizeof(int));
+    int* order = malloc(sizeof(int) * n);
+    char* used = calloc(slots, 1);
+    int max = 0;
+    int ok = 1;
+    for (int i = 0; i < n; i++) start[come_phf_bucket(hashes[i], bucket_mask) + 1]++;
+    for (uint32_t b = 0; b < buckets; b++) {
+        if (start[b + 1] > max) max = start[b + 1];
+        start[b + 1] += start[b];
+    }
+    int* fill = calloc(buckets, sizeof(int));
+    for (int i = 0; i < n; i++) {
+        uint32_t b = come_phf_bucket(hashes[i], bucket_mask);
+        order[start[b] + fill[b]++] = i;
+    }
+    for (int size = max; size > 0 && ok; size--) {
+        for (uint32_t b = 0; b < buckets && ok; b++) {
+            if (start[b + 1] - start[b] != size) continue;
+            uint32_t d = 0;
+            for (; d < (1u << 22); d++) {
+                int k = 0;
+                for (; k < size; k++) {
+                    int key = order[start[b] + k];
+                    slot_of[key] = come_phf_slot(hashes[key], d, shift);
+                    if (used[slot_of[key]]) break;
+                    used[slot_of[key]] = 1;
+                }
+                if (k == size) break;
+                while (k-- > 0) used[slot_of[order[start[b] + k]]] = 0;
+            }
+            disp[b] = d;
+            ok = d < (1u << 22);
+        }
+    }
+    free(start);
+    free(order);
+    free(used);
+    free(fill);
+    return ok;
+}
+
+static uint32_t phf_int_slot(int64_t key, const uint32_t* disp, uint32_t bucket_mask, uint32_t shift) {
+    uint64_t h = come_phf_hash_int(key);
+    return come_phf_slot(h, disp[come_phf_bucket(h, bucket_mask)], shift);
+}
+
+// const come_map_const_t* m = &_m_map; with its perfect hash table as static data. Later
+// duplicate keys win, as in come_map_put_all
+static void emit_const_map(FILE* f, ASTNode* decl, int string_key, const char* val_type, int indent) {
+    ASTNode* lit = decl->children[0];
+    const char* name = decl->text;
+    int n = lit->child_count;
+    int count = 0;
+    int* entry = malloc(sizeof(int) * n);
+    uint64_t* hashes = malloc(sizeof(uint64_t) * n);
+    int64_t* ikeys = malloc(sizeof(int64_t) * n);
+    int* lens = malloc(sizeof(int) * n);
+    char key[4096];
+    for (int i = 0; i < n; i++) {
+        ASTNode* k = lit->children[i]->children[0];
+        if (string_key) {
+            lens[i] = decode_string_literal(k->text, key, sizeof(key));
+            hashes[i] = come_phf_hash(key, (size_t)lens[i]);
+        } else {
+            int_key_literal(k, &ikeys[i]);
+            hashes[i] = come_phf_hash_int(ikeys[i]);
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        int dup = 0;
+        for (int j = i + 1; j < n && !dup; j++) {
+            if (hashes[j] != hashes[i]) continue;
+            if (!string_key) dup = ikeys[j] == ikeys[i];
+            else {
+                char other[4096];
+                decode_string_literal(lit->children[i]->children[0]->text, key, sizeof(key));
+                decode_string_literal(lit->children[j]->children[0]->text, other, sizeof(other));
+                dup = lens[i] == lens[j] && memcmp(key, other, (size_t)lens[i]) == 0;
+            }
+        }
+        if (!dup) {
+            entry[count] = i;
+            hashes[count++] = hashes[i];
+        }
+    }
+
+    // Load at most 4/5, about four keys per bucket
+    uint32_t bits = 1;
+    while (((uint64_t)1 << bits) * 4 < (uint64_t)count * 5) bits++;
+    uint32_t buckets = 1;
+    while (buckets * 4 < (uint32_t)count) buckets <<= 1;
+    uint32_t* disp = malloc(sizeof(uint32_t) * buckets);
+    uint32_t* slot_of = malloc(sizeof(uint32_t) * count);
+    while (!phf_place(hashes, count, 32 - bits, buckets - 1, disp, slot_of)) {
+        if (++bits > 30) {
+            fprintf(stderr, "Error: no perfect hash for map '%.64s'\n", name);
+            exit(1);
+        }
+    }
+    uint32_t slots = (uint32_t)1 << bits;
+    int* at = malloc(sizeof(int) * slots); // Slot -> literal entry, -1 if empty
+    for (uint32_t s = 0; s < slots; s++) at[s] = -1;
+    for (int i = 0; i < count; i++) at[slot_of[i]] = entry[i];
+    int string_val = strcmp(val_type, "come_string_t*") == 0;
+
+    fprintf(f, "static const uint32_t _%s_disp[] = {", name);
+    for (uint32_t b = 0; b < buckets; b++) fprintf(f, b ? ", %u" : "%u", disp[b]);
+    fprintf(f, "};\n");
+    emit_indent(f, indent);
+    if (string_key) {
+        fprintf(f, "static const char* const _%s_keys[] = {", name);
+        for (uint32_t s = 0; s < slots; s++) {
+            if (s) fprintf(f, ", ");
+            if (at[s] < 0) fprintf(f, "\"\"");
+            else generate_expression(f, lit->children[at[s]]->children[0]);
+        }
+        fprintf(f, "};\n");
+        emit_indent(f, indent);
+        fprintf(f, "static const uint32_t _%s_lens[] = {", name);
+        for (uint32_t s = 0; s < slots; s++) {
+            if (s) fprintf(f, ", ");
+            if (at[s] < 0) fprintf(f, "UINT32_MAX");
+            else fprintf(f, "%d", lens[at[s]]);
+        }
+    } else {
+        // Empty slots hold a key that hashes to another slot
+        fprintf(f, "static const int64_t _%s_keys[] = {", name);
+        for (uint32_t s = 0; s < slots; s++) {
+            int64_t filler = 0;
+            while (at[s] < 0 && phf_int_slot(filler, disp, buckets - 1, 32 - bits) == s) filler++;
+            fprintf(f, s ? ", %lldLL" : "%lldLL", (long long)(at[s] < 0 ? filler : ikeys[at[s]]));
+        }
+    }
+    fprintf(f, "};\n");
+    if (string_val) {
+        // Strings cache scan results in their header, so they live in writable static data
+        for (uint32_t s = 0; s < slots; s++) {
+            if (at[s] < 0) continue;
+            emit_indent(f, indent);
+            fprintf(f, "COME_STATIC_STRING(_%s_s%u, ", name, s);
+            generate_expression(f, lit->children[at[s]]->children[1]);
+            fprintf(f, ");\n");
+        }
+    }
+    emit_indent(f, indent);
+    if (string_val) fprintf(f, "static come_string_t* const _%s_vals[] = {", name);
+    else fprintf(f, "static const %s _%s_vals[] = {", val_type, name);
+    for (uint32_t s = 0; s < slots; s++) {
+        if (s) fprintf(f, ", ");
+        if (at[s] < 0) fprintf(f, "0");
+        else if (string_val) fprintf(f, "(come_string_t*)&_%s_s%u", name, s);
+        else generate_expression(f, lit->children[at[s]]->children[1]);
+    }
+    fprintf(f, "};\n");
+    emit_indent(f, indent);
+    char lens_name[80] = "NULL";
+    if (string_key) snprintf(lens_name, sizeof(lens_name), "_%.64s_lens", name);
+    fprintf(f, "static const come_map_const_t _%s_map = {%d, %u, %u, sizeof(%s), %s, _%s_disp, _%s_keys, %s, _%s_vals};\n",
+            name, count, 32 - bits, buckets - 1, val_type, string_key ? "COME_MAP_STRING" : "COME_MAP_INT",
+            name, name, lens_name, name);
+    emit_indent(f, indent);
+    fprintf(f, "const come_map_const_t* %s = &_%s_map;\n", name, name);
+    free(entry);
+    free(hashes);
+    free(ikeys);
+    free(lens);
+    free(disp);
+    free(slot_of);
+    free(at);
+}
+
+// Element stores that are calls: soa s[i] = record scatters it into the columns,
+// bits[i] = v sets one bit of a bool[], m[k] = v inserts into a map or lru cache and
+// q[i] = v replaces a deque element. 0 if node is another assignment
+static int generate_element_store(FILE* f, ASTNode* node) {
+    ASTNode* lhs = node->children[0];
+    char soa[64];
+    char val_type[64];
+    char val_array[64];
+    if (lhs->type != AST_ARRAY_ACCESS || strcmp(node->text, "=") != 0) return 0;
+    if (is_map_variable(lhs->children[0], NULL, val_type, val_array, sizeof(val_type))) {
+        fprintf(f, "%s_set(%s, ", map_func_prefix(lhs->children[0]), lhs->children[0]->text);
+        generate_expression(f, lhs->children[1]);
+        fprintf(f, ", %s, ", val_type);
+        generate_map_value(f, lhs->children[0]->text, node->children[1], val_type);
+        fprintf(f, ")");
+        return 1;
+    }
+    if (is_lru_variable(lhs->children[0], NULL, val_type, val_array, sizeof(val_type)) ||
+        is_deque_variable(lhs->children[0], val_type, val_array, sizeof(val_type))) {
+        fprintf(f, "%s_set(%s, ", is_deque_variable(lhs->children[0], NULL, NULL, 0) ? "come_deque" : "come_lru",
+                lhs->children[0]->text);
+        generate_expression(f, lhs->children[1]);
+        fprintf(f, ", %s, ", val_type);
+        generate_map_value(f, lhs->children[0]->text, node->children[1], val_type);
+        fprintf(f, ")");
+        return 1;
+    }
+    if (is_bits_variable(lhs->children[0])) fprintf(f, "come_bool_array_put(%s, ", lhs->children[0]->text);
+    else if (is_soa_variable(lhs->children[0], soa, sizeof(soa))) fprintf(f, "come_%s_soa_set(%s, ", soa, lhs->children[0]->text);
+    else if (lhs->children[0]->type == AST_MEMBER_ACCESS) {
+        // A field's array type is only known to the C compiler (a bool[] stores a bit)
+        fprintf(f, "COME_ARR_PUT(");
+        generate_expression(f, lhs->children[0]);
+        fprintf(f, ", ");
+    } else return 0;
+    generate_expression(f, lhs->children[1]);
+    fprintf(f, ", ");
+    generate_expression(f, node->children[1]);
+    fprintf(f, ")");
+    return 1;
+}
+
 static int is_pointer_expression(ASTNode* node) {
     if (!node) return 0;
     if (node->type == AST_IDENTIFIER) {
@@ -59,8 +756,18 @@ static int is_pointer_expression(ASTNode* node) {
         for (int i=0; i<sizeof(ptrs)/sizeof(char*); i++) {
             if (strcmp(node->text, ptrs[i]) == 0) return 1;
         }
+        // Locals and params declared T*
+        const char* type = get_local_variable_type(node->text);
+        if (type && type[0] && type[strlen(type) - 1] == '*') return 1;
+        // string locals are come_string_t*
+        if (type && strcmp(type, "string") == 0) return 1;
         // Also check if it's a string literal or something that becomes a pointer?
     }
+    if (node->type == AST_ARRAY_ACCESS && node->children[0]->type == AST_IDENTIFIER) {
+        // p[i] of a T* p is a T
+        const char* type = get_local_variable_type(node->children[0]->text);
+        if (type && type[0] && type[strlen(type) - 1] == '*') return 0;
+    }
     if (node->type == AST_MEMBER_ACCESS || node->type == AST_ARRAY_ACCESS) {
         // If the root is a pointer, assume access on it is a pointer (common for string/list items)
         return is_pointer_expression(node->children[0]);
@@ -116,6 +823,27 @@ static const char* infer_const_type(ASTNode* node) {
     return "int";
 }
 
+// COME type of a map literal's key or value
+static const char* literal_type(ASTNode* node) {
+    if (node->type == AST_STRING_LITERAL) return "string";
+    if (node->type == AST_BOOL_LITERAL) return "bool";
+    if (node->type == AST_NUMBER && node->text[0] != '\'' && strpbrk(node->text, ".eE") &&
+        strncmp(node->text, "0x", 2) != 0 && strncmp(node->text, "0X", 2) != 0) return "double";
+    if (node->type == AST_IDENTIFIER && get_local_variable_type(node->text)) return get_local_variable_type(node->text);
+    return "long";
+}
+
+// A bare "map" or "ordered_map" declared with a literal takes its key and value types from
+// the first entry
+static void infer_map_type(ASTNode* type_node, ASTNode* init_expr) {
+    if (!init_expr || init_expr->type != AST_AGGREGATE_INIT || init_expr->child_count == 0) return;
+    ASTNode* pair = init_expr->children[0];
+    if (pair->type != AST_ASSIGN || strcmp(pair->text, ":") != 0) return;
+    const char* kind = strcmp(type_node->text, "map") == 0 ? "map" : "ordered_map";
+    snprintf(type_node->text, sizeof(type_node->text), "%s<%s,%s>", kind,
+             strcmp(literal_type(pair->children[0]), "string") == 0 ? "string" : "long", literal_type(pair->children[1]));
+}
+
 static void generate_expression(FILE* f, ASTNode* node) {
     if (!node) {
         fprintf(f, "/* AST ERROR: NULL NODE */ 0");
@@ -144,6 +872,50 @@ static void generate_expression(FILE* f, ASTNode* node) {
         generate_expression(f, node->children[0]);
         fprintf(f, ")");
     } else if (node->type == AST_ARRAY_ACCESS) {
+        // soa s[i] as a whole record is gathered from the columns
+        char soa[64];
+        if (is_soa_variable(node->children[0], soa, sizeof(soa))) {
+            fprintf(f, "come_%s_soa_get(%s, ", soa, node->children[0]->text);
+            generate_expression(f, node->children[1]);
+            fprintf(f, ")");
+            return;
+        }
+        if (is_bits_variable(node->children[0])) {
+            fprintf(f, "come_bool_array_test(%s, ", node->children[0]->text);
+            generate_expression(f, node->children[1]);
+            fprintf(f, ")");
+            return;
+        }
+        // m[k] on a map: the value, or its zero value if k is absent
+        char val_type[64];
+        char val_array[64];
+        if (is_map_variable(node->children[0], NULL, val_type, val_array, sizeof(val_type))) {
+            fprintf(f, "%s_get(%s, ", map_func_prefix(node->children[0]), node->children[0]->text);
+            generate_expression(f, node->children[1]);
+            fprintf(f, ", %s)", val_type);
+            return;
+        }
+        // c[k] on an lru cache: as get(k), so it counts as a use
+        if (is_lru_variable(node->children[0], NULL, val_type, val_array, sizeof(val_type))) {
+            fprintf(f, "come_lru_get(%s, ", node->children[0]->text);
+            generate_expression(f, node->children[1]);
+            fprintf(f, ", %s)", val_type);
+            return;
+        }
+        // q[i] on a deque: element i counted from the front
+        if (is_deque_variable(node->children[0], val_type, val_array, sizeof(val_type))) {
+            fprintf(f, "come_deque_get(%s, ", node->children[0]->text);
+            generate_expression(f, node->children[1]);
+            fprintf(f, ", %s)", val_type);
+            return;
+        }
+        // Views are values: index their items directly
+        if (is_view_variable(node->children[0])) {
+            fprintf(f, "(%s).items[", node->children[0]->text);
+            generate_expression(f, node->children[1]);
+            fprintf(f, "]");
+            return;
+        }
         // COME_ARR_GET(arr, index)
         fprintf(f, "COME_ARR_GET(");
         generate_expression(f, node->children[0]);
@@ -151,6 +923,7 @@ static void generate_expression(FILE* f, ASTNode* node) {
         generate_expression(f, node->children[1]);
         fprintf(f, ")");
     } else if (node->type == AST_ASSIGN) {
+        if (generate_element_store(f, node)) return;
         generate_expression(f, node->children[0]);
         fprintf(f, " %s ", node->text);
         generate_expression(f, node->children[1]);
@@ -173,6 +946,15 @@ static void generate_expression(FILE* f, ASTNode* node) {
              }
         }
 
+        // soa s[i].field is a column access
+        char soa[64];
+        if (node->children[0]->type == AST_ARRAY_ACCESS && is_soa_variable(node->children[0]->children[0], soa, sizeof(soa))) {
+            fprintf(f, "%s->%s[", node->children[0]->children[0]->text, node->text);
+            generate_expression(f, node->children[0]->children[1]);
+            fprintf(f, "]");
+            return;
+        }
+
         // Member access - use dot for struct values, arrow for pointers
         fprintf(f, "(");
         generate_expression(f, node->children[0]);
@@ -192,6 +974,10 @@ static void generate_expression(FILE* f, ASTNode* node) {
         char c_func[16384];
         int skip_receiver = 0;
         ASTNode* receiver = node->children[0];
+        char soa[64];
+        char val_type[64];
+        char val_array[64];
+        int string_key = 0;
         
         // Detect module static calls
         if (receiver->type == AST_IDENTIFIER && (
@@ -199,12 +985,36 @@ static void generate_expression(FILE* f, ASTNode* node) {
             strcmp(receiver->text, "conv")==0 || 
             strcmp(receiver->text, "mem")==0 ||
             strcmp(receiver->text, "std")==0 ||
+            strcmp(receiver->text, "regex")==0 ||
+            strcmp(receiver->text, "rope")==0 ||
+            strcmp(receiver->text, "matcher")==0 ||
+            strcmp(receiver->text, "ringbuf")==0 ||
             strcmp(receiver->text, "ERR")==0)) {
             
             skip_receiver = 1;
             
             if (strcmp(receiver->text, "mem")==0 && strcmp(method, "cpy")==0) {
                  strcpy(c_func, "memcpy");
+             } else if (strcmp(receiver->text, "mem")==0 && strcmp(method, "pool")==0) {
+                 strcpy(c_func, "mem_talloc_pool");
+             } else if (strcmp(receiver->text, "mem")==0 && strcmp(method, "stats")==0) {
+                 // mem.stats(): process totals; mem.stats(x): what x's subtree holds now
+                 fprintf(f, "mem_talloc_stats(");
+                 if (node->child_count > 1) generate_expression(f, node->children[1]);
+                 else fprintf(f, "NULL");
+                 fprintf(f, ")");
+                 return;
+             } else if (strcmp(receiver->text, "matcher")==0 && strcmp(method, "replacer")==0 &&
+                        node->child_count == 2 && is_string_map_variable(node->children[1])) {
+                 // matcher.replacer(map): built from the map's keys and values, which it copies
+                 fprintf(f, "({ void* _kv = mem_talloc_new_ctx(NULL); come_string_matcher_t* _km = "
+                            "come_string_replacer_new_kv(COME_CTX, ");
+                 generate_string_map_lists(f, node->children[1], "_kv");
+                 fprintf(f, "); mem_talloc_free(_kv); _km; })");
+                 return;
+             } else if (strcmp(receiver->text, "matcher")==0) {
+                 // matcher.new(needles), matcher.replacer(pairs)
+                 snprintf(c_func, sizeof(c_func), "come_string_%s_new", strcmp(method, "new") == 0 ? "matcher" : method);
              } else if (strcmp(receiver->text, "std")==0 && strcmp(method, "printf")==0) {
                  strcpy(c_func, "printf"); 
              } else if (strcmp(receiver->text, "ERR")==0 && strcmp(method, "no")==0) {
@@ -227,6 +1037,16 @@ static void generate_expression(FILE* f, ASTNode* node) {
         else if (receiver->type == AST_MEMBER_ACCESS && 
                  strcmp(receiver->children[0]->text, "std") == 0) {
             
+             // std.in.read(buf, n), std.out.write(buf, n): buf is a byte[] or byte[:], n optional
+             if ((strcmp(method, "read") == 0 || strcmp(method, "write") == 0) && node->child_count > 1) {
+                 fprintf(f, "come_std__FILE__%s(&std_%s, COME_BYTES(", method, receiver->text);
+                 generate_expression(f, node->children[1]);
+                 fprintf(f, "), ");
+                 if (node->child_count > 2) generate_expression(f, node->children[2]);
+                 else fprintf(f, "UINT32_MAX");
+                 fprintf(f, ")");
+                 return;
+             }
              if ((strcmp(receiver->text, "out") == 0 || strcmp(receiver->text, "err") == 0) && strcmp(method, "printf") == 0) {
                  strcpy(c_func, "fprintf");
                  if (strcmp(receiver->text, "out") == 0) fprintf(f, "fprintf(stdout, ");
@@ -321,7 +1141,7 @@ static void generate_expression(FILE* f, ASTNode* node) {
                          }
                      } else if (arg->type == AST_METHOD_CALL || arg->type == AST_CALL) {
                          // Check methods that return strings
-                         const char* str_methods[] = {"upper", "lower", "repeat", "replace", "trim", "ltrim", "rtrim", "substr", "join", "new", "str", "error"};
+                         const char* str_methods[] = {"upper", "lower", "repeat", "replace", "replace_many", "trim", "ltrim", "rtrim", "substr", "join", "new", "str", "error"};
                          const char* method_name = (arg->type == AST_METHOD_CALL) ? arg->text : arg->text; // Simplification
                          for(int k=0; k<sizeof(str_methods)/sizeof(char*); k++) {
                              if (strcmp(method_name, str_methods[k]) == 0) { is_str = 1; if (arg->child_count > 0 && arg->children[0]->type == AST_IDENTIFIER && strcmp(arg->children[0]->text, "ERR") == 0) is_str = 0; }
@@ -416,6 +1236,255 @@ static void generate_expression(FILE* f, ASTNode* node) {
                  strcpy(c_func, "on"); 
              }
         }
+        // Regex with a literal pattern: use the regex compiled at module init
+        else if (regex_hoisting && is_regex_method(method) && node->child_count > 1 &&
+                 node->children[1]->type == AST_STRING_LITERAL &&
+                 find_regex_literal(node->children[1]->text) >= 0) {
+            const char* op = strcmp(method, "regex") == 0 ? "match" : method + 6;
+            fprintf(f, "come_regex_%s(come_%s__re[%d], ", op, current_module, find_regex_literal(node->children[1]->text));
+            if (receiver->type == AST_STRING_LITERAL) {
+                fprintf(f, "come_string_new(NULL, ");
+                generate_expression(f, receiver);
+                fprintf(f, ")");
+            } else {
+                generate_expression(f, receiver);
+            }
+            for (int i = 2; i < node->child_count; i++) {
+                fprintf(f, ", ");
+                generate_expression(f, node->children[i]);
+            }
+            if ((strcmp(method, "regex_split") == 0 && node->child_count == 2) ||
+                (strcmp(method, "regex_replace") == 0 && node->child_count == 3)) {
+                fputs(", 0", f);
+            }
+            fprintf(f, ")");
+            return;
+        }
+        // Detect compiled regex methods (receiver declared as 'regex')
+        else if (receiver->type == AST_IDENTIFIER && get_local_variable_type(receiver->text) &&
+                 strcmp(get_local_variable_type(receiver->text), "regex") == 0) {
+            snprintf(c_func, sizeof(c_func), "come_regex_%s", method);
+        }
+        // Detect matcher methods (receiver declared as 'matcher'): find, count, replace
+        else if (receiver->type == AST_IDENTIFIER && get_local_variable_type(receiver->text) &&
+                 strcmp(get_local_variable_type(receiver->text), "matcher") == 0) {
+            snprintf(c_func, sizeof(c_func), "come_string_matcher_%s", method);
+        }
+        // Detect rope methods (receiver declared as 'rope')
+        else if (receiver->type == AST_IDENTIFIER && get_local_variable_type(receiver->text) &&
+                 strcmp(get_local_variable_type(receiver->text), "rope") == 0) {
+            snprintf(c_func, sizeof(c_func), "come_rope_%s", method);
+        }
+        // map: typed lookups; the header never moves, so inserts need no reassignment
+        else if (is_map_variable(receiver, &string_key, val_type, val_array, sizeof(val_type))) {
+            // Constant maps (only read) have the same methods on come_map_const_t, ordered
+            // maps on come_ordered_map_t plus the cursors first, lower_bound and range
+            const char* prefix = map_func_prefix(receiver);
+            if (strcmp(method, "size") == 0 || strcmp(method, "len") == 0 || strcmp(method, "length") == 0) {
+                if (strcmp(prefix, "come_map_const") == 0) fprintf(f, "(%s)->count", receiver->text);
+                else fprintf(f, "%s_size(%s)", prefix, receiver->text);
+                return;
+            }
+            if (strcmp(method, "keys") == 0) {
+                fprintf(f, "((%s*)%s_keys(COME_CTX, %s))", string_key ? "come_string_list_t" : "come_long_array_t", prefix, receiver->text);
+                return;
+            }
+            if (strcmp(method, "values") == 0) {
+                fprintf(f, "%s_values_of(COME_CTX, %s, %s)", prefix, receiver->text, val_array);
+                return;
+            }
+            fprintf(f, "%s_%s(%s", prefix, method, receiver->text);
+            for (int i = 1; i < node->child_count; i++) {
+                fprintf(f, ", ");
+                if (i == 2 && strcmp(method, "set") == 0) generate_map_value(f, receiver->text, node->children[i], val_type);
+                else generate_expression(f, node->children[i]);
+                if (i == 1 && (strcmp(method, "get") == 0 || strcmp(method, "set") == 0)) fprintf(f, ", %s", val_type);
+            }
+            fprintf(f, ")");
+            return;
+        }
+        // deque<T>: typed pushes and pops at both ends; the header never moves
+        else if (is_deque_variable(receiver, val_type, val_array, sizeof(val_type))) {
+            if (strcmp(method, "size") == 0 || strcmp(method, "len") == 0 || strcmp(method, "length") == 0) {
+                fprintf(f, "come_deque_size(%s)", receiver->text);
+                return;
+            }
+            if (strcmp(method, "values") == 0) {
+                fprintf(f, "come_deque_values_of(COME_CTX, %s, %s)", receiver->text, val_array);
+                return;
+            }
+            // Typed: push_x(v) -> (q, T, v), pop_x()/front()/back() -> (q, T), get(i) -> (q, i, T),
+            // set(i, v) -> (q, i, T, v)
+            int push = strncmp(method, "push_", 5) == 0;
+            int typed = push || strncmp(method, "pop_", 4) == 0 || strcmp(method, "front") == 0 ||
+                        strcmp(method, "back") == 0 || strcmp(method, "get") == 0 || strcmp(method, "set") == 0;
+            fprintf(f, "come_deque_%s(%s", method, receiver->text);
+            if (typed && (push || node->child_count == 1)) fprintf(f, ", %s", val_type);
+            for (int i = 1; i < node->child_count; i++) {
+                fprintf(f, ", ");
+                if (typed && (push || i == 2)) generate_map_value(f, receiver->text, node->children[i], val_type);
+                else generate_expression(f, node->children[i]);
+                if (typed && !push && i == 1) fprintf(f, ", %s", val_type);
+            }
+            fprintf(f, ")");
+            return;
+        }
+        // heap<T>: push(v, priority) returns a handle for decrease_key / remove / get /
+        // contains / priority; push(v) uses v as its own priority
+        else if (is_heap_variable(receiver, val_type, val_array, sizeof(val_type))) {
+            if (strcmp(method, "size") == 0 || strcmp(method, "len") == 0 || strcmp(method, "length") == 0) {
+                fprintf(f, "come_heap_size(%s)", receiver->text);
+                return;
+            }
+            if (strcmp(method, "push") == 0 && node->child_count > 1) {
+                fprintf(f, "come_heap_push(%s, %s, ", receiver->text, val_type);
+                generate_map_value(f, receiver->text, node->children[1], val_type);
+                fprintf(f, ", (int64_t)(");
+                generate_expression(f, node->children[node->child_count > 2 ? 2 : 1]);
+                fprintf(f, "))");
+                return;
+            }
+            if (strcmp(method, "priority") == 0 && node->child_count == 1) method = "top_priority";
+            int typed = strcmp(method, "pop") == 0 || strcmp(method, "peek") == 0 || strcmp(method, "get") == 0;
+            fprintf(f, "come_heap_%s(%s", method, receiver->text);
+            for (int i = 1; i < node->child_count; i++) {
+                fprintf(f, ", ");
+                generate_expression(f, node->children[i]);
+            }
+            if (typed) fprintf(f, ", %s", val_type);
+            fprintf(f, ")");
+            return;
+        }
+        // lru<K,V>: get moves the entry to the front, peek and has do not; put evicts
+        else if (is_lru_variable(receiver, &string_key, val_type, val_array, sizeof(val_type))) {
+            if (strcmp(method, "size") == 0 || strcmp(method, "len") == 0 || strcmp(method, "length") == 0) {
+                fprintf(f, "come_lru_size(%s)", receiver->text);
+                return;
+            }
+            if (strcmp(method, "keys") == 0) {
+                fprintf(f, "((%s*)come_lru_keys(COME_CTX, %s))", string_key ? "come_string_list_t" : "come_long_array_t", receiver->text);
+                return;
+            }
+            if (strcmp(method, "put") == 0) method = "set";
+            int typed = strcmp(method, "get") == 0 || strcmp(method, "peek") == 0 || strcmp(method, "set") == 0;
+            fprintf(f, "come_lru_%s(%s", method, receiver->text);
+            for (int i = 1; i < node->child_count; i++) {
+                fprintf(f, ", ");
+                if (i == 2 && strcmp(method, "set") == 0) generate_map_value(f, receiver->text, node->children[i], val_type);
+                else generate_expression(f, node->children[i]);
+                if (i == 1 && typed) fprintf(f, ", %s", val_type);
+            }
+            fprintf(f, ")");
+            return;
+        }
+        // ringbuf: bytes in and out as views, recv/send flags default to 0
+        else if (receiver->type == AST_IDENTIFIER && get_local_variable_type(receiver->text) &&
+                 strcmp(get_local_variable_type(receiver->text), "ringbuf") == 0) {
+            if (strcmp(method, "len") == 0 || strcmp(method, "length") == 0) method = "size";
+            fprintf(f, "come_ringbuf_%s(%s", method, receiver->text);
+            for (int i = 1; i < node->child_count; i++) {
+                fprintf(f, ", ");
+                if (strcmp(method, "read") == 0 || strcmp(method, "write") == 0) {
+                    fprintf(f, "COME_BYTES(");
+                    generate_expression(f, node->children[i]);
+                    fprintf(f, ")");
+                } else {
+                    generate_expression(f, node->children[i]);
+                }
+            }
+            if ((strcmp(method, "recv") == 0 || strcmp(method, "send") == 0) && node->child_count == 2) fprintf(f, ", 0");
+            fprintf(f, ")");
+            return;
+        }
+        // ordered_map cursors are values: methods take their address
+        else if (is_ordered_iter_variable(receiver, &string_key, val_type, val_array, sizeof(val_type))) {
+            if (strcmp(method, "key") == 0) {
+                fprintf(f, "come_ordered_map_iter_%s_key(&%s)", string_key ? "string" : "int", receiver->text);
+            } else if (strcmp(method, "value") == 0) {
+                fprintf(f, "(*(%s*)come_ordered_map_iter_value(&%s))", val_type, receiver->text);
+            } else {
+                fprintf(f, "come_ordered_map_iter_%s(&%s)", method, receiver->text);
+            }
+            return;
+        }
+        // soa T[]: the header never moves, so growing methods need no reassignment
+        else if (is_soa_variable(receiver, soa, sizeof(soa))) {
+            if (strcmp(method, "size") == 0 || strcmp(method, "len") == 0 || strcmp(method, "length") == 0) {
+                fprintf(f, "(%s)->count", receiver->text);
+                return;
+            }
+            fprintf(f, "come_%s_soa_%s(%s", soa, method, receiver->text);
+            for (int i = 1; i < node->child_count; i++) {
+                fprintf(f, ", ");
+                generate_expression(f, node->children[i]);
+            }
+            fprintf(f, ")");
+            return;
+        }
+        // bool[]: bit operations; push and resize may move the bitset
+        else if (is_bits_variable(receiver)) {
+            if (strcmp(method, "size") == 0 || strcmp(method, "len") == 0 || strcmp(method, "length") == 0) {
+                fprintf(f, "come_array_size(%s)", receiver->text);
+                return;
+            }
+            int moves = strcmp(method, "push") == 0 || strcmp(method, "resize") == 0;
+            if (moves) fprintf(f, "(%s = ", receiver->text);
+            fprintf(f, "come_bool_array_%s(%s", method, receiver->text);
+            for (int i = 1; i < node->child_count; i++) {
+                fprintf(f, ", ");
+                generate_expression(f, node->children[i]);
+            }
+            fprintf(f, moves ? "))" : ")");
+            return;
+        }
+        // Views (T[:]): size, sub-views, explicit copy, read-only kernels and byte readers
+        else if (is_view_variable(receiver)) {
+            char prefix[128];
+            array_func_prefix(get_local_variable_type(receiver->text), prefix, sizeof(prefix));
+            if (strcmp(method, "size") == 0 || strcmp(method, "len") == 0 || strcmp(method, "length") == 0) {
+                fprintf(f, "(%s).count", receiver->text);
+                return;
+            }
+            if (strcmp(method, "view") == 0 || strcmp(method, "slice") == 0) fprintf(f, "%s_view_slice(%s", prefix, receiver->text);
+            else if (strcmp(method, "copy") == 0) fprintf(f, "%s_view_copy(COME_CTX, %s", prefix, receiver->text);
+            else if (is_byte_reader(method)) fprintf(f, "come_bytes_%s(%s", method, receiver->text);
+            else fprintf(f, "come_array_%s(%s", method, receiver->text);
+            for (int i = 1; i < node->child_count; i++) {
+                fprintf(f, ", ");
+                if (strcmp(method, "binary_search") == 0 && node->children[i]->type == AST_STRING_LITERAL) {
+                    fprintf(f, "come_string_new(COME_CTX, ");
+                    generate_expression(f, node->children[i]);
+                    fprintf(f, ")");
+                } else {
+                    generate_expression(f, node->children[i]);
+                }
+            }
+            if ((strcmp(method, "view") == 0 || strcmp(method, "slice") == 0) && node->child_count < 3) {
+                fprintf(f, node->child_count == 1 ? ", 0, UINT32_MAX" : ", UINT32_MAX");
+            }
+            fprintf(f, ")");
+            return;
+        }
+        // a.view(start, end): zero-copy view of an array; byte[] also reads integers in place
+        else if (is_array_variable(receiver) && (strcmp(method, "view") == 0 || is_byte_reader(method))) {
+            char prefix[128];
+            array_func_prefix(get_local_variable_type(receiver->text), prefix, sizeof(prefix));
+            if (strcmp(method, "view") == 0) fprintf(f, "%s_view(%s", prefix, receiver->text);
+            else fprintf(f, "come_bytes_%s(COME_BYTES(%s)", method, receiver->text);
+            for (int i = 1; i < node->child_count; i++) {
+                fprintf(f, ", ");
+                generate_expression(f, node->children[i]);
+            }
+            if (strcmp(method, "view") == 0 && node->child_count < 3) {
+                fprintf(f, node->child_count == 1 ? ", 0, UINT32_MAX" : ", UINT32_MAX");
+            }
+            fprintf(f, ")");
+            return;
+        }
+        // Array kernels; count and add are string methods too, so the receiver decides
+        else if (is_array_variable(receiver) && is_array_kernel(method)) {
+            snprintf(c_func, sizeof(c_func), "come_array_%s", method);
+        }
         // Detect String methods
         else if (strcmp(method, "length") == 0 || strcmp(method, "len") == 0 || 
                  strcmp(method, "cmp") == 0 || strcmp(method, "casecmp") == 0 ||
@@ -424,15 +1493,31 @@ static void generate_expression(FILE* f, ASTNode* node) {
                  strcmp(method, "replace") == 0 || strcmp(method, "split") == 0 ||
                  strcmp(method, "join") == 0 || strcmp(method, "substr") == 0 || 
                  strcmp(method, "find") == 0 || strcmp(method, "rfind") == 0 || strcmp(method, "count") == 0 ||
+                 strcmp(method, "find_any") == 0 || strcmp(method, "count_any") == 0 || strcmp(method, "replace_many") == 0 ||
                  strcmp(method, "chr") == 0 || strcmp(method, "rchr") == 0 || strcmp(method, "memchr") == 0 ||
                  strcmp(method, "isdigit") == 0 || strcmp(method, "isalpha") == 0 || 
                  strcmp(method, "isalnum") == 0 || strcmp(method, "isspace") == 0 || strcmp(method, "isascii") == 0 ||
+                 strcmp(method, "utf8") == 0 ||
+                 strcmp(method, "upper_inplace") == 0 || strcmp(method, "lower_inplace") == 0 ||
+                 strcmp(method, "caseeq") == 0 || strcmp(method, "casehash") == 0 ||
+                 strcmp(method, "hash") == 0 || strcmp(method, "intern") == 0 ||
+                 strcmp(method, "share") == 0 ||
                  strcmp(method, "repeat") == 0 || strcmp(method, "split_n") == 0 ||
                  strcmp(method, "regex") == 0 || strncmp(method, "regex_", 6) == 0 ||
                  strcmp(method, "chown") == 0 ||
-                 strcmp(method, "tol") == 0 ||
+                 strcmp(method, "tol") == 0 || strcmp(method, "tod") == 0 ||
                  strcmp(method, "byte_array") == 0) {
                  
+            // replace_many(map): old -> new for each entry
+            if (strcmp(method, "replace_many") == 0 && node->child_count == 2 &&
+                is_string_map_variable(node->children[1])) {
+                fprintf(f, "({ void* _kv = mem_talloc_new_ctx(NULL); come_string_t* _kr = come_string_replace_many_kv(");
+                generate_expression(f, receiver);
+                fprintf(f, ", ");
+                generate_string_map_lists(f, node->children[1], "_kv");
+                fprintf(f, "); mem_talloc_free(_kv); _kr; })");
+                return;
+            }
             if (strcmp(method, "length") == 0) strcpy(c_func, "come_string_list_len"); 
             else if (strcmp(method, "tol") == 0) strcpy(c_func, "come_string_tol");
             else snprintf(c_func, sizeof(c_func), "come_string_%s", method);
@@ -444,7 +1529,14 @@ static void generate_expression(FILE* f, ASTNode* node) {
              
         }
         // Detect Array methods
-        else if (strcmp(method, "size") == 0 || strcmp(method, "resize") == 0 || strcmp(method, "free") == 0 || strcmp(method, "slice") == 0) {
+        else if (strcmp(method, "size") == 0 || strcmp(method, "resize") == 0 || strcmp(method, "free") == 0 || strcmp(method, "slice") == 0 ||
+                 (is_array_variable(receiver) &&
+                  (strcmp(method, "push") == 0 || strcmp(method, "pop") == 0 || strcmp(method, "append") == 0 ||
+                   strcmp(method, "insert") == 0 || strcmp(method, "remove") == 0 || strcmp(method, "reserve") == 0 ||
+                   strcmp(method, "shrink_to_fit") == 0 || strcmp(method, "sort") == 0 ||
+                   strcmp(method, "sort_by") == 0 || strcmp(method, "stable_sort") == 0 ||
+                   strcmp(method, "partial_sort") == 0 || strcmp(method, "binary_search") == 0 ||
+                   strcmp(method, "unique") == 0))) {
              if (strcmp(method, "free") == 0) strcpy(c_func, "come_free");
              else if (strcmp(method, "size") == 0) strcpy(c_func, "come_array_size");
              else if (strcmp(method, "slice") == 0) strcpy(c_func, "come_array_slice");
@@ -502,7 +1594,12 @@ static void generate_expression(FILE* f, ASTNode* node) {
         int first_arg = 1;
         
         // Append ctx for specific functions?
-        if (strcmp(c_func, "come_string_sprintf") == 0) {
+        if (strcmp(c_func, "come_string_sprintf") == 0 || strcmp(c_func, "come_regex_new") == 0 ||
+            strcmp(c_func, "come_regex_dfa") == 0 || strcmp(c_func, "come_rope_new") == 0 ||
+            strcmp(c_func, "come_string_matcher_new") == 0 || strcmp(c_func, "come_string_replacer_new") == 0 ||
+            strcmp(c_func, "come_ringbuf_new") == 0 || strcmp(c_func, "mem_talloc_pool") == 0 ||
+            strcmp(c_func, "come_conv_ltos") == 0 || strcmp(c_func, "come_conv_dtos") == 0 ||
+            is_conv_encoding(c_func)) {
             fprintf(f, "COME_CTX");
             first_arg = 0;
         }
@@ -538,6 +1635,11 @@ static void generate_expression(FILE* f, ASTNode* node) {
                      fprintf(f, "come_string_new(NULL, ");
                      generate_expression(f, receiver);
                      fprintf(f, ")");
+                } else if (receiver->type == AST_IDENTIFIER &&
+                           (strcmp(c_func, "come_string_upper_inplace") == 0 ||
+                            strcmp(c_func, "come_string_lower_inplace") == 0)) {
+                     // Copy-on-write: a shared string is swapped for a private copy first
+                     fprintf(f, "(%s = come_string_cow(%s, COME_CTX))", receiver->text, receiver->text);
                 } else {
                      generate_expression(f, receiver);
                 }
@@ -569,10 +1671,30 @@ static void generate_expression(FILE* f, ASTNode* node) {
              if (!first_arg) fprintf(f, ", ");
              
              // Wrapper logic for string methods
-             if ((strcmp(method, "cmp") == 0 || strcmp(method, "casecmp") == 0) && arg->type == AST_STRING_LITERAL) {
+             if ((strcmp(method, "cmp") == 0 || strcmp(method, "casecmp") == 0 || strcmp(method, "caseeq") == 0) &&
+                 arg->type == AST_STRING_LITERAL) {
                     fprintf(f, "come_string_new(NULL, ");
                     generate_expression(f, arg);
                     fprintf(f, ")");
+             } else if ((strcmp(c_func, "come_array_push") == 0 || strcmp(c_func, "come_array_insert") == 0) &&
+                        arg->type == AST_STRING_LITERAL) {
+                    // string[]: the element is a come_string_t* owned by the module context
+                    fprintf(f, "come_string_new(COME_CTX, ");
+                    generate_expression(f, arg);
+                    fprintf(f, ")");
+             } else if (strcmp(c_func, "come_array_binary_search") == 0 && arg->type == AST_STRING_LITERAL) {
+                    fprintf(f, "come_string_new(COME_CTX, ");
+                    generate_expression(f, arg);
+                    fprintf(f, ")");
+             } else if ((strcmp(c_func, "come_array_sort_by") == 0 || strcmp(c_func, "come_array_stable_sort") == 0) &&
+                        arg->type == AST_IDENTIFIER && !get_local_variable_type(arg->text)) {
+                    // Comparator named by its COME function
+                    fprintf(f, "come_%s__%s", current_module, arg->text);
+             } else if (strncmp(c_func, "come_rope_", 10) == 0 && arg->type == AST_STRING_LITERAL) {
+                    // Ropes copy or share their text, so it lives with the caller's context
+                    fprintf(f, "come_string_new(COME_CTX, ");
+                    generate_expression(f, arg);
+                    fprintf(f, ")");
              } else {
                  generate_expression(f, arg);
              }
@@ -586,7 +1708,13 @@ static void generate_expression(FILE* f, ASTNode* node) {
         if (strcmp(method, "replace") == 0 && node->child_count == 3) {
             fputs(", 0", f);
         }
-        if (strcmp(method, "regex_split") == 0 && node->child_count == 2) {
+        if (strcmp(c_func, "come_string_tol") == 0 && node->child_count == 1) {
+            fputs(", 10", f);
+        }
+        if (strcmp(c_func, "come_rope_new") == 0 && node->child_count == 1) {
+            fputs(", NULL", f);
+        }
+        if ((strcmp(method, "regex_split") == 0 || strcmp(c_func, "come_regex_split") == 0) && node->child_count == 2) {
             fputs(", 0", f);
         }
         if (strcmp(method, "regex_replace") == 0 && node->child_count == 3) {
@@ -720,6 +1848,27 @@ static void generate_expression(FILE* f, ASTNode* node) {
 
 static void generate_node(FILE* f, ASTNode* node, int indent);
 
+// Statements of a scope block, or the one statement of a scoped loop body
+static void generate_scope_body(FILE* f, ASTNode* body, int indent) {
+    if (body->type != AST_BLOCK) {
+        generate_node(f, body, indent);
+        return;
+    }
+    for (int i = 0; i < body->child_count; i++) generate_node(f, body->children[i], indent);
+}
+
+// Whether the current function returns a context-owned object (a string, array, map or
+// queue) and value may be one
+// 1 for an object, 2 for an array whose elements are objects too
+static int returns_object(ASTNode* value) {
+    char c_type[128];
+    const char* type = current_function_return_type;
+    if (value->type == AST_STRING_LITERAL || (value->type == AST_IDENTIFIER && strcmp(value->text, "NULL") == 0)) return 0;
+    if (strcmp(type, "string") == 0 || strcmp(type, "rope") == 0 || strcmp(type, "ringbuf") == 0) return 1;
+    if (!array_c_type(type, c_type, sizeof(c_type)) || strstr(type, "[:]") || strncmp(type, "const ", 6) == 0) return 0;
+    return strcmp(c_type, "come_string_list_t*") == 0 ? 2 : 1;
+}
+
 static void generate_program(FILE* f, ASTNode* node) {
     for (int i = 0; i < node->child_count; i++) {
         generate_node(f, node->children[i], 0);
@@ -812,7 +1961,9 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
         
         // Return type
         // Handle "byte" etc alias?? no, just print text
-        fprintf(f, "%s %s(", ret_type->text, func_name);
+        char ret_arr[128];
+        if (array_c_type(ret_type->text, ret_arr, sizeof(ret_arr))) fprintf(f, "%s %s(", ret_arr, func_name);
+        else fprintf(f, "%s %s(", ret_type->text, func_name);
         
         // Args
         int has_args = 0;
@@ -837,15 +1988,10 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                 ASTNode* type = arg->children[1];
                 
                 // array?
-                if (strstr(type->text, "[]")) {
-                    // int input[] -> come_int_array_t* input
-                     char raw[64];
-                     strncpy(raw, type->text, strlen(type->text)-2);
-                     raw[strlen(type->text)-2] = 0;
-                     if (strcmp(raw, "int")==0) fprintf(f, "come_int_array_t* %s", arg->text);
-                     else if (strcmp(raw, "byte")==0) fprintf(f, "come_byte_array_t* %s", arg->text);
-                     else if (strcmp(raw, "string")==0) fprintf(f, "come_string_list_t* %s", arg->text);
-                     else fprintf(f, "come_array_t* %s", arg->text);
+                char arr_type[128];
+                if (array_c_type(type->text, arr_type, sizeof(arr_type))) {
+                    // int input[] -> come_int_array_t* input, int input[:] -> come_int_array_view_t input
+                     fprintf(f, "%s %s", arr_type, arg->text);
                 } else if (is_main && strncmp(arg->text, "args", 4) == 0 && (strcmp(type->text, "string") == 0 || strcmp(type->text, "string[]") == 0)) {
                     // special case for main(string args) -> we pass string list
                     fprintf(f, "come_string_list_t* %s", arg->text);
@@ -876,9 +2022,11 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
             }
 
             
+            current_function_body = body;
             for (int i = 0; i < body->child_count; i++) {
                 generate_node(f, body->children[i], indent + 4);
             }
+            current_function_body = NULL;
             if (is_main) {
                 emit_indent(f, indent + 4);
                 fprintf(f, "return 0;\n");
@@ -903,9 +2051,32 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
     case AST_VAR_DECL: {
         emit_line_directive(f, node);  // Emit #line for variable declaration
         ASTNode* type_node = node->children[1];
-        add_local_variable(node->text, type_node->text);
-
         ASTNode* init_expr = node->children[0];
+        char soa[64];
+        char val_type[64];
+        char val_array[64];
+        int string_key = 0;
+        int declared_const = strncmp(type_node->text, "const ", 6) == 0;
+        if (declared_const) memmove(type_node->text, type_node->text + 6, strlen(type_node->text + 6) + 1);
+        if (strcmp(type_node->text, "map") == 0 || strcmp(type_node->text, "ordered_map") == 0) infer_map_type(type_node, init_expr);
+        int ordered_map = strncmp(type_node->text, "ordered_map", 11) == 0;
+        int const_map = !ordered_map && map_types(type_node->text, &string_key, val_type, val_array, sizeof(val_type)) &&
+                        is_const_map(node, declared_const, string_key, val_type);
+        // var it = m.first() / m.lower_bound(k) / m.range(lo, hi) on an ordered map is a cursor
+        if (strcmp(type_node->text, "var") == 0 && init_expr && init_expr->type == AST_METHOD_CALL &&
+            (strcmp(init_expr->text, "first") == 0 || strcmp(init_expr->text, "lower_bound") == 0 ||
+             strcmp(init_expr->text, "range") == 0) &&
+            strcmp(map_func_prefix(init_expr->children[0]), "come_ordered_map") == 0) {
+            snprintf(type_node->text, sizeof(type_node->text), "ordered_map_iter%s",
+                     get_local_variable_type(init_expr->children[0]->text) + 11);
+        }
+        if (const_map) {
+            char const_type[128];
+            snprintf(const_type, sizeof(const_type), "const %.120s", type_node->text);
+            add_local_variable(node->text, const_type);
+        } else {
+            add_local_variable(node->text, type_node->text);
+        }
         
         emit_indent(f, indent);
             if (strcmp(type_node->text, "string") == 0) {
@@ -933,6 +2104,10 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                 fprintf(f, "bool %s = ", node->text);
                 generate_expression(f, init_expr);
                 fprintf(f, ";\n");
+            } else if (strncmp(type_node->text, "ordered_map_iter<", 17) == 0) {
+                fprintf(f, "come_ordered_map_iter_t %s = ", node->text);
+                generate_expression(f, init_expr);
+                fprintf(f, ";\n");
             } else if (strcmp(type_node->text, "var") == 0) {
                 // Type inference
                 if (init_expr->type == AST_STRING_LITERAL) {
@@ -944,6 +2119,149 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                     generate_expression(f, init_expr);
                     fprintf(f, ";\n");
                 }
+            } else if (strncmp(type_node->text, "bool[", 5) == 0 && strcmp(type_node->text, "bool[:]") != 0) {
+                // Packed bitset: bool b[N] = [...] is N zero bits with the literal's bits set
+                int count = (init_expr && init_expr->type == AST_AGGREGATE_INIT) ? init_expr->child_count : 0;
+                int fixed_size = atoi(type_node->text + 5);
+                if (init_expr && init_expr->type != AST_AGGREGATE_INIT && !(init_expr->type == AST_NUMBER && strcmp(init_expr->text, "0") == 0)) {
+                    fprintf(f, "come_bool_array_t* %s = ", node->text);
+                    generate_expression(f, init_expr);
+                    fprintf(f, ";\n");
+                    break;
+                }
+                fprintf(f, "come_bool_array_t* %s = come_bool_array_new(COME_CTX, %d);\n", node->text, fixed_size > count ? fixed_size : count);
+                if (count > 0) {
+                    emit_indent(f, indent);
+                    fprintf(f, "{ bool _vals[] = ");
+                    generate_expression(f, init_expr);
+                    fprintf(f, "; for (uint32_t _i = 0; _i < %d; _i++) come_bool_array_put(%s, _i, _vals[_i]); }\n", count, node->text);
+                }
+            } else if (const_map) {
+                emit_const_map(f, node, string_key, val_type, indent);
+            } else if (map_types(type_node->text, &string_key, val_type, val_array, sizeof(val_type))) {
+                // Map literal: sized for its entries, then one bulk insert when every key is a
+                // literal (an ordered map given ascending keys builds its tree bottom-up)
+                const char* prefix = ordered_map ? "come_ordered_map" : "come_map";
+                int count = (init_expr && init_expr->type == AST_AGGREGATE_INIT) ? init_expr->child_count : 0;
+                if (init_expr && init_expr->type != AST_AGGREGATE_INIT && !(init_expr->type == AST_NUMBER && strcmp(init_expr->text, "0") == 0)) {
+                    fprintf(f, "%s_t* %s = ", prefix, node->text);
+                    generate_expression(f, init_expr);
+                    fprintf(f, ";\n");
+                    break;
+                }
+                if (ordered_map) {
+                    fprintf(f, "come_ordered_map_t* %s = come_ordered_map_new(COME_CTX, %s, sizeof(%s));\n", node->text,
+                            string_key ? "COME_MAP_STRING" : "COME_MAP_INT", val_type);
+                } else {
+                    fprintf(f, "come_map_t* %s = come_map_new(COME_CTX, %s, sizeof(%s), %d);\n", node->text,
+                            string_key ? "COME_MAP_STRING" : "COME_MAP_INT", val_type, count);
+                }
+                int literal_keys = 1;
+                for (int i = 0; i < count; i++) {
+                    ASTNode* pair = init_expr->children[i];
+                    if (pair->type != AST_ASSIGN || strcmp(pair->text, ":") != 0) {
+                        fprintf(stderr, "Error: map literal entries are key: value\n");
+                        exit(1);
+                    }
+                    if (pair->children[0]->type != (string_key ? AST_STRING_LITERAL : AST_NUMBER)) literal_keys = 0;
+                }
+                if (count > 0 && literal_keys) {
+                    emit_indent(f, indent);
+                    fprintf(f, "{ static const %s _keys[] = {", string_key ? "char* const" : "int64_t");
+                    for (int i = 0; i < count; i++) {
+                        if (i > 0) fprintf(f, ", ");
+                        generate_expression(f, init_expr->children[i]->children[0]);
+                    }
+                    fprintf(f, "}; %s _vals[] = {", val_type);
+                    for (int i = 0; i < count; i++) {
+                        if (i > 0) fprintf(f, ", ");
+                        generate_map_value(f, node->text, init_expr->children[i]->children[1], val_type);
+                    }
+                    fprintf(f, "}; %s_put_all(%s, _keys, _vals, %d); }\n", prefix, node->text, count);
+                } else {
+                    for (int i = 0; i < count; i++) {
+                        emit_indent(f, indent);
+                        fprintf(f, "%s_set(%s, ", prefix, node->text);
+                        generate_expression(f, init_expr->children[i]->children[0]);
+                        fprintf(f, ", %s, ", val_type);
+                        generate_map_value(f, node->text, init_expr->children[i]->children[1], val_type);
+                        fprintf(f, ");\n");
+                    }
+                }
+            } else if (deque_types(type_node->text, val_type, val_array, sizeof(val_type))) {
+                // deque<T> q = [...]: sized for the literal, its elements pushed in order
+                int count = (init_expr && init_expr->type == AST_AGGREGATE_INIT) ? init_expr->child_count : 0;
+                if (init_expr && init_expr->type != AST_AGGREGATE_INIT && !(init_expr->type == AST_NUMBER && strcmp(init_expr->text, "0") == 0)) {
+                    fprintf(f, "come_deque_t* %s = ", node->text);
+                    generate_expression(f, init_expr);
+                    fprintf(f, ";\n");
+                    break;
+                }
+                fprintf(f, "come_deque_t* %s = come_deque_new(COME_CTX, sizeof(%s), %d);\n", node->text, val_type, count);
+                for (int i = 0; i < count; i++) {
+                    emit_indent(f, indent);
+                    fprintf(f, "come_deque_push_back(%s, %s, ", node->text, val_type);
+                    generate_map_value(f, node->text, init_expr->children[i], val_type);
+                    fprintf(f, ");\n");
+                }
+            } else if (heap_types(type_node->text, val_type, val_array, sizeof(val_type))) {
+                // heap<T> q = [...]: each element pushed with itself as its priority
+                int count = (init_expr && init_expr->type == AST_AGGREGATE_INIT) ? init_expr->child_count : 0;
+                if (init_expr && init_expr->type != AST_AGGREGATE_INIT && !(init_expr->type == AST_NUMBER && strcmp(init_expr->text, "0") == 0)) {
+                    fprintf(f, "come_heap_t* %s = ", node->text);
+                    generate_expression(f, init_expr);
+                    fprintf(f, ";\n");
+                    break;
+                }
+                fprintf(f, "come_heap_t* %s = come_heap_new(COME_CTX, sizeof(%s), %d);\n", node->text, val_type, count);
+                for (int i = 0; i < count; i++) {
+                    emit_indent(f, indent);
+                    fprintf(f, "come_heap_push(%s, %s, ", node->text, val_type);
+                    generate_expression(f, init_expr->children[i]);
+                    fprintf(f, ", (int64_t)(");
+                    generate_expression(f, init_expr->children[i]);
+                    fprintf(f, "));\n");
+                }
+            } else if (lru_types(type_node->text, &string_key, val_type, val_array, sizeof(val_type))) {
+                // lru<K,V> c = lru.new(max_count[, max_bytes]): the key and value kinds come
+                // from the declared type. String values are copied into their entries.
+                ASTNode* call = init_expr;
+                if (!call || call->type != AST_METHOD_CALL || strcmp(call->text, "new") != 0 ||
+                    call->children[0]->type != AST_IDENTIFIER || strcmp(call->children[0]->text, "lru") != 0 ||
+                    call->child_count < 2 || call->child_count > 3) {
+                    fprintf(f, "come_lru_t* %s = ", node->text);
+                    if (call) generate_expression(f, call);
+                    else fprintf(f, "NULL");
+                    fprintf(f, ";\n");
+                    break;
+                }
+                int string_value = strcmp(val_type, "come_string_t*") == 0;
+                fprintf(f, "come_lru_t* %s = come_lru_new(COME_CTX, %s, sizeof(%s), %s, ", node->text,
+                        string_key ? "COME_MAP_STRING" : "COME_MAP_INT", val_type,
+                        string_value ? "COME_LRU_VALUE_STRING" : "COME_LRU_VALUE_PLAIN");
+                generate_expression(f, call->children[1]);
+                fprintf(f, ", ");
+                if (call->child_count == 3) generate_expression(f, call->children[2]);
+                else fprintf(f, "0");
+                fprintf(f, ");\n");
+            } else if (soa_struct_name(type_node->text, soa, sizeof(soa))) {
+                // soa T s[N] = [...]: N zeroed records, then the literal's records scattered in
+                const char* lbracket = strchr(type_node->text, '[');
+                int count = (init_expr && init_expr->type == AST_AGGREGATE_INIT) ? init_expr->child_count : 0;
+                int fixed_size = atoi(lbracket + 1);
+                if (init_expr && init_expr->type != AST_AGGREGATE_INIT && !(init_expr->type == AST_NUMBER && strcmp(init_expr->text, "0") == 0)) {
+                    fprintf(f, "come_%s_soa_t* %s = ", soa, node->text);
+                    generate_expression(f, init_expr);
+                    fprintf(f, ";\n");
+                    break;
+                }
+                fprintf(f, "come_%s_soa_t* %s = come_%s_soa_new(COME_CTX, %d);\n", soa, node->text, soa, fixed_size > count ? fixed_size : count);
+                if (count > 0) {
+                    emit_indent(f, indent);
+                    fprintf(f, "{ struct %s _vals[] = ", soa);
+                    generate_expression(f, init_expr);
+                    fprintf(f, "; for (uint32_t _i = 0; _i < %d; _i++) come_%s_soa_set(%s, _i, _vals[_i]); }\n", count, soa, node->text);
+                }
             } else {
                 // Generic case: T x = ...
                 // Check if type ends in []
@@ -960,41 +2278,42 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
 
                     char arr_type[128];
                     char elem_type[64];
-                    strcpy(elem_type, raw_type);
-                    if (strcmp(raw_type, "int")==0) { strcpy(arr_type, "come_int_array_t"); }
-                    else if (strcmp(raw_type, "byte")==0) { strcpy(arr_type, "come_byte_array_t"); strcpy(elem_type, "uint8_t"); }
-                    else if (strcmp(raw_type, "var")==0) { strcpy(arr_type, "come_int_array_t"); strcpy(elem_type, "int"); }
-                    else { snprintf(arr_type, sizeof(arr_type), "come_array_%s_t", raw_type); }
+                    array_type_names(raw_type, arr_type, sizeof(arr_type), elem_type, sizeof(elem_type));
+                    if (lbracket[1] == ':') {
+                        // View: a value, empty until assigned
+                        char view_type[128];
+                        array_view_name(arr_type, view_type, sizeof(view_type));
+                        fprintf(f, "%s %s = ", view_type, node->text);
+                        if (!init_expr || (init_expr->type == AST_NUMBER && strcmp(init_expr->text, "0") == 0)) fprintf(f, "{0}");
+                        else generate_expression(f, init_expr);
+                        fprintf(f, ";\n");
+                        break;
+                    }
+                    // The parser's default initializer for a bare "T x[N]"; module-level arrays
+                    // (indent 0) keep it, as NULL is a valid empty array and C needs a constant
+                    if (indent > 0 && init_expr && init_expr->type == AST_NUMBER && strcmp(init_expr->text, "0") == 0) init_expr = NULL;
                     
                     if (init_expr && init_expr->type == AST_AGGREGATE_INIT) {
                         int count = init_expr->child_count;
                         int alloc_count = (fixed_size > count) ? fixed_size : count;
                         
-                        fprintf(f, "%s* %s = (%s*)mem_talloc_alloc(COME_CTX, sizeof(uint32_t)*2 + %d * sizeof(%s));\n", 
-                                arr_type, node->text, arr_type, alloc_count, elem_type);
+                        fprintf(f, "%s* %s = COME_ARRAY_NEW(COME_CTX, %s, %d);\n", arr_type, node->text, arr_type, alloc_count);
                         emit_indent(f, indent);
-                        fprintf(f, "%s->size = %d; %s->count = %d;\n", node->text, alloc_count, node->text, count);
-                        emit_indent(f, indent);
-                        fprintf(f, "{ %s _vals[] = ", elem_type);
-                        generate_expression(f, init_expr);
-                        fprintf(f, "; memcpy(%s->items, _vals, sizeof(_vals)); }\n", node->text);
+                        fprintf(f, "%s->count = %d;\n", node->text, count);
+                        if (count > 0) { // [] has nothing to copy
+                            emit_indent(f, indent);
+                            fprintf(f, "{ %s _vals[] = ", elem_type);
+                            generate_expression(f, init_expr);
+                            fprintf(f, "; memcpy(%s->items, _vals, sizeof(_vals)); }\n", node->text);
+                        }
                     } else if (init_expr) {
                         // Initialized from expression (e.g. slice, function return)
                         fprintf(f, "%s* %s = ", arr_type, node->text);
                         generate_expression(f, init_expr);
                         fprintf(f, ";\n");
-                    } else if (fixed_size > 0) {
-                        fprintf(f, "%s* %s = (%s*)mem_talloc_alloc(COME_CTX, sizeof(uint32_t)*2 + %d * sizeof(%s));\n", 
-                                arr_type, node->text, arr_type, fixed_size, elem_type);
-                        emit_indent(f, indent);
-                        fprintf(f, "memset(%s->items, 0, %d * sizeof(%s));\n", node->text, fixed_size, elem_type);
-                        emit_indent(f, indent);
-                        fprintf(f, "%s->size = %d; %s->count = %d;\n", node->text, fixed_size, node->text, fixed_size);
                     } else {
-                        // Empty dynamic
-                        fprintf(f, "%s* %s = (%s*)mem_talloc_alloc(COME_CTX, sizeof(uint32_t)*2);\n", arr_type, node->text, arr_type);
-                        emit_indent(f, indent);
-                        fprintf(f, "%s->size = 0; %s->count = 0;\n", node->text, node->text);
+                        // Fixed size: zeroed items; empty dynamic: no items yet
+                        fprintf(f, "%s* %s = COME_ARRAY_NEW(COME_CTX, %s, %d);\n", arr_type, node->text, arr_type, fixed_size);
                     }
                 }
  else {
@@ -1050,7 +2369,7 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                      }
                 } else if (arg->type == AST_METHOD_CALL) {
                     char* m = arg->text;
-                    if (strcmp(m, "upper")==0 || strcmp(m, "lower")==0 || strcmp(m, "repeat")==0 || strcmp(m, "replace")==0 || strcmp(m, "trim")==0 || strcmp(m, "ltrim")==0 || strcmp(m, "rtrim")==0 || strcmp(m, "join")==0 || strcmp(m, "substr")==0 || strcmp(m, "regex_replace")==0) {
+                    if (strcmp(m, "upper")==0 || strcmp(m, "lower")==0 || strcmp(m, "repeat")==0 || strcmp(m, "replace")==0 || strcmp(m, "replace_many")==0 || strcmp(m, "trim")==0 || strcmp(m, "ltrim")==0 || strcmp(m, "rtrim")==0 || strcmp(m, "join")==0 || strcmp(m, "substr")==0 || strcmp(m, "regex_replace")==0) {
                          fprintf(f, "(");
                          generate_expression(f, arg);
                          fprintf(f, ")->data");
@@ -1123,6 +2442,67 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
             break;
         }
 
+        case AST_SCOPE: {
+            // Allocations inside go to a local that shadows the module context (COME_CTX
+            // names it): a new pool freed on the way out, or scope(p) with a pool variable
+            // p, emptied instead. A loop gets one pool, emptied after every iteration.
+            ASTNode* arg = node->children[0];
+            ASTNode* body = node->children[1];
+            if (strcmp(node->text, "iteration") == 0) {
+                emit_indent(f, indent);
+                fprintf(f, "{\n");
+                emit_indent(f, indent + 4);
+                fprintf(f, "TALLOC_CTX* COME_CTX __attribute__((unused, cleanup(mem_talloc_scope_reset))) = %s;\n", arg->text);
+                generate_scope_body(f, body, indent + 4);
+                emit_indent(f, indent);
+                fprintf(f, "}\n");
+                break;
+            }
+            int id = ++scope_count;
+            const char* arg_type = arg && arg->type == AST_IDENTIFIER ? get_local_variable_type(arg->text) : NULL;
+            int reuse = arg_type && strcmp(arg_type, "pool") == 0;
+            int loop = body->type == AST_FOR || body->type == AST_WHILE || body->type == AST_DO_WHILE;
+            if (!scope_outer_id) scope_outer_id = id;
+            emit_line_directive(f, node);
+            emit_indent(f, indent);
+            fprintf(f, "{\n");
+            emit_indent(f, indent + 4);
+            fprintf(f, "TALLOC_CTX* _come_outer_%d __attribute__((unused)) = COME_CTX;\n", id);
+            emit_indent(f, indent + 4);
+            if (reuse) {
+                fprintf(f, "TALLOC_CTX* _come_scope_%d = %s;\n", id, arg->text);
+            } else {
+                fprintf(f, "TALLOC_CTX* _come_scope_%d __attribute__((cleanup(mem_talloc_scope_free))) = mem_talloc_pool(_come_outer_%d, ", id, id);
+                if (arg) generate_expression(f, arg);
+                else fprintf(f, "MEM_TALLOC_SCOPE_POOL");
+                fprintf(f, ");\n");
+            }
+            if (loop) {
+                // The loop runs with its body wrapped in an iteration scope on _come_scope_N
+                int body_idx = body->type == AST_FOR ? 3 : body->type == AST_WHILE ? 1 : 0;
+                ASTNode* loop_body = body->children[body_idx];
+                ASTNode* iteration = ast_new(AST_SCOPE);
+                strcpy(iteration->text, "iteration");
+                iteration->children[iteration->child_count++] = ast_new(AST_IDENTIFIER);
+                snprintf(iteration->children[0]->text, sizeof(iteration->children[0]->text), "_come_scope_%d", id);
+                iteration->children[iteration->child_count++] = loop_body;
+                body->children[body_idx] = iteration;
+                generate_node(f, body, indent + 4);
+                body->children[body_idx] = loop_body;
+                iteration->child_count = 1;
+                ast_free(iteration);
+            } else {
+                emit_indent(f, indent + 4);
+                fprintf(f, "TALLOC_CTX* COME_CTX __attribute__((unused%s)) = _come_scope_%d;\n",
+                        reuse ? ", cleanup(mem_talloc_scope_reset)" : "", id);
+                generate_scope_body(f, body, indent + 4);
+            }
+            emit_indent(f, indent);
+            fprintf(f, "}\n");
+            if (scope_outer_id == id) scope_outer_id = 0;
+            break;
+        }
+
         case AST_RETURN: {
             emit_line_directive(f, node);
             emit_indent(f, indent);
@@ -1130,7 +2510,14 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                  fprintf(f, "return;\n");
             } else {
                 fprintf(f, "return");
-                if (node->child_count > 0) {
+                int escape = node->child_count > 0 && scope_outer_id ? returns_object(node->children[0]) : 0;
+                if (escape) {
+                    // The scopes are freed after the value is computed: move it out first
+                    fprintf(f, " %s(_come_scope_%d, _come_outer_%d, ", escape == 2 ? "come_array_escape" : "mem_talloc_escape",
+                            scope_outer_id, scope_outer_id);
+                    generate_expression(f, node->children[0]);
+                    fprintf(f, ")");
+                } else if (node->child_count > 0) {
                     fprintf(f, " ");
                     generate_expression(f, node->children[0]);
                 } else {
@@ -1163,24 +2550,10 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                  if (field->type == AST_VAR_DECL) {
                      ASTNode* type = field->children[1];
                      emit_indent(f, indent + 4);
-                     // Check array
-                     int len = strlen(type->text);
-                     if (len > 2 && strcmp(type->text + len - 2, "[]") == 0) {
-                         char raw_type[64];
-                         strncpy(raw_type, type->text, len - 2);
-                         raw_type[len-2] = '\0';
-                         // Fixed size array in struct? 
-                         // "byte ipaddr[16]" -> parser logic?
-                         // Parser likely parsed "byte" and name "ipaddr[16]"?
-                         // Or type "byte[]"?
-                         // If parser put dimensions in name, just print name.
-                         // If type is "byte[]", we don't know size here unless in name.
-                         // Let's assume standard type printing.
-                         // Fix: if type ends in [], map to come_byte_array_t* for structs
-                         // Or use pointer? byte* items.
-                         // But we want to support size?
-                         // "byte[]" usually come_byte_array_t* in my codegen.
-                         fprintf(f, "come_%s_array_t* %s;\n", raw_type, field->text);
+                     // T[], T[N] and T[:] fields map like locals; maps, deques, heaps and lrus are handles
+                     char field_type[128];
+                     if (array_c_type(type->text, field_type, sizeof(field_type))) {
+                         fprintf(f, "%s %s;\n", field_type, field->text);
                      } else {
                          fprintf(f, "%s %s;\n", type->text, field->text);
                      }
@@ -1194,12 +2567,43 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                 fprintf(f, "typedef struct %s %s;\n", node->text, node->text);
                 mark_struct_seen(node->text);
             }
+            // X[] storage: come_X_array_t, typedef'd with the struct in pass 0
+            if (is_listed_struct(array_structs, array_struct_count, node->text)) {
+                emit_indent(f, indent);
+                fprintf(f, "typedef struct come_%s_array_t come_%s_array_t;\n", node->text, node->text);
+                emit_indent(f, indent);
+                fprintf(f, "COME_ARRAY_STRUCT(come_%s_array, struct %s)\n", node->text, node->text);
+                emit_indent(f, indent);
+                fprintf(f, "COME_ARRAY_OPS(come_%s_array, come_%s_array_t, struct %s)\n", node->text, node->text, node->text);
+                emit_indent(f, indent);
+                fprintf(f, "COME_ARRAY_VIEW(come_%s_array, come_%s_array_t, struct %s)\n", node->text, node->text, node->text);
+            }
+            // soa X[] storage: one column per field
+            if (!is_listed_struct(soa_structs, soa_struct_count, node->text)) break;
+            emit_indent(f, indent);
+            fprintf(f, "#define come_%s_SOA_FIELDS(F)", node->text);
+            for (int i = 0; i < node->child_count; i++) {
+                ASTNode* field = node->children[i];
+                if (field->type != AST_VAR_DECL) continue;
+                char field_type[128];
+                if (!array_c_type(field->children[1]->text, field_type, sizeof(field_type))) {
+                    snprintf(field_type, sizeof(field_type), "%.127s", field->children[1]->text);
+                }
+                fprintf(f, " F(%s, %s)", field_type, field->text);
+            }
+            fprintf(f, "\n");
+            emit_indent(f, indent);
+            fprintf(f, "COME_SOA(come_%s_soa, struct %s, come_%s_SOA_FIELDS)\n", node->text, node->text, node->text);
             break;
         }
 
         case AST_ASSIGN: {
             emit_line_directive(f, node);  // Emit #line for assignment
             emit_indent(f, indent);
+            if (generate_element_store(f, node)) {
+                fprintf(f, ";\n");
+                break;
+            }
             generate_expression(f, node->children[0]);
             fprintf(f, " %s ", node->text);
             generate_expression(f, node->children[1]);
@@ -1443,6 +2847,10 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
 }
 
 
+void codegen_set_mem_sites(int on) {
+    g_mem_sites = on;
+}
+
 int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_file, int gen_line_map) {
     FILE* f = fopen(out_file, "w");
     if (!f) return 1;
@@ -1472,6 +2880,19 @@ int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_f
         }
     }
 
+    // Reset regex literal tracker; only modules with a generated main() run the init
+    for (int i=0; i<regex_literal_count; i++) free(regex_literals[i]);
+    regex_literal_count = 0;
+    regex_hoisting = strcmp(current_module, "std") != 0 && strcmp(current_module, "string") != 0;
+    if (regex_hoisting) collect_regex_literals(ast);
+
+    // Reset struct array/soa trackers
+    for (int i=0; i<array_struct_count; i++) free(array_structs[i]);
+    array_struct_count = 0;
+    for (int i=0; i<soa_struct_count; i++) free(soa_structs[i]);
+    soa_struct_count = 0;
+    collect_struct_arrays(ast, ast);
+
 
     fprintf(f, "#include <stdio.h>\n");
     fprintf(f, "#include <string.h>\n");
@@ -1479,7 +2900,10 @@ int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_f
     fprintf(f, "#include <stdint.h>\n");
     fprintf(f, "#include \"come_string.h\"\n");
     fprintf(f, "#include \"come_array.h\"\n");
+    fprintf(f, "#include \"come_map.h\"\n");
+    fprintf(f, "#include \"come_queue.h\"\n");
     fprintf(f, "#include \"come_types.h\"\n");
+    fprintf(f, "#include \"come_conv.h\"\n");
     fprintf(f, "#include \"mem/talloc.h\"\n");
     fprintf(f, "#include <errno.h>\n");
     fprintf(f, "#define come_errno_wrapper() (errno)\n");
@@ -1494,6 +2918,15 @@ int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_f
     
     // Module memory context
     fprintf(f, "TALLOC_CTX* come_%s__ctx = NULL;\n", current_module);
+
+    if (regex_literal_count > 0) {
+        fprintf(f, "static come_regex_t* come_%s__re[%d];\n", current_module, regex_literal_count);
+        fprintf(f, "static void come_%s__regex_init(TALLOC_CTX* ctx) {\n", current_module);
+        for (int i = 0; i < regex_literal_count; i++) {
+            fprintf(f, "    come_%s__re[%d] = come_regex_new(ctx, %s);\n", current_module, i, regex_literals[i]);
+        }
+        fprintf(f, "}\n");
+    }
     
     // TODO: Extern imports - disabled for now to avoid linker errors
     // for (int i=0; i<current_import_count; i++) {
@@ -1530,6 +2963,9 @@ int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_f
         fprintf(f, "\nint main(int argc, char* argv[]) {\n");
         fprintf(f, "    COME_CTX = mem_talloc_new_ctx(NULL);\n");
         fprintf(f, "    if (!COME_CTX) { fprintf(stderr, \"OOM\\n\"); return 1; }\n");
+        if (regex_literal_count > 0) {
+            fprintf(f, "    come_%s__regex_init(COME_CTX);\n", current_module);
+        }
         
         // TODO: Handle imported contexts and module init
         // For now, skip these to avoid linker errors
@@ -1552,8 +2988,11 @@ int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_f
         fprintf(f, "    return ret;\n");
         fprintf(f, "}\n");
     }
-    // Map type (not in come_types.h as it's a special case)
-    fprintf(f, "typedef void* map;\n");
+    // Map types (not in come_types.h as they are a special case)
+    fprintf(f, "typedef come_map_t* map;\n");
+    fprintf(f, "typedef come_ordered_map_t* ordered_map;\n");
+    fprintf(f, "typedef TALLOC_CTX* pool;\n");
+    fprintf(f, "typedef mem_talloc_stats_t mem_stats;\n");
 
     fprintf(f, "#include <math.h>\n");
     fprintf(f, "#include <stdlib.h>\n");
@@ -1575,6 +3014,10 @@ int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_f
 
     
     fprintf(f, "#define come_std_eprintf(...) fprintf(stderr, __VA_ARGS__)\n");
+    fprintf(f, "struct come_std__FILE;\n");
+    fprintf(f, "extern struct come_std__FILE std_in, std_out, std_err;\n");
+    fprintf(f, "uint32_t come_std__FILE__read(struct come_std__FILE* self, come_byte_array_view_t buf, uint32_t n);\n");
+    fprintf(f, "uint32_t come_std__FILE__write(struct come_std__FILE* self, come_byte_array_view_t buf, uint32_t n);\n");
 
     // Pass -1: Aliases (typedefs)
     printf("DEBUG: Starting Pass -1 Aliases\n");
@@ -1611,6 +3054,12 @@ int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_f
                  fprintf(f, "typedef struct %s %s;\n", child->text, child->text);
                  mark_struct_seen(child->text);
              }
+             if (is_listed_struct(array_structs, array_struct_count, child->text)) {
+                 fprintf(f, "typedef struct come_%s_array_t come_%s_array_t;\n", child->text, child->text);
+             }
+             if (is_listed_struct(soa_structs, soa_struct_count, child->text)) {
+                 fprintf(f, "typedef struct come_%s_soa_t come_%s_soa_t;\n", child->text, child->text);
+             }
         }
     }
 
@@ -1658,8 +3107,11 @@ int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_f
                       snprintf(func_name, sizeof(func_name), "come_%s__%s", current_module, child->text);
                   }
 
+                  char ret_arr[128];
                   if (ret->text[0] == '(') {
                        fprintf(f, "void %s(", func_name);
+                  } else if (array_c_type(ret->text, ret_arr, sizeof(ret_arr))) {
+                       fprintf(f, "%s %s(", ret_arr, func_name);
                   } else {
                        if (strcmp(ret->text, "string") == 0) fprintf(f, "come_string_t* %s(", func_name);
                        else fprintf(f, "%s %s(", ret->text, func_name);
@@ -1690,15 +3142,9 @@ int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_f
                  if (arg->type == AST_VAR_DECL) {
                      ASTNode* type = arg->children[1];
                      // Array check
-                       if (strstr(type->text, "[]")) {
-                            char raw[64];
-                            strncpy(raw, type->text, strlen(type->text)-2);
-                            raw[strlen(type->text)-2] = 0;
-                            
-                            if (strcmp(raw, "int")==0) fprintf(f, "come_int_array_t*");
-                            else if (strcmp(raw, "byte")==0) fprintf(f, "come_byte_array_t*");
-                            else if (strcmp(raw, "string")==0) fprintf(f, "come_string_list_t*");
-                            else fprintf(f, "come_array_t*");
+                       char arr_type[128];
+                       if (array_c_type(type->text, arr_type, sizeof(arr_type))) {
+                            fprintf(f, "%s", arr_type);
                        } else if (type->text[0] == '(') {
                             fprintf(f, "void"); // Multi-return hack
                        } else {
@@ -12,6 +12,31 @@
 #include "ast.h"
 #include "codegen.h"
 
+/* Runtime sources compiled into every COME program (relative to project root) */
+static const char *runtime_sources[] = {
+    "src/std/std.c",
+    "src/string/string.c",
+    "src/string/regex.c",
+    "src/string/utf8.c",
+    "src/string/case.c",
+    "src/string/hash.c",
+    "src/string/rope.c",
+    "src/conv/number.c",
+    "src/conv/encode.c",
+    "src/array/array.c",
+    "src/array/kernels.c",
+    "src/array/sort.c",
+    "src/array/bits.c",
+    "src/map/map.c",
+    "src/map/btree.c",
+    "src/map/lru.c",
+    "src/queue/deque.c",
+    "src/queue/ringbuf.c",
+    "src/queue/heap.c",
+    "src/mem/talloc.c",
+    "external/talloc/lib/talloc/talloc.c",
+};
+
 /* ---------- small utilities (local, no external deps) ---------- */
 
 static void die(const char *fmt, ...) {
@@ -103,7 +128,7 @@ static void get_project_root(char *out, size_t outsz) {
 
 /* run a shell command; return non-zero if failed */
 static int run_cmd(const char *fmt, ...) {
-    char buf[2048];
+    char buf[8192];
     va_list ap;
     va_start(ap, fmt);
     vsnprintf(buf, sizeof(buf), fmt, ap);
@@ -119,7 +144,9 @@ static void usage(const char *prog) {
     fprintf(stderr,
         "Usage:\n"
         "  %s build <file.co> [-o <bin_path>]  - Full build: generate C and link to binary\n"
-        "  %s genc  <file.co> [-o <c_path>]    - Generate C code only\n",
+        "  %s genc  <file.co> [-o <c_path>]    - Generate C code only\n"
+        "Options:\n"
+        "  --mem-sites  (build) attribute allocations to source lines in mem statistics\n",
         prog, prog);
 }
 
@@ -154,6 +181,8 @@ int main(int argc, char *argv[]) {
                 die("Error: -o requires an output path");
             }
             out_path = argv[++i];
+        } else if (strcmp(argv[i], "--mem-sites") == 0) {
+            codegen_set_mem_sites(1);
         } else if (argv[i][0] == '-') {
             die("Unknown option: %s", argv[i]);
         } else {
@@ -218,11 +247,18 @@ int main(int argc, char *argv[]) {
     char project_root[1024];
     get_project_root(project_root, sizeof(project_root));
 
+    char sources[4096] = "";
+    size_t used = 0;
+    for (size_t i = 0; i < sizeof(runtime_sources) / sizeof(runtime_sources[0]); i++) {
+        used += snprintf(sources + used, sizeof(sources) - used, " %s/%s", project_root, runtime_sources[i]);
+        if (used >= sizeof(sources)) die("Runtime source list too long");
+    }
+
     if (run_cmd("gcc -Wall -Wno-cpp -g -D__STDC_WANT_LIB_EXT1__=1 "
                 "-I%s/src/include -I%s/src/core/include -I%s/external/talloc/lib/talloc -I%s/external/talloc/lib/replace "
-                "\"%s\" %s/src/std/std.c %s/src/string/string.c %s/src/array/array.c %s/src/mem/talloc.c %s/external/talloc/lib/talloc/talloc.c -o \"%s\" -ldl", 
+                "\"%s\"%s -o \"%s\" -ldl -lpthread", 
                 project_root, project_root, project_root, project_root,
-                c_file, project_root, project_root, project_root, project_root, project_root, bin_file) != 0) {
+                c_file, sources, bin_file) != 0) {
         ast_free(ast);
         die("GCC compilation failed");
     }
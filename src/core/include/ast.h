@@ -47,6 +47,7 @@ typedef enum {
     AST_CONTINUE,
     AST_CAST,
     AST_TERNARY,
+    AST_SCOPE,          // scope[(arg)] block / loop: children[0] arg or NULL, children[1] body
     AST_TYPE_END
 } ASTNodeType;
 
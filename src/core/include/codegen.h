@@ -2,4 +2,5 @@
 #define CODEGEN_H
 #include "ast.h"
 int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_file, int gen_line_map);
+void codegen_set_mem_sites(int on); // With the line map: mark statements for mem statistics
 #endif
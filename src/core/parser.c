@@ -75,6 +75,60 @@ static int expect(TokenType type) {
     return 0;
 }
 
+// Rest of a "[...]" type suffix after its '['; "[:]" is an array view
+static const char* type_brackets() {
+    int view = current()->type == TOKEN_COLON;
+    while (current()->type != TOKEN_RBRACKET && current()->type != TOKEN_EOF) advance();
+    expect(TOKEN_RBRACKET);
+    return view ? "[:]" : "[]";
+}
+
+// "<K, V>" after map, ordered_map or lru, "<T>" after deque or heap: appended to the type
+// as "map<K,V>"
+static void map_type_args(char* type_name) {
+    int deque = strcmp(type_name, "deque") == 0 || strcmp(type_name, "heap") == 0;
+    if ((strcmp(type_name, "map") != 0 && strcmp(type_name, "ordered_map") != 0 && strcmp(type_name, "lru") != 0 &&
+         !deque) || current()->type != TOKEN_LT) return;
+    advance();
+    strcat(type_name, "<");
+    if (!deque) {
+        strncat(type_name, current()->text, 32);
+        advance();
+        expect(TOKEN_COMMA);
+        strcat(type_name, ",");
+    }
+    if (current()->type == TOKEN_STRUCT) advance();
+    strncat(type_name, current()->text, 32);
+    advance();
+    expect(TOKEN_GT);
+    strcat(type_name, ">");
+}
+
+// "soa" before "[struct] Type name": struct-of-arrays storage. Consumes it and returns 1;
+// anywhere else soa is an ordinary identifier.
+static int soa_qualifier() {
+    int at = pos + 1;
+    if (current()->type != TOKEN_IDENTIFIER || strcmp(current()->text, "soa") != 0) return 0;
+    if (at < tokens.count && tokens.tokens[at].type == TOKEN_STRUCT) at++;
+    if (at + 1 >= tokens.count || tokens.tokens[at].type != TOKEN_IDENTIFIER ||
+        tokens.tokens[at + 1].type != TOKEN_IDENTIFIER) return 0;
+    advance();
+    return 1;
+}
+
+// "struct T[]" / "T[]" -> "soa T[]"
+static void mark_soa(ASTNode* type_node) {
+    char type[128];
+    const char* t = type_node->text;
+    if (strncmp(t, "struct ", 7) == 0) t += 7;
+    if (!strstr(t, "[") || strstr(t, "[:]")) {
+        fprintf(stderr, "Error: soa needs an array of structs, got '%s'\n", type_node->text);
+        return;
+    }
+    snprintf(type, sizeof(type), "soa %.120s", t);
+    strcpy(type_node->text, type);
+}
+
 ASTNode* ast_new(ASTNodeType type) {
     ASTNode* n = malloc(sizeof(ASTNode));
     n->type = type;
@@ -96,6 +150,34 @@ static ASTNode* parse_block();
 static ASTNode* parse_statement();
 static ASTNode* parse_expression();
 static ASTNode* parse_var_decl();
+
+// "scope" or "scope(arg)" before a block or a loop (before a function at top level): a
+// scope context for the allocations inside. Consumes it and returns the AST_SCOPE node
+// holding arg; anywhere else scope is an ordinary identifier and NULL is returned.
+static ASTNode* scope_qualifier(int top_level) {
+    int at = pos + 1;
+    if (current()->type != TOKEN_IDENTIFIER || strcmp(current()->text, "scope") != 0) return NULL;
+    if (at < tokens.count && tokens.tokens[at].type == TOKEN_LPAREN) {
+        for (int depth = 0; at < tokens.count; at++) {
+            if (tokens.tokens[at].type == TOKEN_LPAREN) depth++;
+            else if (tokens.tokens[at].type == TOKEN_RPAREN && --depth == 0) break;
+        }
+        at++;
+    }
+    if (at >= tokens.count) return NULL;
+    TokenType next = tokens.tokens[at].type;
+    if (top_level ? !(is_type_token(next) || next == TOKEN_MAIN || next == TOKEN_IDENTIFIER)
+                  : !(next == TOKEN_LBRACE || next == TOKEN_FOR || next == TOKEN_WHILE || next == TOKEN_DO)) return NULL;
+    advance();
+    ASTNode* node = ast_new(AST_SCOPE);
+    node->children[node->child_count++] = NULL;
+    if (match(TOKEN_LPAREN)) {
+        node->children[0] = parse_expression();
+        expect(TOKEN_RPAREN);
+    }
+    return node;
+}
+
 static ASTNode* parse_primary() {
     ASTNode* node = NULL;
     Token* t = current();
@@ -189,7 +271,16 @@ static ASTNode* parse_primary() {
                      }
                  }
              } else {
-                 node->children[node->child_count++] = parse_expression();
+                 ASTNode* key = parse_expression();
+                 if (match(TOKEN_COLON)) {
+                     // Map entry: key: value
+                     ASTNode* pair = ast_new(AST_ASSIGN);
+                     strcpy(pair->text, ":");
+                     pair->children[pair->child_count++] = key;
+                     pair->children[pair->child_count++] = parse_expression();
+                     key = pair;
+                 }
+                 node->children[node->child_count++] = key;
              }
              if (!match(TOKEN_COMMA)) break;
         }
@@ -202,9 +293,7 @@ static ASTNode* parse_primary() {
              advance();
              // Check array
              while(match(TOKEN_LBRACKET)) {
-                 while(current()->type!=TOKEN_RBRACKET && current()->type!=TOKEN_EOF) advance();
-                 expect(TOKEN_RBRACKET);
-                 strcat(type_name, "[]");
+                 strcat(type_name, type_brackets());
              }
              expect(TOKEN_RPAREN);
              
@@ -379,11 +468,11 @@ static ASTNode* parse_var_decl() {
         advance();
     }
     
+    map_type_args(type_name);
+    
     // Check for array type: int[] x
     while (match(TOKEN_LBRACKET)) {
-         while(current()->type != TOKEN_RBRACKET && current()->type != TOKEN_EOF) advance();
-         expect(TOKEN_RBRACKET);
-         strcat(type_name, "[]");
+         strcat(type_name, type_brackets());
     }
 
     if (match(TOKEN_IDENTIFIER)) {
@@ -391,7 +480,14 @@ static ASTNode* parse_var_decl() {
         strcpy(var_name, tokens.tokens[pos-1].text);
         
         int is_array = 0;
+        char dim[32] = "";
         if (match(TOKEN_LBRACKET)) {
+            // Keep a literal size: "int arr[10]" is typed int[10]; "int v[:]" is a view
+            if (current()->type == TOKEN_NUMBER && tokens.tokens[pos+1].type == TOKEN_RBRACKET) {
+                snprintf(dim, sizeof(dim), "%.30s", current()->text);
+            } else if (current()->type == TOKEN_COLON) {
+                strcpy(dim, ":");
+            }
             while(current()->type!=TOKEN_RBRACKET && current()->type!=TOKEN_EOF) advance();
             expect(TOKEN_RBRACKET);
             is_array = 1;
@@ -415,7 +511,7 @@ static ASTNode* parse_var_decl() {
          // Child 1: Type
          ASTNode* type_node = ast_new(AST_IDENTIFIER);
          strcpy(type_node->text, type_name);
-         if (is_array) strcat(type_node->text, "[]"); // Mark as array
+         if (is_array) { strcat(type_node->text, "["); strcat(type_node->text, dim); strcat(type_node->text, "]"); } // Mark as array
          decl->children[decl->child_count++] = type_node;
          
          if (current()->type == TOKEN_SEMICOLON) advance();
@@ -679,7 +775,13 @@ static ASTNode* parse_identifier_statement() {
          
          // Check array
          int is_array = 0;
+         char dim[32] = "";
          if (match(TOKEN_LBRACKET)) {
+             if (current()->type == TOKEN_NUMBER && tokens.tokens[pos+1].type == TOKEN_RBRACKET) {
+                 snprintf(dim, sizeof(dim), "%.30s", current()->text);
+             } else if (current()->type == TOKEN_COLON) {
+                 strcpy(dim, ":");
+             }
              while(current()->type!=TOKEN_RBRACKET && current()->type!=TOKEN_EOF) advance();
              expect(TOKEN_RBRACKET);
              is_array = 1;
@@ -701,7 +803,7 @@ static ASTNode* parse_identifier_statement() {
          // Type
          ASTNode* type_node = ast_new(AST_IDENTIFIER);
          strcpy(type_node->text, type_name);
-         if (is_array) strcat(type_node->text, "[]");
+         if (is_array) { strcat(type_node->text, "["); strcat(type_node->text, dim); strcat(type_node->text, "]"); }
          decl->children[decl->child_count++] = type_node;
          if (current()->type == TOKEN_SEMICOLON) advance();
          return decl;
@@ -806,11 +908,45 @@ static ASTNode* parse_statement() {
           return parse_struct_statement();
     }
 
+    // const map m = {...}: a map that may not be modified, recorded as "const map..."
+    if (t->type == TOKEN_CONST && pos + 1 < tokens.count && tokens.tokens[pos+1].type == TOKEN_MAP) {
+        advance();
+        ASTNode* decl = parse_var_decl();
+        if (decl && decl->type == AST_VAR_DECL) {
+            char type_name[128];
+            snprintf(type_name, sizeof(type_name), "const %.120s", decl->children[1]->text);
+            strcpy(decl->children[1]->text, type_name);
+        }
+        return decl;
+    }
+
     if (is_type_token(t->type)) {
         ASTNode* decl = parse_var_decl();
-        if (decl) return decl; 
+        if (decl) return decl;
+    }
+
+    // ordered_map m = {...} / ordered_map<K, V> m / deque<T> q / heap<T> q / lru<K, V> c:
+    // not keywords, so they stay usable as names
+    if (t->type == TOKEN_IDENTIFIER && pos + 1 < tokens.count &&
+        ((strcmp(t->text, "ordered_map") == 0 &&
+          (tokens.tokens[pos+1].type == TOKEN_LT || tokens.tokens[pos+1].type == TOKEN_IDENTIFIER)) ||
+         ((strcmp(t->text, "deque") == 0 || strcmp(t->text, "heap") == 0 || strcmp(t->text, "lru") == 0) &&
+          tokens.tokens[pos+1].type == TOKEN_LT))) {
+        return parse_var_decl();
     }
     
+    ASTNode* scope = scope_qualifier(0);
+    if (scope) {
+        scope->children[scope->child_count++] = current()->type == TOKEN_LBRACE ? parse_block() : parse_statement();
+        return scope;
+    }
+
+    if (soa_qualifier()) {
+        ASTNode* decl = current()->type == TOKEN_STRUCT ? parse_var_decl() : parse_identifier_statement();
+        if (decl && decl->type == AST_VAR_DECL) mark_soa(decl->children[1]);
+        return decl;
+    }
+
     switch (t->type) {
         case TOKEN_IDENTIFIER: return parse_identifier_statement();
         case TOKEN_IF: return parse_if_statement();
@@ -1196,11 +1332,10 @@ static void parse_top_level_decl(ASTNode* program) {
          } else {
              strcpy(type_name, t->text);
              advance();
+             map_type_args(type_name);
              // Check array [] in type? "int[] x" or "int[16] x"
              if (match(TOKEN_LBRACKET)) {
-                 while(current()->type!=TOKEN_RBRACKET && current()->type!=TOKEN_EOF) advance();
-                 expect(TOKEN_RBRACKET);
-                 strcat(type_name, "[]");
+                 strcat(type_name, type_brackets());
              }
          }
          
@@ -1311,6 +1446,7 @@ static void parse_top_level_decl(ASTNode* program) {
                  while (current()->type != TOKEN_RPAREN && current()->type != TOKEN_EOF) {
                       if (current()->type == TOKEN_COMMA) { advance(); continue; }
                       if (current()->type == TOKEN_CONST) advance(); // skip const in args for now
+                      int soa = soa_qualifier();
                       
                       char arg_type[256];
                       if (current()->type == TOKEN_STRUCT) {
@@ -1320,12 +1456,15 @@ static void parse_top_level_decl(ASTNode* program) {
                       } else {
                           strcpy(arg_type, current()->text);
                           advance();
+                          map_type_args(arg_type);
+                      }
+                      while (current()->type == TOKEN_STAR) { // pointer param
+                          strcat(arg_type, "*");
+                          advance();
                       }
                       // brackets?
                       if (match(TOKEN_LBRACKET)) { 
-                          while(current()->type!=TOKEN_RBRACKET && current()->type!=TOKEN_EOF) advance();
-                          expect(TOKEN_RBRACKET); 
-                          strcat(arg_type, "[]"); 
+                          strcat(arg_type, type_brackets()); 
                       }
                       
                       if (current()->type == TOKEN_IDENTIFIER) {
@@ -1341,14 +1480,10 @@ static void parse_top_level_decl(ASTNode* program) {
                           strcpy(at->text, arg_type);
                           
                           // Check array after name
-                          int is_arr = 0;
                           if (match(TOKEN_LBRACKET)) {
-                              while(current()->type!=TOKEN_RBRACKET && current()->type!=TOKEN_EOF) advance();
-                              expect(TOKEN_RBRACKET); 
-                              is_arr = 1;
+                              strcat(at->text, type_brackets()); // array param
                           }
-                          
-                          if (is_arr) strcat(at->text, "[]"); // array param
+                          if (soa) mark_soa(at);
                           arg->children[arg->child_count++] = NULL; // No init
                           arg->children[arg->child_count++] = at;
                           
@@ -1390,13 +1525,7 @@ static void parse_top_level_decl(ASTNode* program) {
                  strcpy(type_node->text, type_name);
                  // check array
                  if (match(TOKEN_LBRACKET)) {
-                     if (current()->type != TOKEN_RBRACKET) {
-                          // int arr[10]
-                          // size?
-                          while(current()->type!=TOKEN_RBRACKET && current()->type!=TOKEN_EOF) advance();
-                     }
-                     expect(TOKEN_RBRACKET);
-                     strcat(type_node->text, "[]");
+                     strcat(type_node->text, type_brackets());
                  }
                  var->children[var->child_count++] = type_node;
                  program->children[program->child_count++] = var;
@@ -1472,9 +1601,23 @@ int parse_file(const char* filename, ASTNode** out_ast) {
             case TOKEN_ALIAS:
                 parse_alias(*out_ast);
                 break;
-            default:
+            default: {
+                // scope before a function: its body runs in a scope context
+                ASTNode* scope = scope_qualifier(1);
+                int count = (*out_ast)->child_count;
                 parse_top_level_decl(*out_ast);
+                ASTNode* func = (*out_ast)->child_count > count ? (*out_ast)->children[count] : NULL;
+                if (scope && func && func->type == AST_FUNCTION &&
+                    func->children[func->child_count - 1]->type == AST_BLOCK) {
+                    ASTNode* body = ast_new(AST_BLOCK);
+                    scope->children[scope->child_count++] = func->children[func->child_count - 1];
+                    body->children[body->child_count++] = scope;
+                    func->children[func->child_count - 1] = body;
+                } else if (scope) {
+                    ast_free(scope);
+                }
                 break;
+            }
         }
     }
     
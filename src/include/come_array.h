@@ -4,47 +4,412 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 // Forward declaration for talloc context
 typedef void TALLOC_CTX;
 
-// Generic array header structure (not used directly, but for clarity)
-// [uint32 size, uint32 count, items...]
-
-typedef struct come_int_array_t {
-    uint32_t size;  // Capacity (elements)
-    uint32_t count; // Used length
-    int items[]; 
-} come_int_array_t;
-
-typedef struct come_byte_array_t {
-    uint32_t size;  // Capacity (elements)
-    uint32_t count; // Used length
-    uint8_t items[]; 
-} come_byte_array_t;
+// Array layout: [uint32 size, uint32 count, items...]. size is the capacity and count the
+// length, both in elements. Items start at offsetof(items), which is 8 for every element
+// type aligned to 8 bytes or less and 16 for 16-byte aligned structs (talloc chunks are
+// 16-byte aligned, so stricter alignment is not guaranteed).
 
 // Note: come_string_t is defined in come_string.h.
 // Forward declaring it here if needed, or include come_string.h
 struct come_string_t;
 
-typedef struct {
-    uint32_t size;
-    uint32_t count;
-    struct come_string_t* items[];
-} come_string_list_t;
-
 // Allocation / Management
 void* come_array_alloc(TALLOC_CTX* ctx, size_t elem_size, uint32_t count);
-void* come_array_realloc(void* arr, size_t elem_size, uint32_t new_size);
+void* come_array_realloc(void* arr, size_t elem_size, uint32_t new_size); // Exact: size = count = new_size
+void* come_array_new(TALLOC_CTX* ctx, size_t hdr, size_t elem_size, uint32_t count); // size = count, zeroed
+
+// Dynamic arrays: size is the capacity, count the length. Growth doubles the capacity, so
+// n pushes cost O(n); shrinking never reallocates except in shrink_to_fit. Anything that
+// may grow returns the (possibly moved) array, NULL on allocation failure.
+// hdr is offsetof(items) of the concrete array type; a NULL arr starts a new array.
+uint32_t come_array_capacity(uint32_t size, uint32_t count, uint32_t extra); // Grown size, 0 on overflow
+void* come_array_grow(void* arr, size_t hdr, size_t elem_size, uint32_t extra); // Room for extra more
+void* come_array_set_count(void* arr, size_t hdr, size_t elem_size, uint32_t count); // New items zeroed
+void* come_array_shrink(void* arr, size_t hdr, size_t elem_size);
+void* come_array_insert_items(void* arr, size_t hdr, size_t elem_size, uint32_t at, const void* items, uint32_t n);
+void come_array_remove_items(void* arr, size_t hdr, size_t elem_size, uint32_t at, uint32_t n);
+void* come_array_slice_items(const void* arr, size_t hdr, size_t elem_size, uint32_t start, uint32_t end); // Copy, child of arr
+
+// Array type struct name##_t with elements T, without the typedef (user struct arrays are
+// forward declared before their element type is complete)
+#define COME_ARRAY_STRUCT(name, T) \
+    struct name##_t { \
+        uint32_t size;  /* Capacity (elements) */ \
+        uint32_t count; /* Used length */ \
+        T items[]; \
+    };
+
+// Typed operations for array type A of T, as name_push() etc.
+#define COME_ARRAY_OPS(name, A, T) \
+    static inline A* name##_new(TALLOC_CTX* ctx, uint32_t n) { \
+        return (A*)come_array_new(ctx, offsetof(A, items), sizeof(T), n); \
+    } \
+    static inline A* name##_push(A* a, T v) { \
+        a = (A*)come_array_grow(a, offsetof(A, items), sizeof(T), 1); \
+        if (a) a->items[a->count++] = v; \
+        return a; \
+    } \
+    static inline T name##_pop(A* a) { \
+        T v = {0}; \
+        if (a && a->count) v = a->items[--a->count]; \
+        return v; \
+    } \
+    static inline A* name##_insert(A* a, uint32_t i, T v) { \
+        return (A*)come_array_insert_items(a, offsetof(A, items), sizeof(T), i, &v, 1); \
+    } \
+    static inline T name##_remove(A* a, uint32_t i) { \
+        T v = {0}; \
+        if (a && i < a->count) { \
+            v = a->items[i]; \
+            come_array_remove_items(a, offsetof(A, items), sizeof(T), i, 1); \
+        } \
+        return v; \
+    } \
+    static inline A* name##_append(A* a, const A* b) { \
+        if (!b) return a; \
+        return (A*)come_array_insert_items(a, offsetof(A, items), sizeof(T), a ? a->count : 0, b->items, b->count); \
+    } \
+    static inline A* name##_reserve(A* a, uint32_t n) { \
+        return (A*)come_array_grow(a, offsetof(A, items), sizeof(T), n); \
+    } \
+    static inline A* name##_shrink_to_fit(A* a) { \
+        return (A*)come_array_shrink(a, offsetof(A, items), sizeof(T)); \
+    } \
+    static inline void* name##_resize(A* a, uint32_t n) { \
+        return come_array_set_count(a, offsetof(A, items), sizeof(T), n); \
+    } \
+    static inline A* name##_slice(A* a, uint32_t start, uint32_t end) { \
+        return (A*)come_array_slice_items(a, offsetof(A, items), sizeof(T), start, end); \
+    }
+
+// View name##_view_t: count items of an array, by value, without a copy. parent is the
+// array that owns them; the view is valid while it is alive and not grown (growing may
+// move the items). Writes through a view go to the parent. copy() makes an independent
+// array on ctx; nothing else copies. Bounds are clamped to the array, so an out of
+// range view is empty.
+#define COME_ARRAY_VIEW(name, A, T) \
+    typedef struct name##_view_t { \
+        T* items; \
+        uint32_t count; \
+        const A* parent; \
+    } name##_view_t; \
+    static inline name##_view_t name##_view(const A* a, uint32_t start, uint32_t end) { \
+        name##_view_t v = { NULL, 0, a }; \
+        uint32_t n = a ? a->count : 0; \
+        if (end > n) end = n; \
+        if (start < end) { \
+            v.items = (T*)a->items + start; \
+            v.count = end - start; \
+        } \
+        return v; \
+    } \
+    static inline name##_view_t name##_view_slice(name##_view_t v, uint32_t start, uint32_t end) { \
+        if (end > v.count) end = v.count; \
+        if (start >= end) { \
+            v.count = 0; \
+            return v; \
+        } \
+        v.items += start; \
+        v.count = end - start; \
+        return v; \
+    } \
+    static inline A* name##_view_copy(TALLOC_CTX* ctx, name##_view_t v) { \
+        A* a = (A*)come_array_new(ctx, offsetof(A, items), sizeof(T), v.count); \
+        if (a && v.count) memcpy(a->items, v.items, v.count * sizeof(T)); \
+        return a; \
+    }
+
+// Struct-of-arrays storage (soa T[]): one column per field of S, all sharing size and
+// count, so a loop over one field touches only that field's memory. FIELDS(F) expands
+// F(type, field) for every field of S; the compiler emits it after the struct. The
+// header never moves (columns are its talloc children and grow in place of it), so soa
+// methods do not return a new pointer: growing ones return NULL on allocation failure.
+// Records are gathered/scattered by value; s->field[i] is the column access.
+void* come_soa_new(TALLOC_CTX* ctx, size_t size);                  // Zeroed header
+void* come_soa_column(void* soa, void* column, size_t bytes);       // (Re)allocate a column
+
+#define COME_SOA_COLUMN(T, f) T* f;
+#define COME_SOA_GROW(T, f) \
+    if (!(column = come_soa_column(s, s->f, (size_t)cap * sizeof(T)))) return NULL; \
+    s->f = (T*)column;
+#define COME_SOA_ZERO(T, f) memset(s->f + s->count, 0, (size_t)(n - s->count) * sizeof(T));
+#define COME_SOA_STORE(T, f) s->f[i] = v.f;
+#define COME_SOA_LOAD(T, f) v.f = s->f[i];
+#define COME_SOA_ERASE(T, f) memmove(s->f + i, s->f + i + 1, (size_t)(s->count - i - 1) * sizeof(T));
+
+#define COME_SOA(name, S, FIELDS) \
+    typedef struct name##_t { \
+        uint32_t size;  /* Capacity of every column */ \
+        uint32_t count; \
+        FIELDS(COME_SOA_COLUMN) \
+    } name##_t; \
+    static inline name##_t* name##_reserve(name##_t* s, uint32_t extra) { \
+        if (!s) return NULL; \
+        if (extra <= s->size - s->count) return s; \
+        uint32_t cap = come_array_capacity(s->size, s->count, extra); \
+        void* column; \
+        if (!cap) return NULL; \
+        FIELDS(COME_SOA_GROW) \
+        s->size = cap; \
+        return s; \
+    } \
+    static inline name##_t* name##_resize(name##_t* s, uint32_t n) { \
+        if (!s) return NULL; \
+        if (n > s->count) { \
+            if (!name##_reserve(s, n - s->count)) return NULL; \
+            FIELDS(COME_SOA_ZERO) \
+        } \
+        s->count = n; \
+        return s; \
+    } \
+    static inline name##_t* name##_new(TALLOC_CTX* ctx, uint32_t n) { \
+        name##_t* s = (name##_t*)come_soa_new(ctx, sizeof(name##_t)); \
+        return name##_resize(s, n); \
+    } \
+    static inline S name##_get(const name##_t* s, uint32_t i) { \
+        S v = {0}; \
+        if (s && i < s->count) { FIELDS(COME_SOA_LOAD) } \
+        return v; \
+    } \
+    static inline void name##_set(name##_t* s, uint32_t i, S v) { \
+        if (s && i < s->count) { FIELDS(COME_SOA_STORE) } \
+    } \
+    static inline name##_t* name##_push(name##_t* s, S v) { \
+        if (!name##_reserve(s, 1)) return NULL; \
+        uint32_t i = s->count++; \
+        FIELDS(COME_SOA_STORE) \
+        return s; \
+    } \
+    static inline S name##_pop(name##_t* s) { \
+        S v = {0}; \
+        if (s && s->count) { uint32_t i = --s->count; FIELDS(COME_SOA_LOAD) } \
+        return v; \
+    } \
+    static inline S name##_remove(name##_t* s, uint32_t i) { \
+        S v = name##_get(s, i); \
+        if (s && i < s->count) { FIELDS(COME_SOA_ERASE) s->count--; } \
+        return v; \
+    }
+
+// Instantiates the array type name##_t of T with its operations and view type
+#define COME_ARRAY(name, T) \
+    typedef struct name##_t name##_t; \
+    COME_ARRAY_STRUCT(name, T) \
+    COME_ARRAY_OPS(name, name##_t, T) \
+    COME_ARRAY_VIEW(name, name##_t, T)
+
+// Built-in element types; T[] of a user struct T is come_T_array_t, emitted by the compiler
+COME_ARRAY(come_int_array, int)
+COME_ARRAY(come_byte_array, uint8_t)
+COME_ARRAY(come_ubyte_array, uint8_t)
+COME_ARRAY(come_short_array, int16_t)
+COME_ARRAY(come_ushort_array, uint16_t)
+COME_ARRAY(come_uint_array, uint32_t)
+COME_ARRAY(come_long_array, int64_t)
+COME_ARRAY(come_ulong_array, uint64_t)
+COME_ARRAY(come_float_array, float)
+COME_ARRAY(come_double_array, double)
+COME_ARRAY(come_wchar_array, int32_t)
+COME_ARRAY(come_string_list, struct come_string_t*)
+
+// bool[] is a packed bitset (bits.c): bit i is bit i % 64 of items[i / 64], size and count
+// are in bits. Bits at or past count are always zero, so the word-at-a-time operations
+// need no tail handling. test/set/clear/put ignore indices past the end; push and
+// resize may move the array like the other growing methods. and/or/xor combine in place
+// over the shorter length, count is the number of set bits and next_set(i) the first
+// set index at or after i, or -1.
+typedef struct come_bool_array_t {
+    uint32_t size;  /* Capacity (bits) */
+    uint32_t count; /* Length (bits) */
+    uint64_t items[];
+} come_bool_array_t;
+
+come_bool_array_t* come_bool_array_new(TALLOC_CTX* ctx, uint32_t n); // n zero bits
+come_bool_array_t* come_bool_array_resize(come_bool_array_t* a, uint32_t n);
+come_bool_array_t* come_bool_array_push(come_bool_array_t* a, bool v);
+bool come_bool_array_pop(come_bool_array_t* a);
+void come_bool_array_and(come_bool_array_t* a, const come_bool_array_t* b);
+void come_bool_array_or(come_bool_array_t* a, const come_bool_array_t* b);
+void come_bool_array_xor(come_bool_array_t* a, const come_bool_array_t* b);
+void come_bool_array_fill(come_bool_array_t* a, bool v);
+uint32_t come_bool_array_count(const come_bool_array_t* a);
+long come_bool_array_next_set(const come_bool_array_t* a, uint32_t i);
+
+static inline bool come_bool_array_test(const come_bool_array_t* a, uint32_t i) {
+    return a && i < a->count && (a->items[i >> 6] >> (i & 63) & 1);
+}
+static inline void come_bool_array_set(come_bool_array_t* a, uint32_t i) {
+    if (a && i < a->count) a->items[i >> 6] |= (uint64_t)1 << (i & 63);
+}
+static inline void come_bool_array_clear(come_bool_array_t* a, uint32_t i) {
+    if (a && i < a->count) a->items[i >> 6] &= ~((uint64_t)1 << (i & 63));
+}
+static inline void come_bool_array_put(come_bool_array_t* a, uint32_t i, bool v) {
+    if (v) come_bool_array_set(a, i);
+    else come_bool_array_clear(a, i);
+}
+
+// Numeric kernels (kernels.c), SIMD with runtime CPU dispatch. Integer sums and dot
+// products widen to 64 bits, float ones accumulate in double; integer element-wise
+// arithmetic wraps. min/max of an empty array is 0, dot and add stop at the shorter
+// array, index_of returns -1 if absent, prefix_sum is inclusive and in place. The
+// read-only kernels also take views.
+#define COME_ARRAY_KERNELS(name, A, T, S) \
+    S name##_view_sum(name##_view_t a); \
+    T name##_view_min(name##_view_t a); \
+    T name##_view_max(name##_view_t a); \
+    S name##_view_dot(name##_view_t a, name##_view_t b); \
+    uint32_t name##_view_count(name##_view_t a, T v); \
+    long name##_view_index_of(name##_view_t a, T v); \
+    S name##_sum(const A* a); \
+    T name##_min(const A* a); \
+    T name##_max(const A* a); \
+    S name##_dot(const A* a, const A* b); \
+    void name##_fill(A* a, T v); \
+    void name##_scale(A* a, T k); \
+    void name##_add(A* a, const A* b); \
+    uint32_t name##_count(const A* a, T v); \
+    long name##_index_of(const A* a, T v); \
+    void name##_prefix_sum(A* a);
 
-// Helpers for specific types (to be called by codegen via _Generic)
-void* come_int_array_resize(come_int_array_t* a, uint32_t n);
-void* come_byte_array_resize(come_byte_array_t* a, uint32_t n);
-void* come_string_list_resize(come_string_list_t* a, uint32_t n);
+COME_ARRAY_KERNELS(come_int_array, come_int_array_t, int, int64_t)
+COME_ARRAY_KERNELS(come_long_array, come_long_array_t, int64_t, int64_t)
+COME_ARRAY_KERNELS(come_float_array, come_float_array_t, float, double)
+COME_ARRAY_KERNELS(come_double_array, come_double_array_t, double, double)
+COME_ARRAY_KERNELS(come_byte_array, come_byte_array_t, uint8_t, uint64_t)
 
-come_int_array_t* come_int_array_slice(come_int_array_t* a, uint32_t start, uint32_t end);
-come_byte_array_t* come_byte_array_slice(come_byte_array_t* a, uint32_t start, uint32_t end);
-come_string_list_t* come_string_list_slice(come_string_list_t* a, uint32_t start, uint32_t end);
+#define COME_ARRAY_KERNEL(a, op) _Generic((a), \
+    come_int_array_t*: come_int_array_##op, \
+    const come_int_array_t*: come_int_array_##op, \
+    come_long_array_t*: come_long_array_##op, \
+    const come_long_array_t*: come_long_array_##op, \
+    come_float_array_t*: come_float_array_##op, \
+    const come_float_array_t*: come_float_array_##op, \
+    come_double_array_t*: come_double_array_##op, \
+    const come_double_array_t*: come_double_array_##op, \
+    come_byte_array_t*: come_byte_array_##op, \
+    const come_byte_array_t*: come_byte_array_##op \
+)
+
+// Read-only kernels: arrays or views
+#define COME_ARRAY_READER(a, op) _Generic((a), \
+    come_int_array_t*: come_int_array_##op, \
+    const come_int_array_t*: come_int_array_##op, \
+    come_int_array_view_t: come_int_array_view_##op, \
+    come_long_array_t*: come_long_array_##op, \
+    const come_long_array_t*: come_long_array_##op, \
+    come_long_array_view_t: come_long_array_view_##op, \
+    come_float_array_t*: come_float_array_##op, \
+    const come_float_array_t*: come_float_array_##op, \
+    come_float_array_view_t: come_float_array_view_##op, \
+    come_double_array_t*: come_double_array_##op, \
+    const come_double_array_t*: come_double_array_##op, \
+    come_double_array_view_t: come_double_array_view_##op, \
+    come_byte_array_t*: come_byte_array_##op, \
+    const come_byte_array_t*: come_byte_array_##op, \
+    come_byte_array_view_t: come_byte_array_view_##op \
+)
+
+#define come_array_sum(a)         COME_ARRAY_READER(a, sum)(a)
+#define come_array_min(a)         COME_ARRAY_READER(a, min)(a)
+#define come_array_max(a)         COME_ARRAY_READER(a, max)(a)
+#define come_array_dot(a, b)      COME_ARRAY_READER(a, dot)((a), (b))
+#define come_array_fill(a, v)     COME_ARRAY_KERNEL(a, fill)((a), (v))
+#define come_array_scale(a, k)    COME_ARRAY_KERNEL(a, scale)((a), (k))
+#define come_array_add(a, b)      COME_ARRAY_KERNEL(a, add)((a), (b))
+#define come_array_count(a, v)    COME_ARRAY_READER(a, count)((a), (v))
+#define come_array_index_of(a, v) COME_ARRAY_READER(a, index_of)((a), (v))
+#define come_array_prefix_sum(a)  COME_ARRAY_KERNEL(a, prefix_sum)(a)
+
+// Sorting (sort.c). sort is ascending; numeric arrays order floats by IEEE total order
+// (-NaN < -inf < -0.0 < 0.0 < inf < NaN) and string lists compare bytewise, NULL as "".
+// partial_sort(a, k) moves the k smallest elements, sorted, to the front and leaves the
+// rest in unspecified order. binary_search expects a sorted array and returns the first
+// index of v, -1 if absent. unique drops adjacent duplicates in place (all duplicates, once
+// sorted) and returns the new count.
+#define COME_ARRAY_SORTING(name, A, T) \
+    void name##_sort(A* a); \
+    void name##_partial_sort(A* a, uint32_t k); \
+    long name##_binary_search(const A* a, T v); \
+    long name##_view_binary_search(name##_view_t a, T v); \
+    uint32_t name##_unique(A* a);
+
+COME_ARRAY_SORTING(come_int_array, come_int_array_t, int)
+COME_ARRAY_SORTING(come_long_array, come_long_array_t, int64_t)
+COME_ARRAY_SORTING(come_float_array, come_float_array_t, float)
+COME_ARRAY_SORTING(come_double_array, come_double_array_t, double)
+COME_ARRAY_SORTING(come_byte_array, come_byte_array_t, uint8_t)
+COME_ARRAY_SORTING(come_string_list, come_string_list_t, struct come_string_t*)
+
+#define COME_ARRAY_SORTER(a, op) _Generic((a), \
+    come_int_array_t*: come_int_array_##op, \
+    come_long_array_t*: come_long_array_##op, \
+    come_float_array_t*: come_float_array_##op, \
+    come_double_array_t*: come_double_array_##op, \
+    come_byte_array_t*: come_byte_array_##op, \
+    come_string_list_t*: come_string_list_##op \
+)
+
+#define come_array_sort(a)             COME_ARRAY_SORTER(a, sort)(a)
+#define come_array_partial_sort(a, k)  COME_ARRAY_SORTER(a, partial_sort)((a), (k))
+#define come_array_binary_search(a, v) _Generic((a), \
+    come_int_array_t*: come_int_array_binary_search, \
+    come_int_array_view_t: come_int_array_view_binary_search, \
+    come_long_array_t*: come_long_array_binary_search, \
+    come_long_array_view_t: come_long_array_view_binary_search, \
+    come_float_array_t*: come_float_array_binary_search, \
+    come_float_array_view_t: come_float_array_view_binary_search, \
+    come_double_array_t*: come_double_array_binary_search, \
+    come_double_array_view_t: come_double_array_view_binary_search, \
+    come_byte_array_t*: come_byte_array_binary_search, \
+    come_byte_array_view_t: come_byte_array_view_binary_search, \
+    come_string_list_t*: come_string_list_binary_search, \
+    come_string_list_view_t: come_string_list_view_binary_search \
+)((a), (v))
+#define come_array_unique(a)           COME_ARRAY_SORTER(a, unique)(a)
+
+// Any array, ordered by cmp(const T*, const T*) returning <0, 0 or >0 like qsort's.
+// stable_sort keeps equal elements in their original order. Returns 0, or -1 with errno
+// ENOMEM if the scratch space cannot be allocated (the array is left unchanged).
+typedef int (*come_array_cmp_t)(const void*, const void*);
+int come_array_sort_items(void* items, uint32_t n, size_t elem_size, come_array_cmp_t cmp, bool stable);
+
+#define come_array_sort_by(a, cmp) \
+    come_array_sort_items((a) ? (a)->items : NULL, come_array_size(a), COME_ARRAY_ELEM(a), (come_array_cmp_t)(cmp), false)
+#define come_array_stable_sort(a, cmp) \
+    come_array_sort_items((a) ? (a)->items : NULL, come_array_size(a), COME_ARRAY_ELEM(a), (come_array_cmp_t)(cmp), true)
+
+// Fixed-width integers at byte offset off of a byte view, big- or little-endian; 0 if
+// they do not fit. For parsing packets and file formats in place.
+#define COME_BYTES_READER(bits, order, big) \
+    static inline uint##bits##_t come_bytes_u##bits##order(come_byte_array_view_t v, uint32_t off) { \
+        if (off > v.count || v.count - off < bits / 8) return 0; \
+        const uint8_t* p = v.items + off; \
+        uint##bits##_t x = 0; \
+        for (int i = 0; i < bits / 8; i++) x |= (uint##bits##_t)p[i] << 8 * ((big) ? bits / 8 - 1 - i : i); \
+        return x; \
+    }
+
+COME_BYTES_READER(16, be, 1)
+COME_BYTES_READER(32, be, 1)
+COME_BYTES_READER(64, be, 1)
+COME_BYTES_READER(16, le, 0)
+COME_BYTES_READER(32, le, 0)
+COME_BYTES_READER(64, le, 0)
+
+// A byte[] or byte view as a view
+static inline come_byte_array_view_t come_bytes_view_of(come_byte_array_view_t v) { return v; }
+static inline come_byte_array_view_t come_bytes_array_view(const come_byte_array_t* a) {
+    return come_byte_array_view(a, 0, UINT32_MAX);
+}
+#define COME_BYTES(x) _Generic((x), \
+    come_byte_array_view_t: come_bytes_view_of, \
+    default: come_bytes_array_view)(x)
 
 // Generic Accessor
 #define COME_ARR_GET(arr, idx) _Generic((arr), \
@@ -52,33 +417,67 @@ come_string_list_t* come_string_list_slice(come_string_list_t* a, uint32_t start
     const come_string_list_t*: ((const come_string_list_t*)(arr))->items[(idx)], \
     struct come_string_t*: come_string_at((struct come_string_t*)(arr), (idx)), \
     const struct come_string_t*: come_string_at((const struct come_string_t*)(arr), (idx)), \
+    come_bool_array_t*: come_bool_array_test((come_bool_array_t*)(arr), (idx)), \
+    const come_bool_array_t*: come_bool_array_test((const come_bool_array_t*)(arr), (idx)), \
     default: (arr)->items[(idx)] \
 )
 
-// Generic Size
-#define come_array_size(arr) _Generic(&(arr), \
-    come_int_array_t**: ((arr) ? (arr)->count : 0), \
-    const come_int_array_t**: ((arr) ? (arr)->count : 0), \
-    come_byte_array_t**: ((arr) ? (arr)->count : 0), \
-    const come_byte_array_t**: ((arr) ? (arr)->count : 0), \
-    come_string_list_t**: ((arr) ? (arr)->count : 0), \
-    const come_string_list_t**: ((arr) ? (arr)->count : 0), \
-    struct come_string_t**: ((arr) ? (arr)->count : 0), \
-    const struct come_string_t**: ((arr) ? (arr)->count : 0) \
+// Generic element store, for receivers the compiler cannot type (struct fields)
+#define COME_ARR_PUT(arr, idx, v) _Generic((arr), \
+    come_bool_array_t*: come_bool_array_put((come_bool_array_t*)(arr), (idx), (v)), \
+    default: (void)((arr)->items[(idx)] = (v)) \
 )
 
-// Array Resize Helper Macro
-#define come_array_resize(a, n) ((a) = _Generic((a), \
-    come_int_array_t*: come_int_array_resize, \
-    come_byte_array_t*: come_byte_array_resize, \
-    come_string_list_t*: come_string_list_resize \
-)((a), (n)))
-
-// Array Slice Helper Macro
-#define come_array_slice(a, start, end) _Generic((a), \
-    come_int_array_t*: come_int_array_slice, \
-    come_byte_array_t*: come_byte_array_slice, \
-    come_string_list_t*: come_string_list_slice \
-)((a), (start), (end))
+// Generic Size (arrays and strings)
+#define come_array_size(arr) ((arr) ? (arr)->count : 0)
+
+// Generic array methods, for any array type from COME_ARRAY. The layout is taken from the
+// array's own type, so no per-type dispatch is needed. Methods that may move the array
+// store it back into a; values are evaluated before the array can move.
+#define COME_ARRAY_HDR(a)  offsetof(__typeof__(*(a)), items)
+#define COME_ARRAY_ELEM(a) sizeof((a)->items[0])
+#define COME_ARRAY_NEW(ctx, A, n) ((A*)come_array_new((ctx), offsetof(A, items), sizeof(((A*)0)->items[0]), (n)))
+
+#define come_array_push(a, v) ({ \
+    __typeof__((a)->items[0]) _cv = (v); \
+    __typeof__(a) _ca = come_array_grow((a), COME_ARRAY_HDR(a), COME_ARRAY_ELEM(a), 1); \
+    if (_ca) _ca->items[_ca->count++] = _cv; \
+    (a) = _ca; \
+})
+// mem_talloc_escape for a returned array of objects (string[]): the array and every
+// element allocated in the scope move to ctx
+#define come_array_escape(scope, ctx, a) ({ \
+    __typeof__(a) _ea = mem_talloc_escape((scope), (ctx), (a)); \
+    for (uint32_t _ei = 0; _ea && _ei < _ea->count; _ei++) mem_talloc_escape((scope), (ctx), _ea->items[_ei]); \
+    _ea; \
+})
+#define come_array_pop(a) ({ \
+    __typeof__((a)->items[0]) _cv = {0}; \
+    if ((a) && (a)->count) _cv = (a)->items[--(a)->count]; \
+    _cv; \
+})
+#define come_array_insert(a, i, v) ({ \
+    __typeof__((a)->items[0]) _cv = (v); \
+    (a) = come_array_insert_items((a), COME_ARRAY_HDR(a), COME_ARRAY_ELEM(a), (i), &_cv, 1); \
+})
+#define come_array_remove(a, i) ({ \
+    __typeof__((a)->items[0]) _cv = {0}; \
+    uint32_t _ci = (i); \
+    if ((a) && _ci < (a)->count) { \
+        _cv = (a)->items[_ci]; \
+        come_array_remove_items((a), COME_ARRAY_HDR(a), COME_ARRAY_ELEM(a), _ci, 1); \
+    } \
+    _cv; \
+})
+#define come_array_append(a, b) ({ \
+    const __typeof__(*(a))* _cb = (b); \
+    if (_cb) (a) = come_array_insert_items((a), COME_ARRAY_HDR(a), COME_ARRAY_ELEM(a), (a) ? (a)->count : 0, _cb->items, _cb->count); \
+    (a); \
+})
+#define come_array_reserve(a, n)    ((a) = come_array_grow((a), COME_ARRAY_HDR(a), COME_ARRAY_ELEM(a), (n)))
+#define come_array_shrink_to_fit(a) ((a) = come_array_shrink((a), COME_ARRAY_HDR(a), COME_ARRAY_ELEM(a)))
+#define come_array_resize(a, n)     ((a) = come_array_set_count((a), COME_ARRAY_HDR(a), COME_ARRAY_ELEM(a), (n)))
+#define come_array_slice(a, start, end) \
+    ((__typeof__(a))come_array_slice_items((a), COME_ARRAY_HDR(a), COME_ARRAY_ELEM(a), (start), (end)))
 
 #endif // COME_ARRAY_MODULE_H
@@ -0,0 +1,93 @@
+#ifndef COME_CONV_MODULE_H
+#define COME_CONV_MODULE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "come_string.h"
+
+// Number conversion without allocation, locale or format strings.
+//
+// Parsers read at most n bytes of s (no NUL needed) and return the number of bytes
+// consumed, 0 if s does not start with a number (*out is then 0). Whitespace is not
+// skipped. On overflow the result saturates and errno is set to ERANGE, as with
+// strtoll/strtod; an unsupported base sets EINVAL.
+//
+// Formatters write without a terminating NUL and return the length. Doubles use the
+// shortest digits that read back to the same value (Grisu2), printed like Python's
+// repr(): "0.1", "3.0", "1e+16", "1.5e-05", "inf", "nan".
+
+#define COME_CONV_LONG_MAX   20 // "-9223372036854775808"
+#define COME_CONV_DOUBLE_MAX 24 // "-2.2250738585072014e-308"
+
+size_t come_conv_parse_long(const char* s, size_t n, int base, long* out); // base 0 or 2-36
+size_t come_conv_parse_ulong(const char* s, size_t n, int base, unsigned long* out);
+size_t come_conv_parse_double(const char* s, size_t n, double* out);
+
+size_t come_conv_format_long(char* out, long v);
+size_t come_conv_format_ulong(char* out, unsigned long v);
+size_t come_conv_format_double(char* out, double v);
+
+// Append to a string builder (see come_string_builder); may move sb
+come_string_t* come_conv_append_long(come_string_t* sb, long v);
+come_string_t* come_conv_append_ulong(come_string_t* sb, unsigned long v);
+come_string_t* come_conv_append_double(come_string_t* sb, double v);
+
+// New strings, for conv.ltos(v) / conv.dtos(v)
+come_string_t* come_conv_ltos(TALLOC_CTX* ctx, long v);
+come_string_t* come_conv_dtos(TALLOC_CTX* ctx, double v);
+
+// Binary-to-text encodings into caller buffers. Formatters return the length written;
+// base64 is padded, base64url is not. Parsers decode all n bytes of s and return the
+// decoded length, or COME_CONV_INVALID with errno EINVAL if s is not valid in that
+// encoding. Base64 parsers accept padded and unpadded input; percent decoding leaves '+'
+// alone. Output may overlap the input only for parse_hex and parse_percent.
+#define COME_CONV_INVALID ((size_t)-1)
+
+#define COME_CONV_BASE64_LEN(n)     (((n) + 2) / 3 * 4)
+#define COME_CONV_BASE64URL_LEN(n)  (((n) * 4 + 2) / 3)
+#define COME_CONV_BASE64_DECODED(n) (((n) + 3) / 4 * 3) // Output buffer size for n characters
+#define COME_CONV_HEX_LEN(n)        ((n) * 2)
+#define COME_CONV_PERCENT_MAX(n)    ((n) * 3)
+
+size_t come_conv_format_base64(char* out, const void* in, size_t n);
+size_t come_conv_format_base64url(char* out, const void* in, size_t n);
+size_t come_conv_format_hex(char* out, const void* in, size_t n); // Lowercase
+size_t come_conv_format_percent(char* out, const void* in, size_t n); // RFC 3986 unreserved kept
+size_t come_conv_parse_base64(uint8_t* out, const char* s, size_t n);
+size_t come_conv_parse_base64url(uint8_t* out, const char* s, size_t n);
+size_t come_conv_parse_hex(uint8_t* out, const char* s, size_t n); // Either case
+size_t come_conv_parse_percent(uint8_t* out, const char* s, size_t n);
+
+typedef enum come_conv_encoding_t {
+    COME_CONV_BASE64,
+    COME_CONV_BASE64URL,
+    COME_CONV_HEX,
+    COME_CONV_PERCENT,
+} come_conv_encoding_t;
+
+come_string_t* come_conv_append_encoded(come_string_t* sb, come_conv_encoding_t enc, const void* p, size_t n);
+come_string_t* come_conv_encode(TALLOC_CTX* ctx, come_conv_encoding_t enc, const void* p, size_t n);
+come_byte_array_t* come_conv_decode(TALLOC_CTX* ctx, come_conv_encoding_t enc, const char* s, size_t n); // NULL if invalid
+come_string_t* come_conv_decode_string(TALLOC_CTX* ctx, come_conv_encoding_t enc, const char* s, size_t n);
+
+// For conv.base64(x) etc.: x is a string or a byte array
+#define COME_CONV_DATA(x) _Generic((x), \
+    come_byte_array_t*: (const void*)((come_byte_array_t*)(x))->items, \
+    const come_byte_array_t*: (const void*)((const come_byte_array_t*)(x))->items, \
+    default: (const void*)((const come_string_t*)(x))->data)
+#define COME_CONV_COUNT(x) ((x) ? (size_t)(x)->count : 0)
+#define COME_CONV_ENCODE(ctx, enc, x) ((x) ? come_conv_encode((ctx), (enc), COME_CONV_DATA(x), COME_CONV_COUNT(x)) : NULL)
+#define COME_CONV_DECODE(ctx, enc, s) ((s) ? come_conv_decode((ctx), (enc), (s)->data, (s)->count) : NULL)
+
+#define come_conv_base64(ctx, x)           COME_CONV_ENCODE(ctx, COME_CONV_BASE64, x)
+#define come_conv_base64url(ctx, x)        COME_CONV_ENCODE(ctx, COME_CONV_BASE64URL, x)
+#define come_conv_hex(ctx, x)              COME_CONV_ENCODE(ctx, COME_CONV_HEX, x)
+#define come_conv_percent(ctx, x)          COME_CONV_ENCODE(ctx, COME_CONV_PERCENT, x)
+#define come_conv_base64_decode(ctx, s)    COME_CONV_DECODE(ctx, COME_CONV_BASE64, s)
+#define come_conv_base64url_decode(ctx, s) COME_CONV_DECODE(ctx, COME_CONV_BASE64URL, s)
+#define come_conv_hex_decode(ctx, s)       COME_CONV_DECODE(ctx, COME_CONV_HEX, s)
+#define come_conv_percent_decode(ctx, s) \
+    ((s) ? come_conv_decode_string((ctx), COME_CONV_PERCENT, (s)->data, (s)->count) : NULL)
+
+#endif
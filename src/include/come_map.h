@@ -0,0 +1,333 @@
+#ifndef COME_MAP_MODULE_H
+#define COME_MAP_MODULE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "come_string.h"
+#include "come_array.h"
+#include "come_phf.h"
+
+// map: SwissTable-style open addressing (map.c). Every slot has a control byte holding
+// EMPTY, DELETED or the low 7 bits of its key's hash; a lookup compares a group of 16
+// control bytes at once (SSE2) and only looks at keys whose bits match. Groups are
+// probed quadratically and the table is rehashed at 7/8 load.
+//
+// Keys are int64_t or strings; string keys are copied into the map. Values are val_size
+// bytes stored as given, so a string value is shared like an array element. The map
+// header never moves and its table, keys and values are its talloc children: freeing
+// the map frees everything, and no map operation returns a new map.
+
+#define COME_MAP_INT    0
+#define COME_MAP_STRING 1
+
+typedef struct come_map_t {
+    uint32_t count;       // Entries
+    uint32_t cap;         // Slots: 0 or a power of two, at least one group
+    uint32_t growth_left; // Inserts into EMPTY slots before the next rehash
+    uint32_t val_size;
+    uint32_t slot_size;   // 8-byte key, then the value padded to 8 bytes
+    int key_kind;         // COME_MAP_INT or COME_MAP_STRING
+    int8_t* ctrl;
+    unsigned char* slots;
+} come_map_t;
+
+come_map_t* come_map_new(TALLOC_CTX* ctx, int key_kind, uint32_t val_size, uint32_t n); // Room for n
+bool come_map_reserve(come_map_t* m, uint32_t n); // Room for n entries in total
+void come_map_clear(come_map_t* m);
+
+// Lookups return the value's slot, or NULL if the key is absent (or of the other kind).
+// insert returns the existing value or a new zeroed one, NULL on allocation failure.
+// The slot stays valid until the next insert or delete.
+void* come_map_find_int(const come_map_t* m, int64_t key);
+void* come_map_find_cstr(const come_map_t* m, const char* key);
+void* come_map_find_string(const come_map_t* m, const come_string_t* key);
+void* come_map_find_str(const come_map_t* m, const char* key, size_t len);
+void* come_map_insert_int(come_map_t* m, int64_t key);
+void* come_map_insert_cstr(come_map_t* m, const char* key);
+void* come_map_insert_string(come_map_t* m, const come_string_t* key);
+void* come_map_insert_str(come_map_t* m, const char* key, size_t len);
+bool come_map_delete_int(come_map_t* m, int64_t key);
+bool come_map_delete_cstr(come_map_t* m, const char* key);
+bool come_map_delete_string(come_map_t* m, const come_string_t* key);
+
+// Bulk insert of n keys (int64_t[] or const char*[] by key kind) and their n values,
+// sized once up front. Used for map literals.
+bool come_map_put_all(come_map_t* m, const void* keys, const void* vals, uint32_t n);
+
+// Iteration in table order: for (long i = come_map_next(m, 0); i >= 0; i = come_map_next(m, i + 1))
+long come_map_next(const come_map_t* m, long i);
+int64_t come_map_int_key_at(const come_map_t* m, long i);
+come_string_t* come_map_string_key_at(const come_map_t* m, long i);
+void* come_map_value_at(const come_map_t* m, long i);
+
+// All keys as come_long_array_t* or come_string_list_t* (the strings belong to the map),
+// and all values as an array whose items start at hdr, in iteration order
+void* come_map_keys(TALLOC_CTX* ctx, const come_map_t* m);
+void* come_map_values(TALLOC_CTX* ctx, const come_map_t* m, size_t hdr);
+
+static inline uint32_t come_map_size(const come_map_t* m) { return m ? m->count : 0; }
+
+// Typed access for the compiler: k is a string (come_string_t* or C string) or an integer,
+// T the map's value type. get of a missing key is T's zero value.
+#define COME_MAP_KEYED(op, m, k) _Generic((k), \
+    come_string_t*: come_map_##op##_string, \
+    const come_string_t*: come_map_##op##_string, \
+    char*: come_map_##op##_cstr, \
+    const char*: come_map_##op##_cstr, \
+    default: come_map_##op##_int)((m), (k))
+
+#define come_map_get(m, k, T) ({ \
+    T* _mp = (T*)COME_MAP_KEYED(find, (m), k); \
+    _mp ? *_mp : (T){0}; \
+})
+#define come_map_set(m, k, T, v) ({ \
+    T _mv = (v); \
+    T* _mp = (T*)COME_MAP_KEYED(insert, (m), k); \
+    if (_mp) *_mp = _mv; \
+    _mp != NULL; \
+})
+#define come_map_has(m, k)    (COME_MAP_KEYED(find, (m), k) != NULL)
+#define come_map_delete(m, k) COME_MAP_KEYED(delete, (m), k)
+#define come_map_values_of(ctx, m, A) ((A*)come_map_values((ctx), (m), offsetof(A, items)))
+
+// Constant map: a perfect hash table the compiler emits in read-only data for a literal
+// with literal keys that is never modified (come_phf.h). Each key owns one slot, so a
+// lookup hashes once, probes one slot and compares one key. Empty slots hold a key
+// that hashes elsewhere (int) or has length UINT32_MAX (string), so they never match.
+typedef struct come_map_const_t {
+    uint32_t count;
+    uint32_t shift;       // Slots: 1 << (32 - shift)
+    uint32_t bucket_mask; // Buckets - 1, a power of two
+    uint32_t val_size;
+    int key_kind;
+    const uint32_t* disp; // Per bucket
+    const void* keys;     // Per slot: int64_t, or const char* with its length in lens
+    const uint32_t* lens;
+    const void* vals;     // Per slot
+} come_map_const_t;
+
+static inline uint32_t come_map_const_slot(const come_map_const_t* m, uint64_t h) {
+    return come_phf_slot(h, m->disp[come_phf_bucket(h, m->bucket_mask)], m->shift);
+}
+
+static inline const void* come_map_const_find_int(const come_map_const_t* m, int64_t key) {
+    uint32_t s = come_map_const_slot(m, come_phf_hash_int(key));
+    if (m->key_kind != COME_MAP_INT || ((const int64_t*)m->keys)[s] != key) return NULL;
+    return (const char*)m->vals + (size_t)s * m->val_size;
+}
+
+static inline const void* come_map_const_find_str(const come_map_const_t* m, const char* key, size_t len) {
+    uint32_t s = come_map_const_slot(m, come_phf_hash(key, len));
+    if (m->key_kind != COME_MAP_STRING || m->lens[s] != len ||
+        memcmp(((const char* const*)m->keys)[s], key, len) != 0) return NULL;
+    return (const char*)m->vals + (size_t)s * m->val_size;
+}
+
+static inline const void* come_map_const_find_cstr(const come_map_const_t* m, const char* key) {
+    return come_map_const_find_str(m, key, strlen(key));
+}
+
+static inline const void* come_map_const_find_string(const come_map_const_t* m, const come_string_t* key) {
+    return key ? come_map_const_find_str(m, key->data, key->count) : NULL;
+}
+
+// keys() and values() as for come_map_t, in slot order
+void* come_map_const_keys(TALLOC_CTX* ctx, const come_map_const_t* m);
+void* come_map_const_values(TALLOC_CTX* ctx, const come_map_const_t* m, size_t hdr);
+
+#define COME_MAP_CONST_FIND(m, k) _Generic((k), \
+    come_string_t*: come_map_const_find_string, \
+    const come_string_t*: come_map_const_find_string, \
+    char*: come_map_const_find_cstr, \
+    const char*: come_map_const_find_cstr, \
+    default: come_map_const_find_int)((m), (k))
+
+#define come_map_const_get(m, k, T) ({ \
+    const T* _mp = (const T*)COME_MAP_CONST_FIND((m), k); \
+    _mp ? *_mp : (T){0}; \
+})
+#define come_map_const_has(m, k) (COME_MAP_CONST_FIND((m), k) != NULL)
+#define come_map_const_values_of(ctx, m, A) ((A*)come_map_const_values((ctx), (m), offsetof(A, items)))
+
+// ordered_map: B+tree (btree.c) keyed like map, iterated in key order. Nodes hold up to
+// 32 keys (inner nodes 33 children) so a lookup touches a few cache-line-dense nodes;
+// values live in the leaves, which are linked for range scans. Nodes come from a talloc
+// pool owned by the map and are recycled through a free list. String keys are copied
+// and compared bytewise.
+typedef struct come_ordered_map_node_t come_ordered_map_node_t;
+
+typedef struct come_ordered_map_t {
+    uint32_t count;
+    uint32_t val_size;
+    uint32_t val_stride; // val_size padded to 8 bytes
+    int key_kind;        // COME_MAP_INT or COME_MAP_STRING
+    uint32_t height;     // Levels above the leaves
+    come_ordered_map_node_t* root;
+    come_ordered_map_node_t* first; // Leftmost leaf, NULL when empty
+    come_ordered_map_node_t* free_nodes;
+    uint32_t free_count;
+    void* pool;          // Context of the nodes and string keys
+} come_ordered_map_t;
+
+// Position in key order; node NULL past the end. A range cursor also stops at its
+// upper bound (whose string must stay alive while iterating). Cursors are invalidated
+// by inserts and deletes.
+typedef struct come_ordered_map_iter_t {
+    const come_ordered_map_t* map;
+    const come_ordered_map_node_t* node;
+    uint32_t i;
+    bool bounded;
+    int64_t hi_int;
+    const char* hi_str;
+    size_t hi_len;
+} come_ordered_map_iter_t;
+
+come_ordered_map_t* come_ordered_map_new(TALLOC_CTX* ctx, int key_kind, uint32_t val_size);
+void come_ordered_map_clear(come_ordered_map_t* m);
+
+// As come_map_find_* / insert_* / delete_*
+void* come_ordered_map_find_int(const come_ordered_map_t* m, int64_t key);
+void* come_ordered_map_find_str(const come_ordered_map_t* m, const char* key, size_t len);
+void* come_ordered_map_find_cstr(const come_ordered_map_t* m, const char* key);
+void* come_ordered_map_find_string(const come_ordered_map_t* m, const come_string_t* key);
+void* come_ordered_map_insert_int(come_ordered_map_t* m, int64_t key);
+void* come_ordered_map_insert_str(come_ordered_map_t* m, const char* key, size_t len);
+void* come_ordered_map_insert_cstr(come_ordered_map_t* m, const char* key);
+void* come_ordered_map_insert_string(come_ordered_map_t* m, const come_string_t* key);
+bool come_ordered_map_delete_int(come_ordered_map_t* m, int64_t key);
+bool come_ordered_map_delete_str(come_ordered_map_t* m, const char* key, size_t len);
+bool come_ordered_map_delete_cstr(come_ordered_map_t* m, const char* key);
+bool come_ordered_map_delete_string(come_ordered_map_t* m, const come_string_t* key);
+
+// n keys (int64_t[] or const char*[]) and values. Into an empty map with strictly
+// ascending keys the tree is built bottom-up with full nodes; otherwise one insert each.
+bool come_ordered_map_put_all(come_ordered_map_t* m, const void* keys, const void* vals, uint32_t n);
+
+// Cursors: the first entry, the first entry with key >= k, and the entries in [lo, hi)
+come_ordered_map_iter_t come_ordered_map_first(const come_ordered_map_t* m);
+come_ordered_map_iter_t come_ordered_map_lower_bound_int(const come_ordered_map_t* m, int64_t key);
+come_ordered_map_iter_t come_ordered_map_lower_bound_str(const come_ordered_map_t* m, const char* key, size_t len);
+come_ordered_map_iter_t come_ordered_map_lower_bound_cstr(const come_ordered_map_t* m, const char* key);
+come_ordered_map_iter_t come_ordered_map_lower_bound_string(const come_ordered_map_t* m, const come_string_t* key);
+come_ordered_map_iter_t come_ordered_map_range_int(const come_ordered_map_t* m, int64_t lo, int64_t hi);
+come_ordered_map_iter_t come_ordered_map_range_cstr(const come_ordered_map_t* m, const char* lo, const char* hi);
+come_ordered_map_iter_t come_ordered_map_range_string(const come_ordered_map_t* m, const come_string_t* lo, const come_string_t* hi);
+bool come_ordered_map_iter_valid(const come_ordered_map_iter_t* it);
+void come_ordered_map_iter_next(come_ordered_map_iter_t* it);
+int64_t come_ordered_map_iter_int_key(const come_ordered_map_iter_t* it);
+come_string_t* come_ordered_map_iter_string_key(const come_ordered_map_iter_t* it);
+void* come_ordered_map_iter_value(const come_ordered_map_iter_t* it);
+
+// All keys / values in key order, as come_map_keys / come_map_values
+void* come_ordered_map_keys(TALLOC_CTX* ctx, const come_ordered_map_t* m);
+void* come_ordered_map_values(TALLOC_CTX* ctx, const come_ordered_map_t* m, size_t hdr);
+
+static inline uint32_t come_ordered_map_size(const come_ordered_map_t* m) { return m ? m->count : 0; }
+
+#define COME_ORDERED_MAP_KEYED(op, m, k) _Generic((k), \
+    come_string_t*: come_ordered_map_##op##_string, \
+    const come_string_t*: come_ordered_map_##op##_string, \
+    char*: come_ordered_map_##op##_cstr, \
+    const char*: come_ordered_map_##op##_cstr, \
+    default: come_ordered_map_##op##_int)
+
+#define come_ordered_map_get(m, k, T) ({ \
+    T* _mp = (T*)COME_ORDERED_MAP_KEYED(find, (m), k)((m), (k)); \
+    _mp ? *_mp : (T){0}; \
+})
+#define come_ordered_map_set(m, k, T, v) ({ \
+    T _mv = (v); \
+    T* _mp = (T*)COME_ORDERED_MAP_KEYED(insert, (m), k)((m), (k)); \
+    if (_mp) *_mp = _mv; \
+    _mp != NULL; \
+})
+#define come_ordered_map_has(m, k)         (COME_ORDERED_MAP_KEYED(find, (m), k)((m), (k)) != NULL)
+#define come_ordered_map_delete(m, k)      COME_ORDERED_MAP_KEYED(delete, (m), k)((m), (k))
+#define come_ordered_map_lower_bound(m, k) COME_ORDERED_MAP_KEYED(lower_bound, (m), k)((m), (k))
+#define come_ordered_map_range(m, lo, hi)  COME_ORDERED_MAP_KEYED(range, (m), lo)((m), (lo), (hi))
+#define come_ordered_map_values_of(ctx, m, A) ((A*)come_ordered_map_values((ctx), (m), offsetof(A, items)))
+
+// lru: a cache of at most max_count entries and max_bytes bytes (0: no limit) that
+// evicts the least recently used entry (lru.c). A map from key to entry finds entries
+// in O(1) and an intrusive doubly linked list through the entries keeps them in use
+// order, so get (which moves the entry to the front) and put are O(1) as well. Each
+// entry is a talloc child of the cache holding its key, its value and, for
+// COME_LRU_VALUE_STRING, a copy of the value string, so an eviction frees all of them.
+// An entry's cost is its size plus the key and value string bytes, without allocator
+// overhead.
+
+#define COME_LRU_VALUE_PLAIN  0 // Values stored as given
+#define COME_LRU_VALUE_STRING 1 // come_string_t* values, copied into the entry (moved if the cache owns them)
+
+typedef struct come_lru_link_t {
+    struct come_lru_link_t* prev;
+    struct come_lru_link_t* next;
+} come_lru_link_t;
+
+typedef struct come_lru_t {
+    uint32_t count;
+    uint32_t max_count;
+    size_t bytes;        // Cost of the entries
+    size_t max_bytes;
+    uint32_t val_size;
+    int key_kind;        // COME_MAP_INT or COME_MAP_STRING
+    int val_kind;        // COME_LRU_VALUE_*
+    come_map_t* index;   // Key to entry
+    come_lru_link_t list; // Sentinel: next is the most recently used entry, prev the least
+} come_lru_t;
+
+come_lru_t* come_lru_new(TALLOC_CTX* ctx, int key_kind, uint32_t val_size, int val_kind,
+                         uint32_t max_count, size_t max_bytes);
+void come_lru_clear(come_lru_t* c);
+
+// find returns the value and makes the entry the most recently used; peek leaves the
+// order alone. NULL if the key is absent. The value belongs to the cache and is freed
+// when its entry is evicted, replaced or deleted.
+void* come_lru_find_int(come_lru_t* c, int64_t key);
+void* come_lru_find_cstr(come_lru_t* c, const char* key);
+void* come_lru_find_string(come_lru_t* c, const come_string_t* key);
+void* come_lru_peek_int(const come_lru_t* c, int64_t key);
+void* come_lru_peek_cstr(const come_lru_t* c, const char* key);
+void* come_lru_peek_string(const come_lru_t* c, const come_string_t* key);
+
+// Store the val_size bytes at val as the most recently used entry, replacing an existing
+// value, then evict from the least recently used end until both limits hold. False if
+// allocation failed or the entry alone is over max_bytes (it is not kept).
+bool come_lru_put_int(come_lru_t* c, int64_t key, const void* val);
+bool come_lru_put_cstr(come_lru_t* c, const char* key, const void* val);
+bool come_lru_put_string(come_lru_t* c, const come_string_t* key, const void* val);
+bool come_lru_delete_int(come_lru_t* c, int64_t key);
+bool come_lru_delete_cstr(come_lru_t* c, const char* key);
+bool come_lru_delete_string(come_lru_t* c, const come_string_t* key);
+
+// All keys, most recently used first, as come_long_array_t* or come_string_list_t* (the
+// strings belong to the cache)
+void* come_lru_keys(TALLOC_CTX* ctx, const come_lru_t* c);
+
+static inline uint32_t come_lru_size(const come_lru_t* c) { return c ? c->count : 0; }
+static inline size_t come_lru_bytes(const come_lru_t* c) { return c ? c->bytes : 0; }
+
+#define COME_LRU_KEYED(op, c, k) _Generic((k), \
+    come_string_t*: come_lru_##op##_string, \
+    const come_string_t*: come_lru_##op##_string, \
+    char*: come_lru_##op##_cstr, \
+    const char*: come_lru_##op##_cstr, \
+    default: come_lru_##op##_int)
+
+#define come_lru_get(c, k, T) ({ \
+    T* _lp = (T*)COME_LRU_KEYED(find, (c), k)((c), (k)); \
+    _lp ? *_lp : (T){0}; \
+})
+#define come_lru_peek(c, k, T) ({ \
+    T* _lp = (T*)COME_LRU_KEYED(peek, (c), k)((c), (k)); \
+    _lp ? *_lp : (T){0}; \
+})
+#define come_lru_set(c, k, T, v) ({ \
+    T _lv = (v); \
+    COME_LRU_KEYED(put, (c), k)((c), (k), &_lv); \
+})
+#define come_lru_has(c, k)    (COME_LRU_KEYED(peek, (c), k)((c), (k)) != NULL)
+#define come_lru_delete(c, k) COME_LRU_KEYED(delete, (c), k)((c), (k))
+
+#endif
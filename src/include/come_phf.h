@@ -0,0 +1,51 @@
+#ifndef COME_PHF_H
+#define COME_PHF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Perfect hashing for constant maps (come_map_const_t). The compiler builds the tables
+// and the program probes them, so both use these functions; unlike come_hash_bytes()
+// they are not seeded per process.
+//
+// A key's 64-bit hash picks its bucket with the high half; its slot is the low half
+// xored with the bucket's displacement, then multiplied and shifted down to the table
+// size. The compiler chooses the displacements so no two keys share a slot.
+
+static inline uint64_t come_phf_mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline uint64_t come_phf_hash(const void* key, size_t len) {
+    const unsigned char* p = (const unsigned char*)key;
+    uint64_t h = 0x9e3779b97f4a7c15ull ^ len;
+    uint64_t w;
+    for (; len >= 8; p += 8, len -= 8) {
+        memcpy(&w, p, 8);
+        h = come_phf_mix(h ^ w);
+    }
+    w = 0;
+    if (len) memcpy(&w, p, len);
+    return come_phf_mix(h ^ w);
+}
+
+static inline uint64_t come_phf_hash_int(int64_t key) {
+    return come_phf_mix((uint64_t)key ^ 0x9e3779b97f4a7c15ull);
+}
+
+static inline uint32_t come_phf_bucket(uint64_t h, uint32_t bucket_mask) {
+    return (uint32_t)(h >> 32) & bucket_mask;
+}
+
+// shift is 32 - log2(slots), slots >= 2
+static inline uint32_t come_phf_slot(uint64_t h, uint32_t disp, uint32_t shift) {
+    return (((uint32_t)h ^ disp) * 0x9e3779b1u) >> shift;
+}
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef COME_QUEUE_MODULE_H
+#define COME_QUEUE_MODULE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include "come_array.h"
+
+// deque: a ring buffer of elem_size-byte elements (deque.c). The capacity is a power of
+// two, so element i is at (head + i) & (cap - 1) and pushing or popping at either end is
+// O(1) with no shifting. A full deque doubles, copying its elements unwrapped once. The
+// header never moves and the buffer is its talloc child: freeing the deque frees it, and
+// no deque operation returns a new deque. Elements are stored as given, so a string
+// element is shared like an array element.
+typedef struct come_deque_t {
+    uint32_t head;  // Slot of element 0
+    uint32_t count;
+    uint32_t cap;   // Slots: 0 or a power of two
+    uint32_t elem_size;
+    unsigned char* items;
+} come_deque_t;
+
+typedef come_deque_t* deque;
+
+come_deque_t* come_deque_new(TALLOC_CTX* ctx, uint32_t elem_size, uint32_t n); // Room for n
+bool come_deque_reserve(come_deque_t* d, uint32_t n); // Room for n elements in total
+void come_deque_clear(come_deque_t* d);
+
+// Slot for a new first / last element, NULL on allocation failure. Its bytes are stale:
+// the caller stores the element.
+void* come_deque_push_front_slot(come_deque_t* d);
+void* come_deque_push_back_slot(come_deque_t* d);
+
+// Elements in order as an array (hdr is offsetof(items) of the array type)
+void* come_deque_values(TALLOC_CTX* ctx, const come_deque_t* d, size_t hdr);
+
+static inline uint32_t come_deque_size(const come_deque_t* d) { return d ? d->count : 0; }
+
+// Element i, NULL if out of range
+static inline void* come_deque_at(const come_deque_t* d, uint32_t i) {
+    if (!d || i >= d->count) return NULL;
+    return d->items + (size_t)((d->head + i) & (d->cap - 1)) * d->elem_size;
+}
+
+// Remove the first / last element; its slot stays readable until the next push
+static inline void* come_deque_take_front(come_deque_t* d) {
+    void* p = come_deque_at(d, 0);
+    if (p) {
+        d->head = (d->head + 1) & (d->cap - 1);
+        d->count--;
+    }
+    return p;
+}
+
+static inline void* come_deque_take_back(come_deque_t* d) {
+    void* p = come_deque_at(d, d ? d->count - 1 : 0);
+    if (p) d->count--;
+    return p;
+}
+
+// Typed access for element type T; a missing element reads as T's zero value
+#define COME_QUEUE_READ(p, T) ({ \
+    T* _dp = (T*)(p); \
+    _dp ? *_dp : (T){0}; \
+})
+#define come_deque_push_back(d, T, v) ({ \
+    T _dv = (v); \
+    T* _dp = (T*)come_deque_push_back_slot(d); \
+    if (_dp) *_dp = _dv; \
+    _dp != NULL; \
+})
+#define come_deque_push_front(d, T, v) ({ \
+    T _dv = (v); \
+    T* _dp = (T*)come_deque_push_front_slot(d); \
+    if (_dp) *_dp = _dv; \
+    _dp != NULL; \
+})
+#define come_deque_pop_front(d, T) COME_QUEUE_READ(come_deque_take_front(d), T)
+#define come_deque_pop_back(d, T)  COME_QUEUE_READ(come_deque_take_back(d), T)
+#define come_deque_front(d, T)     COME_QUEUE_READ(come_deque_at((d), 0), T)
+#define come_deque_back(d, T)      COME_QUEUE_READ(come_deque_at((d), come_deque_size(d) - 1), T)
+#define come_deque_get(d, i, T)    COME_QUEUE_READ(come_deque_at((d), (i)), T)
+#define come_deque_set(d, i, T, v) ({ \
+    T _dv = (v); \
+    T* _dp = (T*)come_deque_at((d), (i)); \
+    if (_dp) *_dp = _dv; \
+    _dp != NULL; \
+})
+#define come_deque_values_of(ctx, d, A) ((A*)come_deque_values((ctx), (d), offsetof(A, items)))
+
+// heap: a 4-ary min-heap of elem_size-byte values ordered by int64_t priority (heap.c).
+// The heap array holds only priorities and value ids, so a node's four children are 64
+// contiguous bytes and a sift compares them without touching the values, which stay
+// put in a slab indexed by id. push returns a handle (generation << 32 | id) that stays
+// valid until its value is popped or removed: decrease_key / remove / get on a stale
+// handle fail instead of touching a reused slot. The arrays are talloc children of the
+// heap; it never moves.
+typedef struct come_heap_entry_t {
+    int64_t priority;
+    uint32_t id;
+} come_heap_entry_t;
+
+typedef struct come_heap_t {
+    uint32_t count;
+    uint32_t cap;       // Ids with room in every array
+    uint32_t elem_size;
+    uint32_t next_id;   // Ids handed out so far
+    uint32_t free_id;   // Most recently freed id, UINT32_MAX if none
+    come_heap_entry_t* order; // count entries in heap order
+    uint32_t* pos;      // Per id: index in order, or the next free id once freed
+    uint32_t* gen;      // Per id: odd while in the heap
+    unsigned char* values;
+} come_heap_t;
+
+typedef come_heap_t* heap;
+
+come_heap_t* come_heap_new(TALLOC_CTX* ctx, uint32_t elem_size, uint32_t n); // Room for n
+bool come_heap_reserve(come_heap_t* h, uint32_t n);
+void come_heap_clear(come_heap_t* h);
+
+// New value slot with the given priority; *handle is set, -1 on allocation failure.
+// The caller stores the value before the next heap call.
+void* come_heap_push_slot(come_heap_t* h, int64_t priority, int64_t* handle);
+
+// Remove the value of least priority (ties in no particular order); its slot stays
+// readable until the next push. NULL when empty
+void* come_heap_take(come_heap_t* h);
+
+// Lower the priority of a queued value (or leave it, if priority is not lower);
+// false for a stale handle
+bool come_heap_decrease_key(come_heap_t* h, int64_t handle, int64_t priority);
+bool come_heap_remove(come_heap_t* h, int64_t handle);
+void* come_heap_value(const come_heap_t* h, int64_t handle); // NULL for a stale handle
+int64_t come_heap_priority(const come_heap_t* h, int64_t handle); // INT64_MAX for a stale handle
+
+static inline uint32_t come_heap_size(const come_heap_t* h) { return h ? h->count : 0; }
+static inline bool come_heap_contains(const come_heap_t* h, int64_t handle) { return come_heap_value(h, handle) != NULL; }
+
+// The value of least priority without removing it, NULL when empty
+static inline void* come_heap_top(const come_heap_t* h) {
+    if (!h || !h->count) return NULL;
+    return h->values + (size_t)h->order[0].id * h->elem_size;
+}
+
+// Least priority, INT64_MAX when empty
+static inline int64_t come_heap_top_priority(const come_heap_t* h) {
+    return h && h->count ? h->order[0].priority : INT64_MAX;
+}
+
+// Typed access for value type T: push returns the handle (-1 on failure), pop / peek
+// the value or T's zero value when empty
+#define come_heap_push(h, T, v, priority) ({ \
+    T _hv = (v); \
+    int64_t _hh; \
+    T* _hp = (T*)come_heap_push_slot((h), (priority), &_hh); \
+    if (_hp) *_hp = _hv; \
+    _hh; \
+})
+#define come_heap_pop(h, T)       COME_QUEUE_READ(come_heap_take(h), T)
+#define come_heap_peek(h, T)      COME_QUEUE_READ(come_heap_top(h), T)
+#define come_heap_get(h, k, T)    COME_QUEUE_READ(come_heap_value((h), (k)), T)
+
+// ringbuf: a fixed-capacity byte queue (ringbuf.c). head and tail are free-running read
+// and write positions that wrap at 2^32; the capacity is a power of two, so the buffer
+// offset of either is a mask and size is tail - head. The free space and the unread
+// bytes are each at most two contiguous regions, split where the buffer wraps:
+// write_region / read_region return the first as a byte view to fill or drain in
+// place (recv into it, then commit; send from it, then consume), and recv / send move
+// both regions in one recvmsg / sendmsg. An empty buffer restarts at offset 0, so its
+// whole capacity is one region.
+typedef struct come_ringbuf_t {
+    uint8_t* data;
+    uint32_t cap;
+    uint32_t head; // Read position
+    uint32_t tail; // Write position
+} come_ringbuf_t;
+
+typedef come_ringbuf_t* ringbuf;
+
+come_ringbuf_t* come_ringbuf_new(TALLOC_CTX* ctx, uint32_t capacity); // Rounded up to a power of two
+void come_ringbuf_clear(come_ringbuf_t* rb);
+
+static inline uint32_t come_ringbuf_size(const come_ringbuf_t* rb) { return rb ? rb->tail - rb->head : 0; }
+static inline uint32_t come_ringbuf_capacity(const come_ringbuf_t* rb) { return rb ? rb->cap : 0; }
+static inline uint32_t come_ringbuf_space(const come_ringbuf_t* rb) { return rb ? rb->cap - (rb->tail - rb->head) : 0; }
+
+// Contiguous free space / unread bytes; the views stay valid until the next call that
+// changes rb. commit marks n written bytes readable (at most the free space) and consume
+// drops n read bytes (at most the unread ones).
+come_byte_array_view_t come_ringbuf_write_region(come_ringbuf_t* rb);
+come_byte_array_view_t come_ringbuf_read_region(const come_ringbuf_t* rb);
+void come_ringbuf_commit(come_ringbuf_t* rb, uint32_t n);
+void come_ringbuf_consume(come_ringbuf_t* rb, uint32_t n);
+
+// Copies: write as much of src as fits, read up to dst.count bytes; return the bytes moved
+uint32_t come_ringbuf_write(come_ringbuf_t* rb, come_byte_array_view_t src);
+uint32_t come_ringbuf_read(come_ringbuf_t* rb, come_byte_array_view_t dst);
+
+// One recvmsg into all free space / sendmsg of all unread bytes, committing or consuming
+// what moved. As recv/send: bytes moved, 0 at end of stream (recv), -1 with errno set.
+// recv into a full buffer fails with ENOBUFS and send of an empty one returns 0, both
+// without a system call.
+ssize_t come_ringbuf_recv(come_ringbuf_t* rb, int fd, int flags);
+ssize_t come_ringbuf_send(come_ringbuf_t* rb, int fd, int flags);
+
+#endif
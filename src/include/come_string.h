@@ -12,18 +12,51 @@ typedef void TALLOC_CTX;
 
 
 typedef struct come_string_t {
-    uint32_t size;  // Total allocated capacity (bytes)
-    uint32_t count; // Number of characters used
-    char data[];    // Flexible array member
+    uint32_t size;   // Total allocated capacity (bytes)
+    uint32_t count;  // Number of characters used
+    uint32_t flags;  // COME_STRING_* scan results, 0 until first needed
+    uint32_t nchars; // Code points, valid once COME_STRING_SCANNED is set
+    uint64_t hash;   // come_string_hash(), valid once COME_STRING_HASHED is set
+    char data[];     // Flexible array member
 } come_string_t;
 
+// Cached in flags; anything writing to data after creation must clear them. Readers fill
+// the caches lazily, also on strings other threads read: the value is stored first and
+// its flag then set with release order, and flags are loaded with acquire order.
+// Interned strings have every cache filled before they are published.
+#define COME_STRING_SCANNED    0x1 // nchars and COME_STRING_ASCII are known
+#define COME_STRING_ASCII      0x2
+#define COME_STRING_UTF8_KNOWN 0x4 // COME_STRING_UTF8 is known
+#define COME_STRING_UTF8       0x8 // Valid UTF-8
+#define COME_STRING_HASHED     0x10 // hash is known
+
 typedef come_string_t* string;
 
+// A string in static storage for compiler-emitted constant tables, used through
+// (come_string_t*)&name. It is not a talloc object: read it, never free, share or grow it.
+#define COME_STATIC_STRING(name, lit) \
+    static struct { uint32_t size, count, flags, nchars; uint64_t hash; char data[sizeof(lit)]; } name = \
+        { sizeof(lit), sizeof(lit) - 1, 0, 0, 0, lit }
+
 // Constructor/Destructor
 come_string_t* come_string_new(TALLOC_CTX* ctx, const char* str);
-come_string_t* come_string_new_len(TALLOC_CTX* ctx, const char* str, size_t len);
+come_string_t* come_string_new_len(TALLOC_CTX* ctx, const char* str, size_t len); // str NULL: reserve len bytes
 void come_string_free(come_string_t* str);
 
+// Copy-on-write sharing via talloc references. share() makes ctx an extra owner of a in
+// O(1) and returns a; the string lives until every owner is freed. Shared strings are
+// read-only: writers first take come_string_cow(), which returns a private copy on ctx
+// (or a itself when nobody else holds it). Builders do this on their own.
+come_string_t* come_string_share(come_string_t* a, TALLOC_CTX* ctx);
+bool come_string_shared(const come_string_t* a);
+come_string_t* come_string_cow(come_string_t* a, TALLOC_CTX* ctx);
+
+// Builder: a string with spare capacity (size > count). Appending may move the string,
+// so always continue with the returned pointer (NULL on allocation failure).
+come_string_t* come_string_builder(TALLOC_CTX* ctx, size_t capacity);
+come_string_t* come_string_reserve(come_string_t* s, size_t extra);
+come_string_t* come_string_append(come_string_t* s, const char* p, size_t n);
+
 // Core Methods
 size_t come_string_size(const come_string_t* a);
 size_t come_string_len(const come_string_t* a);
@@ -38,6 +71,88 @@ long come_string_find(const come_string_t* a, const char* sub);
 long come_string_rfind(const come_string_t* a, const char* sub);
 size_t come_string_count(const come_string_t* a, const char* sub);
 
+// Multi-pattern Search (Aho-Corasick)
+// A matcher is compiled once from a list of needles and can be reused for any number of
+// haystacks; every needle is searched in a single pass. Matches are leftmost-longest and
+// non-overlapping. A replacer is a matcher built from an [old0, new0, old1, new1, ...] list,
+// or from parallel olds and news lists (a map's keys and values). A matcher copies what it
+// needs, so the lists may be freed once it is built.
+typedef struct come_string_matcher_t come_string_matcher_t;
+typedef come_string_matcher_t* matcher;
+
+come_string_matcher_t* come_string_matcher_new(TALLOC_CTX* ctx, const come_string_list_t* needles);
+come_string_matcher_t* come_string_replacer_new(TALLOC_CTX* ctx, const come_string_list_t* pairs);
+come_string_matcher_t* come_string_replacer_new_kv(TALLOC_CTX* ctx, const come_string_list_t* olds,
+                                                   const come_string_list_t* news);
+long come_string_matcher_find(const come_string_matcher_t* m, const come_string_t* a);
+size_t come_string_matcher_count(const come_string_matcher_t* m, const come_string_t* a);
+come_string_t* come_string_matcher_replace(const come_string_matcher_t* m, const come_string_t* a);
+
+long come_string_find_any(const come_string_t* a, const come_string_list_t* needles);
+size_t come_string_count_any(const come_string_t* a, const come_string_list_t* needles);
+come_string_t* come_string_replace_many(const come_string_t* a, const come_string_list_t* pairs);
+come_string_t* come_string_replace_many_kv(const come_string_t* a, const come_string_list_t* olds,
+                                           const come_string_list_t* news);
+
+// UTF-8 (SSE2/AVX2 with scalar fallback, chosen at run time)
+size_t come_utf8_count(const char* s, size_t n, bool* ascii); // Code points; ascii may be NULL
+bool come_utf8_valid(const char* s, size_t n);
+bool come_string_utf8(const come_string_t* a);
+size_t come_utf8_decode(const char* s, size_t n, uint32_t* cp); // Bytes consumed, 0 if invalid
+size_t come_utf8_encode(uint32_t cp, char* out); // Writes 1-4 bytes
+
+// Hashing (wyhash-style, 64-bit, not cryptographic)
+// come_string_hash() uses a per-process random seed and caches the result in the header.
+uint64_t come_hash_bytes(const void* p, size_t n, uint64_t seed);
+uint64_t come_hash_seed(void);
+uint64_t come_string_hash(const come_string_t* a);
+
+// Interning: one canonical string per content, so interned strings compare by pointer.
+// Canonical strings belong to the interner and must not be modified.
+// come_string_intern() uses a process-wide interner, safe to call from any thread.
+typedef struct come_string_interner_t come_string_interner_t;
+
+come_string_interner_t* come_string_interner_new(TALLOC_CTX* ctx);
+come_string_t* come_string_interner_get(come_string_interner_t* t, const char* s, size_t n); // Adds if missing
+come_string_t* come_string_interner_add(come_string_interner_t* t, const come_string_t* a);
+come_string_t* come_string_interner_find(const come_string_interner_t* t, const char* s, size_t n); // NULL if absent
+size_t come_string_interner_count(const come_string_interner_t* t);
+come_string_t* come_string_intern(const come_string_t* a);
+
+// Ropes: text as a balanced tree of come_string_t chunks, for large documents edited in
+// place. Positions are byte offsets; append/concat/insert/delete/substr are O(log n) and
+// never copy more than a small leaf. Editing functions return r, or NULL (errno ENOMEM)
+// leaving r unchanged. substr() and flatten() allocate on r. Strings longer than a small
+// leaf are shared rather than copied (see come_string_share).
+typedef struct come_rope_t come_rope_t;
+typedef come_rope_t* rope;
+
+come_rope_t* come_rope_new(TALLOC_CTX* ctx, const come_string_t* s); // s NULL: empty
+void come_rope_free(come_rope_t* r);
+size_t come_rope_len(const come_rope_t* r);
+come_rope_t* come_rope_append(come_rope_t* r, const come_string_t* s);
+come_rope_t* come_rope_concat(come_rope_t* r, const come_rope_t* other); // other is unchanged
+come_rope_t* come_rope_insert(come_rope_t* r, size_t pos, const come_string_t* s);
+come_rope_t* come_rope_delete(come_rope_t* r, size_t pos, size_t n);
+come_rope_t* come_rope_substr(const come_rope_t* r, size_t start, size_t end);
+come_string_t* come_rope_flatten(const come_rope_t* r);
+long come_rope_write(const come_rope_t* r, int fd); // writev() of the chunks; -1 on error
+
+// Chunk iterator for streaming writes. Each next() yields data[0..len), which lies inside
+// chunk; the rope must not be edited while iterating.
+#define COME_ROPE_MAX_DEPTH 64
+
+typedef struct come_rope_iter_t {
+    const void* stack[COME_ROPE_MAX_DEPTH];
+    int depth;
+    const char* data;
+    size_t len;
+    const come_string_t* chunk;
+} come_rope_iter_t;
+
+void come_rope_iter_init(come_rope_iter_t* it, const come_rope_t* r);
+bool come_rope_iter_next(come_rope_iter_t* it);
+
 // Validation
 bool come_string_isdigit(const come_string_t* a);
 bool come_string_isalpha(const come_string_t* a);
@@ -45,9 +160,21 @@ bool come_string_isalnum(const come_string_t* a);
 bool come_string_isspace(const come_string_t* a);
 bool come_string_isascii(const come_string_t* a);
 
-// Transformation (allocates new string on parent context)
+// Case mapping (ASCII via SSE2/AVX2, other code points via Unicode simple case mappings)
+// upper()/lower() allocate on the parent context. The _inplace forms need an unshared string
+// and leave alone the few code points whose mapping has a different UTF-8 length
+// (e.g. U+0131 -> 'I').
 come_string_t* come_string_upper(const come_string_t* a);
 come_string_t* come_string_lower(const come_string_t* a);
+void come_string_upper_inplace(come_string_t* a);
+void come_string_lower_inplace(come_string_t* a);
+
+// ASCII-only case-insensitive equality and hash, for protocol tokens such as HTTP header
+// names. Bytes >= 0x80 must match exactly; caseeq(a, b) implies casehash(a) == casehash(b).
+bool come_string_caseeq(const come_string_t* a, const come_string_t* b);
+uint64_t come_string_casehash(const come_string_t* a);
+
+// Transformation (allocates new string on parent context)
 come_string_t* come_string_repeat(const come_string_t* a, size_t n);
 come_string_t* come_string_replace(const come_string_t* a, const char* old_str, const char* new_str, size_t n); // n=0 for all
 
@@ -73,6 +200,28 @@ come_string_list_t* come_string_list_from_argv(TALLOC_CTX* ctx, int argc, char*
 come_string_t* come_string_substr(const come_string_t* a, size_t start, size_t end);
 
 // Regex
+// Patterns passed as text are compiled once and kept in a small LRU cache inside the runtime.
+// A come_regex_t is the explicit form: compile once with come_regex_new(), reuse freely.
+typedef struct come_regex_t come_regex_t;
+typedef come_regex_t* regex;
+
+// The engine is picked when a regex is compiled; every call on it then uses that engine.
+typedef enum come_regex_engine_t {
+    COME_REGEX_POSIX = 0, // libc regcomp/regexec: backtracking, stops at the first NUL
+    COME_REGEX_DFA   = 1, // Native: lazy DFA, NFA for captures; linear time, length-delimited
+} come_regex_engine_t;
+
+come_regex_t* come_regex_new(TALLOC_CTX* ctx, const char* pattern); // NULL on invalid pattern
+come_regex_t* come_regex_dfa(TALLOC_CTX* ctx, const char* pattern); // NULL on invalid or non-regular pattern
+come_regex_t* come_regex_new_engine(TALLOC_CTX* ctx, const char* pattern, come_regex_engine_t engine);
+come_regex_engine_t come_regex_engine(const come_regex_t* r);
+void come_regex_free(come_regex_t* r);
+bool come_regex_match(const come_regex_t* r, const come_string_t* a);
+come_string_list_t* come_regex_split(const come_regex_t* r, const come_string_t* a, size_t n);
+come_string_list_t* come_regex_groups(const come_regex_t* r, const come_string_t* a);
+come_string_t* come_regex_replace(const come_regex_t* r, const come_string_t* a, const char* repl, size_t count);
+
+// Pattern given as text: compiled once per thread and cached
 bool come_string_regex(const come_string_t* a, const char* pattern);
 come_string_list_t* come_string_regex_split(const come_string_t* a, const char* pattern, size_t n);
 come_string_list_t* come_string_regex_groups(const come_string_t* a, const char* pattern);
@@ -89,5 +238,6 @@ come_string_t* come_string_sprintf(TALLOC_CTX* ctx, const char* fmt, ...);
 // Conversions
 come_byte_array_t* come_string_to_byte_array(const come_string_t* a);
 
-long come_string_tol(const come_string_t* a);
+long come_string_tol(const come_string_t* a, int base); // base 0 auto-detects 0x/0b/0 prefixes
+double come_string_tod(const come_string_t* a);
 #endif // COME_STRING_MODULE_H
@@ -2,19 +2,83 @@
 #define MEM_TALLOC_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Each thread has its own root context, the parent of allocations made without one.
+// init is implicit on a thread's first such allocation; shutdown frees the calling
+// thread's root (other threads' roots are freed as they exit).
 void mem_talloc_module_init(void);
 void mem_talloc_module_shutdown(void);
 
+// Context for process-wide runtime state (the string interner), made once and freed
+// only with the process. talloc takes no locks: whoever keeps state here serializes
+// every access to it.
+void* mem_talloc_global_ctx(void);
+
 void* mem_talloc_alloc(void* ctx, size_t size);
 void* mem_talloc_realloc(void* ctx, void* ptr, size_t size);
 void mem_talloc_free(void* ptr);
 void* mem_talloc_new_ctx(void* parent);
+void* mem_talloc_pool(void* parent, size_t size); // Context whose children come from one block
+void mem_talloc_free_children(void* ctx); // A pool's block is reused once its children are gone
 void* mem_talloc_steal(void* new_ctx, void* ptr);
+void mem_talloc_set_destructor(void* ptr, int (*destructor)(void*));
+void* mem_talloc_parent(const void* ptr);
+
+// Extra owners: ptr lives until its parent and every reference are gone
+void* mem_talloc_reference(void* ctx, void* ptr);
+int mem_talloc_unlink(void* ctx, void* ptr);
+size_t mem_talloc_reference_count(const void* ptr);
+
+// Scope contexts: the compiler shadows the module context with a local context variable
+// for a scope block and frees it (scope_free) or only its children (scope_reset) through
+// the variable's cleanup attribute, on every way out of the block. escape moves a
+// returned object out of a scope about to be freed to new_ctx; other pointers are
+// returned as they are.
+#define MEM_TALLOC_SCOPE_POOL 16384 // Pool of a scope block without a size
+
+void mem_talloc_scope_free(void** ctx);
+void mem_talloc_scope_reset(void** ctx);
+void* mem_talloc_escape(void* scope, void* new_ctx, void* ptr);
+
+// Hand-off between threads. A tree belongs to the thread that made it, so a subtree
+// moves in two O(1) steps: the sending thread detaches it (it then has no parent and
+// neither tree refers to it), passes the pointer through whatever queue it likes, and
+// the receiving thread adopts it under ctx (NULL: its own root). detach fails with
+// EBUSY while ptr has references. Memory from a pool (mem.pool, scope blocks) must be
+// copied out rather than handed off: freeing it updates the pool.
+void* mem_talloc_detach(void* ptr);
+void* mem_talloc_adopt(void* ctx, void* ptr);
+
+// Allocation statistics, off unless COME_MEM_STATS=N is set when the program starts:
+// N = 1 counts every allocation, N > 1 samples about one in N and scales by N. Blocks
+// are attributed to the statement COME_MEM_SITE() last marked on the thread (come
+// build --mem-sites marks every statement with its #line position). At exit the
+// per-site table is printed to stderr, and with COME_MEM_DUMP=1 the hierarchy still
+// under the thread's root, through talloc_report_full.
+typedef struct mem_talloc_stats_t {
+    uint64_t allocs;     // Allocations so far
+    uint64_t bytes;      // Bytes requested by them, growth included
+    uint64_t live;       // Blocks not yet freed
+    uint64_t live_bytes;
+    uint64_t peak_bytes; // Highest live_bytes
+} mem_talloc_stats_t;
+
+extern __thread const char* mem_talloc_site_file;
+extern __thread int mem_talloc_site_line;
+#define COME_MEM_SITE() (mem_talloc_site_file = __FILE__, mem_talloc_site_line = __LINE__)
+
+// The process totals, or for a ctx the blocks and bytes now in its subtree (counted
+// by walking it, so exact and available with statistics off)
+mem_talloc_stats_t mem_talloc_stats(const void* ctx);
+uint32_t mem_talloc_stats_period(void); // 0 while statistics are off
+void mem_talloc_stats_report(FILE* f);  // Per-site table, most live bytes first
 
 #ifdef __cplusplus
 }
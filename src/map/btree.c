@@ -0,0 +1,666 @@
+#include <string.h>
+#include "come_map.h"
+#include "mem/talloc.h"
+
+// Ordered maps
+// A B+tree. Leaves hold up to ORDER keys with their values and are linked in key order;
+// an inner node holds up to ORDER separators and one more child, keys[i] being the
+// smallest key that may be in child i + 1. Inserting into a full node splits it in half
+// and passes the right half's separator up; a node that falls below half after a delete
+// borrows from a sibling or merges with it. String separators are copies of the key
+// they were taken from, so they stay valid when that key is deleted.
+//
+// Every node has the same size and comes from the map's pool; released nodes go on a
+// free list. An insert first makes sure the free list holds enough nodes for a split at
+// every level, so a split never fails half way.
+
+#define ORDER 32
+#define LEAF_MIN (ORDER / 2)
+#define INNER_MIN (ORDER / 2 - 1)
+#define POOL_NODES 8
+
+typedef union {
+    int64_t i;
+    come_string_t* s;
+} bt_key_t;
+
+struct come_ordered_map_node_t {
+    uint32_t count; // Keys
+    uint32_t leaf;
+    come_ordered_map_node_t* prev; // Leaves: neighbours in key order
+    come_ordered_map_node_t* next;
+    bt_key_t keys[ORDER];
+    unsigned char tail[]; // Leaves: ORDER values of val_stride bytes; inner: ORDER + 1 children
+};
+
+typedef come_ordered_map_node_t node_t;
+
+#define CHILDREN(n) ((node_t**)(n)->tail)
+#define VALUE(m, n, i) ((n)->tail + (size_t)(i) * (m)->val_stride)
+
+// A key being looked up
+typedef struct {
+    int64_t i;
+    const char* s;
+    size_t len;
+} probe_t;
+
+static size_t node_size(const come_ordered_map_t* m) {
+    size_t inner = sizeof(node_t*) * (ORDER + 1);
+    size_t leaf = (size_t)m->val_stride * ORDER;
+    return sizeof(node_t) + (inner > leaf ? inner : leaf);
+}
+
+static bool reserve_nodes(come_ordered_map_t* m, uint32_t k) {
+    while (m->free_count < k) {
+        node_t* n = mem_talloc_alloc(m->pool, node_size(m));
+        if (!n) return false;
+        n->next = m->free_nodes;
+        m->free_nodes = n;
+        m->free_count++;
+    }
+    return true;
+}
+
+// From the free list; callers reserve first
+static node_t* node_take(come_ordered_map_t* m, bool leaf) {
+    node_t* n = m->free_nodes;
+    m->free_nodes = n->next;
+    m->free_count--;
+    n->count = 0;
+    n->leaf = leaf;
+    n->prev = n->next = NULL;
+    return n;
+}
+
+static void node_release(come_ordered_map_t* m, node_t* n) {
+    n->next = m->free_nodes;
+    m->free_nodes = n;
+    m->free_count++;
+}
+
+static int key_cmp(const come_ordered_map_t* m, const probe_t* p, bt_key_t k) {
+    if (m->key_kind == COME_MAP_INT) return (p->i > k.i) - (p->i < k.i);
+    size_t n = p->len < k.s->count ? p->len : k.s->count;
+    int c = n ? memcmp(p->s, k.s->data, n) : 0;
+    if (c) return c;
+    return (p->len > k.s->count) - (p->len < k.s->count);
+}
+
+// First index whose key is >= p
+static uint32_t node_lower(const come_ordered_map_t* m, const node_t* n, const probe_t* p) {
+    if (m->key_kind == COME_MAP_INT) {
+        // Count the smaller keys without branches; the loop vectorizes
+        uint32_t c = 0;
+        for (uint32_t i = 0; i < n->count; i++) c += n->keys[i].i < p->i;
+        return c;
+    }
+    uint32_t lo = 0, hi = n->count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (key_cmp(m, p, n->keys[mid]) > 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Child of an inner node that may hold p: the number of separators <= p
+static uint32_t node_child(const come_ordered_map_t* m, const node_t* n, const probe_t* p) {
+    if (m->key_kind == COME_MAP_INT) {
+        uint32_t c = 0;
+        for (uint32_t i = 0; i < n->count; i++) c += n->keys[i].i <= p->i;
+        return c;
+    }
+    uint32_t lo = 0, hi = n->count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (key_cmp(m, p, n->keys[mid]) >= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static const node_t* find_leaf(const come_ordered_map_t* m, const probe_t* p) {
+    const node_t* n = m->root;
+    while (n && !n->leaf) n = CHILDREN(n)[node_child(m, n, p)];
+    return n;
+}
+
+static bool key_copy(come_ordered_map_t* m, const char* s, size_t len, int64_t i, bt_key_t* k) {
+    if (m->key_kind == COME_MAP_INT) {
+        k->i = i;
+        return true;
+    }
+    k->s = come_string_new_len(m->pool, s, len);
+    return k->s != NULL;
+}
+
+static void key_free(const come_ordered_map_t* m, bt_key_t k) {
+    if (m->key_kind == COME_MAP_STRING) mem_talloc_free(k.s);
+}
+
+// Separator for a node whose first key is k
+static bool sep_copy(come_ordered_map_t* m, bt_key_t k, bt_key_t* sep) {
+    if (m->key_kind == COME_MAP_INT) {
+        *sep = k;
+        return true;
+    }
+    return key_copy(m, k.s->data, k.s->count, 0, sep);
+}
+
+come_ordered_map_t* come_ordered_map_new(TALLOC_CTX* ctx, int key_kind, uint32_t val_size) {
+    come_ordered_map_t* m = mem_talloc_alloc(ctx, sizeof(come_ordered_map_t));
+    if (!m) return NULL;
+    memset(m, 0, sizeof(*m));
+    m->key_kind = key_kind;
+    m->val_size = val_size;
+    m->val_stride = (val_size + 7) & ~7u;
+    m->pool = mem_talloc_pool(m, POOL_NODES * node_size(m));
+    if (!m->pool) {
+        mem_talloc_free(m);
+        return NULL;
+    }
+    return m;
+}
+
+void come_ordered_map_clear(come_ordered_map_t* m) {
+    if (!m) return;
+    void* pool = mem_talloc_pool(m, POOL_NODES * node_size(m));
+    if (!pool) pool = mem_talloc_new_ctx(m);
+    if (pool) {
+        mem_talloc_free(m->pool);
+        m->pool = pool;
+    } // Otherwise the old nodes stay in the old pool until the map is freed
+    m->root = m->first = m->free_nodes = NULL;
+    m->free_count = 0;
+    m->count = 0;
+    m->height = 0;
+}
+
+// Inserts into leaf n at i, splitting it if full; *right is the new right sibling
+static void* leaf_insert(come_ordered_map_t* m, node_t* n, uint32_t i, bt_key_t k, node_t** right, bt_key_t* sep) {
+    if (n->count == ORDER) {
+        // The right half starts at the old keys[half] wherever the new key goes
+        uint32_t half = ORDER / 2;
+        if (!sep_copy(m, n->keys[half], sep)) return NULL;
+        node_t* r = node_take(m, true);
+        memcpy(r->keys, n->keys + half, sizeof(bt_key_t) * (ORDER - half));
+        memcpy(VALUE(m, r, 0), VALUE(m, n, half), (size_t)m->val_stride * (ORDER - half));
+        r->count = ORDER - half;
+        n->count = half;
+        r->prev = n;
+        r->next = n->next;
+        if (n->next) n->next->prev = r;
+        n->next = r;
+        *right = r;
+        if (i > half) {
+            n = r;
+            i -= half;
+        }
+    }
+    memmove(n->keys + i + 1, n->keys + i, sizeof(bt_key_t) * (n->count - i));
+    memmove(VALUE(m, n, i + 1), VALUE(m, n, i), (size_t)m->val_stride * (n->count - i));
+    n->keys[i] = k;
+    memset(VALUE(m, n, i), 0, m->val_stride);
+    n->count++;
+    m->count++;
+    return VALUE(m, n, i);
+}
+
+// Adds separator sep and child c after child ci of inner node n, splitting it if full
+static void inner_insert(come_ordered_map_t* m, node_t* n, uint32_t ci, bt_key_t sep, node_t* c,
+                         node_t** right, bt_key_t* up) {
+    if (n->count < ORDER) {
+        memmove(n->keys + ci + 1, n->keys + ci, sizeof(bt_key_t) * (n->count - ci));
+        memmove(CHILDREN(n) + ci + 2, CHILDREN(n) + ci + 1, sizeof(node_t*) * (n->count - ci));
+        n->keys[ci] = sep;
+        CHILDREN(n)[ci + 1] = c;
+        n->count++;
+        return;
+    }
+    bt_key_t keys[ORDER + 1];
+    node_t* kids[ORDER + 2];
+    memcpy(keys, n->keys, sizeof(bt_key_t) * ci);
+    keys[ci] = sep;
+    memcpy(keys + ci + 1, n->keys + ci, sizeof(bt_key_t) * (ORDER - ci));
+    memcpy(kids, CHILDREN(n), sizeof(node_t*) * (ci + 1));
+    kids[ci + 1] = c;
+    memcpy(kids + ci + 2, CHILDREN(n) + ci + 1, sizeof(node_t*) * (ORDER - ci));
+
+    // Left keeps mid keys, keys[mid] moves up, right takes the rest
+    uint32_t mid = (ORDER + 1) / 2;
+    node_t* r = node_take(m, false);
+    n->count = mid;
+    memcpy(n->keys, keys, sizeof(bt_key_t) * mid);
+    memcpy(CHILDREN(n), kids, sizeof(node_t*) * (mid + 1));
+    *up = keys[mid];
+    r->count = ORDER - mid;
+    memcpy(r->keys, keys + mid + 1, sizeof(bt_key_t) * r->count);
+    memcpy(CHILDREN(r), kids + mid + 1, sizeof(node_t*) * (r->count + 1));
+    *right = r;
+}
+
+// Inserts p under n; if n split, *right is its new right sibling with separator *sep
+static void* node_insert(come_ordered_map_t* m, node_t* n, const probe_t* p, node_t** right, bt_key_t* sep) {
+    *right = NULL;
+    if (n->leaf) {
+        uint32_t i = node_lower(m, n, p);
+        if (i < n->count && key_cmp(m, p, n->keys[i]) == 0) return VALUE(m, n, i);
+        bt_key_t k;
+        if (!key_copy(m, p->s, p->len, p->i, &k)) return NULL;
+        void* v = leaf_insert(m, n, i, k, right, sep);
+        if (!v) key_free(m, k);
+        return v;
+    }
+    uint32_t ci = node_child(m, n, p);
+    node_t* child_right;
+    bt_key_t child_sep;
+    void* v = node_insert(m, CHILDREN(n)[ci], p, &child_right, &child_sep);
+    if (child_right) inner_insert(m, n, ci, child_sep, child_right, right, sep);
+    return v;
+}
+
+static void* insert_key(come_ordered_map_t* m, const probe_t* p) {
+    // A split at every level and a new root
+    if (!reserve_nodes(m, m->height + 2)) return NULL;
+    if (!m->root) {
+        m->root = m->first = node_take(m, true);
+        m->height = 0;
+    }
+    node_t* right;
+    bt_key_t sep;
+    void* v = node_insert(m, m->root, p, &right, &sep);
+    if (right) {
+        node_t* root = node_take(m, false);
+        root->count = 1;
+        root->keys[0] = sep;
+        CHILDREN(root)[0] = m->root;
+        CHILDREN(root)[1] = right;
+        m->root = root;
+        m->height++;
+    }
+    return v;
+}
+
+// Merges child i + 1 of parent into child i
+static void merge(come_ordered_map_t* m, node_t* parent, uint32_t i) {
+    node_t* l = CHILDREN(parent)[i];
+    node_t* r = CHILDREN(parent)[i + 1];
+    if (l->leaf) {
+        memcpy(l->keys + l->count, r->keys, sizeof(bt_key_t) * r->count);
+        memcpy(VALUE(m, l, l->count), VALUE(m, r, 0), (size_t)m->val_stride * r->count);
+        l->count += r->count;
+        l->next = r->next;
+        if (r->next) r->next->prev = l;
+        key_free(m, parent->keys[i]);
+    } else {
+        l->keys[l->count] = parent->keys[i];
+        memcpy(l->keys + l->count + 1, r->keys, sizeof(bt_key_t) * r->count);
+        memcpy(CHILDREN(l) + l->count + 1, CHILDREN(r), sizeof(node_t*) * (r->count + 1));
+        l->count += 1 + r->count;
+    }
+    memmove(parent->keys + i, parent->keys + i + 1, sizeof(bt_key_t) * (parent->count - i - 1));
+    memmove(CHILDREN(parent) + i + 1, CHILDREN(parent) + i + 2, sizeof(node_t*) * (parent->count - i - 1));
+    parent->count--;
+    node_release(m, r);
+}
+
+// Moves the last entry of child ci - 1 to the front of child ci
+static void borrow_left(come_ordered_map_t* m, node_t* parent, uint32_t ci) {
+    node_t* c = CHILDREN(parent)[ci];
+    node_t* l = CHILDREN(parent)[ci - 1];
+    if (c->leaf) {
+        bt_key_t sep;
+        if (!sep_copy(m, l->keys[l->count - 1], &sep)) return; // Stays under half full
+        memmove(c->keys + 1, c->keys, sizeof(bt_key_t) * c->count);
+        memmove(VALUE(m, c, 1), VALUE(m, c, 0), (size_t)m->val_stride * c->count);
+        c->keys[0] = l->keys[l->count - 1];
+        memcpy(VALUE(m, c, 0), VALUE(m, l, l->count - 1), m->val_stride);
+        key_free(m, parent->keys[ci - 1]);
+        parent->keys[ci - 1] = sep;
+    } else {
+        memmove(c->keys + 1, c->keys, sizeof(bt_key_t) * c->count);
+        memmove(CHILDREN(c) + 1, CHILDREN(c), sizeof(node_t*) * (c->count + 1));
+        c->keys[0] = parent->keys[ci - 1];
+        CHILDREN(c)[0] = CHILDREN(l)[l->count];
+        parent->keys[ci - 1] = l->keys[l->count - 1];
+    }
+    c->count++;
+    l->count--;
+}
+
+// Moves the first entry of child ci + 1 to the end of child ci
+static void borrow_right(come_ordered_map_t* m, node_t* parent, uint32_t ci) {
+    node_t* c = CHILDREN(parent)[ci];
+    node_t* r = CHILDREN(parent)[ci + 1];
+    if (c->leaf) {
+        bt_key_t sep;
+        if (!sep_copy(m, r->keys[1], &sep)) return;
+        c->keys[c->count] = r->keys[0];
+        memcpy(VALUE(m, c, c->count), VALUE(m, r, 0), m->val_stride);
+        memmove(r->keys, r->keys + 1, sizeof(bt_key_t) * (r->count - 1));
+        memmove(VALUE(m, r, 0), VALUE(m, r, 1), (size_t)m->val_stride * (r->count - 1));
+        key_free(m, parent->keys[ci]);
+        parent->keys[ci] = sep;
+    } else {
+        c->keys[c->count] = parent->keys[ci];
+        CHILDREN(c)[c->count + 1] = CHILDREN(r)[0];
+        parent->keys[ci] = r->keys[0];
+        memmove(r->keys, r->keys + 1, sizeof(bt_key_t) * (r->count - 1));
+        memmove(CHILDREN(r), CHILDREN(r) + 1, sizeof(node_t*) * r->count);
+    }
+    c->count++;
+    r->count--;
+}
+
+static bool node_delete(come_ordered_map_t* m, node_t* n, const probe_t* p) {
+    if (n->leaf) {
+        uint32_t i = node_lower(m, n, p);
+        if (i >= n->count || key_cmp(m, p, n->keys[i]) != 0) return false;
+        key_free(m, n->keys[i]);
+        memmove(n->keys + i, n->keys + i + 1, sizeof(bt_key_t) * (n->count - i - 1));
+        memmove(VALUE(m, n, i), VALUE(m, n, i + 1), (size_t)m->val_stride * (n->count - i - 1));
+        n->count--;
+        m->count--;
+        return true;
+    }
+    uint32_t ci = node_child(m, n, p);
+    node_t* c = CHILDREN(n)[ci];
+    if (!node_delete(m, c, p)) return false;
+    uint32_t min = c->leaf ? LEAF_MIN : INNER_MIN;
+    if (c->count >= min) return true;
+    if (ci > 0 && CHILDREN(n)[ci - 1]->count > min) borrow_left(m, n, ci);
+    else if (ci < n->count && CHILDREN(n)[ci + 1]->count > min) borrow_right(m, n, ci);
+    else if (ci > 0) merge(m, n, ci - 1);
+    else merge(m, n, ci);
+    return true;
+}
+
+static bool delete_key(come_ordered_map_t* m, const probe_t* p) {
+    if (!m->root || !node_delete(m, m->root, p)) return false;
+    if (!m->root->leaf && m->root->count == 0) {
+        node_t* old = m->root;
+        m->root = CHILDREN(old)[0];
+        m->height--;
+        node_release(m, old);
+    }
+    return true;
+}
+
+static void* find_key(const come_ordered_map_t* m, const probe_t* p) {
+    const node_t* n = find_leaf(m, p);
+    if (!n) return NULL;
+    uint32_t i = node_lower(m, n, p);
+    return i < n->count && key_cmp(m, p, n->keys[i]) == 0 ? (void*)VALUE(m, n, i) : NULL;
+}
+
+#define PROBE_INT(k) (&(probe_t){.i = (k)})
+#define PROBE_STR(k, n) (&(probe_t){.s = (k), .len = (n)})
+
+void* come_ordered_map_find_int(const come_ordered_map_t* m, int64_t key) {
+    if (!m || m->key_kind != COME_MAP_INT) return NULL;
+    return find_key(m, PROBE_INT(key));
+}
+
+void* come_ordered_map_find_str(const come_ordered_map_t* m, const char* key, size_t len) {
+    if (!m || !key || m->key_kind != COME_MAP_STRING) return NULL;
+    return find_key(m, PROBE_STR(key, len));
+}
+
+void* come_ordered_map_find_cstr(const come_ordered_map_t* m, const char* key) {
+    return key ? come_ordered_map_find_str(m, key, strlen(key)) : NULL;
+}
+
+void* come_ordered_map_find_string(const come_ordered_map_t* m, const come_string_t* key) {
+    return key ? come_ordered_map_find_str(m, key->data, key->count) : NULL;
+}
+
+void* come_ordered_map_insert_int(come_ordered_map_t* m, int64_t key) {
+    if (!m || m->key_kind != COME_MAP_INT) return NULL;
+    return insert_key(m, PROBE_INT(key));
+}
+
+void* come_ordered_map_insert_str(come_ordered_map_t* m, const char* key, size_t len) {
+    if (!m || !key || m->key_kind != COME_MAP_STRING) return NULL;
+    return insert_key(m, PROBE_STR(key, len));
+}
+
+void* come_ordered_map_insert_cstr(come_ordered_map_t* m, const char* key) {
+    return key ? come_ordered_map_insert_str(m, key, strlen(key)) : NULL;
+}
+
+void* come_ordered_map_insert_string(come_ordered_map_t* m, const come_string_t* key) {
+    return key ? come_ordered_map_insert_str(m, key->data, key->count) : NULL;
+}
+
+bool come_ordered_map_delete_int(come_ordered_map_t* m, int64_t key) {
+    if (!m || m->key_kind != COME_MAP_INT) return false;
+    return delete_key(m, PROBE_INT(key));
+}
+
+bool come_ordered_map_delete_str(come_ordered_map_t* m, const char* key, size_t len) {
+    if (!m || !key || m->key_kind != COME_MAP_STRING) return false;
+    return delete_key(m, PROBE_STR(key, len));
+}
+
+bool come_ordered_map_delete_cstr(come_ordered_map_t* m, const char* key) {
+    return key ? come_ordered_map_delete_str(m, key, strlen(key)) : false;
+}
+
+bool come_ordered_map_delete_string(come_ordered_map_t* m, const come_string_t* key) {
+    return key ? come_ordered_map_delete_str(m, key->data, key->count) : false;
+}
+
+static bool ascending(const come_ordered_map_t* m, const void* keys, uint32_t n) {
+    for (uint32_t i = 1; i < n; i++) {
+        if (m->key_kind == COME_MAP_INT ? ((const int64_t*)keys)[i - 1] >= ((const int64_t*)keys)[i]
+                                        : strcmp(((const char* const*)keys)[i - 1], ((const char* const*)keys)[i]) >= 0) return false;
+    }
+    return true;
+}
+
+// Bottom-up build of an empty map from n > 0 ascending keys: full leaves left to right
+// (the entries spread evenly so each is at least half full), then each inner level
+// over the one below, with the smallest key of every node kept for its separator
+static bool bulk_load(come_ordered_map_t* m, const void* keys, const void* vals, uint32_t n) {
+    uint32_t nodes = (n + ORDER - 1) / ORDER;
+    uint32_t total = nodes;
+    for (uint32_t k = nodes; k > 1; k = (k + ORDER) / (ORDER + 1)) total += (k + ORDER) / (ORDER + 1);
+    node_t** level = mem_talloc_alloc(m, sizeof(node_t*) * nodes);
+    bt_key_t* mins = mem_talloc_alloc(m, sizeof(bt_key_t) * nodes);
+    if (!level || !mins || !reserve_nodes(m, total)) {
+        mem_talloc_free(level);
+        mem_talloc_free(mins);
+        return false;
+    }
+
+    uint32_t at = 0;
+    node_t* prev = NULL;
+    for (uint32_t j = 0; j < nodes; j++) {
+        node_t* leaf = node_take(m, true);
+        uint32_t take = n / nodes + (j < n % nodes);
+        for (uint32_t i = 0; i < take; i++, at++) {
+            const char* s = m->key_kind == COME_MAP_STRING ? ((const char* const*)keys)[at] : NULL;
+            int64_t ik = m->key_kind == COME_MAP_INT ? ((const int64_t*)keys)[at] : 0;
+            if (!key_copy(m, s, s ? strlen(s) : 0, ik, &leaf->keys[i])) goto fail;
+            memset(VALUE(m, leaf, i), 0, m->val_stride);
+            memcpy(VALUE(m, leaf, i), (const char*)vals + (size_t)at * m->val_size, m->val_size);
+        }
+        leaf->count = take;
+        leaf->prev = prev;
+        if (prev) prev->next = leaf;
+        prev = leaf;
+        level[j] = leaf;
+        mins[j] = leaf->keys[0];
+    }
+    m->first = level[0];
+    m->count = n;
+    m->height = 0;
+
+    while (nodes > 1) {
+        uint32_t parents = (nodes + ORDER) / (ORDER + 1);
+        uint32_t child = 0;
+        for (uint32_t j = 0; j < parents; j++) {
+            node_t* p = node_take(m, false);
+            uint32_t take = nodes / parents + (j < nodes % parents);
+            bt_key_t min = mins[child];
+            for (uint32_t i = 0; i < take; i++, child++) {
+                CHILDREN(p)[i] = level[child];
+                if (i > 0 && !sep_copy(m, mins[child], &p->keys[i - 1])) goto fail;
+            }
+            p->count = take - 1;
+            level[j] = p;
+            mins[j] = min;
+        }
+        nodes = parents;
+        m->height++;
+    }
+    m->root = level[0];
+    mem_talloc_free(level);
+    mem_talloc_free(mins);
+    return true;
+
+fail:
+    // Out of memory: drop what was built
+    mem_talloc_free(level);
+    mem_talloc_free(mins);
+    come_ordered_map_clear(m);
+    return false;
+}
+
+bool come_ordered_map_put_all(come_ordered_map_t* m, const void* keys, const void* vals, uint32_t n) {
+    if (!m || (n && (!keys || !vals))) return false;
+    if (!n) return true;
+    if (m->count == 0 && ascending(m, keys, n)) {
+        come_ordered_map_clear(m);
+        return bulk_load(m, keys, vals, n);
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        void* v = m->key_kind == COME_MAP_STRING ? come_ordered_map_insert_cstr(m, ((const char* const*)keys)[i])
+                                                 : come_ordered_map_insert_int(m, ((const int64_t*)keys)[i]);
+        if (!v) return false;
+        memcpy(v, (const char*)vals + (size_t)i * m->val_size, m->val_size);
+    }
+    return true;
+}
+
+// Cursors skip empty leaves (an emptied root, or a leaf a failed borrow left behind)
+static come_ordered_map_iter_t iter_at(const come_ordered_map_t* m, const node_t* n, uint32_t i) {
+    come_ordered_map_iter_t it = {.map = m, .node = n, .i = i};
+    while (it.node && it.i >= it.node->count) {
+        it.node = it.node->next;
+        it.i = 0;
+    }
+    return it;
+}
+
+come_ordered_map_iter_t come_ordered_map_first(const come_ordered_map_t* m) {
+    return iter_at(m, m ? m->first : NULL, 0);
+}
+
+static come_ordered_map_iter_t lower_bound(const come_ordered_map_t* m, const probe_t* p) {
+    const node_t* n = find_leaf(m, p);
+    return iter_at(m, n, n ? node_lower(m, n, p) : 0);
+}
+
+come_ordered_map_iter_t come_ordered_map_lower_bound_int(const come_ordered_map_t* m, int64_t key) {
+    if (!m || m->key_kind != COME_MAP_INT) return iter_at(m, NULL, 0);
+    return lower_bound(m, PROBE_INT(key));
+}
+
+come_ordered_map_iter_t come_ordered_map_lower_bound_str(const come_ordered_map_t* m, const char* key, size_t len) {
+    if (!m || !key || m->key_kind != COME_MAP_STRING) return iter_at(m, NULL, 0);
+    return lower_bound(m, PROBE_STR(key, len));
+}
+
+come_ordered_map_iter_t come_ordered_map_lower_bound_cstr(const come_ordered_map_t* m, const char* key) {
+    return come_ordered_map_lower_bound_str(m, key, key ? strlen(key) : 0);
+}
+
+come_ordered_map_iter_t come_ordered_map_lower_bound_string(const come_ordered_map_t* m, const come_string_t* key) {
+    return key ? come_ordered_map_lower_bound_str(m, key->data, key->count) : iter_at(m, NULL, 0);
+}
+
+come_ordered_map_iter_t come_ordered_map_range_int(const come_ordered_map_t* m, int64_t lo, int64_t hi) {
+    come_ordered_map_iter_t it = come_ordered_map_lower_bound_int(m, lo);
+    it.bounded = true;
+    it.hi_int = hi;
+    return it;
+}
+
+come_ordered_map_iter_t come_ordered_map_range_cstr(const come_ordered_map_t* m, const char* lo, const char* hi) {
+    come_ordered_map_iter_t it = come_ordered_map_lower_bound_cstr(m, lo);
+    it.bounded = hi != NULL;
+    it.hi_str = hi;
+    it.hi_len = hi ? strlen(hi) : 0;
+    return it;
+}
+
+come_ordered_map_iter_t come_ordered_map_range_string(const come_ordered_map_t* m, const come_string_t* lo,
+                                                      const come_string_t* hi) {
+    come_ordered_map_iter_t it = come_ordered_map_lower_bound_string(m, lo);
+    it.bounded = hi != NULL;
+    it.hi_str = hi ? hi->data : NULL;
+    it.hi_len = hi ? hi->count : 0;
+    return it;
+}
+
+bool come_ordered_map_iter_valid(const come_ordered_map_iter_t* it) {
+    if (!it || !it->node) return false;
+    if (!it->bounded) return true;
+    probe_t hi = {.i = it->hi_int, .s = it->hi_str, .len = it->hi_len};
+    return key_cmp(it->map, &hi, it->node->keys[it->i]) > 0;
+}
+
+void come_ordered_map_iter_next(come_ordered_map_iter_t* it) {
+    if (!it || !it->node) return;
+    come_ordered_map_iter_t at = iter_at(it->map, it->node, it->i + 1);
+    it->node = at.node;
+    it->i = at.i;
+}
+
+int64_t come_ordered_map_iter_int_key(const come_ordered_map_iter_t* it) {
+    return it && it->node && it->map->key_kind == COME_MAP_INT ? it->node->keys[it->i].i : 0;
+}
+
+come_string_t* come_ordered_map_iter_string_key(const come_ordered_map_iter_t* it) {
+    return it && it->node && it->map->key_kind == COME_MAP_STRING ? it->node->keys[it->i].s : NULL;
+}
+
+void* come_ordered_map_iter_value(const come_ordered_map_iter_t* it) {
+    return it && it->node ? (void*)VALUE(it->map, it->node, it->i) : NULL;
+}
+
+void* come_ordered_map_keys(TALLOC_CTX* ctx, const come_ordered_map_t* m) {
+    uint32_t n = come_ordered_map_size(m);
+    uint32_t k = 0;
+    if (m && m->key_kind == COME_MAP_STRING) {
+        come_string_list_t* keys = COME_ARRAY_NEW(ctx, come_string_list_t, n);
+        if (!keys) return NULL;
+        for (const node_t* leaf = m->first; leaf; leaf = leaf->next) {
+            for (uint32_t i = 0; i < leaf->count; i++) keys->items[k++] = leaf->keys[i].s;
+        }
+        return keys;
+    }
+    come_long_array_t* keys = COME_ARRAY_NEW(ctx, come_long_array_t, n);
+    if (!keys) return NULL;
+    for (const node_t* leaf = m ? m->first : NULL; leaf; leaf = leaf->next) {
+        for (uint32_t i = 0; i < leaf->count; i++) keys->items[k++] = leaf->keys[i].i;
+    }
+    return keys;
+}
+
+void* come_ordered_map_values(TALLOC_CTX* ctx, const come_ordered_map_t* m, size_t hdr) {
+    uint32_t n = come_ordered_map_size(m);
+    size_t val_size = m ? m->val_size : 0;
+    char* vals = come_array_new(ctx, hdr, val_size, n);
+    if (!vals) return NULL;
+    char* out = vals + hdr;
+    for (const node_t* leaf = m ? m->first : NULL; leaf; leaf = leaf->next) {
+        for (uint32_t i = 0; i < leaf->count; i++) {
+            memcpy(out, VALUE(m, leaf, i), val_size);
+            out += val_size;
+        }
+    }
+    return vals;
+}
@@ -0,0 +1,252 @@
+#include <string.h>
+#include <errno.h>
+#include "come_map.h"
+#include "mem/talloc.h"
+
+// LRU caches
+// The index maps a key to its entry pointer. Entries are linked in a circular list
+// through the sentinel c->list, most recently used first, so moving an entry to the
+// front and evicting the last one are a few pointer writes. A string key is copied
+// into its entry as well as into the index, so eviction can delete it from the index.
+
+typedef struct {
+    come_lru_link_t link; // First, so a link is its entry
+    size_t cost;
+    int64_t key;
+    come_string_t* skey;  // String keys: the entry's copy
+    unsigned char value[] __attribute__((aligned(8)));
+} entry_t;
+
+#define ENTRY(l) ((entry_t*)(l))
+#define STRING_VALUE(e) (*(come_string_t**)(e)->value)
+
+static void unlink_entry(entry_t* e) {
+    e->link.prev->next = e->link.next;
+    e->link.next->prev = e->link.prev;
+}
+
+static void push_front(come_lru_t* c, entry_t* e) {
+    e->link.prev = &c->list;
+    e->link.next = c->list.next;
+    c->list.next->prev = &e->link;
+    c->list.next = &e->link;
+}
+
+static entry_t* lookup(const come_lru_t* c, int64_t ikey, const char* s, size_t len) {
+    if (!c) return NULL;
+    entry_t** p = c->key_kind == COME_MAP_STRING ? come_map_find_str(c->index, s, len)
+                                                 : come_map_find_int(c->index, ikey);
+    return p ? *p : NULL;
+}
+
+static void evict(come_lru_t* c, entry_t* e) {
+    if (c->key_kind == COME_MAP_STRING) come_map_delete_string(c->index, e->skey);
+    else come_map_delete_int(c->index, e->key);
+    unlink_entry(e);
+    c->count--;
+    c->bytes -= e->cost;
+    mem_talloc_free(e);
+}
+
+static size_t entry_cost(const come_lru_t* c, const entry_t* e) {
+    size_t cost = sizeof(entry_t) + c->val_size;
+    if (e->skey) cost += sizeof(come_string_t) + e->skey->count;
+    if (c->val_kind == COME_LRU_VALUE_STRING && STRING_VALUE(e)) {
+        cost += sizeof(come_string_t) + STRING_VALUE(e)->count;
+    }
+    return cost;
+}
+
+// Store val in e; a string value is copied and the old copy freed. A string the cache
+// itself owns (the compiler allocates a literal value on the cache) is moved instead.
+static bool store(come_lru_t* c, entry_t* e, const void* val) {
+    if (c->val_kind != COME_LRU_VALUE_STRING) {
+        memcpy(e->value, val, c->val_size);
+        return true;
+    }
+    come_string_t* s = *(come_string_t* const*)val;
+    come_string_t* copy = NULL;
+    if (s && mem_talloc_parent(s) == c) copy = mem_talloc_steal(e, s);
+    else if (s) copy = come_string_new_len(e, s->data, s->count);
+    if (s && !copy) return false;
+    mem_talloc_free(STRING_VALUE(e));
+    STRING_VALUE(e) = copy;
+    return true;
+}
+
+static bool put_key(come_lru_t* c, int64_t ikey, const char* s, size_t len, const void* val) {
+    entry_t* e = lookup(c, ikey, s, len);
+    if (e) {
+        if (!store(c, e, val)) return false;
+        unlink_entry(e);
+    } else {
+        e = mem_talloc_alloc(c, sizeof(entry_t) + c->val_size);
+        if (!e) return false;
+        memset(e, 0, sizeof(entry_t) + c->val_size);
+        e->key = ikey;
+        if (c->key_kind == COME_MAP_STRING) e->skey = come_string_new_len(e, s, len);
+        entry_t** slot = NULL;
+        if ((c->key_kind != COME_MAP_STRING || e->skey) && store(c, e, val)) {
+            slot = c->key_kind == COME_MAP_STRING ? come_map_insert_str(c->index, s, len)
+                                                  : come_map_insert_int(c->index, ikey);
+        }
+        if (!slot) {
+            mem_talloc_free(e);
+            return false;
+        }
+        *slot = e;
+        c->count++;
+    }
+    c->bytes -= e->cost;
+    e->cost = entry_cost(c, e);
+    c->bytes += e->cost;
+    push_front(c, e);
+
+    while ((c->max_count && c->count > c->max_count) || (c->max_bytes && c->bytes > c->max_bytes)) {
+        entry_t* last = ENTRY(c->list.prev);
+        evict(c, last);
+        if (last == e) return false;
+    }
+    return true;
+}
+
+come_lru_t* come_lru_new(TALLOC_CTX* ctx, int key_kind, uint32_t val_size, int val_kind,
+                         uint32_t max_count, size_t max_bytes) {
+    if (key_kind != COME_MAP_INT && key_kind != COME_MAP_STRING) {
+        errno = EINVAL;
+        return NULL;
+    }
+    come_lru_t* c = mem_talloc_alloc(ctx, sizeof(come_lru_t));
+    if (!c) return NULL;
+    memset(c, 0, sizeof(*c));
+    c->key_kind = key_kind;
+    c->val_kind = val_kind;
+    c->val_size = val_kind == COME_LRU_VALUE_STRING ? sizeof(come_string_t*) : val_size;
+    c->max_count = max_count;
+    c->max_bytes = max_bytes;
+    c->list.prev = c->list.next = &c->list;
+    // The index never needs more than max_count entries
+    c->index = come_map_new(c, key_kind, sizeof(entry_t*), max_count < 1024 ? max_count : 0);
+    if (!c->index) {
+        mem_talloc_free(c);
+        return NULL;
+    }
+    return c;
+}
+
+void come_lru_clear(come_lru_t* c) {
+    if (!c) return;
+    while (c->list.next != &c->list) {
+        entry_t* e = ENTRY(c->list.next);
+        c->list.next = e->link.next;
+        mem_talloc_free(e);
+    }
+    c->list.prev = &c->list;
+    come_map_clear(c->index);
+    c->count = 0;
+    c->bytes = 0;
+}
+
+static void* find_key(come_lru_t* c, int64_t ikey, const char* s, size_t len) {
+    entry_t* e = lookup(c, ikey, s, len);
+    if (!e) return NULL;
+    if (c->list.next != &e->link) {
+        unlink_entry(e);
+        push_front(c, e);
+    }
+    return e->value;
+}
+
+void* come_lru_find_int(come_lru_t* c, int64_t key) {
+    if (!c || c->key_kind != COME_MAP_INT) return NULL;
+    return find_key(c, key, NULL, 0);
+}
+
+void* come_lru_find_cstr(come_lru_t* c, const char* key) {
+    if (!c || !key || c->key_kind != COME_MAP_STRING) return NULL;
+    return find_key(c, 0, key, strlen(key));
+}
+
+void* come_lru_find_string(come_lru_t* c, const come_string_t* key) {
+    if (!c || !key || c->key_kind != COME_MAP_STRING) return NULL;
+    return find_key(c, 0, key->data, key->count);
+}
+
+void* come_lru_peek_int(const come_lru_t* c, int64_t key) {
+    if (!c || c->key_kind != COME_MAP_INT) return NULL;
+    entry_t* e = lookup(c, key, NULL, 0);
+    return e ? e->value : NULL;
+}
+
+void* come_lru_peek_cstr(const come_lru_t* c, const char* key) {
+    if (!c || !key || c->key_kind != COME_MAP_STRING) return NULL;
+    entry_t* e = lookup(c, 0, key, strlen(key));
+    return e ? e->value : NULL;
+}
+
+void* come_lru_peek_string(const come_lru_t* c, const come_string_t* key) {
+    if (!c || !key || c->key_kind != COME_MAP_STRING) return NULL;
+    entry_t* e = lookup(c, 0, key->data, key->count);
+    return e ? e->value : NULL;
+}
+
+bool come_lru_put_int(come_lru_t* c, int64_t key, const void* val) {
+    if (!c || !val || c->key_kind != COME_MAP_INT) {
+        errno = EINVAL;
+        return false;
+    }
+    return put_key(c, key, NULL, 0, val);
+}
+
+bool come_lru_put_cstr(come_lru_t* c, const char* key, const void* val) {
+    if (!c || !key || !val || c->key_kind != COME_MAP_STRING) {
+        errno = EINVAL;
+        return false;
+    }
+    return put_key(c, 0, key, strlen(key), val);
+}
+
+bool come_lru_put_string(come_lru_t* c, const come_string_t* key, const void* val) {
+    if (!c || !key || !val || c->key_kind != COME_MAP_STRING) {
+        errno = EINVAL;
+        return false;
+    }
+    return put_key(c, 0, key->data, key->count, val);
+}
+
+static bool delete_key(come_lru_t* c, int64_t ikey, const char* s, size_t len) {
+    entry_t* e = lookup(c, ikey, s, len);
+    if (!e) return false;
+    evict(c, e);
+    return true;
+}
+
+bool come_lru_delete_int(come_lru_t* c, int64_t key) {
+    if (!c || c->key_kind != COME_MAP_INT) return false;
+    return delete_key(c, key, NULL, 0);
+}
+
+bool come_lru_delete_cstr(come_lru_t* c, const char* key) {
+    if (!c || !key || c->key_kind != COME_MAP_STRING) return false;
+    return delete_key(c, 0, key, strlen(key));
+}
+
+bool come_lru_delete_string(come_lru_t* c, const come_string_t* key) {
+    if (!c || !key || c->key_kind != COME_MAP_STRING) return false;
+    return delete_key(c, 0, key->data, key->count);
+}
+
+void* come_lru_keys(TALLOC_CTX* ctx, const come_lru_t* c) {
+    uint32_t n = come_lru_size(c);
+    uint32_t k = 0;
+    if (c && c->key_kind == COME_MAP_STRING) {
+        come_string_list_t* keys = COME_ARRAY_NEW(ctx, come_string_list_t, n);
+        if (!keys) return NULL;
+        for (const come_lru_link_t* l = c->list.next; l != &c->list; l = l->next) keys->items[k++] = ENTRY(l)->skey;
+        return keys;
+    }
+    come_long_array_t* keys = COME_ARRAY_NEW(ctx, come_long_array_t, n);
+    if (!keys || !c) return keys;
+    for (const come_lru_link_t* l = c->list.next; l != &c->list; l = l->next) keys->items[k++] = ENTRY(l)->key;
+    return keys;
+}
@@ -0,0 +1,399 @@
+#include <string.h>
+#include <errno.h>
+#include "come_map.h"
+#include "mem/talloc.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Maps
+// The table is cap control bytes plus cap slots, in groups of GROUP. A key's hash picks
+// its first group (high bits) and its control byte (low 7 bits); a probe checks every
+// slot of a group whose control byte matches, then moves to the next group of a
+// triangular sequence, which visits every group of a power-of-two table. It stops at a
+// group with an EMPTY slot, so a deleted slot only becomes EMPTY again if its group
+// still has one (no probe can have passed through a group with an EMPTY slot);
+// otherwise it is DELETED until the next rehash. growth_left counts EMPTY slots that may
+// still be filled before the 7/8 load limit, so every probe finds an EMPTY slot.
+
+#define GROUP 16
+#define CTRL_EMPTY   ((int8_t)-128)
+#define CTRL_DELETED ((int8_t)-2)
+
+#define SLOT(m, i) ((m)->slots + (size_t)(i) * (m)->slot_size)
+#define SLOT_VALUE(m, i) (SLOT(m, i) + 8)
+#define MAX_LOAD(cap) ((cap) / 8 * 7)
+
+// Bit j set where control byte j of the group equals c
+static inline uint32_t group_match(const int8_t* g, int8_t c) {
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)g);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(c)));
+#else
+    uint32_t mask = 0;
+    for (int j = 0; j < GROUP; j++) mask |= (uint32_t)(g[j] == c) << j;
+    return mask;
+#endif
+}
+
+// Bit j set where slot j is EMPTY or DELETED (the control bytes with the sign bit)
+static inline uint32_t group_match_free(const int8_t* g) {
+#ifdef __SSE2__
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)g));
+#else
+    uint32_t mask = 0;
+    for (int j = 0; j < GROUP; j++) mask |= (uint32_t)(g[j] < 0) << j;
+    return mask;
+#endif
+}
+
+static inline uint64_t hash_int(int64_t key) {
+    // murmur3's 64-bit finaliser over the seeded key
+    uint64_t x = (uint64_t)key ^ come_hash_seed();
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline uint64_t hash_str(const char* s, size_t len) {
+    return come_hash_bytes(s, len, come_hash_seed());
+}
+
+static inline come_string_t* slot_string(const come_map_t* m, size_t i) {
+    come_string_t* k;
+    memcpy(&k, SLOT(m, i), sizeof(k));
+    return k;
+}
+
+static inline int64_t slot_int(const come_map_t* m, size_t i) {
+    int64_t k;
+    memcpy(&k, SLOT(m, i), sizeof(k));
+    return k;
+}
+
+// String keys cache their hash (come_string_hash), so rehashing reads no key bytes
+static inline uint64_t slot_hash(const come_map_t* m, size_t i) {
+    return m->key_kind == COME_MAP_STRING ? slot_string(m, i)->hash : hash_int(slot_int(m, i));
+}
+
+static inline bool slot_equal(const come_map_t* m, size_t i, uint64_t h, int64_t ikey, const char* s, size_t len) {
+    if (m->key_kind == COME_MAP_INT) return slot_int(m, i) == ikey;
+    const come_string_t* k = slot_string(m, i);
+    return k->hash == h && k->count == len && memcmp(k->data, s, len) == 0;
+}
+
+// Slot holding the key, or -1
+static long find_slot(const come_map_t* m, uint64_t h, int64_t ikey, const char* s, size_t len) {
+    if (!m->cap) return -1;
+    size_t groups = m->cap / GROUP - 1;
+    size_t g = (size_t)(h >> 7) & groups;
+    int8_t h2 = (int8_t)(h & 0x7f);
+    for (size_t step = 1;; step++) {
+        const int8_t* ctrl = m->ctrl + g * GROUP;
+        for (uint32_t match = group_match(ctrl, h2); match; match &= match - 1) {
+            size_t i = g * GROUP + (size_t)__builtin_ctz(match);
+            if (slot_equal(m, i, h, ikey, s, len)) return (long)i;
+        }
+        if (group_match(ctrl, CTRL_EMPTY)) return -1;
+        g = (g + step) & groups;
+    }
+}
+
+// First EMPTY or DELETED slot on the probe sequence of h
+static size_t find_free(const come_map_t* m, uint64_t h) {
+    size_t groups = m->cap / GROUP - 1;
+    size_t g = (size_t)(h >> 7) & groups;
+    for (size_t step = 1;; step++) {
+        uint32_t match = group_match_free(m->ctrl + g * GROUP);
+        if (match) return g * GROUP + (size_t)__builtin_ctz(match);
+        g = (g + step) & groups;
+    }
+}
+
+// New table with room for need entries. Stays the same size (only dropping DELETED
+// slots) when at most half the current one would be live.
+static bool rehash(come_map_t* m, uint32_t need) {
+    uint64_t cap = GROUP;
+    while (MAX_LOAD(cap) < need) cap *= 2;
+    if (cap < m->cap) cap = m->cap;
+    else if (cap == m->cap && need > MAX_LOAD(cap) / 2) cap *= 2;
+    if (cap > UINT32_MAX || cap > SIZE_MAX / m->slot_size) {
+        errno = ENOMEM;
+        return false;
+    }
+
+    int8_t* ctrl = mem_talloc_alloc(m, (size_t)cap);
+    unsigned char* slots = mem_talloc_alloc(m, (size_t)cap * m->slot_size);
+    if (!ctrl || !slots) {
+        mem_talloc_free(ctrl);
+        mem_talloc_free(slots);
+        errno = ENOMEM;
+        return false;
+    }
+    memset(ctrl, CTRL_EMPTY, (size_t)cap);
+
+    come_map_t old = *m;
+    m->ctrl = ctrl;
+    m->slots = slots;
+    m->cap = (uint32_t)cap;
+    m->growth_left = MAX_LOAD(m->cap) - m->count;
+    for (size_t i = 0; i < old.cap; i++) {
+        if (old.ctrl[i] < 0) continue;
+        uint64_t h = slot_hash(&old, i);
+        size_t j = find_free(m, h);
+        m->ctrl[j] = (int8_t)(h & 0x7f);
+        memcpy(SLOT(m, j), SLOT(&old, i), m->slot_size);
+    }
+    mem_talloc_free(old.ctrl);
+    mem_talloc_free(old.slots);
+    return true;
+}
+
+come_map_t* come_map_new(TALLOC_CTX* ctx, int key_kind, uint32_t val_size, uint32_t n) {
+    come_map_t* m = mem_talloc_alloc(ctx, sizeof(come_map_t));
+    if (!m) return NULL;
+    memset(m, 0, sizeof(*m));
+    m->key_kind = key_kind;
+    m->val_size = val_size;
+    m->slot_size = 8 + ((val_size + 7) & ~7u);
+    if (n && !come_map_reserve(m, n)) {
+        mem_talloc_free(m);
+        return NULL;
+    }
+    return m;
+}
+
+bool come_map_reserve(come_map_t* m, uint32_t n) {
+    if (!m) return false;
+    if (n <= m->count || n - m->count <= m->growth_left) return true;
+    return rehash(m, n);
+}
+
+void come_map_clear(come_map_t* m) {
+    if (!m || !m->cap) return;
+    if (m->key_kind == COME_MAP_STRING) {
+        for (size_t i = 0; i < m->cap; i++) {
+            if (m->ctrl[i] >= 0) mem_talloc_free(slot_string(m, i));
+        }
+    }
+    memset(m->ctrl, CTRL_EMPTY, m->cap);
+    m->count = 0;
+    m->growth_left = MAX_LOAD(m->cap);
+}
+
+static void* insert_key(come_map_t* m, uint64_t h, int64_t ikey, const char* s, size_t len) {
+    long found = find_slot(m, h, ikey, s, len);
+    if (found >= 0) return SLOT_VALUE(m, found);
+
+    come_string_t* copy = NULL;
+    if (m->key_kind == COME_MAP_STRING) {
+        copy = come_string_new_len(m, s, len);
+        if (!copy) return NULL;
+        copy->hash = h;
+        copy->flags |= COME_STRING_HASHED;
+    }
+    size_t i = m->cap ? find_free(m, h) : 0;
+    if (!m->cap || (m->growth_left == 0 && m->ctrl[i] == CTRL_EMPTY)) {
+        if (!rehash(m, m->count + 1)) {
+            mem_talloc_free(copy);
+            return NULL;
+        }
+        i = find_free(m, h);
+    }
+    if (m->ctrl[i] == CTRL_EMPTY) m->growth_left--;
+    m->ctrl[i] = (int8_t)(h & 0x7f);
+    m->count++;
+    if (copy) memcpy(SLOT(m, i), &copy, sizeof(copy));
+    else memcpy(SLOT(m, i), &ikey, sizeof(ikey));
+    memset(SLOT_VALUE(m, i), 0, m->slot_size - 8);
+    return SLOT_VALUE(m, i);
+}
+
+static bool delete_key(come_map_t* m, uint64_t h, int64_t ikey, const char* s, size_t len) {
+    long i = find_slot(m, h, ikey, s, len);
+    if (i < 0) return false;
+    if (m->key_kind == COME_MAP_STRING) mem_talloc_free(slot_string(m, (size_t)i));
+    if (group_match(m->ctrl + (size_t)i / GROUP * GROUP, CTRL_EMPTY)) {
+        m->ctrl[i] = CTRL_EMPTY;
+        m->growth_left++;
+    } else {
+        m->ctrl[i] = CTRL_DELETED;
+    }
+    m->count--;
+    return true;
+}
+
+void* come_map_find_int(const come_map_t* m, int64_t key) {
+    if (!m || m->key_kind != COME_MAP_INT) return NULL;
+    long i = find_slot(m, hash_int(key), key, NULL, 0);
+    return i < 0 ? NULL : SLOT_VALUE(m, i);
+}
+
+void* come_map_find_str(const come_map_t* m, const char* key, size_t len) {
+    if (!m || !key || m->key_kind != COME_MAP_STRING) return NULL;
+    long i = find_slot(m, hash_str(key, len), 0, key, len);
+    return i < 0 ? NULL : SLOT_VALUE(m, i);
+}
+
+void* come_map_find_cstr(const come_map_t* m, const char* key) {
+    return key ? come_map_find_str(m, key, strlen(key)) : NULL;
+}
+
+void* come_map_find_string(const come_map_t* m, const come_string_t* key) {
+    if (!m || !key || m->key_kind != COME_MAP_STRING) return NULL;
+    long i = find_slot(m, come_string_hash(key), 0, key->data, key->count);
+    return i < 0 ? NULL : SLOT_VALUE(m, i);
+}
+
+void* come_map_insert_int(come_map_t* m, int64_t key) {
+    if (!m || m->key_kind != COME_MAP_INT) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return insert_key(m, hash_int(key), key, NULL, 0);
+}
+
+void* come_map_insert_str(come_map_t* m, const char* key, size_t len) {
+    if (!m || !key || m->key_kind != COME_MAP_STRING) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return insert_key(m, hash_str(key, len), 0, key, len);
+}
+
+void* come_map_insert_cstr(come_map_t* m, const char* key) {
+    return come_map_insert_str(m, key, key ? strlen(key) : 0);
+}
+
+void* come_map_insert_string(come_map_t* m, const come_string_t* key) {
+    if (!m || !key || m->key_kind != COME_MAP_STRING) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return insert_key(m, come_string_hash(key), 0, key->data, key->count);
+}
+
+bool come_map_delete_int(come_map_t* m, int64_t key) {
+    if (!m || m->key_kind != COME_MAP_INT) return false;
+    return delete_key(m, hash_int(key), key, NULL, 0);
+}
+
+bool come_map_delete_cstr(come_map_t* m, const char* key) {
+    if (!m || !key || m->key_kind != COME_MAP_STRING) return false;
+    size_t len = strlen(key);
+    return delete_key(m, hash_str(key, len), 0, key, len);
+}
+
+bool come_map_delete_string(come_map_t* m, const come_string_t* key) {
+    if (!m || !key || m->key_kind != COME_MAP_STRING) return false;
+    return delete_key(m, come_string_hash(key), 0, key->data, key->count);
+}
+
+bool come_map_put_all(come_map_t* m, const void* keys, const void* vals, uint32_t n) {
+    if (!m || (n && (!keys || !vals))) return false;
+    if (!come_map_reserve(m, m->count + n)) return false;
+    for (uint32_t i = 0; i < n; i++) {
+        void* v = m->key_kind == COME_MAP_STRING ? come_map_insert_cstr(m, ((const char* const*)keys)[i])
+                                                 : come_map_insert_int(m, ((const int64_t*)keys)[i]);
+        if (!v) return false;
+        memcpy(v, (const char*)vals + (size_t)i * m->val_size, m->val_size);
+    }
+    return true;
+}
+
+long come_map_next(const come_map_t* m, long i) {
+    if (!m || i < 0) return -1;
+    for (; (size_t)i < m->cap; i++) {
+        if (m->ctrl[i] >= 0) return i;
+    }
+    return -1;
+}
+
+int64_t come_map_int_key_at(const come_map_t* m, long i) {
+    return m && m->key_kind == COME_MAP_INT && i >= 0 && (size_t)i < m->cap ? slot_int(m, (size_t)i) : 0;
+}
+
+come_string_t* come_map_string_key_at(const come_map_t* m, long i) {
+    return m && m->key_kind == COME_MAP_STRING && i >= 0 && (size_t)i < m->cap ? slot_string(m, (size_t)i) : NULL;
+}
+
+void* come_map_value_at(const come_map_t* m, long i) {
+    return m && i >= 0 && (size_t)i < m->cap ? SLOT_VALUE(m, i) : NULL;
+}
+
+void* come_map_keys(TALLOC_CTX* ctx, const come_map_t* m) {
+    uint32_t n = come_map_size(m);
+    if (m && m->key_kind == COME_MAP_STRING) {
+        come_string_list_t* keys = COME_ARRAY_NEW(ctx, come_string_list_t, n);
+        if (!keys) return NULL;
+        uint32_t k = 0;
+        for (long i = come_map_next(m, 0); i >= 0; i = come_map_next(m, i + 1)) keys->items[k++] = slot_string(m, i);
+        return keys;
+    }
+    come_long_array_t* keys = COME_ARRAY_NEW(ctx, come_long_array_t, n);
+    if (!keys) return NULL;
+    uint32_t k = 0;
+    for (long i = come_map_next(m, 0); i >= 0; i = come_map_next(m, i + 1)) keys->items[k++] = slot_int(m, i);
+    return keys;
+}
+
+void* come_map_values(TALLOC_CTX* ctx, const come_map_t* m, size_t hdr) {
+    uint32_t n = come_map_size(m);
+    size_t val_size = m ? m->val_size : 0;
+    char* vals = come_array_new(ctx, hdr, val_size, n);
+    if (!vals) return NULL;
+    char* out = vals + hdr;
+    for (long i = come_map_next(m, 0); i >= 0; i = come_map_next(m, i + 1)) {
+        memcpy(out, SLOT_VALUE(m, i), val_size);
+        out += val_size;
+    }
+    return vals;
+}
+
+// Constant maps: a slot is used if its key hashes to it (int) or has a length (string)
+static bool const_slot_used(const come_map_const_t* m, uint32_t s) {
+    if (m->key_kind == COME_MAP_STRING) return m->lens[s] != UINT32_MAX;
+    return come_map_const_slot(m, come_phf_hash_int(((const int64_t*)m->keys)[s])) == s;
+}
+
+void* come_map_const_keys(TALLOC_CTX* ctx, const come_map_const_t* m) {
+    uint32_t slots = (uint32_t)1 << (32 - m->shift);
+    uint32_t k = 0;
+    if (m->key_kind == COME_MAP_STRING) {
+        // The keys are C strings in read-only data: the list gets its own copies
+        come_string_list_t* keys = COME_ARRAY_NEW(ctx, come_string_list_t, m->count);
+        if (!keys) return NULL;
+        for (uint32_t s = 0; s < slots; s++) {
+            if (!const_slot_used(m, s)) continue;
+            keys->items[k] = come_string_new_len(keys, ((const char* const*)m->keys)[s], m->lens[s]);
+            if (!keys->items[k++]) {
+                mem_talloc_free(keys);
+                return NULL;
+            }
+        }
+        return keys;
+    }
+    come_long_array_t* keys = COME_ARRAY_NEW(ctx, come_long_array_t, m->count);
+    if (!keys) return NULL;
+    for (uint32_t s = 0; s < slots; s++) {
+        if (const_slot_used(m, s)) keys->items[k++] = ((const int64_t*)m->keys)[s];
+    }
+    return keys;
+}
+
+void* come_map_const_values(TALLOC_CTX* ctx, const come_map_const_t* m, size_t hdr) {
+    uint32_t slots = (uint32_t)1 << (32 - m->shift);
+    char* vals = come_array_new(ctx, hdr, m->val_size, m->count);
+    if (!vals) return NULL;
+    char* out = vals + hdr;
+    for (uint32_t s = 0; s < slots; s++) {
+        if (!const_slot_used(m, s)) continue;
+        memcpy(out, (const char*)m->vals + (size_t)s * m->val_size, m->val_size);
+        out += m->val_size;
+    }
+    return vals;
+}
@@ -1,32 +1,85 @@
 #include "mem/talloc.h"
 #include "talloc.h"   // from external/talloc/include
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
 
-static void* co_mem_root = NULL;
+// talloc takes no locks, so every thread allocates under its own root context and a
+// tree is only ever touched by the thread that owns it. The root is made on a thread's
+// first allocation without a parent and freed by the key destructor when the thread
+// exits; calls given a parent never touch it.
+static __thread void* co_mem_root = NULL;
+static pthread_key_t co_mem_root_key;
+static pthread_once_t co_mem_root_once = PTHREAD_ONCE_INIT;
+
+static void root_destroy(void* root) {
+    talloc_free(root);
+    co_mem_root = NULL;
+}
+
+static void stats_init(void);
+
+static void root_key_init(void) {
+    pthread_key_create(&co_mem_root_key, root_destroy);
+    // talloc reads its fill setting on the first free; do that once, before any thread
+    talloc_free(talloc_new(NULL));
+    stats_init();
+}
 
 void mem_talloc_module_init(void) {
+    if (co_mem_root) return;
+    pthread_once(&co_mem_root_once, root_key_init);
     co_mem_root = talloc_new(NULL);
     if (!co_mem_root) {
         fprintf(stderr, "talloc: failed to create root context\n");
+        return;
     }
+    pthread_setspecific(co_mem_root_key, co_mem_root);
 }
 
 void mem_talloc_module_shutdown(void) {
-    if (co_mem_root)
+    if (co_mem_root) {
         talloc_free(co_mem_root);
+        pthread_setspecific(co_mem_root_key, NULL);
+    }
     co_mem_root = NULL;
 }
 
+static inline void* root(void) {
+    if (__builtin_expect(!co_mem_root, 0)) mem_talloc_module_init();
+    return co_mem_root;
+}
+
+// Parent of process-wide runtime state; no thread's exit frees it
+static void* co_mem_global = NULL;
+static pthread_once_t co_mem_global_once = PTHREAD_ONCE_INIT;
+
+static void global_init(void) {
+    pthread_once(&co_mem_root_once, root_key_init);
+    co_mem_global = talloc_new(NULL);
+}
+
+void* mem_talloc_global_ctx(void) {
+    pthread_once(&co_mem_global_once, global_init);
+    return co_mem_global;
+}
+
+// Statistics (below): 0 while off, else one allocation in sample_period is tracked
+static uint32_t sample_period = 0;
+static void sample(void* ptr, size_t size);
+static void* realloc_tracked(void* ctx, void* ptr, size_t size);
+
 void* mem_talloc_alloc(void* ctx, size_t size) {
-    if (!co_mem_root) mem_talloc_module_init();
-    if (!ctx) ctx = co_mem_root;
-    return talloc_size(ctx, size);
+    void* ptr = talloc_size(ctx ? ctx : root(), size);
+    if (__builtin_expect(sample_period != 0, 0) && ptr) sample(ptr, size);
+    return ptr;
 }
 
 void* mem_talloc_realloc(void* ctx, void* ptr, size_t size) {
-    if (!co_mem_root) mem_talloc_module_init();
-    if (!ctx) ctx = co_mem_root;
-    return talloc_realloc_size(ctx, ptr, size);
+    if (__builtin_expect(sample_period != 0, 0)) return realloc_tracked(ctx ? ctx : root(), ptr, size);
+    return talloc_realloc_size(ctx ? ctx : root(), ptr, size);
 }
 
 void mem_talloc_free(void* ptr) {
@@ -35,17 +88,322 @@ void mem_talloc_free(void* ptr) {
 }
 
 void* mem_talloc_new_ctx(void* parent) {
-    if (!co_mem_root) mem_talloc_module_init();
-    if (!parent) parent = co_mem_root;  // default parent is global root
-    void* ctx = talloc_new(parent);
+    void* ctx = talloc_new(parent ? parent : root()); // default parent is the thread's root
     if (!ctx) {
         fprintf(stderr, "talloc: failed to create new context\n");
+    } else if (__builtin_expect(sample_period != 0, 0)) {
+        sample(ctx, 0);
     }
     return ctx;
 }
 
+void* mem_talloc_pool(void* parent, size_t size) {
+    void* pool = talloc_pool(parent ? parent : root(), size);
+    // Its block is counted as its children are carved from it
+    if (__builtin_expect(sample_period != 0, 0) && pool) sample(pool, 0);
+    return pool;
+}
+
+void mem_talloc_free_children(void* ctx) {
+    if (ctx)
+        talloc_free_children(ctx);
+}
+
 void* mem_talloc_steal(void* new_ctx, void* ptr) {
-    if (!co_mem_root) mem_talloc_module_init();
-    if (!new_ctx) new_ctx = co_mem_root;
-    return talloc_steal(new_ctx, ptr);
+    return talloc_steal(new_ctx ? new_ctx : root(), ptr);
+}
+
+static bool chain_destructor(void* ptr, int (*destructor)(void*));
+
+void mem_talloc_set_destructor(void* ptr, int (*destructor)(void*)) {
+    if (!ptr) return;
+    if (sample_period && chain_destructor(ptr, destructor)) return;
+    _talloc_set_destructor(ptr, destructor);
+}
+
+void* mem_talloc_parent(const void* ptr) {
+    return ptr ? talloc_parent(ptr) : NULL;
+}
+
+void* mem_talloc_reference(void* ctx, void* ptr) {
+    return talloc_reference(ctx ? ctx : root(), ptr);
+}
+
+int mem_talloc_unlink(void* ctx, void* ptr) {
+    if (!ptr) return -1;
+    if (!ctx) ctx = co_mem_root;
+    return talloc_unlink(ctx, ptr);
+}
+
+size_t mem_talloc_reference_count(const void* ptr) {
+    return ptr ? talloc_reference_count(ptr) : 0;
+}
+
+void mem_talloc_scope_free(void** ctx) {
+    mem_talloc_free(*ctx);
+    *ctx = NULL;
+}
+
+void mem_talloc_scope_reset(void** ctx) {
+    mem_talloc_free_children(*ctx);
+}
+
+void* mem_talloc_escape(void* scope, void* new_ctx, void* ptr) {
+    if (ptr && scope && talloc_is_parent(ptr, scope)) // scope is an ancestor of ptr
+        mem_talloc_steal(new_ctx, ptr);
+    return ptr;
+}
+
+void* mem_talloc_detach(void* ptr) {
+    if (!ptr) return NULL;
+    if (talloc_reference_count(ptr)) {
+        errno = EBUSY;
+        return NULL;
+    }
+    return talloc_steal(NULL, ptr);
+}
+
+void* mem_talloc_adopt(void* ctx, void* ptr) {
+    return ptr ? talloc_steal(ctx ? ctx : root(), ptr) : NULL;
+}
+
+// Allocation statistics
+// COME_MEM_STATS=N turns them on as the first root is made: N = 1 tracks every
+// allocation, N > 1 about one in N, which then stands for N (so the counts are
+// estimates). A tracked block is renamed to its call site record, whose label is the
+// site's "file:line" and so is what talloc_report_full prints for it, and gets a
+// destructor that takes it off the site's live counts. Records sit in one fixed
+// table, which is how a block's name is known to be one. The site is the statement
+// COME_MEM_SITE() last marked on the allocating thread; COME_MEM_DUMP=1 prints the
+// tree still under the root at exit.
+
+#define SITE_LABEL 96
+#define MAX_SITES 4096
+#define SITE_INDEX (2 * MAX_SITES)
+
+typedef struct site_t {
+    char label[SITE_LABEL];   // First: a tracked block's talloc name
+    const char* file;
+    int line;
+    struct site_t* owner;     // The site counted: a variant records a block's destructor
+    int (*destructor)(void*); // Run before the block leaves the counts
+    mem_talloc_stats_t stats;
+} site_t;
+
+// sites[0] holds the totals and the last slot takes sites past the table's end
+static site_t sites[MAX_SITES];
+static uint16_t site_index[SITE_INDEX];
+static uint32_t site_count = 1;
+static pthread_mutex_t site_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool dump_at_exit = false;
+
+__thread const char* mem_talloc_site_file = NULL;
+__thread int mem_talloc_site_line = 0;
+static __thread site_t* last_site = NULL;
+static __thread uint32_t sample_left = 0;
+static __thread uint64_t sample_rng = 0;
+
+static site_t* site_of(const void* ptr) {
+    uintptr_t name = (uintptr_t)talloc_get_name(ptr);
+    if (name < (uintptr_t)sites || name >= (uintptr_t)(sites + MAX_SITES)) return NULL;
+    return (site_t*)name;
+}
+
+static bool same_file(const char* a, const char* b) {
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+static site_t* intern_locked(const char* file, int line, int (*destructor)(void*)) {
+    uint32_t h = 2166136261u ^ (uint32_t)line;
+    for (const char* c = file; c && *c; c++) h = (h ^ (unsigned char)*c) * 16777619u;
+    h ^= (uint32_t)((uintptr_t)destructor >> 4);
+    uint32_t i = h & (SITE_INDEX - 1);
+    for (; site_index[i]; i = (i + 1) & (SITE_INDEX - 1)) {
+        site_t* s = &sites[site_index[i]];
+        if (s->line == line && s->destructor == destructor && same_file(s->file, file)) return s;
+    }
+    site_t* owner = destructor ? intern_locked(file, line, NULL) : NULL;
+    if (site_count >= MAX_SITES - 1) return destructor ? NULL : &sites[MAX_SITES - 1];
+    if (destructor && owner == &sites[MAX_SITES - 1]) return NULL;
+    site_t* s = &sites[site_count];
+    site_index[i] = (uint16_t)site_count++;
+    if (file) snprintf(s->label, SITE_LABEL, "%s:%d", file, line);
+    else snprintf(s->label, SITE_LABEL, "(unknown)");
+    s->file = file;
+    s->line = line;
+    s->owner = owner ? owner : s;
+    s->destructor = destructor;
+    return s;
+}
+
+static site_t* intern(const char* file, int line, int (*destructor)(void*)) {
+    pthread_mutex_lock(&site_lock);
+    site_t* s = intern_locked(file, line, destructor);
+    pthread_mutex_unlock(&site_lock);
+    return s;
+}
+
+static void add_live(mem_talloc_stats_t* st, int64_t blocks, int64_t bytes) {
+    __atomic_add_fetch(&st->live, (uint64_t)blocks, __ATOMIC_RELAXED);
+    uint64_t now = __atomic_add_fetch(&st->live_bytes, (uint64_t)bytes, __ATOMIC_RELAXED);
+    uint64_t peak = __atomic_load_n(&st->peak_bytes, __ATOMIC_RELAXED);
+    while (bytes > 0 && now > peak &&
+           !__atomic_compare_exchange_n(&st->peak_bytes, &peak, now, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// A tracked block of size bytes came (allocs 1), changed by bytes, or went (allocs -1)
+static void count(site_t* s, int allocs, int64_t bytes) {
+    int64_t w = sample_period;
+    mem_talloc_stats_t* both[2] = { &s->owner->stats, &sites[0].stats };
+    for (int i = 0; i < 2; i++) {
+        if (allocs > 0) __atomic_add_fetch(&both[i]->allocs, (uint64_t)w, __ATOMIC_RELAXED);
+        if (bytes > 0 && allocs >= 0) __atomic_add_fetch(&both[i]->bytes, (uint64_t)(w * bytes), __ATOMIC_RELAXED);
+        add_live(both[i], w * allocs, w * bytes);
+    }
+}
+
+static int site_destructor(void* ptr) {
+    site_t* s = site_of(ptr);
+    if (s->destructor) {
+        int rc = s->destructor(ptr);
+        if (rc != 0) return rc;
+    }
+    count(s, -1, -(int64_t)talloc_get_size(ptr));
+    return 0;
+}
+
+static void sample(void* ptr, size_t size) {
+    if (sample_period > 1) {
+        if (sample_left > 1) {
+            sample_left--;
+            return;
+        }
+        // The next gap is uniform in 1 .. 2N - 1, so one in N on average without
+        // locking onto an allocation pattern of period N
+        if (!sample_rng) sample_rng = (uintptr_t)&sample_rng | 1;
+        sample_rng ^= sample_rng << 13;
+        sample_rng ^= sample_rng >> 7;
+        sample_rng ^= sample_rng << 17;
+        sample_left = 1 + (uint32_t)(sample_rng % (2 * (uint64_t)sample_period - 1));
+    }
+    site_t* s = last_site;
+    if (!s || s->file != mem_talloc_site_file || s->line != mem_talloc_site_line) {
+        s = last_site = intern(mem_talloc_site_file, mem_talloc_site_line, NULL);
+    }
+    talloc_set_name_const(ptr, s->label);
+    _talloc_set_destructor(ptr, site_destructor);
+    count(s, 1, (int64_t)size);
+}
+
+static void* realloc_tracked(void* ctx, void* ptr, size_t size) {
+    site_t* s = ptr ? site_of(ptr) : NULL;
+    if (!s) {
+        void* p = talloc_realloc_size(ctx, ptr, size);
+        if (!ptr && p) sample(p, size);
+        return p;
+    }
+    size_t old = talloc_get_size(ptr);
+    // Passing the label keeps the block's name; size 0 frees it through the destructor
+    void* p = _talloc_realloc(ctx, ptr, size, s->label);
+    if (p) count(s, 0, (int64_t)size - (int64_t)old);
+    return p;
+}
+
+// A tracked block keeps site_destructor, renamed to the variant that runs destructor
+// first. False if ptr is not tracked, or is no longer because the table is full.
+static bool chain_destructor(void* ptr, int (*destructor)(void*)) {
+    site_t* s = site_of(ptr);
+    if (!s) return false;
+    site_t* v = intern(s->owner->file, s->owner->line, destructor);
+    if (v) {
+        talloc_set_name_const(ptr, v->label);
+        return true;
+    }
+    count(s, -1, -(int64_t)talloc_get_size(ptr));
+    talloc_set_name_const(ptr, "mem_talloc_set_destructor");
+    return false;
+}
+
+mem_talloc_stats_t mem_talloc_stats(const void* ctx) {
+    mem_talloc_stats_t st = {0};
+    if (ctx) {
+        st.live = talloc_total_blocks(ctx);
+        st.live_bytes = talloc_total_size(ctx);
+        return st;
+    }
+    st.allocs = __atomic_load_n(&sites[0].stats.allocs, __ATOMIC_RELAXED);
+    st.bytes = __atomic_load_n(&sites[0].stats.bytes, __ATOMIC_RELAXED);
+    st.live = __atomic_load_n(&sites[0].stats.live, __ATOMIC_RELAXED);
+    st.live_bytes = __atomic_load_n(&sites[0].stats.live_bytes, __ATOMIC_RELAXED);
+    st.peak_bytes = __atomic_load_n(&sites[0].stats.peak_bytes, __ATOMIC_RELAXED);
+    return st;
+}
+
+uint32_t mem_talloc_stats_period(void) {
+    return sample_period;
+}
+
+static int by_live_bytes(const void* a, const void* b) {
+    const mem_talloc_stats_t* x = &(*(site_t* const*)a)->stats;
+    const mem_talloc_stats_t* y = &(*(site_t* const*)b)->stats;
+    if (x->live_bytes != y->live_bytes) return x->live_bytes < y->live_bytes ? 1 : -1;
+    if (x->bytes != y->bytes) return x->bytes < y->bytes ? 1 : -1;
+    return 0;
+}
+
+void mem_talloc_stats_report(FILE* f) {
+    if (!sample_period) {
+        fprintf(f, "mem: statistics are off (set COME_MEM_STATS)\n");
+        return;
+    }
+    pthread_mutex_lock(&site_lock);
+    uint32_t n = 0;
+    site_t** order = malloc(MAX_SITES * sizeof(site_t*));
+    for (uint32_t i = 1; order && i < MAX_SITES; i++) {
+        if (sites[i].owner == &sites[i] && sites[i].stats.allocs) order[n++] = &sites[i];
+    }
+    pthread_mutex_unlock(&site_lock);
+
+    mem_talloc_stats_t t = mem_talloc_stats(NULL);
+    fprintf(f, "mem: %llu allocations, %llu bytes; %llu blocks, %llu bytes live; peak %llu bytes",
+            (unsigned long long)t.allocs, (unsigned long long)t.bytes, (unsigned long long)t.live,
+            (unsigned long long)t.live_bytes, (unsigned long long)t.peak_bytes);
+    if (sample_period > 1) fprintf(f, " (sampled 1 in %u)", sample_period);
+    fprintf(f, "\n%-40s %12s %14s %10s %14s %14s\n", "site", "allocs", "bytes", "live", "live bytes", "peak bytes");
+    if (!order) return;
+    qsort(order, n, sizeof(site_t*), by_live_bytes);
+    for (uint32_t i = 0; i < n; i++) {
+        mem_talloc_stats_t* st = &order[i]->stats;
+        fprintf(f, "%-40s %12llu %14llu %10llu %14llu %14llu\n", order[i]->label,
+                (unsigned long long)__atomic_load_n(&st->allocs, __ATOMIC_RELAXED),
+                (unsigned long long)__atomic_load_n(&st->bytes, __ATOMIC_RELAXED),
+                (unsigned long long)__atomic_load_n(&st->live, __ATOMIC_RELAXED),
+                (unsigned long long)__atomic_load_n(&st->live_bytes, __ATOMIC_RELAXED),
+                (unsigned long long)__atomic_load_n(&st->peak_bytes, __ATOMIC_RELAXED));
+    }
+    free(order);
+}
+
+static void report_at_exit(void) {
+    if (sample_period) mem_talloc_stats_report(stderr);
+    // The exiting thread's root: the module context is freed by now, so what is left
+    // under it leaked
+    if (dump_at_exit && co_mem_root && talloc_total_blocks(co_mem_root) > 1) {
+        fprintf(stderr, "mem: still allocated at exit:\n");
+        talloc_report_full(co_mem_root, stderr);
+    }
+}
+
+static void stats_init(void) {
+    const char* stats = getenv("COME_MEM_STATS");
+    const char* dump = getenv("COME_MEM_DUMP");
+    long period = stats ? strtol(stats, NULL, 10) : 0;
+    sample_period = period > 0 ? (period < UINT32_MAX / 2 ? (uint32_t)period : UINT32_MAX / 2) : 0;
+    snprintf(sites[0].label, SITE_LABEL, "(total)");
+    sites[0].owner = &sites[0];
+    snprintf(sites[MAX_SITES - 1].label, SITE_LABEL, "(other sites)");
+    sites[MAX_SITES - 1].owner = &sites[MAX_SITES - 1];
+    dump_at_exit = dump && *dump && strcmp(dump, "0") != 0;
+    if (sample_period || dump_at_exit) atexit(report_at_exit);
 }
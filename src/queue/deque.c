@@ -0,0 +1,87 @@
+#include <string.h>
+#include <errno.h>
+#include "come_queue.h"
+#include "mem/talloc.h"
+
+// Deques
+// The elements occupy count slots starting at head and wrapping at cap. Growing copies
+// them to the start of the new buffer in order (the part up to the end of the old
+// buffer, then the wrapped part), so head is 0 again.
+
+#define MIN_CAP 8
+
+#define SLOT(d, s) ((d)->items + (size_t)(s) * (d)->elem_size)
+
+// Buffer of at least need slots
+static bool resize(come_deque_t* d, uint32_t need) {
+    uint64_t cap = d->cap ? d->cap : MIN_CAP;
+    while (cap < need) cap *= 2;
+    if (cap > UINT32_MAX || cap > SIZE_MAX / (d->elem_size ? d->elem_size : 1)) {
+        errno = ENOMEM;
+        return false;
+    }
+    unsigned char* items = mem_talloc_alloc(d, (size_t)cap * d->elem_size);
+    if (!items) {
+        errno = ENOMEM;
+        return false;
+    }
+    uint32_t first = d->count;
+    if (d->cap && d->head + first > d->cap) first = d->cap - d->head;
+    if (d->count) {
+        memcpy(items, SLOT(d, d->head), (size_t)first * d->elem_size);
+        memcpy(items + (size_t)first * d->elem_size, d->items, (size_t)(d->count - first) * d->elem_size);
+    }
+    mem_talloc_free(d->items);
+    d->items = items;
+    d->cap = (uint32_t)cap;
+    d->head = 0;
+    return true;
+}
+
+come_deque_t* come_deque_new(TALLOC_CTX* ctx, uint32_t elem_size, uint32_t n) {
+    come_deque_t* d = mem_talloc_alloc(ctx, sizeof(come_deque_t));
+    if (!d) return NULL;
+    memset(d, 0, sizeof(*d));
+    d->elem_size = elem_size;
+    if (n && !resize(d, n)) {
+        mem_talloc_free(d);
+        return NULL;
+    }
+    return d;
+}
+
+bool come_deque_reserve(come_deque_t* d, uint32_t n) {
+    if (!d) return false;
+    return n <= d->cap || resize(d, n);
+}
+
+void come_deque_clear(come_deque_t* d) {
+    if (!d) return;
+    d->head = 0;
+    d->count = 0;
+}
+
+void* come_deque_push_back_slot(come_deque_t* d) {
+    if (!d) return NULL;
+    if (d->count == d->cap && !resize(d, d->count + 1)) return NULL;
+    return SLOT(d, (d->head + d->count++) & (d->cap - 1));
+}
+
+void* come_deque_push_front_slot(come_deque_t* d) {
+    if (!d) return NULL;
+    if (d->count == d->cap && !resize(d, d->count + 1)) return NULL;
+    d->head = (d->head - 1) & (d->cap - 1);
+    d->count++;
+    return SLOT(d, d->head);
+}
+
+void* come_deque_values(TALLOC_CTX* ctx, const come_deque_t* d, size_t hdr) {
+    uint32_t n = come_deque_size(d);
+    size_t elem_size = d ? d->elem_size : 0;
+    char* vals = come_array_new(ctx, hdr, elem_size, n);
+    if (!vals || !n) return vals;
+    uint32_t first = d->head + n > d->cap ? d->cap - d->head : n;
+    memcpy(vals + hdr, SLOT(d, d->head), (size_t)first * elem_size);
+    memcpy(vals + hdr + (size_t)first * elem_size, d->items, (size_t)(n - first) * elem_size);
+    return vals;
+}
@@ -0,0 +1,165 @@
+#include <string.h>
+#include <errno.h>
+#include "come_queue.h"
+#include "mem/talloc.h"
+
+// Heaps
+// order[] is a 4-ary heap: the children of i are 4i + 1 .. 4i + 4 and its parent is
+// (i - 1) / 4. A 4-ary heap is half as deep as a binary one; a sift down compares four
+// children per level instead of two, but they are adjacent 16-byte entries. Sifts move
+// a hole rather than swapping, and every entry moved updates pos[] of its id.
+
+#define ARITY 4
+#define MIN_CAP 16
+#define NO_ID UINT32_MAX
+
+#define VALUE(h, id) ((h)->values + (size_t)(id) * (h)->elem_size)
+// Handles keep 31 bits of the generation so they stay positive
+#define GEN_MASK 0x7fffffffu
+#define HANDLE(h, id) ((int64_t)((uint64_t)((h)->gen[id] & GEN_MASK) << 32 | (id)))
+
+static bool grow(come_heap_t* h, uint32_t need) {
+    uint64_t cap = h->cap ? h->cap : MIN_CAP;
+    while (cap < need) cap *= 2;
+    if (cap > UINT32_MAX / 2 || cap > SIZE_MAX / (h->elem_size ? h->elem_size : 1)) {
+        errno = ENOMEM;
+        return false;
+    }
+    come_heap_entry_t* order = mem_talloc_realloc(h, h->order, (size_t)cap * sizeof(come_heap_entry_t));
+    if (order) h->order = order;
+    uint32_t* pos = order ? mem_talloc_realloc(h, h->pos, (size_t)cap * sizeof(uint32_t)) : NULL;
+    if (pos) h->pos = pos;
+    uint32_t* gen = pos ? mem_talloc_realloc(h, h->gen, (size_t)cap * sizeof(uint32_t)) : NULL;
+    if (gen) h->gen = gen;
+    unsigned char* values = gen ? mem_talloc_realloc(h, h->values, (size_t)cap * h->elem_size) : NULL;
+    if (!values) {
+        // The arrays that did grow keep their contents; cap stays the smallest
+        errno = ENOMEM;
+        return false;
+    }
+    h->values = values;
+    h->cap = (uint32_t)cap;
+    return true;
+}
+
+static void sift_up(come_heap_t* h, uint32_t i, come_heap_entry_t e) {
+    while (i > 0) {
+        uint32_t parent = (i - 1) / ARITY;
+        if (h->order[parent].priority <= e.priority) break;
+        h->order[i] = h->order[parent];
+        h->pos[h->order[i].id] = i;
+        i = parent;
+    }
+    h->order[i] = e;
+    h->pos[e.id] = i;
+}
+
+static void sift_down(come_heap_t* h, uint32_t i, come_heap_entry_t e) {
+    for (;;) {
+        uint64_t first = (uint64_t)i * ARITY + 1;
+        if (first >= h->count) break;
+        uint32_t last = first + ARITY < h->count ? (uint32_t)first + ARITY : h->count;
+        uint32_t min = (uint32_t)first;
+        for (uint32_t c = min + 1; c < last; c++) {
+            if (h->order[c].priority < h->order[min].priority) min = c;
+        }
+        if (h->order[min].priority >= e.priority) break;
+        h->order[i] = h->order[min];
+        h->pos[h->order[i].id] = i;
+        i = min;
+    }
+    h->order[i] = e;
+    h->pos[e.id] = i;
+}
+
+// Takes order[i] out of the heap and frees its id
+static void* remove_at(come_heap_t* h, uint32_t i) {
+    uint32_t id = h->order[i].id;
+    come_heap_entry_t last = h->order[--h->count];
+    if (i < h->count) {
+        if (i > 0 && last.priority < h->order[(i - 1) / ARITY].priority) sift_up(h, i, last);
+        else sift_down(h, i, last);
+    }
+    h->gen[id]++;
+    h->pos[id] = h->free_id;
+    h->free_id = id;
+    return VALUE(h, id);
+}
+
+static bool live(const come_heap_t* h, int64_t handle, uint32_t* id) {
+    if (!h || handle < 0) return false;
+    *id = (uint32_t)handle;
+    return *id < h->next_id && (h->gen[*id] & GEN_MASK) == (uint64_t)handle >> 32 && (h->gen[*id] & 1);
+}
+
+come_heap_t* come_heap_new(TALLOC_CTX* ctx, uint32_t elem_size, uint32_t n) {
+    come_heap_t* h = mem_talloc_alloc(ctx, sizeof(come_heap_t));
+    if (!h) return NULL;
+    memset(h, 0, sizeof(*h));
+    h->elem_size = elem_size;
+    h->free_id = NO_ID;
+    if (n && !grow(h, n)) {
+        mem_talloc_free(h);
+        return NULL;
+    }
+    return h;
+}
+
+bool come_heap_reserve(come_heap_t* h, uint32_t n) {
+    if (!h) return false;
+    return n <= h->cap || grow(h, n);
+}
+
+void come_heap_clear(come_heap_t* h) {
+    if (!h) return;
+    // Bump the generation of every queued id so old handles go stale
+    while (h->count) remove_at(h, h->count - 1);
+}
+
+void* come_heap_push_slot(come_heap_t* h, int64_t priority, int64_t* handle) {
+    *handle = -1;
+    if (!h) return NULL;
+    uint32_t id = h->free_id;
+    if (id != NO_ID) {
+        h->free_id = h->pos[id];
+    } else {
+        if (h->next_id == h->cap && !grow(h, h->cap + 1)) return NULL;
+        id = h->next_id++;
+        h->gen[id] = 0;
+    }
+    h->gen[id]++;
+    h->count++;
+    sift_up(h, h->count - 1, (come_heap_entry_t){priority, id});
+    *handle = HANDLE(h, id);
+    return VALUE(h, id);
+}
+
+void* come_heap_take(come_heap_t* h) {
+    if (!h || !h->count) return NULL;
+    return remove_at(h, 0);
+}
+
+bool come_heap_decrease_key(come_heap_t* h, int64_t handle, int64_t priority) {
+    uint32_t id;
+    if (!live(h, handle, &id)) return false;
+    uint32_t i = h->pos[id];
+    if (priority < h->order[i].priority) sift_up(h, i, (come_heap_entry_t){priority, id});
+    return true;
+}
+
+bool come_heap_remove(come_heap_t* h, int64_t handle) {
+    uint32_t id;
+    if (!live(h, handle, &id)) return false;
+    remove_at(h, h->pos[id]);
+    return true;
+}
+
+void* come_heap_value(const come_heap_t* h, int64_t handle) {
+    uint32_t id;
+    return live(h, handle, &id) ? VALUE(h, id) : NULL;
+}
+
+int64_t come_heap_priority(const come_heap_t* h, int64_t handle) {
+    uint32_t id;
+    return live(h, handle, &id) ? h->order[h->pos[id]].priority : INT64_MAX;
+}
@@ -0,0 +1,146 @@
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "come_queue.h"
+#include "mem/talloc.h"
+
+// Ring buffers
+// Positions only grow (modulo 2^32), so tail - head is the unread size even after the
+// counters wrap, and a full buffer is told from an empty one without a spare byte.
+
+#define MIN_CAP 16
+#define MAX_CAP (UINT32_C(1) << 31)
+
+#define OFFSET(rb, pos) ((pos) & ((rb)->cap - 1))
+
+come_ringbuf_t* come_ringbuf_new(TALLOC_CTX* ctx, uint32_t capacity) {
+    if (capacity > MAX_CAP) {
+        errno = EINVAL;
+        return NULL;
+    }
+    uint32_t cap = MIN_CAP;
+    while (cap < capacity) cap *= 2;
+    come_ringbuf_t* rb = mem_talloc_alloc(ctx, sizeof(come_ringbuf_t));
+    if (!rb) return NULL;
+    memset(rb, 0, sizeof(*rb));
+    rb->data = mem_talloc_alloc(rb, cap);
+    if (!rb->data) {
+        mem_talloc_free(rb);
+        return NULL;
+    }
+    rb->cap = cap;
+    return rb;
+}
+
+void come_ringbuf_clear(come_ringbuf_t* rb) {
+    if (rb) rb->head = rb->tail = 0;
+}
+
+// The free space (write) or the unread bytes (read) as up to two regions: the first runs
+// from the position to the end of the buffer or the end of the span, the second wraps to
+// the start. Returns the number of regions
+static int regions(const come_ringbuf_t* rb, bool write, struct iovec iov[2]) {
+    uint32_t pos = write ? rb->tail : rb->head;
+    uint32_t span = write ? come_ringbuf_space(rb) : come_ringbuf_size(rb);
+    uint32_t off = OFFSET(rb, pos);
+    uint32_t first = rb->cap - off < span ? rb->cap - off : span;
+    iov[0] = (struct iovec){rb->data + off, first};
+    iov[1] = (struct iovec){rb->data, span - first};
+    return span == 0 ? 0 : span > first ? 2 : 1;
+}
+
+come_byte_array_view_t come_ringbuf_write_region(come_ringbuf_t* rb) {
+    come_byte_array_view_t v = {NULL, 0, NULL};
+    struct iovec iov[2];
+    if (rb && regions(rb, true, iov)) {
+        v.items = iov[0].iov_base;
+        v.count = (uint32_t)iov[0].iov_len;
+    }
+    return v;
+}
+
+come_byte_array_view_t come_ringbuf_read_region(const come_ringbuf_t* rb) {
+    come_byte_array_view_t v = {NULL, 0, NULL};
+    struct iovec iov[2];
+    if (rb && regions(rb, false, iov)) {
+        v.items = iov[0].iov_base;
+        v.count = (uint32_t)iov[0].iov_len;
+    }
+    return v;
+}
+
+void come_ringbuf_commit(come_ringbuf_t* rb, uint32_t n) {
+    if (!rb) return;
+    uint32_t space = come_ringbuf_space(rb);
+    rb->tail += n < space ? n : space;
+}
+
+void come_ringbuf_consume(come_ringbuf_t* rb, uint32_t n) {
+    if (!rb) return;
+    uint32_t size = come_ringbuf_size(rb);
+    rb->head += n < size ? n : size;
+    // Empty: start over at offset 0 so the next write region is the whole buffer
+    if (rb->head == rb->tail) rb->head = rb->tail = 0;
+}
+
+uint32_t come_ringbuf_write(come_ringbuf_t* rb, come_byte_array_view_t src) {
+    if (!rb || !src.count) return 0;
+    struct iovec iov[2];
+    int k = regions(rb, true, iov);
+    uint32_t done = 0;
+    for (int i = 0; i < k && done < src.count; i++) {
+        size_t n = src.count - done < iov[i].iov_len ? src.count - done : iov[i].iov_len;
+        memcpy(iov[i].iov_base, src.items + done, n);
+        done += (uint32_t)n;
+    }
+    rb->tail += done;
+    return done;
+}
+
+uint32_t come_ringbuf_read(come_ringbuf_t* rb, come_byte_array_view_t dst) {
+    if (!rb || !dst.count) return 0;
+    struct iovec iov[2];
+    int k = regions(rb, false, iov);
+    uint32_t done = 0;
+    for (int i = 0; i < k && done < dst.count; i++) {
+        size_t n = dst.count - done < iov[i].iov_len ? dst.count - done : iov[i].iov_len;
+        memcpy(dst.items + done, iov[i].iov_base, n);
+        done += (uint32_t)n;
+    }
+    come_ringbuf_consume(rb, done);
+    return done;
+}
+
+ssize_t come_ringbuf_recv(come_ringbuf_t* rb, int fd, int flags) {
+    if (!rb) {
+        errno = EINVAL;
+        return -1;
+    }
+    struct msghdr msg = {0};
+    struct iovec iov[2];
+    msg.msg_iov = iov;
+    msg.msg_iovlen = regions(rb, true, iov);
+    if (msg.msg_iovlen == 0) {
+        errno = ENOBUFS;
+        return -1;
+    }
+    ssize_t n = recvmsg(fd, &msg, flags);
+    if (n > 0) rb->tail += (uint32_t)n;
+    return n;
+}
+
+ssize_t come_ringbuf_send(come_ringbuf_t* rb, int fd, int flags) {
+    if (!rb) {
+        errno = EINVAL;
+        return -1;
+    }
+    struct msghdr msg = {0};
+    struct iovec iov[2];
+    msg.msg_iov = iov;
+    msg.msg_iovlen = regions(rb, false, iov);
+    if (msg.msg_iovlen == 0) return 0;
+    ssize_t n = sendmsg(fd, &msg, flags);
+    if (n > 0) come_ringbuf_consume(rb, (uint32_t)n);
+    return n;
+}
@@ -82,8 +82,6 @@ static char* come_convert_format(const char* fmt) {
 // Helper to extract C string from come_string_t
 static const char* come_string_to_cstr(come_string_t* s) {
     if (!s) return "(null)";
-    // come_string_t has: uint32_t size, uint32_t count, char data[]
-    // Offset past the header to get to the char array
     return (const char*)&s->data[0];
 }
 
@@ -212,6 +210,30 @@ int come_std__FILE__printf(come_std__FILE_t* self, const char* fmt, ...) {
     return ret;
 }
 
+// in/out/err work before FILE.init() has run
+static FILE* come_std_stream(come_std__FILE_t* self) {
+    if (!self) return NULL;
+    if (self->fp) return self->fp;
+    if (self == &std_in) return stdin;
+    if (self == &std_out) return stdout;
+    if (self == &std_err) return stderr;
+    return NULL;
+}
+
+// Read/write up to n bytes straight from/into the buffer, a byte[] or a byte view (writes
+// into a view land in its parent array). Returns the number of bytes transferred.
+uint32_t come_std__FILE__read(come_std__FILE_t* self, come_byte_array_view_t buf, uint32_t n) {
+    FILE* fp = come_std_stream(self);
+    if (!fp || !buf.count) return 0;
+    return (uint32_t)fread(buf.items, 1, n < buf.count ? n : buf.count, fp);
+}
+
+uint32_t come_std__FILE__write(come_std__FILE_t* self, come_byte_array_view_t buf, uint32_t n) {
+    FILE* fp = come_std_stream(self);
+    if (!fp || !buf.count) return 0;
+    return (uint32_t)fwrite(buf.items, 1, n < buf.count ? n : buf.count, fp);
+}
+
 // Just stubs for now to get it compiling/linking
 bool come_std__FILE__fdopen(come_std__FILE_t* self, int fd, char* mode) { return false; }
 bool come_std__FILE__reopen(come_std__FILE_t* self, char* path, char* mode) { return false; }
@@ -219,8 +241,6 @@ int come_std__FILE__fileno(come_std__FILE_t* self) { return 0; }
 int come_std__FILE__scanf(come_std__FILE_t* self, char* fmt, ...) { return 0; }
 int come_std__FILE__vprintf(come_std__FILE_t* self, char* fmt, va_list ap) { return 0; }
 int come_std__FILE__vscanf(come_std__FILE_t* self, char* fmt, va_list ap) { return 0; }
-uint32_t come_std__FILE__read(come_std__FILE_t* self, uint8_t* buf, uint32_t n) { return 0; } // uint -> uint32_t
-uint32_t come_std__FILE__write(come_std__FILE_t* self, uint8_t* buf, uint32_t n) { return 0; }
 int32_t come_std__FILE__getc(come_std__FILE_t* self) { return 0; }
 void come_std__FILE__putc(come_std__FILE_t* self, int32_t c) { }
 char* come_std__FILE__gets(come_std__FILE_t* self) { return NULL; } // string -> char*
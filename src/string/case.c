@@ -0,0 +1,469 @@
+#include "come_string.h"
+#include <string.h>
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#include <immintrin.h>
+#define COME_CASE_X86 1
+#endif
+
+// Case mapping
+// Nothing here consults the C locale. ASCII letters are flipped with SIMD (SSE2, or AVX2
+// when the CPU has it) and a SWAR fallback; other code points go through the Unicode simple
+// case mappings below, so every code point maps to exactly one code point.
+
+// Ranges of code points >= 0x80 that map to cp + delta. With stride 2 only every other code
+// point in the range maps (upper/lower pairs that alternate, as in Latin Extended-A).
+// Generated from Unicode 14.0: simple upper/lower mappings, and for folding the simple case
+// folding (full folding where it is a single code point, lowercase otherwise).
+typedef struct {
+    uint32_t lo;
+    uint16_t span;
+    uint8_t stride;
+    int32_t delta;
+} case_range_t;
+
+static const case_range_t case_upper[] = {
+    { 0x00B5, 0, 1, 743 }, { 0x00E0, 22, 1, -32 }, { 0x00F8, 6, 1, -32 }, { 0x00FF, 0, 1, 121 },
+    { 0x0101, 46, 2, -1 }, { 0x0131, 0, 1, -232 }, { 0x0133, 4, 2, -1 }, { 0x013A, 14, 2, -1 },
+    { 0x014B, 44, 2, -1 }, { 0x017A, 4, 2, -1 }, { 0x017F, 0, 1, -300 }, { 0x0180, 0, 1, 195 },
+    { 0x0183, 2, 2, -1 }, { 0x0188, 0, 1, -1 }, { 0x018C, 0, 1, -1 }, { 0x0192, 0, 1, -1 },
+    { 0x0195, 0, 1, 97 }, { 0x0199, 0, 1, -1 }, { 0x019A, 0, 1, 163 }, { 0x019E, 0, 1, 130 },
+    { 0x01A1, 4, 2, -1 }, { 0x01A8, 0, 1, -1 }, { 0x01AD, 0, 1, -1 }, { 0x01B0, 0, 1, -1 },
+    { 0x01B4, 2, 2, -1 }, { 0x01B9, 0, 1, -1 }, { 0x01BD, 0, 1, -1 }, { 0x01BF, 0, 1, 56 },
+    { 0x01C5, 0, 1, -1 }, { 0x01C6, 0, 1, -2 }, { 0x01C8, 0, 1, -1 }, { 0x01C9, 0, 1, -2 },
+    { 0x01CB, 0, 1, -1 }, { 0x01CC, 0, 1, -2 }, { 0x01CE, 14, 2, -1 }, { 0x01DD, 0, 1, -79 },
+    { 0x01DF, 16, 2, -1 }, { 0x01F2, 0, 1, -1 }, { 0x01F3, 0, 1, -2 }, { 0x01F5, 0, 1, -1 },
+    { 0x01F9, 38, 2, -1 }, { 0x0223, 16, 2, -1 }, { 0x023C, 0, 1, -1 }, { 0x023F, 1, 1, 10815 },
+    { 0x0242, 0, 1, -1 }, { 0x0247, 8, 2, -1 }, { 0x0250, 0, 1, 10783 }, { 0x0251, 0, 1, 10780 },
+    { 0x0252, 0, 1, 10782 }, { 0x0253, 0, 1, -210 }, { 0x0254, 0, 1, -206 }, { 0x0256, 1, 1, -205 },
+    { 0x0259, 0, 1, -202 }, { 0x025B, 0, 1, -203 }, { 0x025C, 0, 1, 42319 }, { 0x0260, 0, 1, -205 },
+    { 0x0261, 0, 1, 42315 }, { 0x0263, 0, 1, -207 }, { 0x0265, 0, 1, 42280 },
+    { 0x0266, 0, 1, 42308 }, { 0x0268, 0, 1, -209 }, { 0x0269, 0, 1, -211 },
+    { 0x026A, 0, 1, 42308 }, { 0x026B, 0, 1, 10743 }, { 0x026C, 0, 1, 42305 },
+    { 0x026F, 0, 1, -211 }, { 0x0271, 0, 1, 10749 }, { 0x0272, 0, 1, -213 }, { 0x0275, 0, 1, -214 },
+    { 0x027D, 0, 1, 10727 }, { 0x0280, 0, 1, -218 }, { 0x0282, 0, 1, 42307 },
+    { 0x0283, 0, 1, -218 }, { 0x0287, 0, 1, 42282 }, { 0x0288, 0, 1, -218 }, { 0x0289, 0, 1, -69 },
+    { 0x028A, 1, 1, -217 }, { 0x028C, 0, 1, -71 }, { 0x0292, 0, 1, -219 }, { 0x029D, 0, 1, 42261 },
+    { 0x029E, 0, 1, 42258 }, { 0x0345, 0, 1, 84 }, { 0x0371, 2, 2, -1 }, { 0x0377, 0, 1, -1 },
+    { 0x037B, 2, 1, 130 }, { 0x03AC, 0, 1, -38 }, { 0x03AD, 2, 1, -37 }, { 0x03B1, 16, 1, -32 },
+    { 0x03C2, 0, 1, -31 }, { 0x03C3, 8, 1, -32 }, { 0x03CC, 0, 1, -64 }, { 0x03CD, 1, 1, -63 },
+    { 0x03D0, 0, 1, -62 }, { 0x03D1, 0, 1, -57 }, { 0x03D5, 0, 1, -47 }, { 0x03D6, 0, 1, -54 },
+    { 0x03D7, 0, 1, -8 }, { 0x03D9, 22, 2, -1 }, { 0x03F0, 0, 1, -86 }, { 0x03F1, 0, 1, -80 },
+    { 0x03F2, 0, 1, 7 }, { 0x03F3, 0, 1, -116 }, { 0x03F5, 0, 1, -96 }, { 0x03F8, 0, 1, -1 },
+    { 0x03FB, 0, 1, -1 }, { 0x0430, 31, 1, -32 }, { 0x0450, 15, 1, -80 }, { 0x0461, 32, 2, -1 },
+    { 0x048B, 52, 2, -1 }, { 0x04C2, 12, 2, -1 }, { 0x04CF, 0, 1, -15 }, { 0x04D1, 94, 2, -1 },
+    { 0x0561, 37, 1, -48 }, { 0x10D0, 42, 1, 3008 }, { 0x10FD, 2, 1, 3008 }, { 0x13F8, 5, 1, -8 },
+    { 0x1C80, 0, 1, -6254 }, { 0x1C81, 0, 1, -6253 }, { 0x1C82, 0, 1, -6244 },
+    { 0x1C83, 1, 1, -6242 }, { 0x1C85, 0, 1, -6243 }, { 0x1C86, 0, 1, -6236 },
+    { 0x1C87, 0, 1, -6181 }, { 0x1C88, 0, 1, 35266 }, { 0x1D79, 0, 1, 35332 },
+    { 0x1D7D, 0, 1, 3814 }, { 0x1D8E, 0, 1, 35384 }, { 0x1E01, 148, 2, -1 }, { 0x1E9B, 0, 1, -59 },
+    { 0x1EA1, 94, 2, -1 }, { 0x1F00, 7, 1, 8 }, { 0x1F10, 5, 1, 8 }, { 0x1F20, 7, 1, 8 },
+    { 0x1F30, 7, 1, 8 }, { 0x1F40, 5, 1, 8 }, { 0x1F51, 6, 2, 8 }, { 0x1F60, 7, 1, 8 },
+    { 0x1F70, 1, 1, 74 }, { 0x1F72, 3, 1, 86 }, { 0x1F76, 1, 1, 100 }, { 0x1F78, 1, 1, 128 },
+    { 0x1F7A, 1, 1, 112 }, { 0x1F7C, 1, 1, 126 }, { 0x1FB0, 1, 1, 8 }, { 0x1FBE, 0, 1, -7205 },
+    { 0x1FD0, 1, 1, 8 }, { 0x1FE0, 1, 1, 8 }, { 0x1FE5, 0, 1, 7 }, { 0x214E, 0, 1, -28 },
+    { 0x2170, 15, 1, -16 }, { 0x2184, 0, 1, -1 }, { 0x24D0, 25, 1, -26 }, { 0x2C30, 47, 1, -48 },
+    { 0x2C61, 0, 1, -1 }, { 0x2C65, 0, 1, -10795 }, { 0x2C66, 0, 1, -10792 }, { 0x2C68, 4, 2, -1 },
+    { 0x2C73, 0, 1, -1 }, { 0x2C76, 0, 1, -1 }, { 0x2C81, 98, 2, -1 }, { 0x2CEC, 2, 2, -1 },
+    { 0x2CF3, 0, 1, -1 }, { 0x2D00, 37, 1, -7264 }, { 0x2D27, 0, 1, -7264 },
+    { 0x2D2D, 0, 1, -7264 }, { 0xA641, 44, 2, -1 }, { 0xA681, 26, 2, -1 }, { 0xA723, 12, 2, -1 },
+    { 0xA733, 60, 2, -1 }, { 0xA77A, 2, 2, -1 }, { 0xA77F, 8, 2, -1 }, { 0xA78C, 0, 1, -1 },
+    { 0xA791, 2, 2, -1 }, { 0xA794, 0, 1, 48 }, { 0xA797, 18, 2, -1 }, { 0xA7B5, 14, 2, -1 },
+    { 0xA7C8, 2, 2, -1 }, { 0xA7D1, 0, 1, -1 }, { 0xA7D7, 2, 2, -1 }, { 0xA7F6, 0, 1, -1 },
+    { 0xAB53, 0, 1, -928 }, { 0xAB70, 79, 1, -38864 }, { 0xFF41, 25, 1, -32 },
+    { 0x10428, 39, 1, -40 }, { 0x104D8, 35, 1, -40 }, { 0x10597, 10, 1, -39 },
+    { 0x105A3, 14, 1, -39 }, { 0x105B3, 6, 1, -39 }, { 0x105BB, 1, 1, -39 },
+    { 0x10CC0, 50, 1, -64 }, { 0x118C0, 31, 1, -32 }, { 0x16E60, 31, 1, -32 },
+    { 0x1E922, 33, 1, -34 },
+};
+
+static const case_range_t case_lower[] = {
+    { 0x00C0, 22, 1, 32 }, { 0x00D8, 6, 1, 32 }, { 0x0100, 46, 2, 1 }, { 0x0132, 4, 2, 1 },
+    { 0x0139, 14, 2, 1 }, { 0x014A, 44, 2, 1 }, { 0x0178, 0, 1, -121 }, { 0x0179, 4, 2, 1 },
+    { 0x0181, 0, 1, 210 }, { 0x0182, 2, 2, 1 }, { 0x0186, 0, 1, 206 }, { 0x0187, 0, 1, 1 },
+    { 0x0189, 1, 1, 205 }, { 0x018B, 0, 1, 1 }, { 0x018E, 0, 1, 79 }, { 0x018F, 0, 1, 202 },
+    { 0x0190, 0, 1, 203 }, { 0x0191, 0, 1, 1 }, { 0x0193, 0, 1, 205 }, { 0x0194, 0, 1, 207 },
+    { 0x0196, 0, 1, 211 }, { 0x0197, 0, 1, 209 }, { 0x0198, 0, 1, 1 }, { 0x019C, 0, 1, 211 },
+    { 0x019D, 0, 1, 213 }, { 0x019F, 0, 1, 214 }, { 0x01A0, 4, 2, 1 }, { 0x01A6, 0, 1, 218 },
+    { 0x01A7, 0, 1, 1 }, { 0x01A9, 0, 1, 218 }, { 0x01AC, 0, 1, 1 }, { 0x01AE, 0, 1, 218 },
+    { 0x01AF, 0, 1, 1 }, { 0x01B1, 1, 1, 217 }, { 0x01B3, 2, 2, 1 }, { 0x01B7, 0, 1, 219 },
+    { 0x01B8, 0, 1, 1 }, { 0x01BC, 0, 1, 1 }, { 0x01C4, 0, 1, 2 }, { 0x01C5, 0, 1, 1 },
+    { 0x01C7, 0, 1, 2 }, { 0x01C8, 0, 1, 1 }, { 0x01CA, 0, 1, 2 }, { 0x01CB, 16, 2, 1 },
+    { 0x01DE, 16, 2, 1 }, { 0x01F1, 0, 1, 2 }, { 0x01F2, 2, 2, 1 }, { 0x01F6, 0, 1, -97 },
+    { 0x01F7, 0, 1, -56 }, { 0x01F8, 38, 2, 1 }, { 0x0220, 0, 1, -130 }, { 0x0222, 16, 2, 1 },
+    { 0x023A, 0, 1, 10795 }, { 0x023B, 0, 1, 1 }, { 0x023D, 0, 1, -163 }, { 0x023E, 0, 1, 10792 },
+    { 0x0241, 0, 1, 1 }, { 0x0243, 0, 1, -195 }, { 0x0244, 0, 1, 69 }, { 0x0245, 0, 1, 71 },
+    { 0x0246, 8, 2, 1 }, { 0x0370, 2, 2, 1 }, { 0x0376, 0, 1, 1 }, { 0x037F, 0, 1, 116 },
+    { 0x0386, 0, 1, 38 }, { 0x0388, 2, 1, 37 }, { 0x038C, 0, 1, 64 }, { 0x038E, 1, 1, 63 },
+    { 0x0391, 16, 1, 32 }, { 0x03A3, 8, 1, 32 }, { 0x03CF, 0, 1, 8 }, { 0x03D8, 22, 2, 1 },
+    { 0x03F4, 0, 1, -60 }, { 0x03F7, 0, 1, 1 }, { 0x03F9, 0, 1, -7 }, { 0x03FA, 0, 1, 1 },
+    { 0x03FD, 2, 1, -130 }, { 0x0400, 15, 1, 80 }, { 0x0410, 31, 1, 32 }, { 0x0460, 32, 2, 1 },
+    { 0x048A, 52, 2, 1 }, { 0x04C0, 0, 1, 15 }, { 0x04C1, 12, 2, 1 }, { 0x04D0, 94, 2, 1 },
+    { 0x0531, 37, 1, 48 }, { 0x10A0, 37, 1, 7264 }, { 0x10C7, 0, 1, 7264 }, { 0x10CD, 0, 1, 7264 },
+    { 0x13A0, 79, 1, 38864 }, { 0x13F0, 5, 1, 8 }, { 0x1C90, 42, 1, -3008 },
+    { 0x1CBD, 2, 1, -3008 }, { 0x1E00, 148, 2, 1 }, { 0x1E9E, 0, 1, -7615 }, { 0x1EA0, 94, 2, 1 },
+    { 0x1F08, 7, 1, -8 }, { 0x1F18, 5, 1, -8 }, { 0x1F28, 7, 1, -8 }, { 0x1F38, 7, 1, -8 },
+    { 0x1F48, 5, 1, -8 }, { 0x1F59, 6, 2, -8 }, { 0x1F68, 7, 1, -8 }, { 0x1F88, 7, 1, -8 },
+    { 0x1F98, 7, 1, -8 }, { 0x1FA8, 7, 1, -8 }, { 0x1FB8, 1, 1, -8 }, { 0x1FBA, 1, 1, -74 },
+    { 0x1FBC, 0, 1, -9 }, { 0x1FC8, 3, 1, -86 }, { 0x1FCC, 0, 1, -9 }, { 0x1FD8, 1, 1, -8 },
+    { 0x1FDA, 1, 1, -100 }, { 0x1FE8, 1, 1, -8 }, { 0x1FEA, 1, 1, -112 }, { 0x1FEC, 0, 1, -7 },
+    { 0x1FF8, 1, 1, -128 }, { 0x1FFA, 1, 1, -126 }, { 0x1FFC, 0, 1, -9 }, { 0x2126, 0, 1, -7517 },
+    { 0x212A, 0, 1, -8383 }, { 0x212B, 0, 1, -8262 }, { 0x2132, 0, 1, 28 }, { 0x2160, 15, 1, 16 },
+    { 0x2183, 0, 1, 1 }, { 0x24B6, 25, 1, 26 }, { 0x2C00, 47, 1, 48 }, { 0x2C60, 0, 1, 1 },
+    { 0x2C62, 0, 1, -10743 }, { 0x2C63, 0, 1, -3814 }, { 0x2C64, 0, 1, -10727 },
+    { 0x2C67, 4, 2, 1 }, { 0x2C6D, 0, 1, -10780 }, { 0x2C6E, 0, 1, -10749 },
+    { 0x2C6F, 0, 1, -10783 }, { 0x2C70, 0, 1, -10782 }, { 0x2C72, 0, 1, 1 }, { 0x2C75, 0, 1, 1 },
+    { 0x2C7E, 1, 1, -10815 }, { 0x2C80, 98, 2, 1 }, { 0x2CEB, 2, 2, 1 }, { 0x2CF2, 0, 1, 1 },
+    { 0xA640, 44, 2, 1 }, { 0xA680, 26, 2, 1 }, { 0xA722, 12, 2, 1 }, { 0xA732, 60, 2, 1 },
+    { 0xA779, 2, 2, 1 }, { 0xA77D, 0, 1, -35332 }, { 0xA77E, 8, 2, 1 }, { 0xA78B, 0, 1, 1 },
+    { 0xA78D, 0, 1, -42280 }, { 0xA790, 2, 2, 1 }, { 0xA796, 18, 2, 1 }, { 0xA7AA, 0, 1, -42308 },
+    { 0xA7AB, 0, 1, -42319 }, { 0xA7AC, 0, 1, -42315 }, { 0xA7AD, 0, 1, -42305 },
+    { 0xA7AE, 0, 1, -42308 }, { 0xA7B0, 0, 1, -42258 }, { 0xA7B1, 0, 1, -42282 },
+    { 0xA7B2, 0, 1, -42261 }, { 0xA7B3, 0, 1, 928 }, { 0xA7B4, 14, 2, 1 }, { 0xA7C4, 0, 1, -48 },
+    { 0xA7C5, 0, 1, -42307 }, { 0xA7C6, 0, 1, -35384 }, { 0xA7C7, 2, 2, 1 }, { 0xA7D0, 0, 1, 1 },
+    { 0xA7D6, 2, 2, 1 }, { 0xA7F5, 0, 1, 1 }, { 0xFF21, 25, 1, 32 }, { 0x10400, 39, 1, 40 },
+    { 0x104B0, 35, 1, 40 }, { 0x10570, 10, 1, 39 }, { 0x1057C, 14, 1, 39 }, { 0x1058C, 6, 1, 39 },
+    { 0x10594, 1, 1, 39 }, { 0x10C80, 50, 1, 64 }, { 0x118A0, 31, 1, 32 }, { 0x16E40, 31, 1, 32 },
+    { 0x1E900, 33, 1, 34 },
+};
+
+static const case_range_t case_fold[] = {
+    { 0x00B5, 0, 1, 775 }, { 0x00C0, 22, 1, 32 }, { 0x00D8, 6, 1, 32 }, { 0x0100, 46, 2, 1 },
+    { 0x0132, 4, 2, 1 }, { 0x0139, 14, 2, 1 }, { 0x014A, 44, 2, 1 }, { 0x0178, 0, 1, -121 },
+    { 0x0179, 4, 2, 1 }, { 0x017F, 0, 1, -268 }, { 0x0181, 0, 1, 210 }, { 0x0182, 2, 2, 1 },
+    { 0x0186, 0, 1, 206 }, { 0x0187, 0, 1, 1 }, { 0x0189, 1, 1, 205 }, { 0x018B, 0, 1, 1 },
+    { 0x018E, 0, 1, 79 }, { 0x018F, 0, 1, 202 }, { 0x0190, 0, 1, 203 }, { 0x0191, 0, 1, 1 },
+    { 0x0193, 0, 1, 205 }, { 0x0194, 0, 1, 207 }, { 0x0196, 0, 1, 211 }, { 0x0197, 0, 1, 209 },
+    { 0x0198, 0, 1, 1 }, { 0x019C, 0, 1, 211 }, { 0x019D, 0, 1, 213 }, { 0x019F, 0, 1, 214 },
+    { 0x01A0, 4, 2, 1 }, { 0x01A6, 0, 1, 218 }, { 0x01A7, 0, 1, 1 }, { 0x01A9, 0, 1, 218 },
+    { 0x01AC, 0, 1, 1 }, { 0x01AE, 0, 1, 218 }, { 0x01AF, 0, 1, 1 }, { 0x01B1, 1, 1, 217 },
+    { 0x01B3, 2, 2, 1 }, { 0x01B7, 0, 1, 219 }, { 0x01B8, 0, 1, 1 }, { 0x01BC, 0, 1, 1 },
+    { 0x01C4, 0, 1, 2 }, { 0x01C5, 0, 1, 1 }, { 0x01C7, 0, 1, 2 }, { 0x01C8, 0, 1, 1 },
+    { 0x01CA, 0, 1, 2 }, { 0x01CB, 16, 2, 1 }, { 0x01DE, 16, 2, 1 }, { 0x01F1, 0, 1, 2 },
+    { 0x01F2, 2, 2, 1 }, { 0x01F6, 0, 1, -97 }, { 0x01F7, 0, 1, -56 }, { 0x01F8, 38, 2, 1 },
+    { 0x0220, 0, 1, -130 }, { 0x0222, 16, 2, 1 }, { 0x023A, 0, 1, 10795 }, { 0x023B, 0, 1, 1 },
+    { 0x023D, 0, 1, -163 }, { 0x023E, 0, 1, 10792 }, { 0x0241, 0, 1, 1 }, { 0x0243, 0, 1, -195 },
+    { 0x0244, 0, 1, 69 }, { 0x0245, 0, 1, 71 }, { 0x0246, 8, 2, 1 }, { 0x0345, 0, 1, 116 },
+    { 0x0370, 2, 2, 1 }, { 0x0376, 0, 1, 1 }, { 0x037F, 0, 1, 116 }, { 0x0386, 0, 1, 38 },
+    { 0x0388, 2, 1, 37 }, { 0x038C, 0, 1, 64 }, { 0x038E, 1, 1, 63 }, { 0x0391, 16, 1, 32 },
+    { 0x03A3, 8, 1, 32 }, { 0x03C2, 0, 1, 1 }, { 0x03CF, 0, 1, 8 }, { 0x03D0, 0, 1, -30 },
+    { 0x03D1, 0, 1, -25 }, { 0x03D5, 0, 1, -15 }, { 0x03D6, 0, 1, -22 }, { 0x03D8, 22, 2, 1 },
+    { 0x03F0, 0, 1, -54 }, { 0x03F1, 0, 1, -48 }, { 0x03F4, 0, 1, -60 }, { 0x03F5, 0, 1, -64 },
+    { 0x03F7, 0, 1, 1 }, { 0x03F9, 0, 1, -7 }, { 0x03FA, 0, 1, 1 }, { 0x03FD, 2, 1, -130 },
+    { 0x0400, 15, 1, 80 }, { 0x0410, 31, 1, 32 }, { 0x0460, 32, 2, 1 }, { 0x048A, 52, 2, 1 },
+    { 0x04C0, 0, 1, 15 }, { 0x04C1, 12, 2, 1 }, { 0x04D0, 94, 2, 1 }, { 0x0531, 37, 1, 48 },
+    { 0x10A0, 37, 1, 7264 }, { 0x10C7, 0, 1, 7264 }, { 0x10CD, 0, 1, 7264 }, { 0x13F8, 5, 1, -8 },
+    { 0x1C80, 0, 1, -6222 }, { 0x1C81, 0, 1, -6221 }, { 0x1C82, 0, 1, -6212 },
+    { 0x1C83, 1, 1, -6210 }, { 0x1C85, 0, 1, -6211 }, { 0x1C86, 0, 1, -6204 },
+    { 0x1C87, 0, 1, -6180 }, { 0x1C88, 0, 1, 35267 }, { 0x1C90, 42, 1, -3008 },
+    { 0x1CBD, 2, 1, -3008 }, { 0x1E00, 148, 2, 1 }, { 0x1E9B, 0, 1, -58 }, { 0x1E9E, 0, 1, -7615 },
+    { 0x1EA0, 94, 2, 1 }, { 0x1F08, 7, 1, -8 }, { 0x1F18, 5, 1, -8 }, { 0x1F28, 7, 1, -8 },
+    { 0x1F38, 7, 1, -8 }, { 0x1F48, 5, 1, -8 }, { 0x1F59, 6, 2, -8 }, { 0x1F68, 7, 1, -8 },
+    { 0x1F88, 7, 1, -8 }, { 0x1F98, 7, 1, -8 }, { 0x1FA8, 7, 1, -8 }, { 0x1FB8, 1, 1, -8 },
+    { 0x1FBA, 1, 1, -74 }, { 0x1FBC, 0, 1, -9 }, { 0x1FBE, 0, 1, -7173 }, { 0x1FC8, 3, 1, -86 },
+    { 0x1FCC, 0, 1, -9 }, { 0x1FD8, 1, 1, -8 }, { 0x1FDA, 1, 1, -100 }, { 0x1FE8, 1, 1, -8 },
+    { 0x1FEA, 1, 1, -112 }, { 0x1FEC, 0, 1, -7 }, { 0x1FF8, 1, 1, -128 }, { 0x1FFA, 1, 1, -126 },
+    { 0x1FFC, 0, 1, -9 }, { 0x2126, 0, 1, -7517 }, { 0x212A, 0, 1, -8383 }, { 0x212B, 0, 1, -8262 },
+    { 0x2132, 0, 1, 28 }, { 0x2160, 15, 1, 16 }, { 0x2183, 0, 1, 1 }, { 0x24B6, 25, 1, 26 },
+    { 0x2C00, 47, 1, 48 }, { 0x2C60, 0, 1, 1 }, { 0x2C62, 0, 1, -10743 }, { 0x2C63, 0, 1, -3814 },
+    { 0x2C64, 0, 1, -10727 }, { 0x2C67, 4, 2, 1 }, { 0x2C6D, 0, 1, -10780 },
+    { 0x2C6E, 0, 1, -10749 }, { 0x2C6F, 0, 1, -10783 }, { 0x2C70, 0, 1, -10782 },
+    { 0x2C72, 0, 1, 1 }, { 0x2C75, 0, 1, 1 }, { 0x2C7E, 1, 1, -10815 }, { 0x2C80, 98, 2, 1 },
+    { 0x2CEB, 2, 2, 1 }, { 0x2CF2, 0, 1, 1 }, { 0xA640, 44, 2, 1 }, { 0xA680, 26, 2, 1 },
+    { 0xA722, 12, 2, 1 }, { 0xA732, 60, 2, 1 }, { 0xA779, 2, 2, 1 }, { 0xA77D, 0, 1, -35332 },
+    { 0xA77E, 8, 2, 1 }, { 0xA78B, 0, 1, 1 }, { 0xA78D, 0, 1, -42280 }, { 0xA790, 2, 2, 1 },
+    { 0xA796, 18, 2, 1 }, { 0xA7AA, 0, 1, -42308 }, { 0xA7AB, 0, 1, -42319 },
+    { 0xA7AC, 0, 1, -42315 }, { 0xA7AD, 0, 1, -42305 }, { 0xA7AE, 0, 1, -42308 },
+    { 0xA7B0, 0, 1, -42258 }, { 0xA7B1, 0, 1, -42282 }, { 0xA7B2, 0, 1, -42261 },
+    { 0xA7B3, 0, 1, 928 }, { 0xA7B4, 14, 2, 1 }, { 0xA7C4, 0, 1, -48 }, { 0xA7C5, 0, 1, -42307 },
+    { 0xA7C6, 0, 1, -35384 }, { 0xA7C7, 2, 2, 1 }, { 0xA7D0, 0, 1, 1 }, { 0xA7D6, 2, 2, 1 },
+    { 0xA7F5, 0, 1, 1 }, { 0xAB70, 79, 1, -38864 }, { 0xFF21, 25, 1, 32 }, { 0x10400, 39, 1, 40 },
+    { 0x104B0, 35, 1, 40 }, { 0x10570, 10, 1, 39 }, { 0x1057C, 14, 1, 39 }, { 0x1058C, 6, 1, 39 },
+    { 0x10594, 1, 1, 39 }, { 0x10C80, 50, 1, 64 }, { 0x118A0, 31, 1, 32 }, { 0x16E40, 31, 1, 32 },
+    { 0x1E900, 33, 1, 34 },
+};
+
+#define CASE_TABLE_LEN(t) (sizeof(t) / sizeof((t)[0]))
+
+static uint32_t case_map(const case_range_t* t, size_t n, uint32_t cp) {
+    // Last range starting at or below cp
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (t[mid].lo <= cp) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == 0) return cp;
+    const case_range_t* r = &t[lo - 1];
+    uint32_t off = cp - r->lo;
+    if (off > r->span || off % r->stride) return cp;
+    return (uint32_t)((int32_t)cp + r->delta);
+}
+
+static uint32_t case_upper_cp(uint32_t cp) {
+    if (cp < 0x80) return (cp >= 'a' && cp <= 'z') ? cp - 0x20 : cp;
+    return case_map(case_upper, CASE_TABLE_LEN(case_upper), cp);
+}
+
+static uint32_t case_lower_cp(uint32_t cp) {
+    if (cp < 0x80) return (cp >= 'A' && cp <= 'Z') ? cp + 0x20 : cp;
+    return case_map(case_lower, CASE_TABLE_LEN(case_lower), cp);
+}
+
+static uint32_t case_fold_cp(uint32_t cp) {
+    if (cp < 0x80) return (cp >= 'A' && cp <= 'Z') ? cp + 0x20 : cp;
+    return case_map(case_fold, CASE_TABLE_LEN(case_fold), cp);
+}
+
+// ASCII kernels: flip bit 0x20 of every byte in [first, first + 25]. dst may equal src.
+
+#define SWAR_ONES 0x0101010101010101ULL
+
+static inline uint64_t swar_flip_case(uint64_t x, uint8_t first) {
+    // Per byte, bit 7 of ge/gt is set where the low 7 bits are >= first / > first + 25;
+    // ~x drops bytes >= 0x80
+    uint64_t h = x & (0x7F * SWAR_ONES);
+    uint64_t ge = h + (uint64_t)(0x80 - first) * SWAR_ONES;
+    uint64_t gt = h + (uint64_t)(0x80 - first - 26) * SWAR_ONES;
+    uint64_t hit = ge & ~gt & ~x & (0x80 * SWAR_ONES);
+    return x ^ (hit >> 2);
+}
+
+static void ascii_case_scalar(char* dst, const char* src, size_t n, uint8_t first) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t x;
+        memcpy(&x, src + i, 8);
+        x = swar_flip_case(x, first);
+        memcpy(dst + i, &x, 8);
+    }
+    for (; i < n; i++) {
+        uint8_t c = (uint8_t)src[i];
+        dst[i] = (char)((uint8_t)(c - first) < 26 ? c ^ 0x20 : c);
+    }
+}
+
+#ifdef COME_CASE_X86
+
+static void ascii_case_sse2(char* dst, const char* src, size_t n, uint8_t first) {
+    // Signed compares: bytes >= 0x80 are negative and never in range
+    const __m128i below = _mm_set1_epi8((char)(first - 1));
+    const __m128i above = _mm_set1_epi8((char)(first + 26));
+    const __m128i bit = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i hit = _mm_and_si128(_mm_cmpgt_epi8(x, below), _mm_cmpgt_epi8(above, x));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(x, _mm_and_si128(hit, bit)));
+    }
+    ascii_case_scalar(dst + i, src + i, n - i, first);
+}
+
+__attribute__((target("avx2")))
+static void ascii_case_avx2(char* dst, const char* src, size_t n, uint8_t first) {
+    const __m256i below = _mm256_set1_epi8((char)(first - 1));
+    const __m256i above = _mm256_set1_epi8((char)(first + 26));
+    const __m256i bit = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i hit = _mm256_and_si256(_mm256_cmpgt_epi8(x, below), _mm256_cmpgt_epi8(above, x));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_xor_si256(x, _mm256_and_si256(hit, bit)));
+    }
+    ascii_case_sse2(dst + i, src + i, n - i, first);
+}
+
+#endif // COME_CASE_X86
+
+static void (*ascii_case_impl)(char*, const char*, size_t, uint8_t) = NULL;
+
+static void ascii_case(char* dst, const char* src, size_t n, uint8_t first) {
+    if (!ascii_case_impl) {
+        ascii_case_impl = ascii_case_scalar;
+#ifdef COME_CASE_X86
+        ascii_case_impl = ascii_case_sse2;
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) ascii_case_impl = ascii_case_avx2;
+#endif
+    }
+    ascii_case_impl(dst, src, n, first);
+}
+
+// Length of the ASCII run at s[i..n)
+static size_t ascii_run(const char* s, size_t i, size_t n) {
+    size_t j = i;
+    while (j < n && !((uint8_t)s[j] & 0x80)) j++;
+    return j - i;
+}
+
+static come_string_t* case_convert(const come_string_t* a, uint32_t (*map)(uint32_t), uint8_t first) {
+    if (!a) return NULL;
+    if (come_string_isascii(a)) {
+        come_string_t* s = come_string_new_len((void*)a, NULL, a->count);
+        if (!s) return NULL;
+        ascii_case(s->data, a->data, a->count, first);
+        // Same scan results, different bytes
+        s->flags = __atomic_load_n(&a->flags, __ATOMIC_ACQUIRE) & ~COME_STRING_HASHED;
+        s->nchars = __atomic_load_n(&a->nchars, __ATOMIC_RELAXED);
+        return s;
+    }
+
+    // Mapped sequences can change length (U+0250 -> U+2C6F grows, U+0131 -> 'I' shrinks),
+    // so size the result first. Invalid bytes are copied through.
+    char enc[4];
+    size_t out = 0;
+    for (size_t i = 0; i < a->count;) {
+        uint32_t cp;
+        size_t len = come_utf8_decode(a->data + i, a->count - i, &cp);
+        if (len <= 1) { out++; i++; continue; }
+        out += come_utf8_encode(map(cp), enc);
+        i += len;
+    }
+
+    come_string_t* s = come_string_new_len((void*)a, NULL, out);
+    if (!s) return NULL;
+    char* w = s->data;
+    for (size_t i = 0; i < a->count;) {
+        size_t run = ascii_run(a->data, i, a->count);
+        if (run) {
+            ascii_case(w, a->data + i, run, first);
+            w += run;
+            i += run;
+            continue;
+        }
+        uint32_t cp;
+        size_t len = come_utf8_decode(a->data + i, a->count - i, &cp);
+        if (!len) { *w++ = a->data[i++]; continue; }
+        w += come_utf8_encode(map(cp), w);
+        i += len;
+    }
+    return s;
+}
+
+static void case_convert_inplace(come_string_t* a, uint32_t (*map)(uint32_t), uint8_t first) {
+    if (!a) return;
+    // Only same-length replacements, so the cached scan results stay correct
+    a->flags &= ~COME_STRING_HASHED;
+    char enc[4];
+    for (size_t i = 0; i < a->count;) {
+        size_t run = ascii_run(a->data, i, a->count);
+        if (run) {
+            ascii_case(a->data + i, a->data + i, run, first);
+            i += run;
+            continue;
+        }
+        uint32_t cp;
+        size_t len = come_utf8_decode(a->data + i, a->count - i, &cp);
+        if (!len) { i++; continue; }
+        if (come_utf8_encode(map(cp), enc) == len) memcpy(a->data + i, enc, len);
+        i += len;
+    }
+}
+
+come_string_t* come_string_upper(const come_string_t* a) {
+    return case_convert(a, case_upper_cp, 'a');
+}
+
+come_string_t* come_string_lower(const come_string_t* a) {
+    return case_convert(a, case_lower_cp, 'A');
+}
+
+void come_string_upper_inplace(come_string_t* a) {
+    case_convert_inplace(a, case_upper_cp, 'a');
+}
+
+void come_string_lower_inplace(come_string_t* a) {
+    case_convert_inplace(a, case_lower_cp, 'A');
+}
+
+// Folded code point at s[*i], advancing *i. Invalid bytes fold to values above U+10FFFF
+// so they never equal a real character.
+static uint32_t case_fold_next(const come_string_t* s, size_t* i) {
+    uint8_t c = (uint8_t)s->data[*i];
+    if (c < 0x80) {
+        (*i)++;
+        return (c >= 'A' && c <= 'Z') ? c + 0x20u : c;
+    }
+    uint32_t cp;
+    size_t len = come_utf8_decode(s->data + *i, s->count - *i, &cp);
+    if (!len) {
+        (*i)++;
+        return 0x110000u + c;
+    }
+    *i += len;
+    return case_fold_cp(cp);
+}
+
+int come_string_casecmp(const come_string_t* a, const come_string_t* b, size_t n) {
+    if (!a || !b) return 0; // Safety
+
+    size_t i = 0, j = 0, chars = 0;
+    while (i < a->count && j < b->count && (n == 0 || chars < n)) {
+        uint32_t ca = case_fold_next(a, &i);
+        uint32_t cb = case_fold_next(b, &j);
+        if (ca != cb) return ca < cb ? -1 : 1;
+        chars++;
+    }
+
+    if (n != 0 && chars == n) return 0;
+    return (i < a->count) - (j < b->count);
+}
+
+bool come_string_caseeq(const come_string_t* a, const come_string_t* b) {
+    if (!a || !b) return a == b;
+    if (a->count != b->count) return false;
+
+    size_t n = a->count, i = 0;
+#ifdef COME_CASE_X86
+    const __m128i below = _mm_set1_epi8('A' - 1);
+    const __m128i above = _mm_set1_epi8('Z' + 1);
+    const __m128i bit = _mm_set1_epi8(0x20);
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a->data + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b->data + i));
+        x = _mm_or_si128(x, _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi8(x, below), _mm_cmpgt_epi8(above, x)), bit));
+        y = _mm_or_si128(y, _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi8(y, below), _mm_cmpgt_epi8(above, y)), bit));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF) return false;
+    }
+#endif
+    for (; i + 8 <= n; i += 8) {
+        uint64_t x, y;
+        memcpy(&x, a->data + i, 8);
+        memcpy(&y, b->data + i, 8);
+        if (swar_flip_case(x, 'A') != swar_flip_case(y, 'A')) return false;
+    }
+    for (; i < n; i++) {
+        uint8_t x = (uint8_t)a->data[i], y = (uint8_t)b->data[i];
+        if ((uint8_t)(x - 'A') < 26) x |= 0x20;
+        if ((uint8_t)(y - 'A') < 26) y |= 0x20;
+        if (x != y) return false;
+    }
+    return true;
+}
+
+uint64_t come_string_casehash(const come_string_t* a) {
+    if (!a) return 0;
+
+    // Eight lowercased bytes per multiply-rotate step, murmur3 finaliser
+    const uint64_t p1 = 0x9E3779B185EBCA87ULL, p2 = 0xC2B2AE3D27D4EB4FULL;
+    uint64_t h = 0x27D4EB2F165667C5ULL ^ (a->count * p1);
+    size_t n = a->count, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t x;
+        memcpy(&x, a->data + i, 8);
+        h ^= swar_flip_case(x, 'A') * p2;
+        h = ((h << 31) | (h >> 33)) * p1;
+    }
+    if (i < n) {
+        uint64_t x = 0;
+        memcpy(&x, a->data + i, n - i);
+        h ^= swar_flip_case(x, 'A') * p2;
+        h = ((h << 31) | (h >> 33)) * p1;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
@@ -0,0 +1,232 @@
+#include "come_string.h"
+#include "mem/talloc.h"
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/random.h>
+
+// Hashing
+// wyhash (Wang Yi, final version 4): 16 bytes per 64x64->128 multiply, three independent
+// lanes above 48 bytes. Not for anything that needs a cryptographic hash.
+
+static const uint64_t wy_p[4] = {
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL,
+};
+
+static inline void wy_mum(uint64_t* a, uint64_t* b) {
+    unsigned __int128 r = (unsigned __int128)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+}
+
+static inline uint64_t wy_mix(uint64_t a, uint64_t b) {
+    wy_mum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t wy_r8(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t wy_r4(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t wy_r3(const uint8_t* p, size_t k) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+uint64_t come_hash_bytes(const void* key, size_t len, uint64_t seed) {
+    const uint8_t* p = key;
+    uint64_t a, b;
+    seed ^= wy_mix(seed ^ wy_p[0], wy_p[1]);
+
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (wy_r4(p) << 32) | wy_r4(p + ((len >> 3) << 2));
+            b = (wy_r4(p + len - 4) << 32) | wy_r4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = wy_r3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wy_mix(wy_r8(p) ^ wy_p[1], wy_r8(p + 8) ^ seed);
+                see1 = wy_mix(wy_r8(p + 16) ^ wy_p[2], wy_r8(p + 24) ^ see1);
+                see2 = wy_mix(wy_r8(p + 32) ^ wy_p[3], wy_r8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wy_mix(wy_r8(p) ^ wy_p[1], wy_r8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = wy_r8(p + i - 16);
+        b = wy_r8(p + i - 8);
+    }
+
+    a ^= wy_p[1];
+    b ^= seed;
+    wy_mum(&a, &b);
+    return wy_mix(a ^ wy_p[0] ^ len, b ^ wy_p[1]);
+}
+
+// Chosen once per process so hash tables keyed by untrusted input cannot be flooded
+// with precomputed collisions; cached hashes depend on it, so it never changes
+static uint64_t hash_seed;
+static pthread_once_t hash_seed_once = PTHREAD_ONCE_INIT;
+
+static void hash_seed_init(void) {
+    uint64_t s;
+    if (getrandom(&s, sizeof(s), GRND_NONBLOCK) != (ssize_t)sizeof(s)) {
+        s = (uint64_t)time(NULL) ^ (uint64_t)(uintptr_t)&s;
+    }
+    hash_seed = s;
+}
+
+uint64_t come_hash_seed(void) {
+    pthread_once(&hash_seed_once, hash_seed_init);
+    return hash_seed;
+}
+
+uint64_t come_string_hash(const come_string_t* a) {
+    if (!a) return 0;
+    if (!(__atomic_load_n(&a->flags, __ATOMIC_ACQUIRE) & COME_STRING_HASHED)) {
+        come_string_t* m = (come_string_t*)a;
+        __atomic_store_n(&m->hash, come_hash_bytes(a->data, a->count, come_hash_seed()), __ATOMIC_RELAXED);
+        __atomic_fetch_or(&m->flags, COME_STRING_HASHED, __ATOMIC_RELEASE);
+    }
+    return __atomic_load_n(&a->hash, __ATOMIC_RELAXED);
+}
+
+// Interning
+// Open addressing with linear probing over a power-of-two table of (hash, string) slots,
+// grown at 3/4 load. The full hash is stored so probes rarely touch the strings.
+
+typedef struct {
+    uint64_t hash;
+    come_string_t* str; // NULL: empty
+} intern_slot_t;
+
+struct come_string_interner_t {
+    intern_slot_t* slots;
+    size_t mask;
+    size_t count;
+};
+
+#define INTERN_INITIAL_SLOTS 64
+
+come_string_interner_t* come_string_interner_new(TALLOC_CTX* ctx) {
+    come_string_interner_t* t = mem_talloc_alloc(ctx, sizeof(come_string_interner_t));
+    if (!t) return NULL;
+    t->slots = mem_talloc_alloc(t, INTERN_INITIAL_SLOTS * sizeof(intern_slot_t));
+    if (!t->slots) {
+        mem_talloc_free(t);
+        return NULL;
+    }
+    memset(t->slots, 0, INTERN_INITIAL_SLOTS * sizeof(intern_slot_t));
+    t->mask = INTERN_INITIAL_SLOTS - 1;
+    t->count = 0;
+    return t;
+}
+
+// Slot holding s[0..n), or the empty slot where it belongs
+static intern_slot_t* intern_probe(const come_string_interner_t* t, const char* s, size_t n, uint64_t h) {
+    for (size_t i = (size_t)h & t->mask;; i = (i + 1) & t->mask) {
+        intern_slot_t* slot = &t->slots[i];
+        if (!slot->str) return slot;
+        if (slot->hash == h && slot->str->count == n && memcmp(slot->str->data, s, n) == 0) return slot;
+    }
+}
+
+static bool intern_grow(come_string_interner_t* t) {
+    size_t cap = (t->mask + 1) * 2;
+    intern_slot_t* slots = mem_talloc_alloc(t, cap * sizeof(intern_slot_t));
+    if (!slots) return false;
+    memset(slots, 0, cap * sizeof(intern_slot_t));
+
+    intern_slot_t* old = t->slots;
+    size_t old_cap = t->mask + 1;
+    t->slots = slots;
+    t->mask = cap - 1;
+    for (size_t i = 0; i < old_cap; i++) {
+        if (!old[i].str) continue;
+        size_t j = (size_t)old[i].hash & t->mask;
+        while (slots[j].str) j = (j + 1) & t->mask;
+        slots[j] = old[i];
+    }
+    mem_talloc_free(old);
+    return true;
+}
+
+come_string_t* come_string_interner_find(const come_string_interner_t* t, const char* s, size_t n) {
+    if (!t || !s) return NULL;
+    return intern_probe(t, s, n, come_hash_bytes(s, n, come_hash_seed()))->str;
+}
+
+// Shared by _get and _add; src supplies cached scan results when interning a string
+static come_string_t* intern_insert(come_string_interner_t* t, const char* s, size_t n, uint64_t h,
+                                    const come_string_t* src) {
+    intern_slot_t* slot = intern_probe(t, s, n, h);
+    if (slot->str) return slot->str;
+
+    if ((t->count + 1) * 4 > (t->mask + 1) * 3) {
+        if (!intern_grow(t)) return NULL;
+        slot = intern_probe(t, s, n, h);
+    }
+
+    come_string_t* c = come_string_new_len(t, s, n);
+    if (!c) return NULL;
+    if (src) {
+        c->flags = __atomic_load_n(&src->flags, __ATOMIC_ACQUIRE);
+        c->nchars = __atomic_load_n(&src->nchars, __ATOMIC_RELAXED);
+    }
+    c->hash = h;
+    c->flags |= COME_STRING_HASHED;
+    // Filled in before it is published, so readers of an interned string never write to it
+    come_string_utf8(c);
+    slot->hash = h;
+    slot->str = c;
+    t->count++;
+    return c;
+}
+
+come_string_t* come_string_interner_get(come_string_interner_t* t, const char* s, size_t n) {
+    if (!t || !s) return NULL;
+    return intern_insert(t, s, n, come_hash_bytes(s, n, come_hash_seed()), NULL);
+}
+
+come_string_t* come_string_interner_add(come_string_interner_t* t, const come_string_t* a) {
+    if (!t || !a) return NULL;
+    return intern_insert(t, a->data, a->count, come_string_hash(a), a);
+}
+
+size_t come_string_interner_count(const come_string_interner_t* t) {
+    return t ? t->count : 0;
+}
+
+// Shared by every thread, so it lives under the process-wide context (a thread's root
+// would take it along when that thread exits) and is only touched under the lock
+static come_string_interner_t* default_interner = NULL;
+static pthread_mutex_t default_interner_lock = PTHREAD_MUTEX_INITIALIZER;
+
+come_string_t* come_string_intern(const come_string_t* a) {
+    if (!a) return NULL;
+    pthread_mutex_lock(&default_interner_lock);
+    if (!default_interner) default_interner = come_string_interner_new(mem_talloc_global_ctx());
+    come_string_t* c = come_string_interner_add(default_interner, a);
+    pthread_mutex_unlock(&default_interner_lock);
+    return c;
+}
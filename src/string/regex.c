@@ -0,0 +1,1367 @@
+#include "come_string.h"
+#include "mem/talloc.h"
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <regex.h>
+
+// Native engine
+// Patterns (POSIX ERE syntax) compile to a Thompson NFA program. Matching runs on a DFA
+// whose states are built lazily from NFA state sets, so every scan is linear in the input
+// and never backtracks. Capture groups need the NFA itself and run a Pike VM over the span
+// the DFA already found. Input is length-delimited: embedded NUL bytes are ordinary data.
+//
+// Overall matches are leftmost-longest like POSIX: a reverse DFA pass marks every position
+// where a match starts, then forward anchored DFA scans find the longest ends, sharing
+// what they learn so all matches together still take linear time. Submatches follow
+// leftmost-first (greedy) priority within that span.
+
+#define RE_MAX_INST       10000 // Bounds {m,n} expansion
+#define RE_MAX_REPEAT     255   // Largest m or n in {m,n}, as RE_DUP_MAX
+#define RE_DFA_MAX_STATES 2048  // Cache is flushed and rebuilt past this
+#define RE_DFA_TABLE_SIZE 4096  // Power of two, > RE_DFA_MAX_STATES
+#define RE_MEMO_MAX_SLOTS 65536 // Power of two; a full memo overwrites instead of growing
+#define RE_PATH_MAX       32768 // States of one scan remembered past its match end
+
+enum { RE_CHAR, RE_SPLIT, RE_JMP, RE_SAVE, RE_BOL, RE_EOL, RE_MATCH };
+
+typedef struct {
+    uint8_t op;
+    int x; // RE_CHAR: byte set; RE_SPLIT/RE_JMP: preferred target; RE_SAVE: capture slot
+    int y; // RE_SPLIT: other target
+} re_inst_t;
+
+typedef struct {
+    uint8_t bits[32];
+} re_set_t;
+
+typedef struct re_prog_t {
+    re_inst_t* inst;
+    int ninst;
+    int cap;
+    re_set_t* sets;
+    int nsets;
+    uint8_t classes[256]; // Byte -> equivalence class, bytes no set tells apart share one
+    int nclasses;
+    int error;
+} re_prog_t;
+
+static inline bool re_set_has(const re_set_t* set, uint8_t c) {
+    return (set->bits[c >> 3] >> (c & 7)) & 1;
+}
+
+static inline void re_set_add(re_set_t* set, uint8_t c) {
+    set->bits[c >> 3] |= (uint8_t)(1u << (c & 7));
+}
+
+// Parser: pattern -> syntax tree
+
+enum { RN_EMPTY, RN_SET, RN_CAT, RN_ALT, RN_STAR, RN_PLUS, RN_QUEST, RN_REPEAT, RN_GROUP, RN_BOL, RN_EOL };
+
+typedef struct re_node_t {
+    int type;
+    struct re_node_t* a;
+    struct re_node_t* b;
+    int set;      // RN_SET
+    int min, max; // RN_REPEAT, max -1 is unbounded
+    int group;    // RN_GROUP
+} re_node_t;
+
+typedef struct {
+    const char* p;
+    void* ctx;
+    re_set_t* sets;
+    int nsets;
+    int set_cap;
+    int ngroups;
+    int error;
+} re_parser_t;
+
+static re_node_t* re_parse_alt(re_parser_t* ps);
+
+static re_node_t* re_node(re_parser_t* ps, int type, re_node_t* a, re_node_t* b) {
+    re_node_t* n = mem_talloc_alloc(ps->ctx, sizeof(re_node_t));
+    if (!n) {
+        ps->error = 1;
+        return NULL;
+    }
+    memset(n, 0, sizeof(*n));
+    n->type = type;
+    n->a = a;
+    n->b = b;
+    return n;
+}
+
+static re_node_t* re_set_node(re_parser_t* ps, const re_set_t* set) {
+    if (ps->nsets == ps->set_cap) {
+        int cap = ps->set_cap ? ps->set_cap * 2 : 16;
+        re_set_t* sets = mem_talloc_realloc(ps->ctx, ps->sets, sizeof(re_set_t) * cap);
+        if (!sets) {
+            ps->error = 1;
+            return NULL;
+        }
+        ps->sets = sets;
+        ps->set_cap = cap;
+    }
+    ps->sets[ps->nsets] = *set;
+    re_node_t* n = re_node(ps, RN_SET, NULL, NULL);
+    if (n) n->set = ps->nsets++;
+    return n;
+}
+
+static void re_set_negate(re_set_t* set) {
+    for (int i = 0; i < 32; i++) set->bits[i] = (uint8_t)~set->bits[i];
+}
+
+static void re_set_add_ctype(re_set_t* set, int (*pred)(int)) {
+    for (int c = 0; c < 256; c++) {
+        if (pred(c)) re_set_add(set, (uint8_t)c);
+    }
+}
+
+static int re_isword(int c) {
+    return isalnum(c) || c == '_';
+}
+
+static const struct {
+    const char* name;
+    int (*pred)(int);
+} re_classes[] = {
+    { "alpha", isalpha }, { "digit", isdigit }, { "alnum", isalnum }, { "upper", isupper },
+    { "lower", islower }, { "space", isspace }, { "blank", isblank }, { "punct", ispunct },
+    { "print", isprint }, { "graph", isgraph }, { "cntrl", iscntrl }, { "xdigit", isxdigit },
+};
+
+// [...] bracket expression; ps->p points just past '['
+static re_node_t* re_parse_bracket(re_parser_t* ps) {
+    re_set_t set;
+    memset(&set, 0, sizeof(set));
+    bool negate = false;
+    if (*ps->p == '^') {
+        negate = true;
+        ps->p++;
+    }
+
+    bool first = true;
+    while (*ps->p && (first || *ps->p != ']')) {
+        first = false;
+        if (ps->p[0] == '[' && ps->p[1] == ':') {
+            const char* name = ps->p + 2;
+            const char* end = strstr(name, ":]");
+            if (!end) break;
+            size_t len = end - name;
+            bool found = false;
+            for (size_t i = 0; i < sizeof(re_classes) / sizeof(re_classes[0]); i++) {
+                if (strlen(re_classes[i].name) == len && strncmp(re_classes[i].name, name, len) == 0) {
+                    re_set_add_ctype(&set, re_classes[i].pred);
+                    found = true;
+                }
+            }
+            if (!found) break;
+            ps->p = end + 2;
+            continue;
+        }
+        if (ps->p[0] == '[' && (ps->p[1] == '=' || ps->p[1] == '.')) break; // Collating elements unsupported
+
+        uint8_t lo = (uint8_t)*ps->p++;
+        uint8_t hi = lo;
+        if (ps->p[0] == '-' && ps->p[1] && ps->p[1] != ']') {
+            hi = (uint8_t)ps->p[1];
+            ps->p += 2;
+            if (hi < lo) break;
+        }
+        for (int c = lo; c <= hi; c++) re_set_add(&set, (uint8_t)c);
+    }
+    if (*ps->p != ']') {
+        ps->error = 1;
+        return NULL;
+    }
+    ps->p++;
+
+    if (negate) re_set_negate(&set);
+    return re_set_node(ps, &set);
+}
+
+static re_node_t* re_parse_atom(re_parser_t* ps) {
+    re_set_t set;
+    memset(&set, 0, sizeof(set));
+    char c = *ps->p;
+
+    switch (c) {
+    case '(': {
+        ps->p++;
+        int group = ++ps->ngroups;
+        re_node_t* inner = re_parse_alt(ps);
+        if (ps->error) return NULL;
+        if (*ps->p != ')') {
+            ps->error = 1;
+            return NULL;
+        }
+        ps->p++;
+        re_node_t* n = re_node(ps, RN_GROUP, inner, NULL);
+        if (n) n->group = group;
+        return n;
+    }
+    case '^':
+        ps->p++;
+        return re_node(ps, RN_BOL, NULL, NULL);
+    case '$':
+        ps->p++;
+        return re_node(ps, RN_EOL, NULL, NULL);
+    case '.':
+        ps->p++;
+        memset(&set, 0xff, sizeof(set));
+        return re_set_node(ps, &set);
+    case '[':
+        ps->p++;
+        return re_parse_bracket(ps);
+    case '\\': {
+        char e = ps->p[1];
+        if (!e) {
+            ps->error = 1;
+            return NULL;
+        }
+        ps->p += 2;
+        switch (e) {
+        case 'd': case 'D': re_set_add_ctype(&set, isdigit); break;
+        case 'w': case 'W': re_set_add_ctype(&set, re_isword); break;
+        case 's': case 'S': re_set_add_ctype(&set, isspace); break;
+        default:
+            // Back-references and word boundaries are not regular
+            if ((e >= '1' && e <= '9') || e == 'b' || e == 'B' || e == '<' || e == '>' || e == '`' || e == '\'') {
+                ps->error = 1;
+                return NULL;
+            }
+            re_set_add(&set, (uint8_t)e);
+            return re_set_node(ps, &set);
+        }
+        if (isupper((unsigned char)e)) re_set_negate(&set);
+        return re_set_node(ps, &set);
+    }
+    case '*': case '+': case '?': case '{': case ')': case '\0':
+        ps->error = 1;
+        return NULL;
+    default:
+        ps->p++;
+        re_set_add(&set, (uint8_t)c);
+        return re_set_node(ps, &set);
+    }
+}
+
+static int re_parse_int(re_parser_t* ps) {
+    if (!isdigit((unsigned char)*ps->p)) return -1;
+    int v = 0;
+    while (isdigit((unsigned char)*ps->p)) {
+        v = v * 10 + (*ps->p++ - '0');
+        if (v > RE_MAX_REPEAT) return -2;
+    }
+    return v;
+}
+
+static re_node_t* re_parse_piece(re_parser_t* ps) {
+    re_node_t* n = re_parse_atom(ps);
+    while (n && !ps->error) {
+        char c = *ps->p;
+        if ((n->type == RN_BOL || n->type == RN_EOL) && (c == '*' || c == '+' || c == '?' || c == '{')) {
+            ps->error = 1; // Quantified anchor, rejected like regcomp does
+            return NULL;
+        }
+        if (c == '*') n = re_node(ps, RN_STAR, n, NULL);
+        else if (c == '+') n = re_node(ps, RN_PLUS, n, NULL);
+        else if (c == '?') n = re_node(ps, RN_QUEST, n, NULL);
+        else if (c == '{') {
+            ps->p++;
+            int min = re_parse_int(ps);
+            int max = min;
+            if (*ps->p == ',') {
+                ps->p++;
+                max = (*ps->p == '}') ? -1 : re_parse_int(ps);
+            }
+            if (min < 0 || (max < 0 && max != -1) || (max != -1 && max < min) || *ps->p != '}') {
+                ps->error = 1;
+                return NULL;
+            }
+            n = re_node(ps, RN_REPEAT, n, NULL);
+            if (n) {
+                n->min = min;
+                n->max = max;
+            }
+        } else {
+            break;
+        }
+        ps->p++;
+    }
+    return n;
+}
+
+static re_node_t* re_parse_cat(re_parser_t* ps) {
+    re_node_t* n = NULL;
+    while (*ps->p && *ps->p != '|' && *ps->p != ')' && !ps->error) {
+        re_node_t* piece = re_parse_piece(ps);
+        if (!piece) return NULL;
+        n = n ? re_node(ps, RN_CAT, n, piece) : piece;
+    }
+    return n ? n : re_node(ps, RN_EMPTY, NULL, NULL);
+}
+
+static re_node_t* re_parse_alt(re_parser_t* ps) {
+    re_node_t* n = re_parse_cat(ps);
+    while (n && !ps->error && *ps->p == '|') {
+        ps->p++;
+        re_node_t* rhs = re_parse_cat(ps);
+        if (!rhs) return NULL;
+        n = re_node(ps, RN_ALT, n, rhs);
+    }
+    return n;
+}
+
+// Compiler: syntax tree -> program
+
+static int re_emit(re_prog_t* prog, int op, int x, int y) {
+    if (prog->error) return 0;
+    if (prog->ninst == RE_MAX_INST) {
+        prog->error = 1;
+        return 0;
+    }
+    if (prog->ninst == prog->cap) {
+        int cap = prog->cap ? prog->cap * 2 : 32;
+        re_inst_t* inst = mem_talloc_realloc(prog, prog->inst, sizeof(re_inst_t) * cap);
+        if (!inst) {
+            prog->error = 1;
+            return 0;
+        }
+        prog->inst = inst;
+        prog->cap = cap;
+    }
+    re_inst_t* in = &prog->inst[prog->ninst];
+    in->op = (uint8_t)op;
+    in->x = x;
+    in->y = y;
+    return prog->ninst++;
+}
+
+// reverse: emit the program for the mirrored language (used to find match starts)
+static void re_compile_node(re_prog_t* prog, const re_node_t* n, bool reverse) {
+    if (!n || prog->error) return;
+    int l1, l2;
+    switch (n->type) {
+    case RN_EMPTY:
+        break;
+    case RN_SET:
+        re_emit(prog, RE_CHAR, n->set, 0);
+        break;
+    case RN_CAT:
+        re_compile_node(prog, reverse ? n->b : n->a, reverse);
+        re_compile_node(prog, reverse ? n->a : n->b, reverse);
+        break;
+    case RN_ALT:
+        l1 = re_emit(prog, RE_SPLIT, prog->ninst + 1, 0);
+        re_compile_node(prog, n->a, reverse);
+        l2 = re_emit(prog, RE_JMP, 0, 0);
+        if (prog->error) return;
+        prog->inst[l1].y = prog->ninst;
+        re_compile_node(prog, n->b, reverse);
+        prog->inst[l2].x = prog->ninst;
+        break;
+    case RN_STAR:
+        l1 = re_emit(prog, RE_SPLIT, prog->ninst + 1, 0);
+        re_compile_node(prog, n->a, reverse);
+        re_emit(prog, RE_JMP, l1, 0);
+        if (prog->error) return;
+        prog->inst[l1].y = prog->ninst;
+        break;
+    case RN_PLUS:
+        l1 = prog->ninst;
+        re_compile_node(prog, n->a, reverse);
+        re_emit(prog, RE_SPLIT, l1, prog->ninst + 1);
+        break;
+    case RN_QUEST:
+        l1 = re_emit(prog, RE_SPLIT, prog->ninst + 1, 0);
+        re_compile_node(prog, n->a, reverse);
+        if (prog->error) return;
+        prog->inst[l1].y = prog->ninst;
+        break;
+    case RN_REPEAT: {
+        for (int i = 0; i < n->min; i++) re_compile_node(prog, n->a, reverse);
+        if (n->max == -1) {
+            l1 = re_emit(prog, RE_SPLIT, prog->ninst + 1, 0);
+            re_compile_node(prog, n->a, reverse);
+            re_emit(prog, RE_JMP, l1, 0);
+            if (prog->error) return;
+            prog->inst[l1].y = prog->ninst;
+            break;
+        }
+        // Optional copies: each SPLIT skips to the end of the whole run
+        int first = prog->ninst;
+        for (int i = n->min; i < n->max; i++) {
+            re_emit(prog, RE_SPLIT, prog->ninst + 1, -1);
+            re_compile_node(prog, n->a, reverse);
+        }
+        if (prog->error) return;
+        for (int i = first; i < prog->ninst; i++) {
+            if (prog->inst[i].op == RE_SPLIT && prog->inst[i].y == -1) prog->inst[i].y = prog->ninst;
+        }
+        break;
+    }
+    case RN_GROUP:
+        if (!reverse) re_emit(prog, RE_SAVE, 2 * n->group, 0);
+        re_compile_node(prog, n->a, reverse);
+        if (!reverse) re_emit(prog, RE_SAVE, 2 * n->group + 1, 0);
+        break;
+    case RN_BOL:
+        re_emit(prog, reverse ? RE_EOL : RE_BOL, 0, 0);
+        break;
+    case RN_EOL:
+        re_emit(prog, reverse ? RE_BOL : RE_EOL, 0, 0);
+        break;
+    }
+}
+
+static void re_build_classes(re_prog_t* prog) {
+    bool boundary[256] = { false };
+    for (int s = 0; s < prog->nsets; s++) {
+        for (int c = 1; c < 256; c++) {
+            if (re_set_has(&prog->sets[s], (uint8_t)c) != re_set_has(&prog->sets[s], (uint8_t)(c - 1))) boundary[c] = true;
+        }
+    }
+    int cls = 0;
+    for (int c = 0; c < 256; c++) {
+        if (boundary[c]) cls++;
+        prog->classes[c] = (uint8_t)cls;
+    }
+    prog->nclasses = cls + 1;
+}
+
+static re_prog_t* re_compile(TALLOC_CTX* ctx, const re_node_t* root, const re_parser_t* ps, bool reverse) {
+    re_prog_t* prog = mem_talloc_alloc(ctx, sizeof(re_prog_t));
+    if (!prog) return NULL;
+    memset(prog, 0, sizeof(*prog));
+
+    re_compile_node(prog, root, reverse);
+    re_emit(prog, RE_MATCH, 0, 0);
+
+    prog->sets = mem_talloc_alloc(prog, sizeof(re_set_t) * (ps->nsets ? ps->nsets : 1));
+    if (prog->error || !prog->sets) {
+        mem_talloc_free(prog);
+        return NULL;
+    }
+    memcpy(prog->sets, ps->sets, sizeof(re_set_t) * ps->nsets);
+    prog->nsets = ps->nsets;
+    re_build_classes(prog);
+    return prog;
+}
+
+// Sparse set of program counters: O(1) insert, membership and clear
+
+typedef struct {
+    int* dense;
+    int* sparse;
+    int n;
+} re_sset_t;
+
+static bool re_sset_init(void* ctx, re_sset_t* set, int size) {
+    set->dense = mem_talloc_alloc(ctx, sizeof(int) * size);
+    set->sparse = mem_talloc_alloc(ctx, sizeof(int) * size);
+    set->n = 0;
+    if (!set->dense || !set->sparse) return false;
+    memset(set->sparse, 0, sizeof(int) * size);
+    return true;
+}
+
+static inline bool re_sset_has(const re_sset_t* set, int pc) {
+    int i = set->sparse[pc];
+    return i < set->n && set->dense[i] == pc;
+}
+
+static inline int re_sset_add(re_sset_t* set, int pc) {
+    set->sparse[pc] = set->n;
+    set->dense[set->n] = pc;
+    return set->n++;
+}
+
+// Follow empty transitions from pc; BOL/EOL only pass at the ends of the scanned text
+static void re_closure(const re_prog_t* prog, re_sset_t* set, int* stack, int pc, bool at_begin, bool at_end) {
+    int sp = 0;
+    stack[sp++] = pc;
+    while (sp) {
+        pc = stack[--sp];
+        if (re_sset_has(set, pc)) continue;
+        re_sset_add(set, pc);
+        const re_inst_t* in = &prog->inst[pc];
+        switch (in->op) {
+        case RE_JMP: stack[sp++] = in->x; break;
+        case RE_SPLIT: stack[sp++] = in->y; stack[sp++] = in->x; break;
+        case RE_SAVE: stack[sp++] = pc + 1; break;
+        case RE_BOL: if (at_begin) stack[sp++] = pc + 1; break;
+        case RE_EOL: if (at_end) stack[sp++] = pc + 1; break;
+        }
+    }
+}
+
+// Lazy DFA
+// A state is the set of NFA instructions that can still consume input or accept
+// (RE_CHAR, RE_EOL, RE_MATCH), so equivalent NFA states collapse to one DFA state.
+
+typedef struct {
+    int* pcs;
+    int npcs;
+    uint32_t hash;
+    uint8_t at_begin;     // Built at the start of the scan; BOL was followed
+    uint8_t match;        // Accepts here
+    uint8_t dead;         // Nothing left to consume
+    int8_t match_at_end;  // Accepts if the text ends here; -1 until computed
+    int32_t* next;        // Per byte class, -1 until computed
+} re_dstate_t;
+
+typedef struct re_dfa_t {
+    const re_prog_t* prog;
+    bool unanchored;
+    void* pool;           // States; freed wholesale on flush
+    re_dstate_t* states;
+    int nstates;
+    int cap;
+    int32_t index[RE_DFA_TABLE_SIZE];
+    re_sset_t set;
+    int* stack;
+    int* key;
+    unsigned generation;
+} re_dfa_t;
+
+static int re_int_cmp(const void* a, const void* b) {
+    return *(const int*)a - *(const int*)b;
+}
+
+static void re_dfa_flush(re_dfa_t* d) {
+    mem_talloc_free(d->pool);
+    d->pool = mem_talloc_new_ctx(d);
+    d->states = NULL;
+    d->nstates = 0;
+    d->cap = 0;
+    memset(d->index, 0xff, sizeof(d->index));
+    d->generation++;
+}
+
+static re_dfa_t* re_dfa_new(TALLOC_CTX* ctx, const re_prog_t* prog, bool unanchored) {
+    re_dfa_t* d = mem_talloc_alloc(ctx, sizeof(re_dfa_t));
+    if (!d) return NULL;
+    memset(d, 0, sizeof(*d));
+    d->prog = prog;
+    d->unanchored = unanchored;
+    d->stack = mem_talloc_alloc(d, sizeof(int) * (2 * prog->ninst + 2));
+    d->key = mem_talloc_alloc(d, sizeof(int) * prog->ninst);
+    if (!d->stack || !d->key || !re_sset_init(d, &d->set, prog->ninst)) {
+        mem_talloc_free(d);
+        return NULL;
+    }
+    re_dfa_flush(d);
+    return d;
+}
+
+// Look up (or add) the state for the instruction set in d->set; -1 on OOM
+static int re_dfa_intern(re_dfa_t* d, bool at_begin) {
+    const re_prog_t* prog = d->prog;
+    int n = 0;
+    bool match = false, dead = true;
+    for (int i = 0; i < d->set.n; i++) {
+        int pc = d->set.dense[i];
+        int op = prog->inst[pc].op;
+        if (op == RE_CHAR) dead = false;
+        if (op == RE_MATCH) match = true;
+        if (op == RE_CHAR || op == RE_EOL || op == RE_MATCH) d->key[n++] = pc;
+    }
+    qsort(d->key, n, sizeof(int), re_int_cmp);
+
+    uint32_t h = 2166136261u ^ (uint32_t)at_begin;
+    for (int i = 0; i < n; i++) h = (h ^ (uint32_t)d->key[i]) * 16777619u;
+
+    uint32_t slot = h & (RE_DFA_TABLE_SIZE - 1);
+    while (d->index[slot] >= 0) {
+        re_dstate_t* st = &d->states[d->index[slot]];
+        if (st->hash == h && st->npcs == n && st->at_begin == at_begin &&
+            memcmp(st->pcs, d->key, sizeof(int) * n) == 0) {
+            return d->index[slot];
+        }
+        slot = (slot + 1) & (RE_DFA_TABLE_SIZE - 1);
+    }
+
+    if (d->nstates == RE_DFA_MAX_STATES) {
+        re_dfa_flush(d);
+        slot = h & (RE_DFA_TABLE_SIZE - 1);
+    }
+    if (d->nstates == d->cap) {
+        int cap = d->cap ? d->cap * 2 : 16;
+        re_dstate_t* states = mem_talloc_realloc(d->pool, d->states, sizeof(re_dstate_t) * cap);
+        if (!states) return -1;
+        d->states = states;
+        d->cap = cap;
+    }
+
+    re_dstate_t* st = &d->states[d->nstates];
+    st->pcs = mem_talloc_alloc(d->pool, sizeof(int) * (n ? n : 1) + sizeof(int32_t) * prog->nclasses);
+    if (!st->pcs) return -1;
+    memcpy(st->pcs, d->key, sizeof(int) * n);
+    st->next = (int32_t*)(st->pcs + (n ? n : 1));
+    memset(st->next, 0xff, sizeof(int32_t) * prog->nclasses);
+    st->npcs = n;
+    st->hash = h;
+    st->at_begin = at_begin;
+    st->match = match;
+    st->dead = dead;
+    st->match_at_end = -1;
+    d->index[slot] = d->nstates;
+    return d->nstates++;
+}
+
+static int re_dfa_start(re_dfa_t* d, bool at_begin) {
+    d->set.n = 0;
+    re_closure(d->prog, &d->set, d->stack, 0, at_begin, false);
+    return re_dfa_intern(d, at_begin);
+}
+
+static int re_dfa_step(re_dfa_t* d, int si, uint8_t c) {
+    const re_prog_t* prog = d->prog;
+    int cls = prog->classes[c];
+    int32_t ns = d->states[si].next[cls];
+    if (ns >= 0) return ns;
+
+    d->set.n = 0;
+    const re_dstate_t* st = &d->states[si];
+    for (int i = 0; i < st->npcs; i++) {
+        const re_inst_t* in = &prog->inst[st->pcs[i]];
+        if (in->op == RE_CHAR && re_set_has(&prog->sets[in->x], c)) {
+            re_closure(prog, &d->set, d->stack, st->pcs[i] + 1, false, false);
+        }
+    }
+    if (d->unanchored) re_closure(prog, &d->set, d->stack, 0, false, false);
+
+    unsigned generation = d->generation;
+    ns = re_dfa_intern(d, false);
+    if (ns >= 0 && generation == d->generation) d->states[si].next[cls] = ns;
+    return ns;
+}
+
+static bool re_dfa_match_at_end(re_dfa_t* d, int si) {
+    re_dstate_t* st = &d->states[si];
+    if (st->match_at_end < 0) {
+        d->set.n = 0;
+        for (int i = 0; i < st->npcs; i++) {
+            re_closure(d->prog, &d->set, d->stack, st->pcs[i], st->at_begin, true);
+        }
+        st->match_at_end = 0;
+        for (int i = 0; i < d->set.n; i++) {
+            if (d->prog->inst[d->set.dense[i]].op == RE_MATCH) st->match_at_end = 1;
+        }
+    }
+    return st->match_at_end;
+}
+
+// Unanchored forward scan: does any match exist? Stops at the first accepting state.
+static int re_dfa_search(re_dfa_t* d, const uint8_t* s, size_t n) {
+    int st = re_dfa_start(d, true);
+    for (size_t i = 0; i < n; i++) {
+        if (st < 0) return -1;
+        if (d->states[st].match) return 1;
+        st = re_dfa_step(d, st, s[i]);
+    }
+    if (st < 0) return -1;
+    return re_dfa_match_at_end(d, st);
+}
+
+// Unanchored reverse scan over the whole text; bit i is set when a match starts at i
+static int re_dfa_starts(re_dfa_t* d, const uint8_t* s, size_t n, uint8_t* starts) {
+    int st = re_dfa_start(d, true);
+    for (size_t i = n; ; i--) {
+        if (st < 0) return -1;
+        if (i == 0 ? re_dfa_match_at_end(d, st) : d->states[st].match) starts[i >> 3] |= (uint8_t)(1u << (i & 7));
+        if (i == 0) break;
+        st = re_dfa_step(d, st, s[i - 1]);
+    }
+    return 0;
+}
+
+// Longest ends for the matches of one split, replace or groups call. Where a match ends
+// depends only on the DFA state at a position and the text after it, so the end found
+// for (position, state) is remembered: a later scan that reaches the same pair stops
+// there. Later scans start at or past this one's match end, so only the states from
+// there on are kept. Each pair is scanned at most once, so finding every match stays
+// linear in the text even when a candidate longer match is followed to the end of it.
+// Memory is bounded: past RE_MEMO_MAX_SLOTS the memo evicts and past RE_PATH_MAX a scan
+// stops recording, which costs rescans but never a wrong end.
+
+typedef struct {
+    size_t pos;          // Position + 1; 0: empty
+    int32_t state;
+    unsigned generation; // State ids are only meaningful within one DFA generation
+    long end;
+} re_memo_slot_t;
+
+typedef struct {
+    void* ctx;
+    uint8_t* starts;     // Bitmap of match start positions
+    re_memo_slot_t* memo;
+    size_t mask;
+    size_t count;
+    size_t floor;        // Start of the current scan; entries before it are dead
+    int32_t* path;       // States of the current scan from its latest match end
+    size_t path_cap;
+} re_scan_t;
+
+static inline size_t re_memo_hash(size_t pos, int32_t state, unsigned generation) {
+    uint64_t h = ((uint64_t)pos * 0x9e3779b97f4a7c15ULL) ^ ((uint64_t)(uint32_t)state << 32) ^ generation;
+    return (size_t)(h ^ (h >> 29));
+}
+
+static re_memo_slot_t* re_memo_find(re_scan_t* sc, size_t pos, int32_t state, unsigned generation) {
+    for (size_t i = re_memo_hash(pos, state, generation) & sc->mask;; i = (i + 1) & sc->mask) {
+        re_memo_slot_t* slot = &sc->memo[i];
+        if (!slot->pos || (slot->pos == pos + 1 && slot->state == state && slot->generation == generation)) return slot;
+    }
+}
+
+static bool re_memo_put(re_scan_t* sc, size_t pos, int32_t state, unsigned generation, long end) {
+    re_memo_slot_t* slot;
+    if ((sc->count + 1) * 2 > sc->mask + 1 && sc->mask + 1 < RE_MEMO_MAX_SLOTS) {
+        size_t cap = (sc->mask + 1) * 2;
+        re_memo_slot_t* old = sc->memo;
+        size_t old_cap = sc->mask + 1;
+        sc->memo = mem_talloc_alloc(sc->ctx, sizeof(re_memo_slot_t) * cap);
+        if (!sc->memo) {
+            sc->memo = old;
+            return false;
+        }
+        memset(sc->memo, 0, sizeof(re_memo_slot_t) * cap);
+        sc->mask = cap - 1;
+        sc->count = 0;
+        for (size_t i = 0; i < old_cap; i++) {
+            if (old[i].pos && old[i].pos - 1 >= sc->floor) {
+                *re_memo_find(sc, old[i].pos - 1, old[i].state, old[i].generation) = old[i];
+                sc->count++;
+            }
+        }
+        mem_talloc_free(old);
+    }
+    if ((sc->count + 1) * 2 > sc->mask + 1) {
+        // Full: the pair takes its home slot, so probe chains never grow
+        slot = &sc->memo[re_memo_hash(pos, state, generation) & sc->mask];
+    } else {
+        slot = re_memo_find(sc, pos, state, generation);
+        if (!slot->pos) sc->count++;
+    }
+    slot->pos = pos + 1;
+    slot->state = state;
+    slot->generation = generation;
+    slot->end = end;
+    return true;
+}
+
+// Anchored forward scan from start; end of the longest match, -1 if none
+static long re_dfa_longest(re_dfa_t* d, re_scan_t* sc, const uint8_t* s, size_t n, size_t start) {
+    int st = re_dfa_start(d, start == 0);
+    unsigned generation = d->generation;
+    size_t from = start; // Position of path[0]
+    size_t len = 0;
+    long end = -1;
+    sc->floor = start;
+    for (size_t i = start; ; i++) {
+        if (st < 0) return -1;
+        if (d->generation != generation) { // Flushed: the states on the path are gone
+            generation = d->generation;
+            from = i;
+            len = 0;
+        }
+        re_memo_slot_t* seen = re_memo_find(sc, i, st, generation);
+        if (seen->pos) {
+            if (seen->end >= 0) end = seen->end;
+            break;
+        }
+        if (i == n ? re_dfa_match_at_end(d, st) : d->states[st].match) {
+            end = (long)i;
+            from = i; // No later scan starts before the match end
+            len = 0;
+        }
+        if (len == sc->path_cap && sc->path_cap < RE_PATH_MAX) {
+            int32_t* path = mem_talloc_realloc(sc->ctx, sc->path, sizeof(int32_t) * sc->path_cap * 2);
+            if (path) {
+                sc->path = path;
+                sc->path_cap *= 2;
+            }
+        }
+        if (len < sc->path_cap) sc->path[len++] = st;
+        if (i == n || d->states[st].dead) break;
+        st = re_dfa_step(d, st, s[i]);
+    }
+    // The longest end from any point on the path is this scan's, if it is not behind it
+    for (size_t k = 0; k < len; k++) {
+        if (!re_memo_put(sc, from + k, sc->path[k], generation, end >= (long)(from + k) ? end : -1)) break;
+    }
+    return end;
+}
+
+// Pike VM: capture positions for the match spanning exactly [so, eo)
+
+typedef struct {
+    re_sset_t set; // Thread order is priority order
+    long* caps;    // ncap slots per thread
+} re_tlist_t;
+
+static void re_pike_add(const re_prog_t* prog, re_tlist_t* l, int pc, size_t pos, size_t n, long* caps, int ncap) {
+    if (re_sset_has(&l->set, pc)) return;
+    int t = re_sset_add(&l->set, pc);
+    const re_inst_t* in = &prog->inst[pc];
+    switch (in->op) {
+    case RE_JMP:
+        re_pike_add(prog, l, in->x, pos, n, caps, ncap);
+        break;
+    case RE_SPLIT:
+        re_pike_add(prog, l, in->x, pos, n, caps, ncap);
+        re_pike_add(prog, l, in->y, pos, n, caps, ncap);
+        break;
+    case RE_SAVE:
+        if (in->x < ncap) {
+            long old = caps[in->x];
+            caps[in->x] = (long)pos;
+            re_pike_add(prog, l, pc + 1, pos, n, caps, ncap);
+            caps[in->x] = old;
+        } else {
+            re_pike_add(prog, l, pc + 1, pos, n, caps, ncap);
+        }
+        break;
+    case RE_BOL:
+        if (pos == 0) re_pike_add(prog, l, pc + 1, pos, n, caps, ncap);
+        break;
+    case RE_EOL:
+        if (pos == n) re_pike_add(prog, l, pc + 1, pos, n, caps, ncap);
+        break;
+    default:
+        memcpy(l->caps + (size_t)t * ncap, caps, sizeof(long) * ncap);
+        break;
+    }
+}
+
+static bool re_pike_captures(const re_prog_t* prog, const uint8_t* s, size_t n, size_t so, size_t eo, long* out, int ncap) {
+    void* tmp = mem_talloc_new_ctx(NULL);
+    re_tlist_t lists[2];
+    long* caps = mem_talloc_alloc(tmp, sizeof(long) * ncap);
+    bool ok = caps != NULL;
+    for (int i = 0; i < 2 && ok; i++) {
+        lists[i].caps = mem_talloc_alloc(tmp, sizeof(long) * ncap * prog->ninst);
+        ok = lists[i].caps && re_sset_init(tmp, &lists[i].set, prog->ninst);
+    }
+    if (!ok) {
+        mem_talloc_free(tmp);
+        return false;
+    }
+
+    bool found = false;
+    re_tlist_t* clist = &lists[0];
+    re_tlist_t* nlist = &lists[1];
+    for (int i = 0; i < ncap; i++) caps[i] = -1;
+    re_pike_add(prog, clist, 0, so, n, caps, ncap);
+
+    for (size_t i = so; ; i++) {
+        nlist->set.n = 0;
+        for (int t = 0; t < clist->set.n; t++) {
+            const re_inst_t* in = &prog->inst[clist->set.dense[t]];
+            long* tc = clist->caps + (size_t)t * ncap;
+            if (in->op == RE_MATCH && i == eo) {
+                memcpy(out, tc, sizeof(long) * ncap);
+                found = true;
+                break; // Lower-priority threads are cut
+            }
+            if (in->op == RE_CHAR && i < eo && re_set_has(&prog->sets[in->x], s[i])) {
+                re_pike_add(prog, nlist, clist->set.dense[t] + 1, i + 1, n, tc, ncap);
+            }
+        }
+        if (found || i == eo) break;
+        re_tlist_t* swap = clist;
+        clist = nlist;
+        nlist = swap;
+    }
+
+    mem_talloc_free(tmp);
+    if (found) {
+        out[0] = (long)so;
+        out[1] = (long)eo;
+    }
+    return found;
+}
+
+// Regex
+// A compiled regex owns its program; the talloc destructor releases the regex_t, so freeing
+// the context (or the regex) is all the caller has to do.
+struct come_regex_t {
+    come_regex_engine_t engine;
+    regex_t re;          // COME_REGEX_POSIX
+    re_prog_t* prog;     // COME_REGEX_DFA: forward program
+    re_prog_t* rprog;    // COME_REGEX_DFA: mirrored program, finds where matches start
+    re_dfa_t* search;    // DFAs are built on first use
+    re_dfa_t* longest;
+    re_dfa_t* starts;
+    size_t nsub;
+};
+
+static int come_regex_destructor(void* ptr) {
+    regfree(&((come_regex_t*)ptr)->re);
+    return 0;
+}
+
+come_regex_t* come_regex_new_engine(TALLOC_CTX* ctx, const char* pattern, come_regex_engine_t engine) {
+    if (!pattern) return NULL;
+    come_regex_t* r = mem_talloc_alloc(ctx, sizeof(come_regex_t));
+    if (!r) return NULL;
+    memset(r, 0, sizeof(*r));
+    r->engine = engine;
+
+    if (engine == COME_REGEX_DFA) {
+        re_parser_t ps = { .p = pattern, .ctx = mem_talloc_new_ctx(r) };
+        re_node_t* root = ps.ctx ? re_parse_alt(&ps) : NULL;
+        if (root && !ps.error && *ps.p == '\0') {
+            r->prog = re_compile(r, root, &ps, false);
+            r->rprog = re_compile(r, root, &ps, true);
+        }
+        mem_talloc_free(ps.ctx);
+        if (!r->prog || !r->rprog) {
+            mem_talloc_free(r);
+            return NULL;
+        }
+        r->nsub = ps.ngroups;
+        return r;
+    }
+
+    if (regcomp(&r->re, pattern, REG_EXTENDED) != 0) {
+        mem_talloc_free(r); // No destructor yet, nothing to regfree
+        return NULL;
+    }
+    r->nsub = r->re.re_nsub;
+    mem_talloc_set_destructor(r, come_regex_destructor);
+    return r;
+}
+
+come_regex_t* come_regex_new(TALLOC_CTX* ctx, const char* pattern) {
+    return come_regex_new_engine(ctx, pattern, COME_REGEX_POSIX);
+}
+
+come_regex_t* come_regex_dfa(TALLOC_CTX* ctx, const char* pattern) {
+    return come_regex_new_engine(ctx, pattern, COME_REGEX_DFA);
+}
+
+come_regex_engine_t come_regex_engine(const come_regex_t* r) {
+    return r ? r->engine : COME_REGEX_POSIX;
+}
+
+void come_regex_free(come_regex_t* r) {
+    mem_talloc_free(r);
+}
+
+// Native engine entry points. The DFA caches fill in lazily, hence the casts from const.
+
+typedef struct {
+    size_t so, eo;
+} re_span_t;
+
+static re_dfa_t* re_dfa_get(const come_regex_t* r, re_dfa_t** slot, const re_prog_t* prog, bool unanchored) {
+    if (!*slot) *slot = re_dfa_new((void*)r, prog, unanchored);
+    return *slot;
+}
+
+static bool re_native_match(const come_regex_t* r, const come_string_t* a) {
+    re_dfa_t* d = re_dfa_get(r, &((come_regex_t*)r)->search, r->prog, true);
+    return d && re_dfa_search(d, (const uint8_t*)a->data, a->count) == 1;
+}
+
+// Starts bitmap (a->count + 1 bits) and an empty memo on ctx
+static bool re_native_scan(const come_regex_t* r, const come_string_t* a, void* ctx, re_scan_t* sc) {
+    re_dfa_t* d = re_dfa_get(r, &((come_regex_t*)r)->starts, r->rprog, true);
+    memset(sc, 0, sizeof(*sc));
+    sc->ctx = ctx;
+    sc->starts = mem_talloc_alloc(ctx, a->count / 8 + 1);
+    sc->memo = mem_talloc_alloc(ctx, sizeof(re_memo_slot_t) * 64);
+    sc->mask = 63;
+    sc->path = mem_talloc_alloc(ctx, sizeof(int32_t) * 64);
+    sc->path_cap = 64;
+    if (!d || !sc->starts || !sc->memo || !sc->path) return false;
+    memset(sc->starts, 0, a->count / 8 + 1);
+    memset(sc->memo, 0, sizeof(re_memo_slot_t) * 64);
+    return re_dfa_starts(d, (const uint8_t*)a->data, a->count, sc->starts) == 0;
+}
+
+// Leftmost-longest match starting at or after from
+static bool re_native_next(const come_regex_t* r, const come_string_t* a, re_scan_t* sc, size_t from, size_t* so, size_t* eo) {
+    re_dfa_t* d = re_dfa_get(r, &((come_regex_t*)r)->longest, r->prog, false);
+    if (!d) return false;
+    const uint8_t* starts = sc->starts;
+    size_t n = a->count;
+    for (size_t i = from; i <= n; i++) {
+        if ((i & 7) == 0 && starts[i >> 3] == 0) {
+            i += 7;
+            continue;
+        }
+        if (!(starts[i >> 3] & (1u << (i & 7)))) continue;
+        long end = re_dfa_longest(d, sc, (const uint8_t*)a->data, n, i);
+        if (end < 0) return false;
+        *so = i;
+        *eo = (size_t)end;
+        return true;
+    }
+    return false;
+}
+
+static bool re_span_push(void* ctx, re_span_t** spans, size_t* count, size_t* cap, size_t so, size_t eo) {
+    if (*count == *cap) {
+        size_t new_cap = *cap ? *cap * 2 : 16;
+        re_span_t* grown = mem_talloc_realloc(ctx, *spans, sizeof(re_span_t) * new_cap);
+        if (!grown) return false;
+        *spans = grown;
+        *cap = new_cap;
+    }
+    (*spans)[*count].so = so;
+    (*spans)[*count].eo = eo;
+    (*count)++;
+    return true;
+}
+
+static come_string_list_t* re_native_split(const come_regex_t* r, const come_string_t* a, size_t n) {
+    void* tmp = mem_talloc_new_ctx(NULL);
+    re_scan_t sc;
+    if (!re_native_scan(r, a, tmp, &sc)) {
+        mem_talloc_free(tmp);
+        return NULL;
+    }
+
+    re_span_t* spans = NULL;
+    size_t nspans = 0, cap = 0, p = 0, so, eo;
+    while ((n == 0 || nspans < n - 1) && re_native_next(r, a, &sc, p, &so, &eo)) {
+        if (eo == so) { // Empty matches do not split
+            p = so + 1;
+            continue;
+        }
+        if (!re_span_push(tmp, &spans, &nspans, &cap, so, eo)) break;
+        p = eo;
+    }
+
+    size_t count = nspans + 1;
+    come_string_list_t* list = mem_talloc_alloc((void*)a, sizeof(come_string_list_t) + sizeof(come_string_t*) * count);
+    if (list) {
+        list->size = count;
+        list->count = count;
+        size_t start = 0;
+        for (size_t i = 0; i < nspans; i++) {
+            list->items[i] = come_string_new_len(list, a->data + start, spans[i].so - start);
+            start = spans[i].eo;
+        }
+        list->items[nspans] = come_string_new_len(list, a->data + start, a->count - start);
+    }
+    mem_talloc_free(tmp);
+    return list;
+}
+
+static come_string_list_t* re_native_groups(const come_regex_t* r, const come_string_t* a) {
+    void* tmp = mem_talloc_new_ctx(NULL);
+    re_scan_t sc;
+    bool scanned = re_native_scan(r, a, tmp, &sc);
+    size_t nmatch = r->nsub + 1;
+    int ncap = (int)(2 * nmatch);
+    long* caps = mem_talloc_alloc(tmp, sizeof(long) * ncap);
+    size_t so, eo;
+
+    come_string_list_t* list = NULL;
+    if (scanned && caps && re_native_next(r, a, &sc, 0, &so, &eo) &&
+        re_pike_captures(r->prog, (const uint8_t*)a->data, a->count, so, eo, caps, ncap)) {
+        list = mem_talloc_alloc((void*)a, sizeof(come_string_list_t) + sizeof(come_string_t*) * nmatch);
+        if (list) {
+            list->size = nmatch;
+            list->count = nmatch;
+            for (size_t i = 0; i < nmatch; i++) {
+                if (caps[2 * i] >= 0 && caps[2 * i + 1] >= 0) {
+                    list->items[i] = come_string_new_len(list, a->data + caps[2 * i], caps[2 * i + 1] - caps[2 * i]);
+                } else {
+                    list->items[i] = NULL; // Optional group not matched
+                }
+            }
+        }
+    } else if (scanned && caps) {
+        list = mem_talloc_alloc((void*)a, sizeof(come_string_list_t));
+        if (list) {
+            list->size = 0;
+            list->count = 0;
+        }
+    }
+    mem_talloc_free(tmp);
+    return list;
+}
+
+static come_string_t* re_native_replace(const come_regex_t* r, const come_string_t* a, const char* repl, size_t count) {
+    void* tmp = mem_talloc_new_ctx(NULL);
+    re_scan_t sc;
+    if (!re_native_scan(r, a, tmp, &sc)) {
+        mem_talloc_free(tmp);
+        return NULL;
+    }
+
+    // One scan collects the matches; the result is then sized and filled in one go
+    re_span_t* spans = NULL;
+    size_t nspans = 0, cap = 0, p = 0, so, eo, removed = 0;
+    while (p < a->count && (count == 0 || nspans < count) && re_native_next(r, a, &sc, p, &so, &eo)) {
+        if (!re_span_push(tmp, &spans, &nspans, &cap, so, eo)) break;
+        removed += eo - so;
+        p = (eo == so) ? so + 1 : eo; // Empty match: keep the next char, search after it
+    }
+
+    size_t repl_len = strlen(repl);
+    come_string_t* res = come_string_new_len((void*)a, NULL, a->count - removed + nspans * repl_len);
+    if (res) {
+        char* dest = res->data;
+        size_t start = 0;
+        for (size_t i = 0; i < nspans; i++) {
+            memcpy(dest, a->data + start, spans[i].so - start);
+            dest += spans[i].so - start;
+            memcpy(dest, repl, repl_len);
+            dest += repl_len;
+            start = spans[i].eo;
+        }
+        memcpy(dest, a->data + start, a->count - start);
+    }
+    mem_talloc_free(tmp);
+    return res;
+}
+
+// Pattern cache used by the come_string_regex* helpers, so a pattern passed as text is
+// compiled once and reused until it is evicted (least recently used first). Each thread
+// has its own, under its own root: the root's exit clears it through the destructor.
+#define COME_REGEX_CACHE_SIZE 32
+
+typedef struct {
+    uint64_t hash;
+    char* pattern;      // Child of re, freed with it
+    come_regex_t* re;
+    uint64_t last_used;
+} come_regex_cache_entry_t;
+
+static __thread come_regex_cache_entry_t regex_cache[COME_REGEX_CACHE_SIZE];
+static __thread void* regex_cache_ctx = NULL;
+static __thread uint64_t regex_cache_tick = 0;
+
+static int regex_cache_destructor(void* ptr) {
+    (void)ptr;
+    memset(regex_cache, 0, sizeof(regex_cache));
+    regex_cache_ctx = NULL;
+    return 0;
+}
+
+static uint64_t regex_pattern_hash(const char* s) {
+    uint64_t h = 1469598103934665603ULL; // FNV-1a
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static come_regex_t* come_regex_cached(const char* pattern) {
+    if (!pattern) return NULL;
+    uint64_t h = regex_pattern_hash(pattern);
+
+    size_t victim = 0;
+    for (size_t i = 0; i < COME_REGEX_CACHE_SIZE; i++) {
+        come_regex_cache_entry_t* e = &regex_cache[i];
+        if (e->re && e->hash == h && strcmp(e->pattern, pattern) == 0) {
+            e->last_used = ++regex_cache_tick;
+            return e->re;
+        }
+        // Prefer an empty slot, otherwise the oldest one
+        if (regex_cache[victim].re && (!e->re || e->last_used < regex_cache[victim].last_used)) {
+            victim = i;
+        }
+    }
+
+    if (!regex_cache_ctx) {
+        regex_cache_ctx = mem_talloc_new_ctx(NULL);
+        if (!regex_cache_ctx) return NULL;
+        mem_talloc_set_destructor(regex_cache_ctx, regex_cache_destructor);
+    }
+
+    come_regex_t* re = come_regex_new(regex_cache_ctx, pattern);
+    if (!re) return NULL;
+
+    come_regex_cache_entry_t* e = &regex_cache[victim];
+    if (e->re) mem_talloc_free(e->re);
+
+    size_t plen = strlen(pattern);
+    e->pattern = mem_talloc_alloc(re, plen + 1);
+    if (!e->pattern) {
+        mem_talloc_free(re);
+        e->re = NULL;
+        return NULL;
+    }
+    memcpy(e->pattern, pattern, plen + 1);
+    e->hash = h;
+    e->re = re;
+    e->last_used = ++regex_cache_tick;
+    return re;
+}
+
+bool come_regex_match(const come_regex_t* r, const come_string_t* a) {
+    if (!r || !a) return false;
+    if (r->engine == COME_REGEX_DFA) return re_native_match(r, a);
+    return regexec(&r->re, a->data, 0, NULL, 0) == 0;
+}
+
+come_string_list_t* come_regex_split(const come_regex_t* r, const come_string_t* a, size_t n) {
+    if (!r || !a) return NULL;
+    if (r->engine == COME_REGEX_DFA) return re_native_split(r, a, n);
+    const regex_t* regex = &r->re;
+
+    // First pass: count
+    size_t count = 1;
+    const char* p = a->data;
+    regmatch_t pmatch[1];
+    size_t matches = 0;
+    
+    while (regexec(regex, p, 1, pmatch, 0) == 0) {
+        if (n > 0 && matches >= n - 1) break;
+        // Avoid infinite loop on empty match
+        if (pmatch[0].rm_eo == pmatch[0].rm_so) {
+             p++; // Advance one char if empty match
+             if (*p == '\0') break;
+             continue;
+        }
+        count++;
+        matches++;
+        p += pmatch[0].rm_eo;
+    }
+    
+    come_string_list_t* list = mem_talloc_alloc((void*)a, sizeof(come_string_list_t) + sizeof(come_string_t*) * count);
+    list->size = count;
+    list->count = count;
+
+    // Second pass: fill
+    p = a->data;
+    matches = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (regexec(regex, p, 1, pmatch, 0) == 0 && (n == 0 || matches < n - 1)) {
+            size_t len = pmatch[0].rm_so;
+            list->items[i] = come_string_new_len(list, p, len);
+            p += pmatch[0].rm_eo;
+            matches++;
+        } else {
+            size_t len = strlen(p);
+            list->items[i] = come_string_new_len(list, p, len);
+        }
+    }
+
+    return list;
+}
+
+come_string_list_t* come_regex_groups(const come_regex_t* r, const come_string_t* a) {
+    if (!r || !a) return NULL;
+    if (r->engine == COME_REGEX_DFA) return re_native_groups(r, a);
+
+    size_t nmatch = r->nsub + 1; // 0 is full match, 1..n are groups
+    regmatch_t pmatch_stack[16];
+    regmatch_t* pmatch_vals = nmatch <= 16 ? pmatch_stack : malloc(sizeof(regmatch_t) * nmatch);
+    
+    come_string_list_t* list = NULL;
+    if (regexec(&r->re, a->data, nmatch, pmatch_vals, 0) == 0) {
+        list = mem_talloc_alloc((void*)a, sizeof(come_string_list_t) + sizeof(come_string_t*) * nmatch);
+        list->size = nmatch;
+        list->count = nmatch;
+        for (size_t i = 0; i < nmatch; i++) {
+            if (pmatch_vals[i].rm_so != -1) {
+                size_t len = pmatch_vals[i].rm_eo - pmatch_vals[i].rm_so;
+                list->items[i] = come_string_new_len(list, a->data + pmatch_vals[i].rm_so, len);
+            } else {
+                list->items[i] = NULL; // Optional group not matched
+            }
+        }
+    } else {
+        list = mem_talloc_alloc((void*)a, sizeof(come_string_list_t));
+        list->size = 0;
+        list->count = 0;
+    }
+
+    if (pmatch_vals != pmatch_stack) free(pmatch_vals);
+    return list;
+}
+
+come_string_t* come_regex_replace(const come_regex_t* r, const come_string_t* a, const char* repl, size_t count) {
+    if (!r || !a || !repl) return NULL;
+    if (r->engine == COME_REGEX_DFA) return re_native_replace(r, a, repl, count);
+    const regex_t* regex = &r->re;
+
+    // We need to build the new string.
+    // Since we don't know the size, we might need a dynamic buffer or two passes.
+    // Two passes is easier.
+    
+    // Pass 1: calculate size
+    size_t new_len = 0;
+    const char* p = a->data;
+    size_t matches = 0;
+    regmatch_t pmatch[1];
+    size_t repl_len = strlen(repl);
+    
+    while (*p && (count == 0 || matches < count)) {
+        if (regexec(regex, p, 1, pmatch, 0) == 0) {
+            new_len += pmatch[0].rm_so; // Prefix
+            new_len += repl_len;        // Replacement
+            p += pmatch[0].rm_eo;
+            matches++;
+            if (pmatch[0].rm_eo == pmatch[0].rm_so) { // Empty match
+                if (*p) { new_len++; p++; } // Advance one char
+            }
+        } else {
+            new_len += strlen(p);
+            break;
+        }
+    }
+    if (count && matches == count && *p) new_len += strlen(p); // Remaining (loop stopped at count)
+    
+    come_string_t* res = come_string_new_len((void*)a, NULL, new_len);
+    
+    // Pass 2: copy
+    p = a->data;
+    char* dest = res->data;
+    matches = 0;
+    
+    while (*p && (count == 0 || matches < count)) {
+        if (regexec(regex, p, 1, pmatch, 0) == 0) {
+            size_t prefix_len = pmatch[0].rm_so;
+            memcpy(dest, p, prefix_len);
+            dest += prefix_len;
+            memcpy(dest, repl, repl_len);
+            dest += repl_len;
+            p += pmatch[0].rm_eo;
+            matches++;
+            if (pmatch[0].rm_eo == pmatch[0].rm_so) {
+                if (*p) { *dest++ = *p++; }
+            }
+        } else {
+            strcpy(dest, p);
+            dest += strlen(p);
+            break;
+        }
+    }
+    if (count && matches == count && *p) strcpy(dest, p);
+    
+    return res;
+}
+
+bool come_string_regex(const come_string_t* a, const char* pattern) {
+    if (!a || !pattern) return false;
+    return come_regex_match(come_regex_cached(pattern), a);
+}
+
+come_string_list_t* come_string_regex_split(const come_string_t* a, const char* pattern, size_t n) {
+    if (!a || !pattern) return NULL;
+    return come_regex_split(come_regex_cached(pattern), a, n);
+}
+
+come_string_list_t* come_string_regex_groups(const come_string_t* a, const char* pattern) {
+    if (!a || !pattern) return NULL;
+    return come_regex_groups(come_regex_cached(pattern), a);
+}
+
+come_string_t* come_string_regex_replace(const come_string_t* a, const char* pattern, const char* repl, size_t count) {
+    if (!a || !pattern) return NULL;
+    return come_regex_replace(come_regex_cached(pattern), a, repl, count);
+}
@@ -0,0 +1,449 @@
+#include "come_string.h"
+#include "mem/talloc.h"
+#include <string.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+// Ropes
+// An AVL-balanced concatenation tree with the text in the leaves. Nodes are immutable and
+// reference counted, so every edit is split/join with path copying: O(log n) new nodes,
+// and substr() shares whole subtrees with its source. A leaf is a window onto a
+// come_string_t chunk; large strings are adopted with come_string_share() instead of
+// copied, small ones are copied so neighbouring small leaves can be merged.
+//
+// Nodes live in a pool context shared by a rope and the ropes derived from it. A rope
+// holds its pool (as owner or by reference) and a pool holds a reference to every foreign
+// pool whose nodes were concatenated into it, so shared nodes outlive their first rope.
+
+#define ROPE_SMALL 512 // Leaves up to this size are copied and merged
+#define ROPE_IOV   64  // Chunks per writev()
+
+typedef struct rope_node_t {
+    size_t len;     // Bytes in this subtree
+    uint32_t refs;
+    uint8_t height; // 0: leaf
+    union {
+        struct {
+            struct rope_node_t* left;
+            struct rope_node_t* right;
+        };
+        struct {
+            come_string_t* str; // Owned by the leaf or shared with other leaves
+            size_t off;
+        };
+    };
+} rope_node_t;
+
+struct come_rope_t {
+    rope_node_t* root; // NULL: empty
+    void* pool;
+};
+
+// Functions taking rope_node_t* consume the caller's reference and return an owned one.
+// An allocation failure marks the op failed; the result is then discarded by the caller.
+typedef struct {
+    void* pool;
+    bool failed;
+} rope_op_t;
+
+static inline int rope_height(const rope_node_t* n) {
+    return n ? n->height : -1;
+}
+
+static inline rope_node_t* rope_take(rope_node_t* n) {
+    if (n) n->refs++;
+    return n;
+}
+
+static void rope_unref(rope_node_t* n) {
+    while (n && --n->refs == 0) {
+        rope_node_t* next = NULL;
+        if (n->height) {
+            rope_unref(n->left);
+            next = n->right;
+        }
+        mem_talloc_free(n); // A leaf's chunk goes with it unless other leaves share it
+        n = next;
+    }
+}
+
+static rope_node_t* rope_alloc(rope_op_t* op) {
+    rope_node_t* n = mem_talloc_alloc(op->pool, sizeof(rope_node_t));
+    if (!n) {
+        op->failed = true;
+        return NULL;
+    }
+    n->refs = 1;
+    n->height = 0;
+    return n;
+}
+
+// Leaf holding a private copy of p[0..len)
+static rope_node_t* rope_leaf_copy(rope_op_t* op, const char* p, size_t len) {
+    rope_node_t* n = rope_alloc(op);
+    if (!n) return NULL;
+    n->str = come_string_new_len(n, p, len);
+    if (!n->str) {
+        mem_talloc_free(n);
+        op->failed = true;
+        return NULL;
+    }
+    n->off = 0;
+    n->len = len;
+    return n;
+}
+
+// Leaf viewing str[off..off+len); str gains this leaf as an owner
+static rope_node_t* rope_leaf_share(rope_op_t* op, come_string_t* str, size_t off, size_t len) {
+    rope_node_t* n = rope_alloc(op);
+    if (!n) return NULL;
+    if (!come_string_share(str, n)) {
+        mem_talloc_free(n);
+        op->failed = true;
+        return NULL;
+    }
+    n->str = str;
+    n->off = off;
+    n->len = len;
+    return n;
+}
+
+static rope_node_t* rope_leaf_string(rope_op_t* op, const come_string_t* s) {
+    if (!s || s->count == 0) return NULL;
+    if (s->count <= ROPE_SMALL) return rope_leaf_copy(op, s->data, s->count);
+    return rope_leaf_share(op, (come_string_t*)s, 0, s->count);
+}
+
+static rope_node_t* rope_node(rope_op_t* op, rope_node_t* l, rope_node_t* r) {
+    rope_node_t* n = op->failed ? NULL : rope_alloc(op);
+    if (!n) {
+        rope_unref(l);
+        rope_unref(r);
+        return NULL;
+    }
+    n->left = l;
+    n->right = r;
+    n->len = l->len + r->len;
+    n->height = (uint8_t)((l->height > r->height ? l->height : r->height) + 1);
+    return n;
+}
+
+// Node over a and b, whose heights differ by at most 2, with one single or double rotation
+static rope_node_t* rope_balance(rope_op_t* op, rope_node_t* a, rope_node_t* b) {
+    if (op->failed || !a || !b) return rope_node(op, a, b);
+
+    if (a->height > b->height + 1) {
+        rope_node_t* al = rope_take(a->left);
+        rope_node_t* ar = rope_take(a->right);
+        rope_unref(a);
+        if (rope_height(al) >= rope_height(ar)) return rope_node(op, al, rope_node(op, ar, b));
+        rope_node_t* arl = rope_take(ar->left);
+        rope_node_t* arr = rope_take(ar->right);
+        rope_unref(ar);
+        return rope_node(op, rope_node(op, al, arl), rope_node(op, arr, b));
+    }
+    if (b->height > a->height + 1) {
+        rope_node_t* bl = rope_take(b->left);
+        rope_node_t* br = rope_take(b->right);
+        rope_unref(b);
+        if (rope_height(br) >= rope_height(bl)) return rope_node(op, rope_node(op, a, bl), br);
+        rope_node_t* bll = rope_take(bl->left);
+        rope_node_t* blr = rope_take(bl->right);
+        rope_unref(bl);
+        return rope_node(op, rope_node(op, a, bll), rope_node(op, blr, br));
+    }
+    return rope_node(op, a, b);
+}
+
+// AVL join: descend the taller tree's inner spine to the other tree's height
+static rope_node_t* rope_join_avl(rope_op_t* op, rope_node_t* l, rope_node_t* r) {
+    if (op->failed || !l || !r) return rope_node(op, l, r);
+
+    if (l->height > r->height + 1) {
+        rope_node_t* ll = rope_take(l->left);
+        rope_node_t* lr = rope_take(l->right);
+        rope_unref(l);
+        return rope_balance(op, ll, rope_join_avl(op, lr, r));
+    }
+    if (r->height > l->height + 1) {
+        rope_node_t* rl = rope_take(r->left);
+        rope_node_t* rr = rope_take(r->right);
+        rope_unref(r);
+        return rope_balance(op, rope_join_avl(op, l, rl), rr);
+    }
+    return rope_node(op, l, r);
+}
+
+static const rope_node_t* rope_edge(const rope_node_t* n, bool right) {
+    while (n->height) n = right ? n->right : n->left;
+    return n;
+}
+
+// t with its leftmost or rightmost leaf replaced by leaf; heights are unchanged
+static rope_node_t* rope_replace_edge(rope_op_t* op, rope_node_t* t, bool right, rope_node_t* leaf) {
+    if (!t->height) {
+        rope_unref(t);
+        return leaf;
+    }
+    rope_node_t* l = rope_take(t->left);
+    rope_node_t* r = rope_take(t->right);
+    rope_unref(t);
+    if (right) r = rope_replace_edge(op, r, right, leaf);
+    else l = rope_replace_edge(op, l, right, leaf);
+    return rope_node(op, l, r);
+}
+
+static rope_node_t* rope_join(rope_op_t* op, rope_node_t* l, rope_node_t* r) {
+    if (!l) return r;
+    if (!r) return l;
+    if (op->failed) {
+        rope_unref(l);
+        rope_unref(r);
+        return NULL;
+    }
+
+    // Small pieces typed or pasted next to each other share one leaf instead of growing
+    // the tree by a node each
+    const rope_node_t* le = rope_edge(l, true);
+    const rope_node_t* re = rope_edge(r, false);
+    if (le->len + re->len <= ROPE_SMALL && (!l->height || !r->height)) {
+        char buf[ROPE_SMALL];
+        memcpy(buf, le->str->data + le->off, le->len);
+        memcpy(buf + le->len, re->str->data + re->off, re->len);
+        rope_node_t* leaf = rope_leaf_copy(op, buf, le->len + re->len);
+        if (!leaf) {
+            rope_unref(l);
+            rope_unref(r);
+            return NULL;
+        }
+        if (!r->height) {
+            rope_unref(r);
+            return rope_replace_edge(op, l, true, leaf);
+        }
+        rope_unref(l);
+        return rope_replace_edge(op, r, false, leaf);
+    }
+    return rope_join_avl(op, l, r);
+}
+
+// Split t at byte i into [0, i) and [i, len)
+static void rope_split(rope_op_t* op, rope_node_t* t, size_t i, rope_node_t** lo, rope_node_t** hi) {
+    if (!t || i == 0) {
+        *lo = NULL;
+        *hi = t;
+        return;
+    }
+    if (i >= t->len) {
+        *lo = t;
+        *hi = NULL;
+        return;
+    }
+    if (!t->height) {
+        *lo = rope_leaf_share(op, t->str, t->off, i);
+        *hi = rope_leaf_share(op, t->str, t->off + i, t->len - i);
+        rope_unref(t);
+        return;
+    }
+
+    rope_node_t* l = rope_take(t->left);
+    rope_node_t* r = rope_take(t->right);
+    rope_unref(t);
+    rope_node_t *a, *b;
+    if (i < l->len) {
+        rope_split(op, l, i, &a, &b);
+        *lo = a;
+        *hi = rope_join(op, b, r);
+    } else if (i > l->len) {
+        rope_split(op, r, i - l->len, &a, &b);
+        *lo = rope_join(op, l, a);
+        *hi = b;
+    } else {
+        *lo = l;
+        *hi = r;
+    }
+}
+
+static int come_rope_destructor(void* ptr) {
+    come_rope_t* r = ptr;
+    rope_unref(r->root);
+    r->root = NULL;
+    return 0;
+}
+
+static come_rope_t* rope_handle(TALLOC_CTX* ctx, void* pool) {
+    come_rope_t* r = mem_talloc_alloc(ctx, sizeof(come_rope_t));
+    if (!r) return NULL;
+    r->root = NULL;
+    r->pool = pool ? pool : mem_talloc_new_ctx(r);
+    if (!r->pool || (pool && !mem_talloc_reference(r, pool))) {
+        mem_talloc_free(r);
+        return NULL;
+    }
+    mem_talloc_set_destructor(r, come_rope_destructor);
+    return r;
+}
+
+// Installs the result of an op, or keeps the old tree if anything failed
+static come_rope_t* rope_commit(come_rope_t* r, rope_op_t* op, rope_node_t* root) {
+    if (op->failed) {
+        rope_unref(root);
+        errno = ENOMEM;
+        return NULL;
+    }
+    rope_unref(r->root);
+    r->root = root;
+    return r;
+}
+
+come_rope_t* come_rope_new(TALLOC_CTX* ctx, const come_string_t* s) {
+    come_rope_t* r = rope_handle(ctx, NULL);
+    if (!r) return NULL;
+    rope_op_t op = {r->pool, false};
+    r->root = rope_leaf_string(&op, s);
+    if (op.failed) {
+        mem_talloc_free(r);
+        return NULL;
+    }
+    return r;
+}
+
+void come_rope_free(come_rope_t* r) {
+    mem_talloc_free(r);
+}
+
+size_t come_rope_len(const come_rope_t* r) {
+    return r && r->root ? r->root->len : 0;
+}
+
+come_rope_t* come_rope_append(come_rope_t* r, const come_string_t* s) {
+    if (!r) return NULL;
+    rope_op_t op = {r->pool, false};
+    rope_node_t* leaf = rope_leaf_string(&op, s);
+    return rope_commit(r, &op, rope_join(&op, rope_take(r->root), leaf));
+}
+
+come_rope_t* come_rope_concat(come_rope_t* r, const come_rope_t* other) {
+    if (!r || !other) return NULL;
+    if (other->pool != r->pool && other->root && !mem_talloc_reference(r->pool, other->pool)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    rope_op_t op = {r->pool, false};
+    return rope_commit(r, &op, rope_join(&op, rope_take(r->root), rope_take(other->root)));
+}
+
+come_rope_t* come_rope_insert(come_rope_t* r, size_t pos, const come_string_t* s) {
+    if (!r) return NULL;
+    if (pos > come_rope_len(r)) pos = come_rope_len(r);
+    rope_op_t op = {r->pool, false};
+    rope_node_t *lo, *hi;
+    rope_split(&op, rope_take(r->root), pos, &lo, &hi);
+    rope_node_t* mid = rope_leaf_string(&op, s);
+    return rope_commit(r, &op, rope_join(&op, rope_join(&op, lo, mid), hi));
+}
+
+come_rope_t* come_rope_delete(come_rope_t* r, size_t pos, size_t n) {
+    if (!r) return NULL;
+    size_t len = come_rope_len(r);
+    if (pos > len) pos = len;
+    if (n > len - pos) n = len - pos;
+    rope_op_t op = {r->pool, false};
+    rope_node_t *lo, *rest, *mid, *hi;
+    rope_split(&op, rope_take(r->root), pos, &lo, &rest);
+    rope_split(&op, rest, n, &mid, &hi);
+    rope_unref(mid);
+    return rope_commit(r, &op, rope_join(&op, lo, hi));
+}
+
+come_rope_t* come_rope_substr(const come_rope_t* r, size_t start, size_t end) {
+    if (!r) return NULL;
+    size_t len = come_rope_len(r);
+    if (end > len) end = len;
+    if (start > end) start = end;
+
+    come_rope_t* out = rope_handle((void*)r, r->pool);
+    if (!out) return NULL;
+    rope_op_t op = {r->pool, false};
+    rope_node_t *lo, *rest, *mid, *hi;
+    rope_split(&op, rope_take(r->root), start, &lo, &rest);
+    rope_split(&op, rest, end - start, &mid, &hi);
+    rope_unref(lo);
+    rope_unref(hi);
+    if (!rope_commit(out, &op, mid)) {
+        mem_talloc_free(out);
+        return NULL;
+    }
+    return out;
+}
+
+void come_rope_iter_init(come_rope_iter_t* it, const come_rope_t* r) {
+    it->depth = 0;
+    if (r && r->root) it->stack[it->depth++] = r->root;
+    it->data = NULL;
+    it->len = 0;
+    it->chunk = NULL;
+}
+
+bool come_rope_iter_next(come_rope_iter_t* it) {
+    if (it->depth == 0) return false;
+    const rope_node_t* n = it->stack[--it->depth];
+    while (n->height) {
+        it->stack[it->depth++] = n->right;
+        n = n->left;
+    }
+    it->chunk = n->str;
+    it->data = n->str->data + n->off;
+    it->len = n->len;
+    return true;
+}
+
+come_string_t* come_rope_flatten(const come_rope_t* r) {
+    if (!r) return NULL;
+    come_string_t* s = come_string_new_len((void*)r, NULL, come_rope_len(r));
+    if (!s) return NULL;
+    char* w = s->data;
+    come_rope_iter_t it;
+    come_rope_iter_init(&it, r);
+    while (come_rope_iter_next(&it)) {
+        memcpy(w, it.data, it.len);
+        w += it.len;
+    }
+    return s;
+}
+
+long come_rope_write(const come_rope_t* r, int fd) {
+    if (!r) return 0;
+    struct iovec iov[ROPE_IOV];
+    come_rope_iter_t it;
+    come_rope_iter_init(&it, r);
+    long total = 0;
+    bool more = true;
+
+    while (more) {
+        int n = 0;
+        while (n < ROPE_IOV && (more = come_rope_iter_next(&it))) {
+            iov[n].iov_base = (void*)it.data;
+            iov[n].iov_len = it.len;
+            n++;
+        }
+        struct iovec* v = iov;
+        while (n > 0) {
+            ssize_t w = writev(fd, v, n);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                return -1;
+            }
+            total += w;
+            while (n > 0 && (size_t)w >= v->iov_len) {
+                w -= v->iov_len;
+                v++;
+                n--;
+            }
+            if (n > 0) {
+                v->iov_base = (char*)v->iov_base + w;
+                v->iov_len -= w;
+            }
+        }
+    }
+    return total;
+}
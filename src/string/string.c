@@ -1,10 +1,10 @@
 #include "come_string.h"
+#include "come_conv.h"
 #include "mem/talloc.h"
 #include <string.h>
 #include <ctype.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <regex.h>
 
 
 
@@ -19,35 +19,142 @@ come_string_t* come_string_new_len(TALLOC_CTX* ctx, const char* str, size_t len)
 
     s->size = sizeof(come_string_t) + len + 1;
     s->count = len;
+    s->flags = 0;
+    s->nchars = 0;
     
-    memcpy(s->data, str, len);
+    if (str) memcpy(s->data, str, len); // NULL: caller fills data
     s->data[len] = '\0';
     return s;
 }
 
 void come_string_free(come_string_t* str) {
-    mem_talloc_free(str);
+    // A shared string only loses its parent; the other owners keep it alive
+    if (come_string_shared(str)) mem_talloc_unlink(mem_talloc_parent(str), str);
+    else mem_talloc_free(str);
+}
+
+come_string_t* come_string_share(come_string_t* a, TALLOC_CTX* ctx) {
+    if (!a) return NULL;
+    return mem_talloc_reference(ctx, a) ? a : NULL;
+}
+
+bool come_string_shared(const come_string_t* a) {
+    return mem_talloc_reference_count(a) > 0;
+}
+
+come_string_t* come_string_cow(come_string_t* a, TALLOC_CTX* ctx) {
+    if (!a || !come_string_shared(a)) return a;
+    // The original stays with its owners; only this writer moves to the copy
+    come_string_t* c = come_string_new_len(ctx, a->data, a->count);
+    if (!c) return NULL;
+    c->flags = __atomic_load_n(&a->flags, __ATOMIC_ACQUIRE);
+    c->nchars = __atomic_load_n(&a->nchars, __ATOMIC_RELAXED);
+    c->hash = __atomic_load_n(&a->hash, __ATOMIC_RELAXED);
+    return c;
+}
+
+come_string_t* come_string_builder(TALLOC_CTX* ctx, size_t capacity) {
+    come_string_t* s = come_string_new_len(ctx, NULL, capacity);
+    if (!s) return NULL;
+    s->count = 0;
+    s->data[0] = '\0';
+    return s;
+}
+
+come_string_t* come_string_reserve(come_string_t* s, size_t extra) {
+    if (!s) return NULL;
+    // A shared builder carries on with a private copy owned by its parent
+    if (come_string_shared(s)) {
+        s = come_string_cow(s, mem_talloc_parent(s));
+        if (!s) return NULL;
+    }
+    size_t need = sizeof(come_string_t) + s->count + extra + 1;
+    if (need <= s->size) return s;
+
+    // Geometric growth keeps repeated appends amortised O(1)
+    size_t cap = (size_t)s->size * 2;
+    if (cap < need) cap = need;
+    if (cap > UINT32_MAX) cap = need;
+    if (cap > UINT32_MAX) return NULL;
+
+    come_string_t* grown = mem_talloc_realloc(NULL, s, cap);
+    if (!grown) return NULL;
+    grown->size = (uint32_t)cap;
+    return grown;
+}
+
+come_string_t* come_string_append(come_string_t* s, const char* p, size_t n) {
+    s = come_string_reserve(s, n);
+    if (!s) return NULL;
+    memcpy(s->data + s->count, p, n);
+    s->count += n;
+    s->data[s->count] = '\0';
+    s->flags = 0;
+    return s;
 }
 
 size_t come_string_size(const come_string_t* a) {
     return a ? a->count : 0;
 }
 
-// Basic UTF-8 char counting
+// Code point count and ASCII flag, computed once and cached in the header.
+// Only builders change a string's length or code points after creation, and they reset
+// the flags (in-place case mapping only swaps same-length letters).
+static const come_string_t* come_string_scan(const come_string_t* a) {
+    if (!(__atomic_load_n(&a->flags, __ATOMIC_ACQUIRE) & COME_STRING_SCANNED)) {
+        come_string_t* m = (come_string_t*)a;
+        bool ascii;
+        __atomic_store_n(&m->nchars, (uint32_t)come_utf8_count(a->data, a->count, &ascii), __ATOMIC_RELAXED);
+        __atomic_fetch_or(&m->flags, COME_STRING_SCANNED |
+                          (ascii ? COME_STRING_ASCII | COME_STRING_UTF8_KNOWN | COME_STRING_UTF8 : 0),
+                          __ATOMIC_RELEASE);
+    }
+    return a;
+}
+
+static inline bool come_string_is_ascii_cached(const come_string_t* a) {
+    return (__atomic_load_n(&come_string_scan(a)->flags, __ATOMIC_RELAXED) & COME_STRING_ASCII) != 0;
+}
+
+// A byte range of an ASCII string is ASCII too
+static come_string_t* come_string_ascii_slice(const come_string_t* a, size_t start, size_t len) {
+    come_string_t* s = come_string_new_len((void*)a, a->data + start, len);
+    if (s) {
+        s->flags = COME_STRING_SCANNED | COME_STRING_ASCII | COME_STRING_UTF8_KNOWN | COME_STRING_UTF8;
+        s->nchars = len;
+    }
+    return s;
+}
+
 size_t come_string_len(const come_string_t* a) {
     if (!a) return 0;
-    size_t count = 0;
-    const char* p = a->data;
-    while (*p) {
-        if ((*p & 0xC0) != 0x80) count++;
-        p++;
+    return __atomic_load_n(&come_string_scan(a)->nchars, __ATOMIC_RELAXED);
+}
+
+bool come_string_utf8(const come_string_t* a) {
+    if (!a) return false;
+    uint32_t flags = __atomic_load_n(&a->flags, __ATOMIC_ACQUIRE);
+    if (!(flags & COME_STRING_UTF8_KNOWN)) {
+        come_string_t* m = (come_string_t*)a;
+        bool valid = come_string_is_ascii_cached(a) || come_utf8_valid(a->data, a->count);
+        flags = __atomic_or_fetch(&m->flags, COME_STRING_UTF8_KNOWN | (valid ? COME_STRING_UTF8 : 0), __ATOMIC_RELEASE);
     }
-    return count;
+    return (flags & COME_STRING_UTF8) != 0;
 }
 
 int come_string_cmp(const come_string_t* a, const come_string_t* b, size_t n) {
     if (!a || !b) return 0; // Safety
     if (n == 0) return strcmp(a->data, b->data);
+
+    // Both known ASCII: n characters are n bytes
+    if ((__atomic_load_n(&a->flags, __ATOMIC_RELAXED) & COME_STRING_ASCII) &&
+        (__atomic_load_n(&b->flags, __ATOMIC_RELAXED) & COME_STRING_ASCII)) {
+        size_t la = a->count < n ? a->count : n;
+        size_t lb = b->count < n ? b->count : n;
+        int r = memcmp(a->data, b->data, la < lb ? la : lb);
+        if (r || la == lb) return r;
+        return la < lb ? -(unsigned char)b->data[la] : (unsigned char)a->data[lb];
+    }
     
     // UTF-8 aware comparison for 'n' chars is complex, falling back to byte comparison for MVP if n is large
     // Or we iterate n UTF-8 chars.
@@ -73,29 +180,6 @@ int come_string_cmp(const come_string_t* a, const come_string_t* b, size_t n) {
     return *p1 - *p2;
 }
 
-int come_string_casecmp(const come_string_t* a, const come_string_t* b, size_t n) {
-    // Similar to cmp but tolower
-    if (!a || !b) return 0;
-    
-    const char* p1 = a->data;
-    const char* p2 = b->data;
-    size_t chars = 0;
-    
-    while (*p1 && *p2 && (n == 0 || chars < n)) {
-        if (tolower(*p1) != tolower(*p2)) return tolower(*p1) - tolower(*p2);
-        
-        // Advance p1
-        do { p1++; } while ((*p1 & 0xC0) == 0x80);
-        // Advance p2
-        do { p2++; } while ((*p2 & 0xC0) == 0x80);
-        
-        chars++;
-    }
-    
-    if (n != 0 && chars == n) return 0;
-    return tolower(*p1) - tolower(*p2);
-}
-
 long come_string_chr(const come_string_t* a, int c) {
     char* p = strchr(a->data, c);
     return p ? (p - a->data) : -1;
@@ -171,35 +255,13 @@ bool come_string_isspace(const come_string_t* a) {
 
 bool come_string_isascii(const come_string_t* a) {
     if (!a) return false;
-    // Check if high bit is set
-    const unsigned char* bytes = (const unsigned char*)a->data;
-    while (*bytes) {
-        if (*bytes & 0x80) return false;
-        bytes++;
-    }
-    return true;
+    return come_string_is_ascii_cached(a);
 }
 
 // Transformation
-come_string_t* come_string_upper(const come_string_t* a) {
-    come_string_t* new_str = come_string_new_len((void*)a, a->data, a->count);
-    for (size_t i = 0; i < new_str->count; i++) {
-        new_str->data[i] = toupper(new_str->data[i]);
-    }
-    return new_str;
-}
-
-come_string_t* come_string_lower(const come_string_t* a) {
-    come_string_t* new_str = come_string_new_len((void*)a, a->data, a->count);
-    for (size_t i = 0; i < new_str->count; i++) {
-        new_str->data[i] = tolower(new_str->data[i]);
-    }
-    return new_str;
-}
-
 come_string_t* come_string_repeat(const come_string_t* a, size_t n) {
     size_t new_len = a->count * n;
-    come_string_t* new_str = come_string_new_len((void*)a, "", new_len); // Alloc space
+    come_string_t* new_str = come_string_new_len((void*)a, NULL, new_len); // Alloc space
     // Manually fill
     for (size_t i = 0; i < n; i++) {
         memcpy(new_str->data + (i * a->count), a->data, a->count);
@@ -225,7 +287,7 @@ come_string_t* come_string_replace(const come_string_t* a, const char* old_str,
     }
     
     size_t final_len = a->count + count * (new_len_part - old_len);
-    come_string_t* res = come_string_new_len((void*)a, "", final_len);
+    come_string_t* res = come_string_new_len((void*)a, NULL, final_len);
     
     p = a->data;
     char* dest = res->data;
@@ -249,6 +311,299 @@ come_string_t* come_string_replace(const come_string_t* a, const char* old_str,
     return res;
 }
 
+// Multi-pattern search (Aho-Corasick)
+// The trie holds the needles reversed and is turned into a full DFA: failure links are
+// folded into the transition table, so scanning is one table lookup per input byte. Run
+// right to left, the automaton's state at position i names the longest needle starting at
+// i, which is exactly what a leftmost-longest search needs without any lookahead.
+// Bytes that never occur in a needle share a single input class, which keeps the table
+// small (states x classes, not states x 256).
+struct come_string_matcher_t {
+    uint32_t nstates;
+    uint32_t nclasses;
+    uint8_t classes[256];   // byte -> input class (0 = not used by any needle)
+    uint32_t* delta;        // nstates * nclasses transitions
+    uint32_t* match;        // 1-based index of the longest needle ending in each state, 0 = none
+    uint32_t npatterns;
+    uint32_t max_len;       // longest needle
+    uint32_t* pat_len;
+    come_string_t** repl;   // replacement per needle, copied (replacer only)
+};
+
+// Needle p is olds[p * stride], replaced by news[p * stride] when news is given
+static come_string_matcher_t* ac_build(TALLOC_CTX* ctx, come_string_t* const* olds, come_string_t* const* news,
+                                       size_t npat, size_t stride) {
+    come_string_matcher_t* m = mem_talloc_alloc(ctx, sizeof(come_string_matcher_t));
+    if (!m) return NULL;
+    memset(m, 0, sizeof(*m));
+    m->npatterns = npat;
+
+    // Input classes and an upper bound on the number of states
+    size_t max_states = 1;
+    uint32_t nclasses = 1;
+    for (size_t p = 0; p < npat; p++) {
+        const come_string_t* s = olds[p * stride];
+        if (!s) continue;
+        max_states += s->count;
+        if (s->count > m->max_len) m->max_len = s->count;
+        for (size_t i = 0; i < s->count; i++) {
+            unsigned char c = (unsigned char)s->data[i];
+            if (!m->classes[c]) m->classes[c] = nclasses++;
+        }
+    }
+    m->nclasses = nclasses;
+
+    m->delta = mem_talloc_alloc(m, max_states * nclasses * sizeof(uint32_t));
+    m->match = mem_talloc_alloc(m, max_states * sizeof(uint32_t));
+    m->pat_len = mem_talloc_alloc(m, (npat ? npat : 1) * sizeof(uint32_t));
+    uint32_t* fail = mem_talloc_alloc(m, max_states * sizeof(uint32_t));
+    uint32_t* queue = mem_talloc_alloc(m, max_states * sizeof(uint32_t));
+    if (!m->delta || !m->match || !m->pat_len || !fail || !queue) {
+        mem_talloc_free(m);
+        return NULL;
+    }
+    memset(m->delta, 0, max_states * nclasses * sizeof(uint32_t));
+    m->match[0] = 0;
+
+    if (news) {
+        m->repl = mem_talloc_alloc(m, (npat ? npat : 1) * sizeof(come_string_t*));
+        if (!m->repl) {
+            mem_talloc_free(m);
+            return NULL;
+        }
+        for (size_t p = 0; p < npat; p++) {
+            const come_string_t* r = news[p * stride];
+            m->repl[p] = r ? come_string_new_len(m->repl, r->data, r->count) : NULL;
+        }
+    }
+
+    // Trie of the reversed needles. Transition 0 means "no edge" here since no edge ever
+    // leads back to the root.
+    uint32_t nstates = 1;
+    for (size_t p = 0; p < npat; p++) {
+        const come_string_t* s = olds[p * stride];
+        m->pat_len[p] = s ? s->count : 0;
+        if (!s || s->count == 0) continue; // empty needles never match
+        uint32_t state = 0;
+        for (size_t i = s->count; i-- > 0;) {
+            uint32_t* t = &m->delta[state * nclasses + m->classes[(unsigned char)s->data[i]]];
+            if (!*t) {
+                *t = nstates;
+                m->match[nstates] = 0;
+                nstates++;
+            }
+            state = *t;
+        }
+        if (!m->match[state]) m->match[state] = p + 1; // first duplicate wins
+    }
+    m->nstates = nstates;
+
+    // Breadth-first pass: failure links, folded transitions and inherited matches.
+    // A state's failure target is always shallower, so its row is already folded.
+    size_t head = 0, tail = 0;
+    for (uint32_t c = 0; c < nclasses; c++) {
+        uint32_t t = m->delta[c];
+        if (t) { fail[t] = 0; queue[tail++] = t; }
+    }
+    while (head < tail) {
+        uint32_t s = queue[head++];
+        uint32_t* row = &m->delta[s * nclasses];
+        const uint32_t* frow = &m->delta[fail[s] * nclasses];
+        if (!m->match[s]) m->match[s] = m->match[fail[s]];
+        for (uint32_t c = 0; c < nclasses; c++) {
+            if (row[c]) {
+                fail[row[c]] = frow[c];
+                queue[tail++] = row[c];
+            } else {
+                row[c] = frow[c];
+            }
+        }
+    }
+    mem_talloc_free(queue);
+    mem_talloc_free(fail);
+    return m;
+}
+
+come_string_matcher_t* come_string_matcher_new(TALLOC_CTX* ctx, const come_string_list_t* needles) {
+    return ac_build(ctx, needles ? needles->items : NULL, NULL, needles ? needles->count : 0, 1);
+}
+
+come_string_matcher_t* come_string_replacer_new(TALLOC_CTX* ctx, const come_string_list_t* pairs) {
+    if (!pairs) return ac_build(ctx, NULL, NULL, 0, 2);
+    return ac_build(ctx, pairs->items, pairs->items + 1, pairs->count / 2, 2);
+}
+
+come_string_matcher_t* come_string_replacer_new_kv(TALLOC_CTX* ctx, const come_string_list_t* olds,
+                                                   const come_string_list_t* news) {
+    size_t n = olds && news ? (olds->count < news->count ? olds->count : news->count) : 0;
+    return ac_build(ctx, n ? olds->items : NULL, n ? news->items : NULL, n, 1);
+}
+
+// A left-to-right search over one text. The text is labelled in blocks of at least
+// max_len positions: one right-to-left run per block records the needle starting at each
+// position, and starts max_len - 1 bytes past the block so the first labels are exact.
+// Every byte is thus read at most twice, however the matches fall.
+#define AC_BLOCK 256
+
+typedef struct {
+    const come_string_matcher_t* m;
+    const unsigned char* s;
+    size_t n;
+    size_t block;               // first position labelled in starts
+    size_t block_end;
+    size_t cap;
+    uint32_t* starts;           // 1-based needle starting at block + k, 0 = none
+    uint32_t local[AC_BLOCK];
+} ac_scan_t;
+
+static bool ac_scan_init(ac_scan_t* sc, const come_string_matcher_t* m, const come_string_t* a) {
+    sc->m = m;
+    sc->s = (const unsigned char*)a->data;
+    sc->n = a->count;
+    sc->block = sc->block_end = 0;
+    sc->cap = AC_BLOCK;
+    sc->starts = sc->local;
+    if (m->max_len > AC_BLOCK) {
+        sc->cap = m->max_len;
+        sc->starts = mem_talloc_alloc(NULL, sc->cap * sizeof(uint32_t));
+        if (!sc->starts) return false;
+    }
+    return true;
+}
+
+static void ac_scan_done(ac_scan_t* sc) {
+    if (sc->starts != sc->local) mem_talloc_free(sc->starts);
+}
+
+static void ac_label(ac_scan_t* sc, size_t from) {
+    const come_string_matcher_t* m = sc->m;
+    size_t to = sc->n - from < sc->cap ? sc->n : from + sc->cap;
+    size_t reach = m->max_len ? m->max_len - 1 : 0;
+    size_t end = sc->n - to <= reach ? sc->n : to + reach;
+    uint32_t state = 0;
+    for (size_t i = end; i-- > from;) {
+        state = m->delta[state * m->nclasses + m->classes[sc->s[i]]];
+        if (i < to) sc->starts[i - from] = m->match[state];
+    }
+    sc->block = from;
+    sc->block_end = to;
+}
+
+// Finds the leftmost-longest match at or after 'pos'
+static bool ac_next(ac_scan_t* sc, size_t pos, size_t* mstart, size_t* mend, uint32_t* mpat) {
+    for (size_t i = pos; i < sc->n; i++) {
+        if (i < sc->block || i >= sc->block_end) ac_label(sc, i);
+        uint32_t p = sc->starts[i - sc->block];
+        if (p) {
+            *mstart = i;
+            *mend = i + sc->m->pat_len[p - 1];
+            *mpat = p - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+long come_string_matcher_find(const come_string_matcher_t* m, const come_string_t* a) {
+    if (!m || !a) return -1;
+    ac_scan_t sc;
+    size_t start, end;
+    uint32_t pat;
+    if (!ac_scan_init(&sc, m, a)) return -1;
+    long idx = ac_next(&sc, 0, &start, &end, &pat) ? (long)start : -1;
+    ac_scan_done(&sc);
+    return idx;
+}
+
+size_t come_string_matcher_count(const come_string_matcher_t* m, const come_string_t* a) {
+    if (!m || !a) return 0;
+    ac_scan_t sc;
+    size_t count = 0, pos = 0, start, end;
+    uint32_t pat;
+    if (!ac_scan_init(&sc, m, a)) return 0;
+    while (ac_next(&sc, pos, &start, &end, &pat)) {
+        count++;
+        pos = end;
+    }
+    ac_scan_done(&sc);
+    return count;
+}
+
+come_string_t* come_string_matcher_replace(const come_string_matcher_t* m, const come_string_t* a) {
+    if (!m || !a) return NULL;
+    ac_scan_t sc;
+    size_t pos, start, end;
+    uint32_t pat;
+    if (!ac_scan_init(&sc, m, a)) return NULL;
+
+    // Pass 1: size of the result, so it is allocated exactly once
+    size_t final_len = a->count;
+    pos = 0;
+    while (ac_next(&sc, pos, &start, &end, &pat)) {
+        size_t repl_len = (m->repl && m->repl[pat]) ? m->repl[pat]->count : 0;
+        final_len = final_len - (end - start) + repl_len;
+        pos = end;
+    }
+
+    come_string_t* res = come_string_new_len((void*)a, NULL, final_len);
+    if (!res) {
+        ac_scan_done(&sc);
+        return NULL;
+    }
+
+    // Pass 2: copy
+    char* dest = res->data;
+    pos = 0;
+    while (ac_next(&sc, pos, &start, &end, &pat)) {
+        memcpy(dest, a->data + pos, start - pos);
+        dest += start - pos;
+        if (m->repl && m->repl[pat]) {
+            memcpy(dest, m->repl[pat]->data, m->repl[pat]->count);
+            dest += m->repl[pat]->count;
+        }
+        pos = end;
+    }
+    memcpy(dest, a->data + pos, a->count - pos);
+    res->data[final_len] = '\0';
+    ac_scan_done(&sc);
+    return res;
+}
+
+long come_string_find_any(const come_string_t* a, const come_string_list_t* needles) {
+    if (!a || !needles) return -1;
+    come_string_matcher_t* m = come_string_matcher_new(NULL, needles);
+    long idx = come_string_matcher_find(m, a);
+    mem_talloc_free(m);
+    return idx;
+}
+
+size_t come_string_count_any(const come_string_t* a, const come_string_list_t* needles) {
+    if (!a || !needles) return 0;
+    come_string_matcher_t* m = come_string_matcher_new(NULL, needles);
+    size_t count = come_string_matcher_count(m, a);
+    mem_talloc_free(m);
+    return count;
+}
+
+come_string_t* come_string_replace_many(const come_string_t* a, const come_string_list_t* pairs) {
+    if (!a) return NULL;
+    if (!pairs) return come_string_new_len((void*)a, a->data, a->count);
+    come_string_matcher_t* m = come_string_replacer_new(NULL, pairs);
+    come_string_t* res = come_string_matcher_replace(m, a);
+    mem_talloc_free(m);
+    return res;
+}
+
+come_string_t* come_string_replace_many_kv(const come_string_t* a, const come_string_list_t* olds,
+                                           const come_string_list_t* news) {
+    if (!a) return NULL;
+    if (!olds || !news) return come_string_new_len((void*)a, a->data, a->count);
+    come_string_matcher_t* m = come_string_replacer_new_kv(NULL, olds, news);
+    come_string_t* res = come_string_matcher_replace(m, a);
+    mem_talloc_free(m);
+    return res;
+}
+
 void come_string_chown(come_string_t* a, TALLOC_CTX* new_ctx) {
     if (a) {
         mem_talloc_steal(new_ctx, a);
@@ -366,7 +721,7 @@ come_string_t* come_string_join(const come_string_list_t* list, const come_strin
 
     // Allocate on list context? Or sep context? Or new?
     // Usually join creates a new string. Let's use list as parent.
-    come_string_t* res = come_string_new_len((void*)list, "", total_len);
+    come_string_t* res = come_string_new_len((void*)list, NULL, total_len);
     
     char* p = res->data;
     for (size_t i = 0; i < list->size; i++) {
@@ -386,8 +741,13 @@ come_string_t* come_string_join(const come_string_list_t* list, const come_strin
 come_string_t* come_string_substr(const come_string_t* a, size_t start, size_t end) {
     if (!a) return NULL;
     // start/end are character indices, not bytes!
+    if (come_string_is_ascii_cached(a)) {
+        if (end > a->count) end = a->count;
+        if (start > end) start = end;
+        return come_string_ascii_slice(a, start, end - start);
+    }
+
     // Need to iterate UTF-8
-    
     const char* p = a->data;
     size_t char_idx = 0;
     const char* start_p = NULL;
@@ -413,163 +773,6 @@ come_string_t* come_string_substr(const come_string_t* a, size_t start, size_t e
 }
 
 
-// Regex
-bool come_string_regex(const come_string_t* a, const char* pattern) {
-    if (!a || !pattern) return false;
-    regex_t regex;
-    if (regcomp(&regex, pattern, REG_EXTENDED | REG_NOSUB) != 0) return false;
-    
-    int ret = regexec(&regex, a->data, 0, NULL, 0);
-    regfree(&regex);
-    return ret == 0;
-}
-
-come_string_list_t* come_string_regex_split(const come_string_t* a, const char* pattern, size_t n) {
-    if (!a || !pattern) return NULL;
-    
-    regex_t regex;
-    if (regcomp(&regex, pattern, REG_EXTENDED) != 0) return NULL;
-
-    // First pass: count
-    size_t count = 1;
-    const char* p = a->data;
-    regmatch_t pmatch[1];
-    size_t matches = 0;
-    
-    while (regexec(&regex, p, 1, pmatch, 0) == 0) {
-        if (n > 0 && matches >= n - 1) break;
-        // Avoid infinite loop on empty match
-        if (pmatch[0].rm_eo == pmatch[0].rm_so) {
-             p++; // Advance one char if empty match
-             if (*p == '\0') break;
-             continue;
-        }
-        count++;
-        matches++;
-        p += pmatch[0].rm_eo;
-    }
-    
-    come_string_list_t* list = mem_talloc_alloc((void*)a, sizeof(come_string_list_t) + sizeof(come_string_t*) * count);
-    list->size = count;
-    list->count = count;
-
-    // Second pass: fill
-    p = a->data;
-    matches = 0;
-    for (size_t i = 0; i < count; i++) {
-        if (regexec(&regex, p, 1, pmatch, 0) == 0 && (n == 0 || matches < n - 1)) {
-            size_t len = pmatch[0].rm_so;
-            list->items[i] = come_string_new_len(list, p, len);
-            p += pmatch[0].rm_eo;
-            matches++;
-        } else {
-            size_t len = strlen(p);
-            list->items[i] = come_string_new_len(list, p, len);
-        }
-    }
-
-    regfree(&regex);
-    return list;
-}
-
-come_string_list_t* come_string_regex_groups(const come_string_t* a, const char* pattern) {
-    if (!a || !pattern) return NULL;
-    
-    regex_t regex;
-    if (regcomp(&regex, pattern, REG_EXTENDED) != 0) return NULL;
-
-    size_t nmatch = regex.re_nsub + 1; // 0 is full match, 1..n are groups
-    regmatch_t* pmatch_vals = malloc(sizeof(regmatch_t) * nmatch);
-    
-    if (regexec(&regex, a->data, nmatch, pmatch_vals, 0) == 0) {
-        come_string_list_t* list = mem_talloc_alloc((void*)a, sizeof(come_string_list_t) + sizeof(come_string_t*) * nmatch);
-        list->size = nmatch;
-        list->count = nmatch;
-        for (size_t i = 0; i < nmatch; i++) {
-            if (pmatch_vals[i].rm_so != -1) {
-                size_t len = pmatch_vals[i].rm_eo - pmatch_vals[i].rm_so;
-                list->items[i] = come_string_new_len(list, a->data + pmatch_vals[i].rm_so, len);
-            } else {
-                list->items[i] = NULL; // Optional group not matched
-            }
-        }
-        free(pmatch_vals);
-        regfree(&regex);
-        return list;
-    }
-
-    free(pmatch_vals);
-    regfree(&regex);
-    come_string_list_t* empty = mem_talloc_alloc((void*)a, sizeof(come_string_list_t));
-    empty->size = 0;
-    empty->count = 0;
-    return empty;
-}
-
-come_string_t* come_string_regex_replace(const come_string_t* a, const char* pattern, const char* repl, size_t count) {
-    if (!a || !pattern) return NULL;
-    
-    regex_t regex;
-    if (regcomp(&regex, pattern, REG_EXTENDED) != 0) return NULL;
-
-    // We need to build the new string.
-    // Since we don't know the size, we might need a dynamic buffer or two passes.
-    // Two passes is easier.
-    
-    // Pass 1: calculate size
-    size_t new_len = 0;
-    const char* p = a->data;
-    size_t matches = 0;
-    regmatch_t pmatch[1];
-    size_t repl_len = strlen(repl);
-    
-    while (*p && (count == 0 || matches < count)) {
-        if (regexec(&regex, p, 1, pmatch, 0) == 0) {
-            new_len += pmatch[0].rm_so; // Prefix
-            new_len += repl_len;        // Replacement
-            p += pmatch[0].rm_eo;
-            matches++;
-            if (pmatch[0].rm_eo == pmatch[0].rm_so) { // Empty match
-                if (*p) { new_len++; p++; } // Advance one char
-            }
-        } else {
-            new_len += strlen(p);
-            break;
-        }
-    }
-    if (matches == count && *p) new_len += strlen(p); // Remaining
-    
-    come_string_t* res = come_string_new_len((void*)a, "", new_len);
-    
-    // Pass 2: copy
-    p = a->data;
-    char* dest = res->data;
-    matches = 0;
-    
-    while (*p && (count == 0 || matches < count)) {
-        if (regexec(&regex, p, 1, pmatch, 0) == 0) {
-            size_t prefix_len = pmatch[0].rm_so;
-            memcpy(dest, p, prefix_len);
-            dest += prefix_len;
-            memcpy(dest, repl, repl_len);
-            dest += repl_len;
-            p += pmatch[0].rm_eo;
-            matches++;
-            if (pmatch[0].rm_eo == pmatch[0].rm_so) {
-                if (*p) { *dest++ = *p++; }
-            }
-        } else {
-            strcpy(dest, p);
-            dest += strlen(p);
-            break;
-        }
-    }
-    if (matches == count && *p) strcpy(dest, p);
-    
-    regfree(&regex);
-    return res;
-}
-
 size_t come_string_list_len(const come_string_list_t* list) {
     if (!list) return 0;
     return list->count;
@@ -603,7 +806,7 @@ come_string_t* come_string_sprintf(TALLOC_CTX* ctx, const char* fmt, ...) {
         return NULL;
     }
     
-    come_string_t* s = come_string_new_len(ctx, "", len);
+    come_string_t* s = come_string_new_len(ctx, NULL, len);
     if (!s) {
         va_end(args);
         return NULL;
@@ -633,6 +836,10 @@ come_byte_array_t* come_string_to_byte_array(const come_string_t* a) {
 // Element Access
 come_string_t* come_string_at(const come_string_t* a, size_t index) {
     if (!a) return NULL;
+    if (come_string_is_ascii_cached(a)) {
+        return index < a->count ? come_string_ascii_slice(a, index, 1) : NULL;
+    }
+    if (index >= __atomic_load_n(&a->nchars, __ATOMIC_RELAXED)) return NULL; // Scanned above
     
     const char* p = a->data;
     size_t current_idx = 0;
@@ -656,7 +863,26 @@ come_string_t* come_string_at(const come_string_t* a, size_t index) {
     return NULL; // Out of bounds
 }
 
-long come_string_tol(const come_string_t* a) {
+// Leading whitespace is skipped and trailing text ignored, as with strtol/strtod;
+// errno is ERANGE on overflow
+static size_t come_string_skip_space(const come_string_t* a) {
+    size_t i = 0;
+    while (i < a->count && (a->data[i] == ' ' || (a->data[i] >= '\t' && a->data[i] <= '\r'))) i++;
+    return i;
+}
+
+long come_string_tol(const come_string_t* a, int base) {
+    if (!a) return 0;
+    long v = 0;
+    size_t i = come_string_skip_space(a);
+    come_conv_parse_long(a->data + i, a->count - i, base, &v);
+    return v;
+}
+
+double come_string_tod(const come_string_t* a) {
     if (!a) return 0;
-    return strtol(a->data, NULL, 10);
+    double v = 0;
+    size_t i = come_string_skip_space(a);
+    come_conv_parse_double(a->data + i, a->count - i, &v);
+    return v;
 }
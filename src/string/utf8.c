@@ -0,0 +1,289 @@
+#include "come_string.h"
+#include <string.h>
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#include <immintrin.h>
+#define COME_UTF8_X86 1
+#endif
+
+// UTF-8 kernels
+// Code points are counted as bytes that are not continuation bytes (10xxxxxx), which is
+// also what the count means for invalid input. Validation follows RFC 3629: no overlong
+// forms, no surrogates, nothing above U+10FFFF. The AVX2 validator is the lookup algorithm
+// of Keiser & Lemire ("Validating UTF-8 In Less Than One Instruction Per Byte"); SSE2 has
+// no byte shuffle, so there only all-ASCII blocks are skipped in bulk.
+
+// Length of the valid sequence at s[i], 0 if invalid or truncated
+static size_t utf8_seq_len(const uint8_t* s, size_t n, size_t i) {
+    uint8_t c = s[i];
+    if (c < 0x80) return 1;
+
+    size_t len;
+    uint8_t lo = 0x80, hi = 0xBF; // Allowed range of the second byte
+    if (c >= 0xC2 && c <= 0xDF) len = 2;
+    else if (c == 0xE0) { len = 3; lo = 0xA0; }
+    else if (c == 0xED) { len = 3; hi = 0x9F; }
+    else if (c >= 0xE1 && c <= 0xEF) len = 3;
+    else if (c == 0xF0) { len = 4; lo = 0x90; }
+    else if (c == 0xF4) { len = 4; hi = 0x8F; }
+    else if (c >= 0xF1 && c <= 0xF3) len = 4;
+    else return 0;
+
+    if (n - i < len) return 0;
+    if (s[i + 1] < lo || s[i + 1] > hi) return 0;
+    for (size_t k = 2; k < len; k++) {
+        if ((s[i + k] & 0xC0) != 0x80) return 0;
+    }
+    return len;
+}
+
+static bool utf8_valid_scalar(const uint8_t* s, size_t n) {
+    size_t i = 0;
+    while (i < n) {
+        size_t len = utf8_seq_len(s, n, i);
+        if (!len) return false;
+        i += len;
+    }
+    return true;
+}
+
+static size_t utf8_count_scalar(const uint8_t* s, size_t n, bool* ascii) {
+    size_t count = 0;
+    uint8_t high = 0;
+    for (size_t i = 0; i < n; i++) {
+        high |= s[i];
+        count += (s[i] & 0xC0) != 0x80;
+    }
+    *ascii = !(high & 0x80);
+    return count;
+}
+
+#ifdef COME_UTF8_X86
+
+static size_t utf8_count_sse2(const uint8_t* s, size_t n, bool* ascii) {
+    const __m128i cont_max = _mm_set1_epi8(-64); // Continuation bytes are -128..-65 as int8
+    __m128i high = _mm_setzero_si128();
+    size_t cont = 0, i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        high = _mm_or_si128(high, v);
+        cont += __builtin_popcount(_mm_movemask_epi8(_mm_cmpgt_epi8(cont_max, v)));
+    }
+    bool tail_ascii;
+    size_t count = (i - cont) + utf8_count_scalar(s + i, n - i, &tail_ascii);
+    *ascii = tail_ascii && _mm_movemask_epi8(high) == 0;
+    return count;
+}
+
+static bool utf8_valid_sse2(const uint8_t* s, size_t n) {
+    size_t i = 0;
+    while (i < n) {
+        if (i + 16 <= n && _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(s + i))) == 0) {
+            i += 16;
+            continue;
+        }
+        // Validate sequence by sequence past this block; i stays on a sequence boundary
+        size_t block_end = i + 16 < n ? i + 16 : n;
+        while (i < block_end) {
+            size_t len = utf8_seq_len(s, n, i);
+            if (!len) return false;
+            i += len;
+        }
+    }
+    return true;
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t utf8_count_avx2(const uint8_t* s, size_t n, bool* ascii) {
+    const __m256i cont_max = _mm256_set1_epi8(-64);
+    __m256i high = _mm256_setzero_si256();
+    size_t cont = 0, i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+        high = _mm256_or_si256(high, v);
+        cont += __builtin_popcount((uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(cont_max, v)));
+    }
+    bool tail_ascii;
+    size_t count = (i - cont) + utf8_count_scalar(s + i, n - i, &tail_ascii);
+    *ascii = tail_ascii && _mm256_movemask_epi8(high) == 0;
+    return count;
+}
+
+// Error classes of a (previous byte, byte) pair; a pair is invalid if all three nibble
+// lookups agree on at least one class
+#define U8_TOO_SHORT   (1 << 0) // Lead byte not followed by a continuation
+#define U8_TOO_LONG    (1 << 1) // ASCII followed by a continuation
+#define U8_OVERLONG_3  (1 << 2) // E0 80..9F
+#define U8_TOO_LARGE   (1 << 3) // F4 90..BF, F5..FF
+#define U8_SURROGATE   (1 << 4) // ED A0..BF
+#define U8_OVERLONG_2  (1 << 5) // C0, C1
+#define U8_TOO_LARGE_1000 (1 << 6) // F5..FF 80..8F
+#define U8_OVERLONG_4  (1 << 6) // F0 80..8F
+#define U8_TWO_CONTS   (1 << 7) // Continuation after continuation (checked against lead distance)
+#define U8_CARRY (U8_TOO_SHORT | U8_TOO_LONG | U8_TWO_CONTS)
+
+#define U8_TABLE(...) _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+
+__attribute__((target("avx2")))
+static inline __m256i utf8_prev(__m256i in, __m256i prev, int k) {
+    __m256i straddle = _mm256_permute2x128_si256(prev, in, 0x21);
+    switch (k) {
+    case 1: return _mm256_alignr_epi8(in, straddle, 15);
+    case 2: return _mm256_alignr_epi8(in, straddle, 14);
+    default: return _mm256_alignr_epi8(in, straddle, 13);
+    }
+}
+
+__attribute__((target("avx2")))
+static inline __m256i utf8_check_block(__m256i in, __m256i prev) {
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i byte_1_high_tbl = U8_TABLE(
+        U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+        U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+        U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS,
+        U8_TOO_SHORT | U8_OVERLONG_2,
+        U8_TOO_SHORT,
+        U8_TOO_SHORT | U8_OVERLONG_3 | U8_SURROGATE,
+        U8_TOO_SHORT | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_OVERLONG_4);
+    const __m256i byte_1_low_tbl = U8_TABLE(
+        U8_CARRY | U8_OVERLONG_3 | U8_OVERLONG_2 | U8_OVERLONG_4,
+        U8_CARRY | U8_OVERLONG_2,
+        U8_CARRY,
+        U8_CARRY,
+        U8_CARRY | U8_TOO_LARGE,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_SURROGATE,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000);
+    const __m256i byte_2_high_tbl = U8_TABLE(
+        U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+        U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+        U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE_1000 | U8_OVERLONG_4,
+        U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE,
+        U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+        U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+        U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT);
+
+    __m256i prev1 = utf8_prev(in, prev, 1);
+    __m256i b1h = _mm256_shuffle_epi8(byte_1_high_tbl, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+    __m256i b1l = _mm256_shuffle_epi8(byte_1_low_tbl, _mm256_and_si256(prev1, nibble));
+    __m256i b2h = _mm256_shuffle_epi8(byte_2_high_tbl, _mm256_and_si256(_mm256_srli_epi16(in, 4), nibble));
+    __m256i special = _mm256_and_si256(_mm256_and_si256(b1h, b1l), b2h);
+
+    // Third and fourth bytes of a sequence must be continuations, and only they may be
+    // (TWO_CONTS cancels out exactly where a continuation is required)
+    __m256i third = _mm256_subs_epu8(utf8_prev(in, prev, 2), _mm256_set1_epi8((char)(0xE0 - 0x80)));
+    __m256i fourth = _mm256_subs_epu8(utf8_prev(in, prev, 3), _mm256_set1_epi8((char)(0xF0 - 0x80)));
+    __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+    return _mm256_xor_si256(must23, special);
+}
+
+__attribute__((target("avx2")))
+static bool utf8_valid_avx2(const uint8_t* s, size_t n) {
+    // Non-zero where the block ends inside a sequence
+    const __m256i incomplete_max = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    __m256i prev = _mm256_setzero_si256();
+    __m256i error = _mm256_setzero_si256();
+    __m256i prev_incomplete = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i*)(s + i));
+        if (_mm256_movemask_epi8(in) == 0) {
+            error = _mm256_or_si256(error, prev_incomplete);
+            prev_incomplete = _mm256_setzero_si256();
+        } else {
+            error = _mm256_or_si256(error, utf8_check_block(in, prev));
+            prev_incomplete = _mm256_subs_epu8(in, incomplete_max);
+        }
+        prev = in;
+    }
+
+    if (i < n) {
+        // Zero padding reads as ASCII, so a truncated final sequence is TOO_SHORT
+        uint8_t tail[32] = { 0 };
+        memcpy(tail, s + i, n - i);
+        __m256i in = _mm256_loadu_si256((const __m256i*)tail);
+        error = _mm256_or_si256(error, utf8_check_block(in, prev));
+    } else {
+        error = _mm256_or_si256(error, prev_incomplete);
+    }
+    return _mm256_testz_si256(error, error);
+}
+
+#endif // COME_UTF8_X86
+
+static size_t (*utf8_count_impl)(const uint8_t*, size_t, bool*) = NULL;
+static bool (*utf8_valid_impl)(const uint8_t*, size_t) = NULL;
+
+static void utf8_dispatch_init(void) {
+    utf8_count_impl = utf8_count_scalar;
+    utf8_valid_impl = utf8_valid_scalar;
+#ifdef COME_UTF8_X86
+    utf8_count_impl = utf8_count_sse2;
+    utf8_valid_impl = utf8_valid_sse2;
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        utf8_count_impl = utf8_count_avx2;
+        utf8_valid_impl = utf8_valid_avx2;
+    }
+#endif
+}
+
+size_t come_utf8_count(const char* s, size_t n, bool* ascii) {
+    bool dummy;
+    if (!ascii) ascii = &dummy;
+    if (!utf8_count_impl) utf8_dispatch_init();
+    return utf8_count_impl((const uint8_t*)s, n, ascii);
+}
+
+bool come_utf8_valid(const char* s, size_t n) {
+    if (!utf8_valid_impl) utf8_dispatch_init();
+    return utf8_valid_impl((const uint8_t*)s, n);
+}
+
+size_t come_utf8_decode(const char* s, size_t n, uint32_t* cp) {
+    const uint8_t* u = (const uint8_t*)s;
+    size_t len = n ? utf8_seq_len(u, n, 0) : 0;
+    switch (len) {
+    case 1: *cp = u[0]; break;
+    case 2: *cp = (uint32_t)(u[0] & 0x1F) << 6 | (u[1] & 0x3F); break;
+    case 3: *cp = (uint32_t)(u[0] & 0x0F) << 12 | (uint32_t)(u[1] & 0x3F) << 6 | (u[2] & 0x3F); break;
+    case 4: *cp = (uint32_t)(u[0] & 0x07) << 18 | (uint32_t)(u[1] & 0x3F) << 12 |
+                  (uint32_t)(u[2] & 0x3F) << 6 | (u[3] & 0x3F); break;
+    }
+    return len;
+}
+
+size_t come_utf8_encode(uint32_t cp, char* out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | cp >> 6);
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | cp >> 12);
+        out[1] = (char)(0x80 | (cp >> 6 & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | cp >> 18);
+    out[1] = (char)(0x80 | (cp >> 12 & 0x3F));
+    out[2] = (char)(0x80 | (cp >> 6 & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
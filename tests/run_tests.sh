@@ -9,6 +9,20 @@ gcc -Wall -g -Isrc/include -Isrc/core/include tests/test_parser.c src/core/parse
 gcc -Wall -g -Isrc/include -Isrc/core/include tests/test_codegen.c src/core/parser.c src/core/lexer.c src/core/codegen.c -o build/tests/test_codegen
 ./build/tests/test_codegen
 
-gcc -Wall -g -D__STDC_WANT_LIB_EXT1__=1 -Isrc/include -Isrc/core/include -Iexternal/talloc/lib/talloc -Iexternal/talloc/lib/replace tests/test_string.c src/string/string.c src/mem/talloc.c src/core/utils.c external/talloc/lib/talloc/talloc.c -o build/tests/test_string -ldl
+gcc -Wall -g -D__STDC_WANT_LIB_EXT1__=1 -Isrc/include -Isrc/core/include -Iexternal/talloc/lib/talloc -Iexternal/talloc/lib/replace tests/test_string.c src/string/string.c src/string/regex.c src/string/utf8.c src/string/case.c src/string/hash.c src/string/rope.c src/conv/number.c src/conv/encode.c src/mem/talloc.c src/core/utils.c external/talloc/lib/talloc/talloc.c -o build/tests/test_string -ldl
 ./build/tests/test_string
 
+gcc -Wall -g -D__STDC_WANT_LIB_EXT1__=1 -Isrc/include -Isrc/core/include -Iexternal/talloc/lib/talloc -Iexternal/talloc/lib/replace tests/test_conv.c src/conv/number.c src/conv/encode.c src/string/string.c src/string/regex.c src/string/utf8.c src/string/case.c src/string/hash.c src/string/rope.c src/mem/talloc.c external/talloc/lib/talloc/talloc.c -o build/tests/test_conv -ldl
+./build/tests/test_conv
+
+gcc -Wall -g -D__STDC_WANT_LIB_EXT1__=1 -Isrc/include -Isrc/core/include -Iexternal/talloc/lib/talloc -Iexternal/talloc/lib/replace tests/test_sort.c src/array/sort.c src/array/array.c src/string/string.c src/string/regex.c src/string/utf8.c src/string/case.c src/string/hash.c src/string/rope.c src/conv/number.c src/conv/encode.c src/mem/talloc.c external/talloc/lib/talloc/talloc.c -o build/tests/test_sort -ldl -lm
+./build/tests/test_sort
+
+gcc -Wall -g -D__STDC_WANT_LIB_EXT1__=1 -Isrc/include -Isrc/core/include -Iexternal/talloc/lib/talloc -Iexternal/talloc/lib/replace tests/test_map.c src/map/map.c src/map/btree.c src/map/lru.c src/array/array.c src/string/string.c src/string/regex.c src/string/utf8.c src/string/case.c src/string/hash.c src/string/rope.c src/conv/number.c src/conv/encode.c src/mem/talloc.c external/talloc/lib/talloc/talloc.c -o build/tests/test_map -ldl -lm
+./build/tests/test_map
+
+gcc -Wall -g -D__STDC_WANT_LIB_EXT1__=1 -Isrc/include -Isrc/core/include -Iexternal/talloc/lib/talloc -Iexternal/talloc/lib/replace tests/test_queue.c src/queue/deque.c src/queue/ringbuf.c src/queue/heap.c src/array/array.c src/string/string.c src/string/regex.c src/string/utf8.c src/string/case.c src/string/hash.c src/string/rope.c src/conv/number.c src/conv/encode.c src/mem/talloc.c external/talloc/lib/talloc/talloc.c -o build/tests/test_queue -ldl -lm
+./build/tests/test_queue
+
+gcc -Wall -g -D__STDC_WANT_LIB_EXT1__=1 -Isrc/include -Isrc/core/include -Iexternal/talloc/lib/talloc -Iexternal/talloc/lib/replace tests/test_mem.c src/string/string.c src/string/regex.c src/string/utf8.c src/string/case.c src/string/hash.c src/string/rope.c src/array/array.c src/conv/number.c src/conv/encode.c src/mem/talloc.c external/talloc/lib/talloc/talloc.c -o build/tests/test_mem -ldl -lm -lpthread
+./build/tests/test_mem
@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include "come_conv.h"
+#include "mem/talloc.h"
+
+static void check_long(const char* s, int base, long expected, size_t used) {
+    long v;
+    assert(come_conv_parse_long(s, strlen(s), base, &v) == used);
+    assert(v == expected);
+}
+
+static void check_double(const char* s, double expected, size_t used) {
+    double v;
+    assert(come_conv_parse_double(s, strlen(s), &v) == used);
+    assert(v == expected);
+}
+
+static void check_format(double d, const char* expected) {
+    char buf[COME_CONV_DOUBLE_MAX];
+    size_t len = come_conv_format_double(buf, d);
+    assert(len == strlen(expected));
+    assert(memcmp(buf, expected, len) == 0);
+}
+
+void test_parse_int() {
+    check_long("12345", 10, 12345, 5);
+    check_long("-1234567890123456789x", 10, -1234567890123456789L, 20);
+    check_long("+42", 10, 42, 3);
+    check_long("ff", 16, 255, 2);
+    check_long("0x1F", 0, 31, 4);
+    check_long("0x1F", 16, 31, 4);
+    check_long("0xg", 0, 0, 1);
+    check_long("0b101", 0, 5, 5);
+    check_long("0755", 0, 493, 4);
+    check_long("zz", 36, 1295, 2);
+    check_long("9223372036854775807", 10, LONG_MAX, 19);
+    check_long("-9223372036854775808", 10, LONG_MIN, 20);
+    check_long("abc", 10, 0, 0);
+    check_long("", 10, 0, 0);
+
+    errno = 0;
+    check_long("9223372036854775808", 10, LONG_MAX, 19);
+    assert(errno == ERANGE);
+    errno = 0;
+    check_long("-99999999999999999999999", 10, LONG_MIN, 24);
+    assert(errno == ERANGE);
+    errno = 0;
+    check_long("10", 37, 0, 0);
+    assert(errno == EINVAL);
+
+    unsigned long u;
+    assert(come_conv_parse_ulong("18446744073709551615", 20, 10, &u) == 20 && u == ULONG_MAX);
+    // Length-delimited: digits past n are not read
+    assert(come_conv_parse_ulong("123456789", 4, 10, &u) == 4 && u == 1234);
+
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    assert(come_string_tol(come_string_new(ctx, "  -77 apples"), 10) == -77);
+    assert(come_string_tol(come_string_new(ctx, "7f"), 16) == 127);
+    assert(come_string_tol(come_string_new(ctx, "0x10"), 0) == 16);
+    mem_talloc_free(ctx);
+    printf("Integer parsing tests passed\n");
+}
+
+void test_parse_double() {
+    check_double("3.14159", 3.14159, 7);
+    check_double("-0.000123e+2x", -0.0123, 12);
+    check_double("1e22", 1e22, 4);
+    check_double("1.5e30", 1.5e30, 6);
+    check_double(".5", 0.5, 2);
+    check_double("5.", 5.0, 2);
+    check_double("1e", 1.0, 1);
+    check_double("12345678901234567890123", 12345678901234567890123.0, 23);
+    check_double("2.2250738585072014e-308", 2.2250738585072014e-308, 23);
+    check_double("0.1000000000000000055511151231257827", 0.1, 36);
+    check_double("-inf", -__builtin_inf(), 4);
+    check_double("Infinity", __builtin_inf(), 8);
+    check_double(".", 0, 0);
+    check_double("e5", 0, 0);
+
+    double v;
+    assert(come_conv_parse_double("nan", 3, &v) == 3 && v != v);
+    errno = 0;
+    assert(come_conv_parse_double("1e999", 5, &v) == 5 && v == __builtin_inf());
+    assert(errno == ERANGE);
+
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    assert(come_string_tod(come_string_new(ctx, " 2.5kg")) == 2.5);
+    mem_talloc_free(ctx);
+    printf("Float parsing tests passed\n");
+}
+
+void test_format() {
+    char buf[COME_CONV_LONG_MAX];
+    assert(come_conv_format_long(buf, 0) == 1 && memcmp(buf, "0", 1) == 0);
+    assert(come_conv_format_long(buf, -1205) == 5 && memcmp(buf, "-1205", 5) == 0);
+    assert(come_conv_format_long(buf, LONG_MIN) == 20 && memcmp(buf, "-9223372036854775808", 20) == 0);
+    assert(come_conv_format_ulong(buf, ULONG_MAX) == 20 && memcmp(buf, "18446744073709551615", 20) == 0);
+
+    check_format(0.1, "0.1");
+    check_format(3.0, "3.0");
+    check_format(-0.0, "-0.0");
+    check_format(1234.5, "1234.5");
+    check_format(1e16, "1e+16");
+    check_format(123456789012345.0, "123456789012345.0");
+    check_format(0.0001, "0.0001");
+    check_format(1.5e-5, "1.5e-05");
+    check_format(1.7976931348623157e308, "1.7976931348623157e+308");
+    check_format(5e-324, "5e-324");
+    check_format(-2.2250738585072014e-308, "-2.2250738585072014e-308");
+    check_format(__builtin_inf(), "inf");
+    check_format(__builtin_nan(""), "nan");
+
+    // Builder output
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_string_t* sb = come_string_builder(ctx, 4);
+    for (long i = 0; i < 100; i++) {
+        sb = come_conv_append_long(sb, i);
+        sb = come_string_append(sb, ",", 1);
+    }
+    sb = come_conv_append_double(sb, 0.25);
+    assert(sb->count == 290 + 4);
+    assert(strncmp(sb->data, "0,1,2,", 6) == 0);
+    assert(strcmp(sb->data + sb->count - 10, "98,99,0.25") == 0);
+    assert(come_string_len(sb) == sb->count);
+    assert(strcmp(come_conv_dtos(ctx, 2.5)->data, "2.5") == 0);
+    assert(strcmp(come_conv_ltos(ctx, -3)->data, "-3") == 0);
+    mem_talloc_free(ctx);
+    printf("Formatting tests passed\n");
+}
+
+static void check_base64(const char* plain, const char* std, const char* url) {
+    char out[64];
+    uint8_t back[64];
+    size_t n = strlen(plain);
+    assert(come_conv_format_base64(out, plain, n) == strlen(std) && memcmp(out, std, strlen(std)) == 0);
+    assert(come_conv_format_base64url(out, plain, n) == strlen(url) && memcmp(out, url, strlen(url)) == 0);
+    assert(come_conv_parse_base64(back, std, strlen(std)) == n && memcmp(back, plain, n) == 0);
+    assert(come_conv_parse_base64url(back, url, strlen(url)) == n && memcmp(back, plain, n) == 0);
+}
+
+void test_encode() {
+    // RFC 4648 test vectors
+    check_base64("", "", "");
+    check_base64("f", "Zg==", "Zg");
+    check_base64("fo", "Zm8=", "Zm8");
+    check_base64("foo", "Zm9v", "Zm9v");
+    check_base64("foob", "Zm9vYg==", "Zm9vYg");
+    check_base64("fooba", "Zm9vYmE=", "Zm9vYmE");
+    check_base64("foobar", "Zm9vYmFy", "Zm9vYmFy");
+    check_base64("\xfb\xff\xfe", "+//+", "-__-");
+
+    uint8_t out[256];
+    errno = 0;
+    assert(come_conv_parse_base64(out, "Zm9v!mFy", 8) == COME_CONV_INVALID && errno == EINVAL);
+    assert(come_conv_parse_base64(out, "Zm9vY", 5) == COME_CONV_INVALID);
+    assert(come_conv_parse_base64(out, "Zg==Zm8=", 8) == COME_CONV_INVALID);
+    assert(come_conv_parse_base64(out, "-__-", 4) == COME_CONV_INVALID);
+    assert(come_conv_parse_base64(out, "Zm8", 3) == 2); // Padding is optional
+
+    // Long enough for the SIMD kernels: every byte value, then back
+    uint8_t bytes[256];
+    for (int i = 0; i < 256; i++) bytes[i] = (uint8_t)i;
+    char text[COME_CONV_PERCENT_MAX(256)];
+    size_t len = come_conv_format_base64(text, bytes, 256);
+    assert(len == COME_CONV_BASE64_LEN(256));
+    assert(come_conv_parse_base64(out, text, len) == 256 && memcmp(out, bytes, 256) == 0);
+    text[100] = '*';
+    assert(come_conv_parse_base64(out, text, len) == COME_CONV_INVALID);
+
+    len = come_conv_format_hex(text, bytes, 256);
+    assert(len == 512 && memcmp(text, "000102", 6) == 0 && memcmp(text + 506, "fdfeff", 6) == 0);
+    assert(come_conv_parse_hex(out, text, len) == 256 && memcmp(out, bytes, 256) == 0);
+    assert(come_conv_parse_hex(out, "DeadBEEF", 8) == 4 && memcmp(out, "\xde\xad\xbe\xef", 4) == 0);
+    assert(come_conv_parse_hex(out, "abc", 3) == COME_CONV_INVALID);
+    assert(come_conv_parse_hex(out, "0g", 2) == COME_CONV_INVALID);
+
+    const char* query = "a b&c=d/e?f~g_h.i-j+k\xc3\xa9";
+    len = come_conv_format_percent(text, query, strlen(query));
+    const char* escaped = "a%20b%26c%3Dd%2Fe%3Ff~g_h.i-j%2Bk%C3%A9";
+    assert(len == strlen(escaped) && memcmp(text, escaped, len) == 0);
+    assert(come_conv_parse_percent(out, text, len) == strlen(query) && memcmp(out, query, strlen(query)) == 0);
+    assert(come_conv_parse_percent(out, "a+b%2b", 6) == 4 && memcmp(out, "a+b+", 4) == 0);
+    assert(come_conv_parse_percent(out, "100%", 4) == COME_CONV_INVALID);
+    assert(come_conv_parse_percent(out, "%zz", 3) == COME_CONV_INVALID);
+
+    // Strings and byte arrays
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_string_t* s = come_string_new(ctx, "hello, world");
+    come_string_t* b64 = come_conv_base64(ctx, s);
+    assert(strcmp(b64->data, "aGVsbG8sIHdvcmxk") == 0 && come_string_isascii(b64));
+    come_byte_array_t* raw = come_conv_base64_decode(ctx, b64);
+    assert(raw->count == s->count && memcmp(raw->items, s->data, s->count) == 0);
+    assert(strcmp(come_conv_hex(ctx, raw)->data, "68656c6c6f2c20776f726c64") == 0);
+    assert(come_conv_hex_decode(ctx, s) == NULL);
+    come_string_t* url = come_conv_percent(ctx, s);
+    assert(strcmp(url->data, "hello%2C%20world") == 0);
+    assert(come_string_cmp(come_conv_percent_decode(ctx, url), s, 0) == 0);
+
+    come_string_t* sb = come_string_builder(ctx, 0);
+    sb = come_string_append(sb, "data:", 5);
+    sb = come_conv_append_encoded(sb, COME_CONV_BASE64, "hi", 2);
+    assert(strcmp(sb->data, "data:aGk=") == 0);
+    mem_talloc_free(ctx);
+    printf("Encoding tests passed\n");
+}
+
+int main() {
+    test_parse_int();
+    test_parse_double();
+    test_format();
+    test_encode();
+    return 0;
+}
@@ -0,0 +1,469 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "come_map.h"
+#include "come_string.h"
+#include "mem/talloc.h"
+
+// Map tests: random operations checked against a direct-address table, string keys,
+// bulk insert and the typed macros the compiler uses; the same for ordered maps, plus
+// their key order, cursors and ranges; LRU caches checked against a recency list
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+
+static uint64_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+#define KEYS 4096
+
+static void test_int_random(void) {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_map_t* m = come_map_new(ctx, COME_MAP_INT, sizeof(int64_t), 0);
+    static int64_t ref[KEYS];
+    static bool present[KEYS];
+    uint32_t count = 0;
+    assert(m && come_map_size(m) == 0 && !come_map_find_int(m, 1));
+
+    for (int op = 0; op < 300000; op++) {
+        int64_t k = (int64_t)(rng() % KEYS) - KEYS / 2;
+        size_t r = (size_t)(k + KEYS / 2);
+        switch (rng() % 3) {
+        case 0: {
+            int64_t* v = come_map_insert_int(m, k);
+            assert(v);
+            if (!present[r]) {
+                assert(*v == 0);
+                present[r] = true;
+                count++;
+            }
+            *v = ref[r] = (int64_t)rng();
+            break;
+        }
+        case 1:
+            assert(come_map_delete_int(m, k) == present[r]);
+            if (present[r]) count--;
+            present[r] = false;
+            break;
+        default: {
+            int64_t* v = come_map_find_int(m, k);
+            assert((v != NULL) == present[r]);
+            if (v) assert(*v == ref[r]);
+        }
+        }
+        assert(come_map_size(m) == count);
+    }
+
+    uint32_t seen = 0;
+    for (long i = come_map_next(m, 0); i >= 0; i = come_map_next(m, i + 1)) {
+        int64_t k = come_map_int_key_at(m, i);
+        assert(present[k + KEYS / 2]);
+        assert(*(int64_t*)come_map_value_at(m, i) == ref[k + KEYS / 2]);
+        seen++;
+    }
+    assert(seen == count);
+
+    come_long_array_t* keys = come_map_keys(ctx, m);
+    assert(keys && keys->count == count);
+    come_long_array_t* vals = come_map_values_of(ctx, m, come_long_array_t);
+    assert(vals && vals->count == count);
+    for (uint32_t i = 0; i < count; i++) assert(vals->items[i] == ref[keys->items[i] + KEYS / 2]);
+
+    // Wrong key kind
+    assert(!come_map_find_cstr(m, "x") && !come_map_insert_cstr(m, "x"));
+
+    come_map_clear(m);
+    assert(come_map_size(m) == 0 && !come_map_find_int(m, 0));
+    mem_talloc_free(ctx);
+    printf("Int key map tests passed\n");
+}
+
+static void test_strings(void) {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_map_t* m = come_map_new(ctx, COME_MAP_STRING, sizeof(int), 16);
+    char buf[32];
+    for (int i = 0; i < 20000; i++) {
+        snprintf(buf, sizeof(buf), "key%d", i);
+        int* v = come_map_insert_cstr(m, buf);
+        assert(v && *v == 0);
+        *v = i;
+    }
+    assert(come_map_size(m) == 20000);
+    for (int i = 0; i < 20000; i += 2) {
+        snprintf(buf, sizeof(buf), "key%d", i);
+        assert(come_map_delete_cstr(m, buf));
+    }
+    assert(come_map_size(m) == 10000);
+    for (int i = 0; i < 20000; i++) {
+        snprintf(buf, sizeof(buf), "key%d", i);
+        come_string_t* s = come_string_new(ctx, buf);
+        int* a = come_map_find_cstr(m, buf);
+        int* b = come_map_find_string(m, s);
+        assert(a == b);
+        assert((a != NULL) == (i % 2 == 1));
+        if (a) assert(*a == i);
+    }
+
+    // Keys are copied: changing the caller's string does not affect the map
+    come_string_t* k = come_string_new(ctx, "mutable");
+    *(int*)come_map_insert_string(m, k) = 7;
+    k->data[0] = 'M';
+    k->flags = 0;
+    assert(come_map_find_cstr(m, "mutable") && !come_map_find_string(m, k));
+
+    // Embedded NUL and empty keys
+    *(int*)come_map_insert_str(m, "a\0b", 3) = 1;
+    *(int*)come_map_insert_str(m, "", 0) = 2;
+    assert(*(int*)come_map_find_str(m, "a\0b", 3) == 1 && !come_map_find_str(m, "a", 1));
+    assert(*(int*)come_map_find_cstr(m, "") == 2);
+
+    come_string_list_t* keys = come_map_keys(ctx, m);
+    assert(keys && keys->count == come_map_size(m));
+    mem_talloc_free(ctx);
+    printf("String key map tests passed\n");
+}
+
+static void test_bulk_and_macros(void) {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    static const char* const keys[] = {"html", "css", "js", "png"};
+    double vals[] = {1.5, 2.5, 3.5, 4.5};
+    come_map_t* m = come_map_new(ctx, COME_MAP_STRING, sizeof(double), 4);
+    assert(come_map_put_all(m, keys, vals, 4));
+    assert(come_map_size(m) == 4);
+    assert(come_map_get(m, "css", double) == 2.5);
+    assert(come_map_get(m, "gif", double) == 0.0);
+
+    come_string_t* js = come_string_new(ctx, "js");
+    assert(come_map_has(m, js) && !come_map_has(m, "gif"));
+    assert(come_map_set(m, "gif", double, 9.0));
+    assert(come_map_get(m, "gif", double) == 9.0 && come_map_size(m) == 5);
+    assert(come_map_delete(m, js) && !come_map_has(m, "js"));
+
+    come_map_t* ids = come_map_new(ctx, COME_MAP_INT, sizeof(come_string_t*), 0);
+    int64_t ikeys[] = {10, 20, 30};
+    come_string_t* names[] = {come_string_new(ctx, "ten"), come_string_new(ctx, "twenty"), js};
+    assert(come_map_put_all(ids, ikeys, names, 3));
+    assert(come_map_get(ids, 20, come_string_t*) == names[1]);
+    assert(come_map_get(ids, 40, come_string_t*) == NULL);
+    assert(come_map_set(ids, 40, come_string_t*, names[0]) && come_map_size(ids) == 4);
+    assert(come_map_delete(ids, 10) && !come_map_delete(ids, 10));
+
+    // Reserve up front, then no rehash while filling
+    come_map_t* big = come_map_new(ctx, COME_MAP_INT, sizeof(int), 0);
+    assert(come_map_reserve(big, 100000));
+    int8_t* ctrl = big->ctrl;
+    for (int i = 0; i < 100000; i++) assert(come_map_set(big, i * 7919, int, i));
+    assert(big->ctrl == ctrl && come_map_size(big) == 100000);
+    for (int i = 0; i < 100000; i++) assert(come_map_get(big, i * 7919, int) == i);
+    mem_talloc_free(ctx);
+    printf("Bulk insert and typed map tests passed\n");
+}
+
+// Walks the whole map in order, checking it against the reference table
+static void check_ordered(const come_ordered_map_t* m, const int64_t* ref, const bool* present, uint32_t count) {
+    uint32_t seen = 0;
+    int64_t prev = INT64_MIN;
+    for (come_ordered_map_iter_t it = come_ordered_map_first(m); come_ordered_map_iter_valid(&it);
+         come_ordered_map_iter_next(&it)) {
+        int64_t k = come_ordered_map_iter_int_key(&it);
+        assert(k > prev && present[k + KEYS / 2]);
+        assert(*(int64_t*)come_ordered_map_iter_value(&it) == ref[k + KEYS / 2]);
+        prev = k;
+        seen++;
+    }
+    assert(seen == count && come_ordered_map_size(m) == count);
+}
+
+static void test_ordered_random(void) {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_ordered_map_t* m = come_ordered_map_new(ctx, COME_MAP_INT, sizeof(int64_t));
+    static int64_t ref[KEYS];
+    static bool present[KEYS];
+    uint32_t count = 0;
+    assert(m && come_ordered_map_size(m) == 0 && !come_ordered_map_find_int(m, 1));
+    come_ordered_map_iter_t empty = come_ordered_map_first(m);
+    assert(!come_ordered_map_iter_valid(&empty));
+
+    // Phases that grow and shrink the tree so nodes split, borrow and merge
+    for (int op = 0; op < 400000; op++) {
+        int64_t k = (int64_t)(rng() % KEYS) - KEYS / 2;
+        size_t r = (size_t)(k + KEYS / 2);
+        uint64_t pick = rng() % 10;
+        bool growing = (op / 50000) % 2 == 0;
+        if (pick < (growing ? 6u : 2u)) {
+            int64_t* v = come_ordered_map_insert_int(m, k);
+            assert(v);
+            if (!present[r]) {
+                assert(*v == 0);
+                present[r] = true;
+                count++;
+            }
+            *v = ref[r] = (int64_t)rng();
+        } else if (pick < 8) {
+            assert(come_ordered_map_delete_int(m, k) == present[r]);
+            if (present[r]) count--;
+            present[r] = false;
+        } else {
+            int64_t* v = come_ordered_map_find_int(m, k);
+            assert((v != NULL) == present[r]);
+            if (v) assert(*v == ref[r]);
+
+            // The cursor lands on the first present key >= k
+            come_ordered_map_iter_t it = come_ordered_map_lower_bound_int(m, k);
+            size_t j = r;
+            while (j < KEYS && !present[j]) j++;
+            assert(come_ordered_map_iter_valid(&it) == (j < KEYS));
+            if (j < KEYS) assert(come_ordered_map_iter_int_key(&it) == (int64_t)j - KEYS / 2);
+        }
+        assert(come_ordered_map_size(m) == count);
+        if (op % 50000 == 49999) check_ordered(m, ref, present, count);
+    }
+    check_ordered(m, ref, present, count);
+
+    // [lo, hi) visits exactly the present keys in between
+    uint32_t in_range = 0, seen = 0;
+    for (int64_t k = -100; k < 300; k++) in_range += present[k + KEYS / 2];
+    for (come_ordered_map_iter_t it = come_ordered_map_range(m, -100, 300); come_ordered_map_iter_valid(&it);
+         come_ordered_map_iter_next(&it)) {
+        int64_t k = come_ordered_map_iter_int_key(&it);
+        assert(k >= -100 && k < 300);
+        seen++;
+    }
+    assert(seen == in_range);
+
+    come_long_array_t* keys = come_ordered_map_keys(ctx, m);
+    come_long_array_t* vals = come_ordered_map_values_of(ctx, m, come_long_array_t);
+    assert(keys && vals && keys->count == count && vals->count == count);
+    for (uint32_t i = 0; i < count; i++) {
+        assert(i == 0 || keys->items[i - 1] < keys->items[i]);
+        assert(vals->items[i] == ref[keys->items[i] + KEYS / 2]);
+    }
+
+    // Empty it completely, then reuse it
+    for (int64_t k = -KEYS / 2; k < KEYS / 2; k++) {
+        if (present[k + KEYS / 2]) assert(come_ordered_map_delete_int(m, k));
+        present[k + KEYS / 2] = false;
+    }
+    check_ordered(m, ref, present, 0);
+    assert(come_ordered_map_set(m, 5, int64_t, 25) && come_ordered_map_get(m, 5, int64_t) == 25);
+    assert(!come_ordered_map_find_cstr(m, "x") && !come_ordered_map_insert_cstr(m, "x"));
+    come_ordered_map_clear(m);
+    assert(come_ordered_map_size(m) == 0 && !come_ordered_map_find_int(m, 5));
+    mem_talloc_free(ctx);
+    printf("Ordered map tests passed\n");
+}
+
+static void test_ordered_strings(void) {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    enum { N = 10000 };
+
+    // Ascending keys into an empty map are bulk loaded; the result must behave like a
+    // map built one insert at a time
+    static char bufs[N][16];
+    static const char* keys[N];
+    static int vals[N];
+    for (int i = 0; i < N; i++) {
+        snprintf(bufs[i], sizeof(bufs[i]), "k%05d", i);
+        keys[i] = bufs[i];
+        vals[i] = i;
+    }
+    come_ordered_map_t* bulk = come_ordered_map_new(ctx, COME_MAP_STRING, sizeof(int));
+    come_ordered_map_t* one = come_ordered_map_new(ctx, COME_MAP_STRING, sizeof(int));
+    assert(come_ordered_map_put_all(bulk, keys, vals, N));
+    for (int i = N - 1; i >= 0; i--) assert(come_ordered_map_set(one, keys[i], int, i));
+    assert(come_ordered_map_size(bulk) == N && come_ordered_map_size(one) == N);
+    for (int i = 0; i < N; i++) {
+        assert(come_ordered_map_get(bulk, keys[i], int) == i && come_ordered_map_get(one, keys[i], int) == i);
+    }
+
+    // Delete most keys from the bulk-loaded tree, then check order and lookups
+    for (int i = 0; i < N; i++) {
+        if (i % 7) assert(come_ordered_map_delete_cstr(bulk, keys[i]));
+    }
+    assert(come_ordered_map_size(bulk) == (N + 6) / 7);
+    int expect = 0;
+    for (come_ordered_map_iter_t it = come_ordered_map_first(bulk); come_ordered_map_iter_valid(&it);
+         come_ordered_map_iter_next(&it), expect += 7) {
+        assert(strcmp(come_ordered_map_iter_string_key(&it)->data, keys[expect]) == 0);
+        assert(*(int*)come_ordered_map_iter_value(&it) == expect);
+    }
+    assert(expect == (N + 6) / 7 * 7);
+
+    // Lower bound between keys, and string ranges
+    come_ordered_map_iter_t it = come_ordered_map_lower_bound(one, "k00100x");
+    assert(come_ordered_map_iter_valid(&it) && strcmp(come_ordered_map_iter_string_key(&it)->data, "k00101") == 0);
+    it = come_ordered_map_lower_bound(one, "z");
+    assert(!come_ordered_map_iter_valid(&it));
+    come_string_t* lo = come_string_new(ctx, "k00500");
+    come_string_t* hi = come_string_new(ctx, "k00600");
+    int n = 0;
+    for (it = come_ordered_map_range(one, lo, hi); come_ordered_map_iter_valid(&it); come_ordered_map_iter_next(&it)) n++;
+    assert(n == 100);
+    n = 0;
+    for (it = come_ordered_map_range(one, "k09990", "l"); come_ordered_map_iter_valid(&it); come_ordered_map_iter_next(&it)) n++;
+    assert(n == 10);
+
+    // Keys are copied, embedded NULs and the empty key sort bytewise
+    *(int*)come_ordered_map_insert_str(one, "a\0b", 3) = 1;
+    *(int*)come_ordered_map_insert_str(one, "a", 1) = 2;
+    *(int*)come_ordered_map_insert_str(one, "", 0) = 3;
+    it = come_ordered_map_first(one);
+    assert(come_ordered_map_iter_string_key(&it)->count == 0);
+    come_ordered_map_iter_next(&it);
+    assert(come_ordered_map_iter_string_key(&it)->count == 1);
+    come_ordered_map_iter_next(&it);
+    assert(come_ordered_map_iter_string_key(&it)->count == 3 && *(int*)come_ordered_map_iter_value(&it) == 1);
+
+    come_string_list_t* names = come_ordered_map_keys(ctx, one);
+    assert(names && names->count == N + 3);
+    mem_talloc_free(ctx);
+    printf("Ordered map string and bulk load tests passed\n");
+}
+
+#define LRU_CAP 64
+
+// Reference for the cache: keys most recently used first
+static int64_t lru_ref[LRU_CAP + 1];
+static uint32_t lru_ref_count;
+
+static long lru_ref_find(int64_t key) {
+    for (uint32_t i = 0; i < lru_ref_count; i++) {
+        if (lru_ref[i] == key) return i;
+    }
+    return -1;
+}
+
+static void lru_ref_remove(long i) {
+    memmove(lru_ref + i, lru_ref + i + 1, (lru_ref_count - i - 1) * sizeof(int64_t));
+    lru_ref_count--;
+}
+
+static void lru_ref_touch(int64_t key) {
+    long i = lru_ref_find(key);
+    if (i >= 0) lru_ref_remove(i);
+    memmove(lru_ref + 1, lru_ref, lru_ref_count * sizeof(int64_t));
+    lru_ref[0] = key;
+    lru_ref_count++;
+}
+
+static void test_lru_random(void) {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_lru_t* c = come_lru_new(ctx, COME_MAP_INT, sizeof(int64_t), COME_LRU_VALUE_PLAIN, LRU_CAP, 0);
+    static int64_t vals[256];
+    assert(c && come_lru_size(c) == 0 && !come_lru_find_int(c, 1) && !come_lru_find_cstr(c, "a"));
+
+    for (int op = 0; op < 100000; op++) {
+        int64_t key = (int64_t)(rng() % 256) - 128, v = (int64_t)rng();
+        long i = lru_ref_find(key);
+        switch (rng() % 4) {
+        case 0:
+            assert(come_lru_set(c, key, int64_t, v));
+            vals[key + 128] = v;
+            lru_ref_touch(key);
+            if (lru_ref_count > LRU_CAP) lru_ref_count--;
+            break;
+        case 1:
+            assert(come_lru_get(c, key, int64_t) == (i >= 0 ? vals[key + 128] : 0));
+            if (i >= 0) lru_ref_touch(key);
+            break;
+        case 2:
+            assert(come_lru_peek(c, key, int64_t) == (i >= 0 ? vals[key + 128] : 0));
+            assert(come_lru_has(c, key) == (i >= 0));
+            break;
+        default:
+            assert(come_lru_delete(c, key) == (i >= 0));
+            if (i >= 0) lru_ref_remove(i);
+        }
+        assert(come_lru_size(c) == lru_ref_count && come_map_size(c->index) == lru_ref_count);
+        if (op % 1000 == 0) {
+            come_long_array_t* keys = come_lru_keys(ctx, c);
+            assert(keys->count == lru_ref_count && memcmp(keys->items, lru_ref, lru_ref_count * sizeof(int64_t)) == 0);
+            mem_talloc_free(keys);
+        }
+    }
+    size_t per_entry = come_lru_bytes(c) / come_lru_size(c);
+    assert(come_lru_bytes(c) == per_entry * come_lru_size(c));
+    come_lru_clear(c);
+    assert(come_lru_size(c) == 0 && come_lru_bytes(c) == 0 && !come_lru_has(c, lru_ref[0]));
+    assert(come_lru_set(c, 5, int64_t, 50) && come_lru_get(c, 5, int64_t) == 50);
+    mem_talloc_free(ctx);
+    printf("LRU random tests passed\n");
+}
+
+static int freed_values;
+
+static int count_free(void* p) {
+    (void)p;
+    freed_values++;
+    return 0;
+}
+
+static void test_lru_bytes(void) {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_lru_t* c = come_lru_new(ctx, COME_MAP_STRING, 0, COME_LRU_VALUE_STRING, 0, 4096);
+    assert(c && c->val_size == sizeof(come_string_t*));
+
+    // Values are copies owned by their entries; evicting an entry frees its copy
+    come_string_t* body = come_string_new_len(ctx, NULL, 1000);
+    memset(body->data, 'x', 1000);
+    body->count = 1000;
+    char key[32];
+    for (int i = 0; i < 3; i++) {
+        snprintf(key, sizeof(key), "/page/%d", i);
+        assert(come_lru_set(c, key, come_string_t*, body));
+        come_string_t* copy = come_lru_peek(c, key, come_string_t*);
+        assert(copy != body && copy->count == 1000 && mem_talloc_parent(mem_talloc_parent(copy)) == c);
+        mem_talloc_set_destructor(copy, count_free);
+    }
+    size_t each = come_lru_bytes(c) / 3;
+    assert(come_lru_size(c) == 3 && each > 1000 && come_lru_bytes(c) == 3 * each);
+
+    // Using /page/0 makes /page/1 the least recently used, so it goes first
+    assert(come_lru_get(c, "/page/0", come_string_t*));
+    assert(come_lru_set(c, "/page/3", come_string_t*, body));
+    assert(come_lru_size(c) == 3 && freed_values == 1 && !come_lru_has(c, "/page/1"));
+    come_string_list_t* keys = come_lru_keys(ctx, c);
+    assert(keys->count == 3 && strcmp(keys->items[0]->data, "/page/3") == 0 &&
+           strcmp(keys->items[1]->data, "/page/0") == 0 && strcmp(keys->items[2]->data, "/page/2") == 0);
+
+    // Replacing a value frees the old copy and updates the cost; a string the cache owns
+    // is moved in rather than copied
+    come_string_t* small = come_string_new(ctx, "tiny");
+    assert(come_lru_set(c, "/page/2", come_string_t*, small) && freed_values == 2);
+    assert(come_lru_bytes(c) == 3 * each - 996);
+    come_string_t* owned = come_string_new(c, "moved");
+    assert(come_lru_set(c, "/page/0", come_string_t*, owned) && freed_values == 3);
+    assert(come_lru_peek(c, "/page/0", come_string_t*) == owned && mem_talloc_parent(mem_talloc_parent(owned)) == c);
+    assert(strcmp(come_lru_get(c, "/page/2", come_string_t*)->data, "tiny") == 0);
+
+    // An entry over the whole budget is not kept, and pushes everything else out
+    come_string_t* huge = come_string_new_len(ctx, NULL, 5000);
+    huge->count = 5000;
+    assert(!come_lru_set(c, "/huge", come_string_t*, huge));
+    assert(come_lru_size(c) == 0 && come_lru_bytes(c) == 0 && freed_values == 3);
+    assert(come_map_size(c->index) == 0);
+
+    // NULL values and a count limit together with the byte limit
+    come_lru_t* d = come_lru_new(ctx, COME_MAP_STRING, 0, COME_LRU_VALUE_STRING, 2, 1 << 20);
+    assert(come_lru_set(d, "a", come_string_t*, NULL) && come_lru_has(d, "a") && !come_lru_get(d, "a", come_string_t*));
+    assert(come_lru_set(d, "b", come_string_t*, small) && come_lru_set(d, "c", come_string_t*, small));
+    assert(come_lru_size(d) == 2 && !come_lru_has(d, "a"));
+    assert(come_lru_delete(d, "b") && !come_lru_delete(d, "b") && come_lru_size(d) == 1);
+    mem_talloc_free(ctx);
+    printf("LRU byte limit tests passed\n");
+}
+
+int main(void) {
+    test_int_random();
+    test_strings();
+    test_bulk_and_macros();
+    test_ordered_random();
+    test_ordered_strings();
+    test_lru_random();
+    test_lru_bytes();
+    return 0;
+}
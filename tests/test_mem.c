@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "mem/talloc.h"
+#include "come_string.h"
+#include "talloc.h"
+
+// Memory tests: per-thread roots under concurrent allocation, roots freed as threads
+// exit, subtrees handed from producer threads to a consumer, runtime singletons outliving
+// the thread that made them, and allocation statistics, exact (the tests above run with
+// them on too) and sampled in a child process, which also bound the scratch memory of a
+// regex scan
+
+#define THREADS 8
+#define ROUNDS 20000
+#define PARCELS 2000
+#define PARCEL_ITEMS 16
+
+static int roots_freed = 0;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t changed = PTHREAD_COND_INITIALIZER;
+
+static int count_free(void* ptr) {
+    (void)ptr;
+    __atomic_add_fetch(&roots_freed, 1, __ATOMIC_SEQ_CST);
+    return 0;
+}
+
+static void* roots[THREADS];
+static pthread_barrier_t all_running;
+
+// Allocates and frees under the thread's root, then waits with every other thread
+// alive while main compares the roots
+static void* churn(void* arg) {
+    size_t me = (size_t)arg;
+    unsigned seed = (unsigned)me + 1;
+    void* live[64] = {0};
+    for (int i = 0; i < ROUNDS; i++) {
+        seed = seed * 1103515245 + 12345;
+        int slot = (seed >> 16) % 64;
+        mem_talloc_free(live[slot]);
+        live[slot] = (seed >> 8) & 1 ? mem_talloc_alloc(NULL, 16 + (seed >> 20) % 256)
+                                     : mem_talloc_new_ctx(NULL);
+        assert(live[slot]);
+    }
+    roots[me] = mem_talloc_parent(live[0]);
+    for (int i = 0; i < 64; i++) assert(mem_talloc_parent(live[i]) == roots[me]);
+    // Left for the root to free at thread exit
+    mem_talloc_set_destructor(live[0], count_free);
+    pthread_barrier_wait(&all_running);
+    pthread_barrier_wait(&all_running);
+    return NULL;
+}
+
+static void test_thread_roots(void) {
+    pthread_t t[THREADS];
+    roots_freed = 0;
+    assert(pthread_barrier_init(&all_running, NULL, THREADS + 1) == 0);
+    for (size_t i = 0; i < THREADS; i++) assert(pthread_create(&t[i], NULL, churn, (void*)i) == 0);
+    pthread_barrier_wait(&all_running);
+    void* mine = mem_talloc_alloc(NULL, 8);
+    for (int i = 0; i < THREADS; i++) {
+        assert(roots[i] && roots[i] != mem_talloc_parent(mine));
+        for (int j = 0; j < i; j++) assert(roots[i] != roots[j]);
+    }
+    mem_talloc_free(mine);
+    pthread_barrier_wait(&all_running);
+    for (int i = 0; i < THREADS; i++) assert(pthread_join(t[i], NULL) == 0);
+    assert(__atomic_load_n(&roots_freed, __ATOMIC_SEQ_CST) == THREADS);
+    pthread_barrier_destroy(&all_running);
+    printf("Thread root tests passed\n");
+}
+
+// One-slot mailbox between producers and the consumer
+static void* mailbox = NULL;
+static int produced = 0;
+
+typedef struct {
+    int id;
+    int items[PARCEL_ITEMS];
+    char* label; // A child of the parcel
+} parcel_t;
+
+static void* produce(void* arg) {
+    int base = (int)(size_t)arg;
+    for (int n = 0; n < PARCELS; n++) {
+        parcel_t* parcel = mem_talloc_alloc(NULL, sizeof(parcel_t));
+        parcel->id = base + n;
+        for (int i = 0; i < PARCEL_ITEMS; i++) parcel->items[i] = parcel->id + i;
+        parcel->label = mem_talloc_alloc(parcel, 32);
+        snprintf(parcel->label, 32, "parcel %d", parcel->id);
+        assert(mem_talloc_detach(parcel) == parcel && !mem_talloc_parent(parcel));
+
+        pthread_mutex_lock(&lock);
+        while (mailbox) pthread_cond_wait(&changed, &lock);
+        mailbox = parcel;
+        produced++;
+        pthread_cond_broadcast(&changed);
+        pthread_mutex_unlock(&lock);
+    }
+    return NULL;
+}
+
+static void test_handoff(void) {
+    pthread_t t[THREADS];
+    for (size_t i = 0; i < THREADS; i++) {
+        assert(pthread_create(&t[i], NULL, produce, (void*)(i * 1000000)) == 0);
+    }
+    void* inbox = mem_talloc_new_ctx(NULL);
+    for (int got = 0; got < THREADS * PARCELS; got++) {
+        pthread_mutex_lock(&lock);
+        while (!mailbox) pthread_cond_wait(&changed, &lock);
+        parcel_t* parcel = mailbox;
+        mailbox = NULL;
+        pthread_cond_broadcast(&changed);
+        pthread_mutex_unlock(&lock);
+
+        assert(mem_talloc_adopt(inbox, parcel) == parcel && mem_talloc_parent(parcel) == inbox);
+        // The subtree came along
+        char want[32];
+        snprintf(want, sizeof(want), "parcel %d", parcel->id);
+        assert(mem_talloc_parent(parcel->label) == parcel && strcmp(parcel->label, want) == 0);
+        for (int i = 0; i < PARCEL_ITEMS; i++) assert(parcel->items[i] == parcel->id + i);
+        // Every 100th parcel is kept until the inbox goes
+        if (got % 100) mem_talloc_free(parcel);
+    }
+    for (int i = 0; i < THREADS; i++) assert(pthread_join(t[i], NULL) == 0);
+    assert(produced == THREADS * PARCELS);
+    mem_talloc_free(inbox);
+    printf("Hand-off tests passed\n");
+}
+
+static void test_detach_refused(void) {
+    void* a = mem_talloc_new_ctx(NULL);
+    void* b = mem_talloc_new_ctx(NULL);
+    void* obj = mem_talloc_alloc(a, 8);
+    assert(mem_talloc_reference(b, obj));
+    errno = 0;
+    assert(!mem_talloc_detach(obj) && errno == EBUSY && mem_talloc_parent(obj) == a);
+    assert(mem_talloc_unlink(b, obj) == 0);
+    assert(mem_talloc_detach(obj) == obj && !mem_talloc_parent(obj));
+    assert(mem_talloc_adopt(b, obj) == obj && mem_talloc_parent(obj) == b);
+    assert(!mem_talloc_detach(NULL) && !mem_talloc_adopt(b, NULL));
+    mem_talloc_free(a);
+    mem_talloc_free(b);
+    printf("Detach tests passed\n");
+}
+
+static void test_escape(void) {
+    void* outer = mem_talloc_new_ctx(NULL);
+    void* scope = mem_talloc_pool(outer, 4096);
+    char* parent = mem_talloc_alloc(scope, 16);
+    char* deep = mem_talloc_alloc(parent, 16); // Two levels down in the pool
+    char* elsewhere = mem_talloc_alloc(outer, 16);
+    strcpy(deep, "escaped");
+    assert(mem_talloc_escape(scope, outer, deep) == deep && mem_talloc_parent(deep) == outer);
+    assert(mem_talloc_escape(scope, outer, elsewhere) == elsewhere && mem_talloc_parent(elsewhere) == outer);
+    assert(mem_talloc_escape(scope, outer, NULL) == NULL);
+    mem_talloc_free(scope);
+    // The pool's block outlives the pool while the escaped block is in it
+    assert(strcmp(deep, "escaped") == 0);
+    mem_talloc_free(outer);
+    printf("Escape tests passed\n");
+}
+
+static void test_stats(void) {
+    mem_talloc_free(mem_talloc_new_ctx(NULL));
+    assert(mem_talloc_stats_period() == 1);
+    mem_talloc_stats_t before = mem_talloc_stats(NULL);
+    void* ctx = mem_talloc_new_ctx(NULL);
+    void* blocks[10];
+    int line = __LINE__ + 2;
+    for (int i = 0; i < 10; i++) {
+        COME_MEM_SITE(); blocks[i] = mem_talloc_alloc(ctx, 100);
+    }
+    mem_talloc_stats_t st = mem_talloc_stats(NULL);
+    // The context is a block of its own
+    assert(st.allocs - before.allocs == 11 && st.bytes - before.bytes == 1000);
+    assert(st.live - before.live == 11 && st.live_bytes - before.live_bytes == 1000);
+    assert(st.peak_bytes >= st.live_bytes);
+
+    // A tracked block is named after its site
+    char site[256];
+    snprintf(site, sizeof(site), "%s:%d", __FILE__, line);
+    assert(strcmp(talloc_get_name(blocks[3]), site) == 0);
+
+    // Growth counts as bytes requested; the name survives
+    blocks[0] = mem_talloc_realloc(ctx, blocks[0], 300);
+    st = mem_talloc_stats(NULL);
+    assert(st.bytes - before.bytes == 1200 && st.live_bytes - before.live_bytes == 1200);
+    assert(strcmp(talloc_get_name(blocks[0]), site) == 0);
+
+    // A destructor set on a tracked block runs, and the block still leaves the counts
+    roots_freed = 0;
+    mem_talloc_set_destructor(blocks[1], count_free);
+    mem_talloc_free(blocks[1]);
+    assert(__atomic_load_n(&roots_freed, __ATOMIC_SEQ_CST) == 1);
+    st = mem_talloc_stats(NULL);
+    assert(st.live - before.live == 10 && st.live_bytes - before.live_bytes == 1100);
+
+    // Per context: its subtree, itself included
+    mem_talloc_stats_t mine = mem_talloc_stats(ctx);
+    assert(mine.live == 10 && mine.live_bytes == 1100);
+
+    char* text = NULL;
+    size_t len = 0;
+    FILE* f = open_memstream(&text, &len);
+    mem_talloc_stats_report(f);
+    fclose(f);
+    assert(strstr(text, site) && strstr(text, "peak"));
+    free(text);
+
+    mem_talloc_free(ctx);
+    st = mem_talloc_stats(NULL);
+    assert(st.live == before.live && st.live_bytes == before.live_bytes);
+    printf("Stats tests passed\n");
+}
+
+// Run in a child with COME_MEM_STATS=16: the totals are estimates from the samples
+static void test_stats_sampled(void) {
+    mem_talloc_free(mem_talloc_new_ctx(NULL));
+    assert(mem_talloc_stats_period() == 16);
+    mem_talloc_stats_t before = mem_talloc_stats(NULL);
+    void* ctx = mem_talloc_new_ctx(NULL);
+    enum { N = 200000 };
+    void** blocks = malloc(N * sizeof(void*));
+    for (int i = 0; i < N; i++) blocks[i] = mem_talloc_alloc(ctx, 64);
+    mem_talloc_stats_t st = mem_talloc_stats(NULL);
+    double allocs = (double)(st.allocs - before.allocs);
+    double live_bytes = (double)(st.live_bytes - before.live_bytes);
+    assert(allocs > N * 0.95 && allocs < N * 1.05);
+    assert(live_bytes > N * 64 * 0.95 && live_bytes < N * 64 * 1.05);
+    for (int i = 0; i < N; i += 2) mem_talloc_free(blocks[i]);
+    st = mem_talloc_stats(NULL);
+    double live = (double)(st.live - before.live);
+    assert(live > N / 2 * 0.9 && live < N / 2 * 1.1);
+    mem_talloc_free(ctx);
+    free(blocks);
+    st = mem_talloc_stats(NULL);
+    assert(st.live == before.live && st.live_bytes == before.live_bytes);
+    printf("Sampled stats tests passed\n");
+}
+
+// The longest-end memo of a regex scan is capped, however far a scan runs past its match
+static void test_regex_scan_memory(void) {
+    void* ctx = mem_talloc_new_ctx(NULL);
+    come_regex_t* longer = come_regex_dfa(ctx, "a|a*b");
+    enum { N = 4 << 20 };
+    come_string_t* big = come_string_repeat(come_string_new(ctx, "a"), N);
+    mem_talloc_stats_t before = mem_talloc_stats(NULL);
+    come_string_list_t* groups = come_regex_groups(longer, big);
+    mem_talloc_stats_t st = mem_talloc_stats(NULL);
+    assert(groups && groups->count == 1 && groups->items[0]->count == 1);
+    // The starts bitmap is N / 8 bytes. The memo tops out at 1.5 MB (2.25 MB while its last
+    // growth copies it), the path at 128 KB; the rest is the DFA.
+    assert(st.peak_bytes - before.live_bytes < N / 8 + (3 << 20));
+    mem_talloc_free(ctx);
+    printf("Regex scan memory tests passed\n");
+}
+
+#define WORDS 500
+
+static come_string_t* canonical[WORDS]; // First interned string seen for "word i"
+
+// The interner and the regex cache are made by whichever thread uses them first
+static void* use_singletons(void* arg) {
+    size_t me = (size_t)arg;
+    void* ctx = mem_talloc_new_ctx(NULL);
+    char text[32];
+    for (int i = 0; i < 2000; i++) {
+        int w = (int)((i * 7 + me) % WORDS);
+        snprintf(text, sizeof(text), "word %d", w);
+        come_string_t* s = come_string_new(ctx, text);
+        come_string_t* c = come_string_intern(s);
+        assert(c && c != s && strcmp(c->data, text) == 0);
+        come_string_t* seen = NULL;
+        if (!__atomic_compare_exchange_n(&canonical[w], &seen, c, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+            assert(seen == c);
+        }
+        assert(come_string_regex(s, "^word [0-9]+$"));
+        mem_talloc_free(s);
+    }
+    mem_talloc_free(ctx);
+    return NULL;
+}
+
+static void test_singletons(void) {
+    // A worker makes both and exits, taking its root with it
+    pthread_t t[THREADS];
+    assert(pthread_create(&t[0], NULL, use_singletons, (void*)0) == 0);
+    assert(pthread_join(t[0], NULL) == 0);
+
+    come_string_t* a = come_string_new(NULL, "word 3");
+    come_string_t* c = come_string_intern(a);
+    assert(c && c == canonical[3]);
+    assert(come_string_regex(a, "^word [0-9]+$") && !come_string_regex(a, "^[0-9]"));
+
+    // Then many at once
+    for (size_t i = 0; i < THREADS; i++) assert(pthread_create(&t[i], NULL, use_singletons, (void*)i) == 0);
+    for (int i = 0; i < THREADS; i++) assert(pthread_join(t[i], NULL) == 0);
+    assert(come_string_intern(a) == c);
+    for (int i = 0; i < WORDS; i++) {
+        char text[32];
+        snprintf(text, sizeof(text), "word %d", i);
+        come_string_t* s = come_string_new(NULL, text);
+        assert(come_string_intern(s) == canonical[i]);
+        mem_talloc_free(s);
+    }
+    mem_talloc_free(a);
+    printf("Singleton tests passed\n");
+}
+
+int main(void) {
+    // Statistics start with the first root, so the modes are chosen before any allocation
+    fflush(stdout);
+    pid_t child = fork();
+    assert(child >= 0);
+    if (child == 0) {
+        setenv("COME_MEM_STATS", "16", 1);
+        test_stats_sampled();
+        fflush(stdout);
+        _exit(0);
+    }
+    int status = 0;
+    assert(waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    setenv("COME_MEM_STATS", "1", 1);
+
+    test_stats();
+    test_regex_scan_memory();
+    test_escape();
+    test_thread_roots();
+    test_handoff();
+    test_detach_refused();
+    test_singletons();
+    mem_talloc_module_shutdown();
+    return 0;
+}
@@ -0,0 +1,340 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "come_queue.h"
+#include "mem/talloc.h"
+
+// Queue tests: deque operations at both ends checked against a plain array, growth
+// while wrapped, heap order and handles checked against a scanned table, and ringbuf
+// regions, copies and recv/send over a socket pair
+
+static uint64_t rng_state = 0x2545f4914f6cdd1dull;
+
+static uint64_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+#define REF 100000
+
+static void test_deque_random(void) {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_deque_t* d = come_deque_new(ctx, sizeof(int64_t), 0);
+    // Reference: elements ref[lo..hi), started in the middle so both ends can grow
+    static int64_t ref[2 * REF];
+    uint32_t lo = REF, hi = REF;
+    assert(d && come_deque_size(d) == 0 && !come_deque_at(d, 0));
+    assert(come_deque_pop_front(d, int64_t) == 0 && come_deque_pop_back(d, int64_t) == 0);
+
+    for (int op = 0; op < 200000; op++) {
+        int64_t v = (int64_t)rng();
+        switch (rng() % 5) {
+        case 0:
+            assert(come_deque_push_back(d, int64_t, v));
+            ref[hi++] = v;
+            break;
+        case 1:
+            assert(come_deque_push_front(d, int64_t, v));
+            ref[--lo] = v;
+            break;
+        case 2:
+            assert(come_deque_pop_front(d, int64_t) == (lo < hi ? ref[lo] : 0));
+            if (lo < hi) lo++;
+            break;
+        case 3:
+            assert(come_deque_pop_back(d, int64_t) == (lo < hi ? ref[hi - 1] : 0));
+            if (lo < hi) hi--;
+            break;
+        default:
+            if (lo < hi) {
+                uint32_t i = (uint32_t)(rng() % (hi - lo));
+                assert(come_deque_get(d, i, int64_t) == ref[lo + i]);
+                assert(come_deque_set(d, i, int64_t, v));
+                ref[lo + i] = v;
+                assert(come_deque_front(d, int64_t) == ref[lo] && come_deque_back(d, int64_t) == ref[hi - 1]);
+            }
+        }
+        assert(come_deque_size(d) == hi - lo);
+        assert(d->cap == 0 || (d->cap & (d->cap - 1)) == 0);
+    }
+
+    come_long_array_t* vals = come_deque_values_of(ctx, d, come_long_array_t);
+    assert(vals && vals->count == hi - lo);
+    for (uint32_t i = 0; i < vals->count; i++) assert(vals->items[i] == ref[lo + i]);
+    assert(!come_deque_get(d, hi - lo, int64_t) && !come_deque_set(d, hi - lo, int64_t, 1));
+    mem_talloc_free(ctx);
+    printf("Deque random tests passed\n");
+}
+
+typedef struct {
+    int id;
+    double weight;
+    char tag[20];
+} job_t;
+
+static void test_deque_wrap(void) {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_deque_t* d = come_deque_new(ctx, sizeof(job_t), 8);
+    assert(d && d->cap == 8);
+
+    // Walk head around the buffer, then grow while the elements wrap
+    for (int i = 0; i < 6; i++) assert(come_deque_push_back(d, job_t, ((job_t){.id = i})));
+    for (int i = 0; i < 5; i++) assert(come_deque_pop_front(d, job_t).id == i);
+    for (int i = 6; i < 13; i++) assert(come_deque_push_back(d, job_t, ((job_t){.id = i, .weight = i * 0.5})));
+    assert(d->cap == 8 && d->head + come_deque_size(d) > d->cap);
+    assert(come_deque_push_front(d, job_t, ((job_t){.id = 4})));
+    assert(come_deque_push_back(d, job_t, ((job_t){.id = 13})));
+    assert(d->cap == 16 && come_deque_size(d) == 10);
+    for (int i = 4; i < 14; i++) {
+        job_t j = come_deque_pop_front(d, job_t);
+        assert(j.id == i);
+    }
+    assert(come_deque_size(d) == 0 && come_deque_pop_back(d, job_t).id == 0);
+
+    // reserve keeps the order and prevents reallocation
+    for (int i = 0; i < 5; i++) assert(come_deque_push_front(d, job_t, ((job_t){.id = i})));
+    assert(come_deque_reserve(d, 1000) && d->cap == 1024);
+    unsigned char* items = d->items;
+    for (int i = 5; i < 1000; i++) assert(come_deque_push_front(d, job_t, ((job_t){.id = i})));
+    assert(d->items == items);
+    for (int i = 0; i < 1000; i++) assert(come_deque_get(d, (uint32_t)i, job_t).id == 999 - i);
+    come_deque_clear(d);
+    assert(come_deque_size(d) == 0 && d->cap == 1024);
+    mem_talloc_free(ctx);
+    printf("Deque wrap and growth tests passed\n");
+}
+
+#define HEAP_REF 4096
+
+// Reference for the heap: every pushed value with its handle, priority and whether it
+// is still queued; the minimum is found by a scan
+typedef struct {
+    int64_t handle;
+    int64_t priority;
+    int64_t value;
+    bool queued;
+} heap_ref_t;
+
+static void test_heap_random(void) {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_heap_t* h = come_heap_new(ctx, sizeof(int64_t), 0);
+    static heap_ref_t ref[HEAP_REF];
+    uint32_t n = 0, queued = 0;
+    assert(h && come_heap_size(h) == 0 && !come_heap_top(h) && come_heap_pop(h, int64_t) == 0);
+    assert(come_heap_top_priority(h) == INT64_MAX);
+
+    for (int op = 0; op < 200000; op++) {
+        uint32_t r = n ? (uint32_t)(rng() % n) : 0;
+        switch (rng() % 5) {
+        case 0:
+        case 1:
+            if (n < HEAP_REF) {
+                // Few distinct priorities, so ties are common
+                int64_t p = (int64_t)(rng() % 64) - 32, v = (int64_t)rng();
+                int64_t k = come_heap_push(h, int64_t, v, p);
+                assert(k >= 0 && come_heap_get(h, k, int64_t) == v && come_heap_priority(h, k) == p);
+                ref[n++] = (heap_ref_t){k, p, v, true};
+                queued++;
+            }
+            break;
+        case 2: {
+            int64_t least = INT64_MAX;
+            for (uint32_t i = 0; i < n; i++) {
+                if (ref[i].queued && ref[i].priority < least) least = ref[i].priority;
+            }
+            assert(come_heap_top_priority(h) == least);
+            int64_t* p = come_heap_take(h);
+            assert(!p == !queued);
+            if (!p) break;
+            // Ties pop in no particular order: mark the popped value's entry
+            uint32_t i = 0;
+            while (!(ref[i].queued && ref[i].priority == least && ref[i].value == *p)) i++;
+            ref[i].queued = false;
+            queued--;
+            break;
+        }
+        case 3:
+            if (n) {
+                int64_t p = ref[r].priority - (int64_t)(rng() % 8);
+                assert(come_heap_decrease_key(h, ref[r].handle, p) == ref[r].queued);
+                if (ref[r].queued) ref[r].priority = p;
+            }
+            break;
+        default:
+            if (n) {
+                assert(come_heap_remove(h, ref[r].handle) == ref[r].queued);
+                if (ref[r].queued) queued--;
+                ref[r].queued = false;
+                assert(!come_heap_contains(h, ref[r].handle) && come_heap_priority(h, ref[r].handle) == INT64_MAX);
+            }
+        }
+        assert(come_heap_size(h) == queued);
+        // Popped entries are dropped from the table once it fills up
+        if (n == HEAP_REF) {
+            uint32_t k = 0;
+            for (uint32_t i = 0; i < n; i++) {
+                if (ref[i].queued) ref[k++] = ref[i];
+            }
+            n = k;
+        }
+    }
+
+    // Every queued value is still reachable through its handle, and draining yields
+    // nondecreasing priorities
+    for (uint32_t i = 0; i < n; i++) {
+        assert(come_heap_contains(h, ref[i].handle) == ref[i].queued);
+        if (ref[i].queued) assert(come_heap_get(h, ref[i].handle, int64_t) == ref[i].value);
+    }
+    int64_t last = INT64_MIN;
+    while (come_heap_size(h)) {
+        assert(come_heap_top_priority(h) >= last);
+        last = come_heap_top_priority(h);
+        come_heap_take(h);
+    }
+    for (uint32_t i = 0; i < n; i++) assert(!come_heap_contains(h, ref[i].handle));
+    mem_talloc_free(ctx);
+    printf("Heap random tests passed\n");
+}
+
+static void test_heap_handles(void) {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_heap_t* h = come_heap_new(ctx, sizeof(job_t), 4);
+    assert(h && h->cap == 16);
+
+    // A freed id is reused, but the old handle stays stale
+    int64_t a = come_heap_push(h, job_t, ((job_t){.id = 1}), 10);
+    int64_t b = come_heap_push(h, job_t, ((job_t){.id = 2}), 20);
+    assert(a >= 0 && b >= 0 && a != b);
+    assert(come_heap_pop(h, job_t).id == 1);
+    int64_t c = come_heap_push(h, job_t, ((job_t){.id = 3}), 30);
+    assert((uint32_t)c == (uint32_t)a && c != a);
+    assert(!come_heap_contains(h, a) && !come_heap_decrease_key(h, a, 0) && !come_heap_remove(h, a));
+    assert(come_heap_get(h, a, job_t).id == 0 && come_heap_get(h, c, job_t).id == 3);
+    assert(!come_heap_contains(h, -1) && !come_heap_contains(h, (int64_t)1 << 40));
+
+    // decrease_key moves a value to the top; a higher priority is ignored
+    assert(come_heap_decrease_key(h, c, 5) && come_heap_peek(h, job_t).id == 3);
+    assert(come_heap_decrease_key(h, b, 100) && come_heap_priority(h, b) == 20);
+
+    // Growth keeps values and handles
+    for (int i = 0; i < 1000; i++) assert(come_heap_push(h, job_t, ((job_t){.id = 10 + i}), 2000 - i) >= 0);
+    assert(h->cap == 1024 && come_heap_size(h) == 1002);
+    assert(come_heap_get(h, b, job_t).id == 2 && come_heap_peek(h, job_t).id == 3);
+
+    // clear makes every handle stale and keeps the room
+    come_heap_clear(h);
+    assert(come_heap_size(h) == 0 && !come_heap_contains(h, b) && !come_heap_contains(h, c) && h->cap == 1024);
+    assert(come_heap_push(h, job_t, ((job_t){.id = 7}), 0) >= 0 && come_heap_pop(h, job_t).id == 7);
+    mem_talloc_free(ctx);
+    printf("Heap handle tests passed\n");
+}
+
+static come_byte_array_view_t bytes(void* p, uint32_t n) {
+    return (come_byte_array_view_t){p, n, NULL};
+}
+
+static void test_ringbuf(void) {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_ringbuf_t* rb = come_ringbuf_new(ctx, 100);
+    assert(rb && come_ringbuf_capacity(rb) == 128 && come_ringbuf_size(rb) == 0 && come_ringbuf_space(rb) == 128);
+    assert(!come_ringbuf_new(ctx, UINT32_MAX) && errno == EINVAL);
+
+    // Empty: one region covering the buffer
+    come_byte_array_view_t w = come_ringbuf_write_region(rb);
+    assert(w.items == rb->data && w.count == 128);
+    assert(come_ringbuf_read_region(rb).count == 0);
+    memcpy(w.items, "hello world", 11);
+    come_ringbuf_commit(rb, 11);
+    come_byte_array_view_t r = come_ringbuf_read_region(rb);
+    assert(r.count == 11 && memcmp(r.items, "hello", 5) == 0);
+    come_ringbuf_consume(rb, 6);
+    r = come_ringbuf_read_region(rb);
+    assert(r.count == 5 && memcmp(r.items, "world", 5) == 0);
+
+    // Fill to the end so the free space and then the data wrap
+    uint8_t buf[256];
+    for (int i = 0; i < 256; i++) buf[i] = (uint8_t)i;
+    assert(come_ringbuf_write(rb, bytes(buf, 200)) == 123 && come_ringbuf_space(rb) == 0);
+    assert(come_ringbuf_write(rb, bytes(buf, 1)) == 0 && come_ringbuf_write_region(rb).count == 0);
+    uint8_t out[256];
+    assert(come_ringbuf_read(rb, bytes(out, 100)) == 100);
+    assert(memcmp(out, "world", 5) == 0 && memcmp(out + 5, buf, 95) == 0);
+    // Unread bytes wrap (offsets 106..127 and 0..5); the free space between is contiguous
+    r = come_ringbuf_read_region(rb);
+    assert(r.items == rb->data + 106 && r.count == 22);
+    w = come_ringbuf_write_region(rb);
+    assert(w.items == rb->data + 6 && w.count == 100);
+    assert(come_ringbuf_write(rb, bytes(buf + 123, 100)) == 100 && come_ringbuf_size(rb) == 128);
+    assert(come_ringbuf_read(rb, bytes(out, 256)) == 128);
+    assert(memcmp(out, buf + 95, 128) == 0);
+
+    // Drained: both positions restart at 0
+    assert(rb->head == 0 && rb->tail == 0 && come_ringbuf_write_region(rb).count == 128);
+
+    // Commit and consume are clamped
+    come_ringbuf_commit(rb, 1000);
+    assert(come_ringbuf_size(rb) == 128);
+    come_ringbuf_consume(rb, 1000);
+    assert(come_ringbuf_size(rb) == 0);
+    mem_talloc_free(ctx);
+    printf("Ringbuf region tests passed\n");
+}
+
+static void test_ringbuf_socket(void) {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    int sv[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    come_ringbuf_t* out = come_ringbuf_new(ctx, 64);
+    come_ringbuf_t* in = come_ringbuf_new(ctx, 64);
+    uint8_t msg[64 * 50];
+    for (size_t i = 0; i < sizeof(msg); i++) msg[i] = (uint8_t)(i * 31 + 7);
+
+    // Stream msg through both buffers in uneven pieces so recv and send see wrapped
+    // regions; every byte must arrive once and in order
+    size_t queued = 0, received = 0;
+    uint8_t got[sizeof(msg)];
+    assert(come_ringbuf_send(out, sv[0], 0) == 0);
+    while (received < sizeof(msg)) {
+        uint32_t piece = (uint32_t)(rng() % 40);
+        if (queued < sizeof(msg)) {
+            if (piece > sizeof(msg) - queued) piece = (uint32_t)(sizeof(msg) - queued);
+            queued += come_ringbuf_write(out, bytes(msg + queued, piece));
+        }
+        assert(come_ringbuf_send(out, sv[0], MSG_DONTWAIT) >= 0);
+        ssize_t n = come_ringbuf_recv(in, sv[1], MSG_DONTWAIT);
+        assert(n >= 0 || errno == EAGAIN || errno == ENOBUFS);
+        uint32_t take = (uint32_t)(rng() % 48);
+        if (take > sizeof(msg) - received) take = (uint32_t)(sizeof(msg) - received);
+        received += come_ringbuf_read(in, bytes(got + received, take));
+    }
+    assert(memcmp(got, msg, sizeof(msg)) == 0);
+
+    // Full buffer: recv fails without reading; end of stream reads as 0
+    assert(come_ringbuf_write(out, bytes(msg, 64)) == 64 && come_ringbuf_send(out, sv[0], 0) == 64);
+    assert(come_ringbuf_write(in, bytes(msg, 64)) == 64);
+    assert(come_ringbuf_recv(in, sv[1], 0) == -1 && errno == ENOBUFS);
+    come_ringbuf_clear(in);
+    assert(come_ringbuf_recv(in, sv[1], 0) == 64);
+    close(sv[0]);
+    come_ringbuf_clear(in);
+    assert(come_ringbuf_recv(in, sv[1], 0) == 0);
+    close(sv[1]);
+    mem_talloc_free(ctx);
+    printf("Ringbuf recv/send tests passed\n");
+}
+
+int main(void) {
+    test_deque_random();
+    test_deque_wrap();
+    test_heap_random();
+    test_heap_handles();
+    test_ringbuf();
+    test_ringbuf_socket();
+    return 0;
+}
@@ -0,0 +1,363 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+#include "come_array.h"
+#include "come_string.h"
+#include "mem/talloc.h"
+
+// Sorting tests; run with --bench to time the sorts against qsort instead
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+
+static uint64_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static int cmp_int(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_long(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_float(const void* a, const void* b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_byte(const void* a, const void* b) {
+    return *(const uint8_t*)a - *(const uint8_t*)b;
+}
+
+static int cmp_string(const void* a, const void* b) {
+    const come_string_t* x = *(come_string_t* const*)a;
+    const come_string_t* y = *(come_string_t* const*)b;
+    uint32_t n = x->count < y->count ? x->count : y->count;
+    int c = memcmp(x->data, y->data, n);
+    return c ? c : (x->count > y->count) - (x->count < y->count);
+}
+
+typedef struct {
+    int key;
+    int seq;
+} pair;
+
+static int cmp_pair(const void* a, const void* b) {
+    return cmp_int(&((const pair*)a)->key, &((const pair*)b)->key);
+}
+
+// Input shapes pdqsort and radix sort treat differently
+static int64_t gen(int shape, uint32_t i, uint32_t n) {
+    switch (shape) {
+    case 0: return (int64_t)rng();
+    case 1: return (int64_t)(rng() % 16) - 8;    // Many duplicates
+    case 2: return i;                            // Sorted
+    case 3: return (int64_t)n - i;               // Reversed
+    case 4: return i % 2 ? (int64_t)i : -(int64_t)i; // Organ pipe-ish
+    case 5: return rng() % 100 ? i : (int64_t)rng(); // Nearly sorted
+    default: return 7;                           // All equal
+    }
+}
+
+static const uint32_t sizes[] = {0, 1, 2, 3, 10, 23, 24, 25, 100, 255, 256, 257, 1000, 5000, 70000};
+
+void test_int() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (int shape = 0; shape < 7; shape++) {
+            uint32_t n = sizes[s];
+            come_int_array_t* a = come_int_array_new(ctx, n);
+            come_long_array_t* l = come_long_array_new(ctx, n);
+            int* ref = malloc((n + 1) * sizeof(int));
+            int64_t* lref = malloc((n + 1) * sizeof(int64_t));
+            for (uint32_t i = 0; i < n; i++) {
+                int64_t v = gen(shape, i, n);
+                a->items[i] = ref[i] = (int)v;
+                l->items[i] = lref[i] = v;
+            }
+            qsort(ref, n, sizeof(int), cmp_int);
+            qsort(lref, n, sizeof(int64_t), cmp_long);
+            come_array_sort(a);
+            come_array_sort(l);
+            assert(memcmp(a->items, ref, n * sizeof(int)) == 0);
+            assert(memcmp(l->items, lref, n * sizeof(int64_t)) == 0);
+
+            // Every value is found at its first index; absent values are not
+            for (uint32_t i = 0; i < n; i += 1 + n / 50) {
+                long at = come_array_binary_search(a, ref[i]);
+                assert(at >= 0 && at <= (long)i && a->items[at] == ref[i]);
+                assert(at == 0 || a->items[at - 1] < ref[i]);
+            }
+            if (n) assert(come_array_binary_search(a, ref[n - 1] == INT32_MAX ? ref[0] : ref[n - 1] + 1) ==
+                          (ref[n - 1] == INT32_MAX ? 0 : -1));
+
+            uint32_t distinct = n ? 1 : 0;
+            for (uint32_t i = 1; i < n; i++) distinct += ref[i] != ref[i - 1];
+            assert(come_array_unique(a) == distinct && a->count == distinct);
+            for (uint32_t i = 1; i < a->count; i++) assert(a->items[i - 1] < a->items[i]);
+
+            // partial_sort puts the k smallest first, sorted
+            for (uint32_t i = 0; i < n; i++) l->items[i] = gen(shape, i, n);
+            for (uint32_t i = 0; i < n; i++) lref[i] = l->items[i];
+            qsort(lref, n, sizeof(int64_t), cmp_long);
+            uint32_t k = n / 3 + 1;
+            come_array_partial_sort(l, k);
+            for (uint32_t i = 0; i < k && i < n; i++) assert(l->items[i] == lref[i]);
+            free(ref);
+            free(lref);
+        }
+    }
+    mem_talloc_free(ctx);
+}
+
+void test_float() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        uint32_t n = sizes[s];
+        come_double_array_t* d = come_double_array_new(ctx, n);
+        come_float_array_t* f = come_float_array_new(ctx, n);
+        double* ref = malloc((n + 1) * sizeof(double));
+        float* fref = malloc((n + 1) * sizeof(float));
+        for (uint32_t i = 0; i < n; i++) {
+            double v = (double)(int64_t)rng() / 1e12;
+            if (i % 7 == 0) v = -v;
+            if (i % 11 == 0) v = 0.0;
+            d->items[i] = ref[i] = v;
+            f->items[i] = fref[i] = (float)v;
+        }
+        qsort(ref, n, sizeof(double), cmp_double);
+        qsort(fref, n, sizeof(float), cmp_float);
+        come_array_sort(d);
+        come_array_sort(f);
+        for (uint32_t i = 0; i < n; i++) {
+            assert(d->items[i] == ref[i]);
+            assert(f->items[i] == fref[i]);
+        }
+        if (n > 1) assert(come_array_binary_search(d, ref[n / 2]) >= 0);
+    }
+
+    // Total order: -NaN < -inf < -0.0 < 0.0 < inf < NaN, at both pdqsort and radix sizes
+    for (uint32_t n = 6; n <= 600; n += 594) {
+        come_double_array_t* d = come_double_array_new(ctx, n);
+        for (uint32_t i = 0; i < n; i++) {
+            static const double vals[] = {0.0, -0.0, 1.5};
+            d->items[i] = vals[i % 3];
+        }
+        d->items[0] = NAN;
+        d->items[1] = -INFINITY;
+        d->items[2] = INFINITY;
+        d->items[n - 1] = -NAN;
+        come_array_sort(d);
+        assert(isnan(d->items[0]) && signbit(d->items[0]));
+        assert(d->items[1] == -INFINITY);
+        assert(d->items[2] == 0.0 && signbit(d->items[2]));
+        assert(d->items[n - 2] == INFINITY);
+        assert(isnan(d->items[n - 1]) && !signbit(d->items[n - 1]));
+        for (uint32_t i = 1; i < n - 1; i++) {
+            assert(d->items[i - 1] <= d->items[i] || isnan(d->items[i - 1]));
+        }
+    }
+    mem_talloc_free(ctx);
+}
+
+void test_byte() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        uint32_t n = sizes[s];
+        come_byte_array_t* b = come_byte_array_new(ctx, n);
+        uint8_t* ref = malloc(n + 1);
+        for (uint32_t i = 0; i < n; i++) b->items[i] = ref[i] = (uint8_t)rng();
+        qsort(ref, n, 1, cmp_byte);
+        come_array_partial_sort(b, 5);
+        for (uint32_t i = 0; i < 5 && i < n; i++) assert(b->items[i] == ref[i]);
+        come_array_sort(b);
+        assert(memcmp(b->items, ref, n) == 0);
+        if (n) assert(come_array_binary_search(b, ref[n - 1]) >= 0);
+        free(ref);
+    }
+    mem_talloc_free(ctx);
+}
+
+void test_strings() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    // Prefix edge cases: shorter than, exactly and just past the 8 cached bytes, embedded NULs
+    static const struct { const char* s; uint32_t len; } words[] = {
+        {"", 0}, {"a", 1}, {"ab", 2}, {"ab\0", 3}, {"abc", 3}, {"abcdefgh", 8}, {"abcdefgh\0", 9},
+        {"abcdefghi", 9}, {"abcdefghij", 10}, {"abcdefgx", 8}, {"b", 1}, {"\xff", 1}, {"zz", 2},
+    };
+    const uint32_t nwords = sizeof(words) / sizeof(words[0]);
+    come_string_list_t* list = come_string_list_new(ctx, 0);
+    come_string_t** ref = malloc(4000 * sizeof(come_string_t*));
+    for (uint32_t i = 0; i < 4000; i++) {
+        come_string_t* s;
+        if (i < nwords * 2) {
+            s = come_string_new_len(ctx, words[i % nwords].s, words[i % nwords].len);
+        } else {
+            char buf[24];
+            int len = (int)(rng() % 20);
+            for (int j = 0; j < len; j++) buf[j] = (char)('a' + rng() % 3);
+            s = come_string_new_len(ctx, buf, len);
+        }
+        list = come_string_list_push(list, s);
+        ref[i] = s;
+    }
+    qsort(ref, 4000, sizeof(come_string_t*), cmp_string);
+    come_array_sort(list);
+    for (uint32_t i = 0; i < 4000; i++) assert(cmp_string(&list->items[i], &ref[i]) == 0);
+
+    assert(come_array_binary_search(list, come_string_new(ctx, "abcdefghi")) >= 0);
+    assert(come_array_binary_search(list, come_string_new(ctx, "abcdefghz")) == -1);
+    uint32_t distinct = 1;
+    for (uint32_t i = 1; i < 4000; i++) distinct += cmp_string(&ref[i], &ref[i - 1]) != 0;
+    assert(come_array_unique(list) == distinct);
+    free(ref);
+    mem_talloc_free(ctx);
+}
+
+void test_sort_by() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        uint32_t n = sizes[s];
+        pair* items = mem_talloc_alloc(ctx, (n + 1) * sizeof(pair));
+        for (uint32_t i = 0; i < n; i++) {
+            items[i].key = (int)(rng() % 50);
+            items[i].seq = (int)i;
+        }
+        assert(come_array_sort_items(items, n, sizeof(pair), cmp_pair, true) == 0);
+        for (uint32_t i = 1; i < n; i++) {
+            assert(items[i - 1].key < items[i].key ||
+                   (items[i - 1].key == items[i].key && items[i - 1].seq < items[i].seq));
+        }
+        for (uint32_t i = 0; i < n; i++) items[i].key = (int)(rng() % 50);
+        assert(come_array_sort_items(items, n, sizeof(pair), cmp_pair, false) == 0);
+        for (uint32_t i = 1; i < n; i++) assert(items[i - 1].key <= items[i].key);
+    }
+
+    come_int_array_t* a = come_int_array_new(ctx, 0);
+    for (int i = 0; i < 100; i++) a = come_int_array_push(a, (i * 37) % 100);
+    assert(come_array_sort_by(a, cmp_int) == 0);
+    for (int i = 0; i < 100; i++) assert(a->items[i] == i);
+    come_int_array_t* none = NULL;
+    assert(come_array_stable_sort(none, cmp_int) == 0);
+    mem_talloc_free(ctx);
+}
+
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_report(const char* what, uint32_t n, double t_sort, double t_qsort) {
+    printf("  %-28s n=%-8u %8.2f ms  qsort %8.2f ms  %5.1fx\n", what, n, t_sort * 1e3, t_qsort * 1e3, t_qsort / t_sort);
+}
+
+// Times each sort against qsort over the same input
+static void bench() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    static const uint32_t bench_sizes[] = {1000, 100000, 1000000};
+    static const char* shapes[] = {"random", "few distinct", "sorted", "reversed"};
+    for (size_t s = 0; s < sizeof(bench_sizes) / sizeof(bench_sizes[0]); s++) {
+        uint32_t n = bench_sizes[s];
+        int reps = n < 10000 ? 1000 : n < 500000 ? 10 : 2;
+        for (int shape = 0; shape < 4; shape++) {
+            come_int_array_t* a = come_int_array_new(ctx, n);
+            come_long_array_t* l = come_long_array_new(ctx, n);
+            come_double_array_t* d = come_double_array_new(ctx, n);
+            int* src = malloc(n * sizeof(int));
+            int64_t* lsrc = malloc(n * sizeof(int64_t));
+            double* dsrc = malloc(n * sizeof(double));
+            for (uint32_t i = 0; i < n; i++) {
+                src[i] = (int)gen(shape, i, n);
+                lsrc[i] = gen(shape, i, n);
+                dsrc[i] = (double)src[i] / 3.0;
+            }
+            char label[64];
+            double t0, t1, t2;
+
+            t0 = seconds();
+            for (int r = 0; r < reps; r++) { memcpy(a->items, src, n * sizeof(int)); come_array_sort(a); }
+            t1 = seconds();
+            for (int r = 0; r < reps; r++) { memcpy(a->items, src, n * sizeof(int)); qsort(a->items, n, sizeof(int), cmp_int); }
+            t2 = seconds();
+            snprintf(label, sizeof(label), "int %s", shapes[shape]);
+            bench_report(label, n, (t1 - t0) / reps, (t2 - t1) / reps);
+            double int_qsort = (t2 - t1) / reps;
+
+            t0 = seconds();
+            for (int r = 0; r < reps; r++) { memcpy(l->items, lsrc, n * sizeof(int64_t)); come_array_sort(l); }
+            t1 = seconds();
+            for (int r = 0; r < reps; r++) { memcpy(l->items, lsrc, n * sizeof(int64_t)); qsort(l->items, n, sizeof(int64_t), cmp_long); }
+            t2 = seconds();
+            snprintf(label, sizeof(label), "long %s", shapes[shape]);
+            bench_report(label, n, (t1 - t0) / reps, (t2 - t1) / reps);
+
+            t0 = seconds();
+            for (int r = 0; r < reps; r++) { memcpy(d->items, dsrc, n * sizeof(double)); come_array_sort(d); }
+            t1 = seconds();
+            for (int r = 0; r < reps; r++) { memcpy(d->items, dsrc, n * sizeof(double)); qsort(d->items, n, sizeof(double), cmp_double); }
+            t2 = seconds();
+            snprintf(label, sizeof(label), "double %s", shapes[shape]);
+            bench_report(label, n, (t1 - t0) / reps, (t2 - t1) / reps);
+
+            if (shape == 0) {
+                t0 = seconds();
+                for (int r = 0; r < reps; r++) { memcpy(a->items, src, n * sizeof(int)); come_array_sort_by(a, cmp_int); }
+                t1 = seconds();
+                bench_report("int sort_by random", n, (t1 - t0) / reps, int_qsort);
+                t0 = seconds();
+                for (int r = 0; r < reps; r++) { memcpy(a->items, src, n * sizeof(int)); come_array_partial_sort(a, 10); }
+                t1 = seconds();
+                bench_report("int partial_sort(10) random", n, (t1 - t0) / reps, int_qsort);
+            }
+            free(src);
+            free(lsrc);
+            free(dsrc);
+        }
+
+        // Strings sharing long prefixes are the slow case for the cached prefix
+        come_string_list_t* list = come_string_list_new(ctx, n);
+        come_string_t** strs = malloc(n * sizeof(come_string_t*));
+        for (uint32_t i = 0; i < n; i++) {
+            char buf[32];
+            int len = snprintf(buf, sizeof(buf), "%s%llu", i % 2 ? "user/" : "session/key/", (unsigned long long)(rng() % 10000000));
+            strs[i] = come_string_new_len(ctx, buf, len);
+        }
+        int sreps = reps < 100 ? reps : 100;
+        double t0 = seconds();
+        for (int r = 0; r < sreps; r++) { memcpy(list->items, strs, n * sizeof(come_string_t*)); come_array_sort(list); }
+        double t1 = seconds();
+        for (int r = 0; r < sreps; r++) { memcpy(list->items, strs, n * sizeof(come_string_t*)); qsort(list->items, n, sizeof(come_string_t*), cmp_string); }
+        double t2 = seconds();
+        bench_report("string random", n, (t1 - t0) / sreps, (t2 - t1) / sreps);
+        free(strs);
+    }
+    mem_talloc_free(ctx);
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        bench();
+        return 0;
+    }
+    test_int();
+    test_float();
+    test_byte();
+    test_strings();
+    test_sort_by();
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 #include "come_string.h"
 #include "mem/talloc.h"
 
@@ -165,6 +166,490 @@ void test_regex() {
     printf("Regex tests passed\n");
 }
 
+void test_regex_compiled() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_regex_t* re = come_regex_new(ctx, "([a-z]+)=([0-9]+)");
+    assert(re != NULL);
+    assert(come_regex_new(ctx, "([a-z") == NULL); // Invalid pattern
+
+    come_string_t* s = come_string_new(ctx, "width=640 height=480");
+    assert(come_regex_match(re, s) == true);
+
+    come_string_list_t* groups = come_regex_groups(re, s);
+    assert(groups->count == 3);
+    come_string_t* expected_key = come_string_new(ctx, "width");
+    assert(come_string_cmp(groups->items[1], expected_key, 0) == 0);
+
+    come_string_t* replaced = come_regex_replace(re, s, "?", 0);
+    come_string_t* expected_repl = come_string_new(ctx, "? ?");
+    assert(come_string_cmp(replaced, expected_repl, 0) == 0);
+
+    come_string_list_t* parts = come_regex_split(re, s, 0);
+    assert(parts->count == 3);
+
+    // Cache: more distinct patterns than cache slots, then reuse the first one
+    char pattern[32];
+    for (int i = 0; i < 40; i++) {
+        snprintf(pattern, sizeof(pattern), "^x{%d}$", i + 1);
+        assert(come_string_regex(s, pattern) == false);
+    }
+    assert(come_string_regex(s, "^x{1}$") == false);
+    assert(come_string_regex(s, "height=[0-9]+$") == true);
+    assert(come_string_regex(s, "height=[0-9]+$") == true);
+
+    come_regex_free(re);
+    mem_talloc_free(ctx);
+    printf("Compiled regex tests passed\n");
+}
+
+void test_regex_dfa() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_regex_t* re = come_regex_dfa(ctx, "([a-z]+)=([0-9]+)");
+    assert(re != NULL);
+    assert(come_regex_engine(re) == COME_REGEX_DFA);
+    assert(come_regex_dfa(ctx, "(a)\\1") == NULL); // Back-references are not regular
+    assert(come_regex_dfa(ctx, "a{2") == NULL);
+
+    come_string_t* s = come_string_new(ctx, "width=640 height=480");
+    assert(come_regex_match(re, s) == true);
+
+    come_string_list_t* groups = come_regex_groups(re, s);
+    assert(groups->count == 3);
+    come_string_t* expected_key = come_string_new(ctx, "width");
+    come_string_t* expected_val = come_string_new(ctx, "640");
+    assert(come_string_cmp(groups->items[1], expected_key, 0) == 0);
+    assert(come_string_cmp(groups->items[2], expected_val, 0) == 0);
+
+    come_string_t* replaced = come_regex_replace(re, s, "?", 1);
+    come_string_t* expected_repl = come_string_new(ctx, "? height=480");
+    assert(come_string_cmp(replaced, expected_repl, 0) == 0);
+
+    // Leftmost-longest, as POSIX
+    come_regex_t* alt = come_regex_dfa(ctx, "a|ab|abc");
+    come_string_t* abc = come_string_new(ctx, "xabcx");
+    come_string_t* alt_repl = come_regex_replace(alt, abc, "#", 0);
+    come_string_t* expected_alt = come_string_new(ctx, "x#x");
+    assert(come_string_cmp(alt_repl, expected_alt, 0) == 0);
+
+    // Anchors apply to the whole text, not to each search position
+    come_regex_t* anchored = come_regex_dfa(ctx, "^a");
+    come_string_t* aaa = come_string_new(ctx, "aaa");
+    come_string_t* anchored_repl = come_regex_replace(anchored, aaa, "b", 0);
+    come_string_t* expected_anchored = come_string_new(ctx, "baa");
+    assert(come_string_cmp(anchored_repl, expected_anchored, 0) == 0);
+
+    // Split and optional groups
+    come_regex_t* sep = come_regex_dfa(ctx, "[[:space:]]*,[[:space:]]*");
+    come_string_t* csv = come_string_new(ctx, "a , b,c");
+    come_string_list_t* parts = come_regex_split(sep, csv, 0);
+    assert(parts->count == 3);
+    come_string_t* expected_b = come_string_new(ctx, "b");
+    assert(come_string_cmp(parts->items[1], expected_b, 0) == 0);
+
+    come_regex_t* opt = come_regex_dfa(ctx, "(x)?y");
+    come_string_t* y = come_string_new(ctx, "y");
+    come_string_list_t* opt_groups = come_regex_groups(opt, y);
+    assert(opt_groups->count == 2);
+    assert(opt_groups->items[1] == NULL);
+
+    // Length-delimited: an embedded NUL is ordinary data
+    come_regex_t* tail = come_regex_dfa(ctx, "tail$");
+    come_string_t* bin = come_string_new_len(ctx, "head\0tail", 9);
+    assert(come_regex_match(tail, bin) == true);
+
+    // Adversarial input for a backtracking matcher stays linear here
+    come_regex_t* evil = come_regex_dfa(ctx, "(a|aa)*b");
+    come_string_t* as = come_string_repeat(come_string_new(ctx, "a"), 100000);
+    assert(come_regex_match(evil, as) == false);
+    come_string_t* as_repl = come_regex_replace(evil, as, "#", 0);
+    assert(come_string_cmp(as_repl, as, 0) == 0);
+
+    // Every position starts a match whose longer alternative is alive to the end of the
+    // text: finding all of them must not rescan the rest of it each time
+    come_regex_t* longer = come_regex_dfa(ctx, "a|a*b");
+    come_string_t* a80k = come_string_repeat(come_string_new(ctx, "a"), 80000);
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    come_string_t* hashes = come_regex_replace(longer, a80k, "#", 0);
+    come_string_list_t* pieces = come_regex_split(longer, a80k, 0);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    assert(hashes->count == 80000 && hashes->data[0] == '#' && hashes->data[79999] == '#');
+    assert(pieces->count == 80001 && pieces->items[40000]->count == 0);
+    assert((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9 < 1.0);
+    come_string_t* ab = come_string_new(ctx, "aab xa");
+    come_string_t* ab_repl = come_regex_replace(longer, ab, "#", 0);
+    come_string_t* expected_ab = come_string_new(ctx, "# x#");
+    assert(come_string_cmp(ab_repl, expected_ab, 0) == 0);
+
+    mem_talloc_free(ctx);
+    printf("DFA regex tests passed\n");
+}
+
+void test_multi_search() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_string_t* s = come_string_new(ctx, "user=bob token=abc123 pass=hunter2");
+
+    come_string_list_t* needles = come_string_split(come_string_new(ctx, "token=,pass=,user="), ",");
+    assert(come_string_find_any(s, needles) == 0);
+    assert(come_string_count_any(s, needles) == 3);
+
+    // Leftmost-longest: "abcd" wins over the shorter "bc" that ends first
+    come_string_t* t = come_string_new(ctx, "xabcdx bc");
+    come_string_list_t* overlap = come_string_split(come_string_new(ctx, "bc,abcd"), ",");
+    assert(come_string_find_any(t, overlap) == 1);
+    assert(come_string_count_any(t, overlap) == 2);
+
+    // Compiled once, reused across haystacks
+    come_string_list_t* pairs = come_string_split(come_string_new(ctx, "abc123,***,hunter2,***,bob,b*b"), ",");
+    come_string_matcher_t* scrub = come_string_replacer_new(ctx, pairs);
+    come_string_t* out = come_string_matcher_replace(scrub, s);
+    come_string_t* expected = come_string_new(ctx, "user=b*b token=*** pass=***");
+    assert(come_string_cmp(out, expected, 0) == 0);
+    assert(come_string_matcher_count(scrub, come_string_new(ctx, "no secrets")) == 0);
+
+    // From parallel lists (a map's keys and values), which may go once it is built
+    TALLOC_CTX* lists = mem_talloc_new_ctx(ctx);
+    come_string_list_t* olds = come_string_split(come_string_new(lists, "abc123,hunter2"), ",");
+    come_string_list_t* news = come_string_split(come_string_new(lists, "<token>,<pass>"), ",");
+    come_string_matcher_t* kv = come_string_replacer_new_kv(ctx, olds, news);
+    come_string_t* kv_once = come_string_replace_many_kv(s, olds, news);
+    mem_talloc_free(lists);
+    come_string_t* kv_out = come_string_matcher_replace(kv, s);
+    come_string_t* kv_expected = come_string_new(ctx, "user=bob token=<token> pass=<pass>");
+    assert(come_string_cmp(kv_out, kv_expected, 0) == 0 && come_string_cmp(kv_once, kv_expected, 0) == 0);
+
+    come_string_t* replaced = come_string_replace_many(t, come_string_split(come_string_new(ctx, "bc,X,abcd,Y"), ","));
+    come_string_t* expected2 = come_string_new(ctx, "xYx X");
+    assert(come_string_cmp(replaced, expected2, 0) == 0);
+
+    // Every position matches "a" while a longer needle stays alive past it: counting them
+    // must not rescan the lookahead after each match. The long needle exceeds one block.
+    char spec[1003] = "a,";
+    memset(spec + 2, 'a', 999);
+    spec[1001] = 'b';
+    spec[1002] = '\0';
+    come_string_list_t* shadow = come_string_split(come_string_new(ctx, spec), ",");
+    come_string_matcher_t* shadowed = come_string_matcher_new(ctx, shadow);
+    come_string_t* a_run = come_string_repeat(come_string_new(ctx, "a"), 400000);
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    size_t shadow_count = come_string_matcher_count(shadowed, a_run);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    assert(shadow_count == 400000);
+    assert((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9 < 1.0);
+    come_string_t* ab_run = come_string_new(ctx, spec);
+    ab_run->data[1] = 'a';
+    assert(come_string_matcher_count(shadowed, ab_run) == 3 && come_string_matcher_find(shadowed, ab_run) == 0);
+
+    mem_talloc_free(ctx);
+    printf("Multi-pattern tests passed\n");
+}
+
+void test_utf8() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+
+    // ASCII: counts are cached and character ops are byte ops
+    come_string_t* a = come_string_new(ctx, "hello, world");
+    assert(a->flags == 0);
+    assert(come_string_len(a) == 12);
+    assert(a->flags & COME_STRING_ASCII);
+    assert(come_string_isascii(a));
+    assert(come_string_utf8(a));
+    come_string_t* sub = come_string_substr(a, 7, 100);
+    assert(strcmp(sub->data, "world") == 0);
+    assert(sub->flags & COME_STRING_ASCII);
+    assert(come_string_len(sub) == 5);
+    assert(come_string_at(a, 12) == NULL);
+    assert(strcmp(come_string_at(a, 4)->data, "o") == 0);
+    assert(come_string_cmp(a, come_string_new(ctx, "hello, there"), 7) == 0);
+    assert(come_string_cmp(a, come_string_new(ctx, "hello"), 7) > 0);
+
+    // Multi-byte, long enough to cross several SIMD blocks
+    come_string_t* u = come_string_new(ctx, "h\xc3\xa9llo \xe2\x82\xac \xf0\x9f\x98\x80 "
+                                             "0123456789abcdef0123456789abcdef0123456789 \xc3\xa9");
+    assert(come_string_len(u) == 54);
+    assert(!come_string_isascii(u));
+    assert(come_string_utf8(u));
+    assert(strcmp(come_string_at(u, 1)->data, "\xc3\xa9") == 0);
+    assert(strcmp(come_string_at(u, 53)->data, "\xc3\xa9") == 0);
+    assert(come_string_at(u, 54) == NULL);
+    assert(strcmp(come_string_substr(u, 6, 9)->data, "\xe2\x82\xac \xf0\x9f\x98\x80") == 0);
+
+    // Invalid: overlong, surrogate, out of range, truncated, stray continuation
+    const char* bad[] = {
+        "abc\xc0\xaf", "\xed\xa0\x80", "\xf4\x90\x80\x80", "0123456789abcdef0123456789abcde\xe2\x82",
+        "\x80", "0123456789abcdef0123456789abcdef\xff" "0123456789",
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        assert(!come_string_utf8(come_string_new(ctx, bad[i])));
+        assert(!come_utf8_valid(bad[i], strlen(bad[i])));
+    }
+    assert(come_utf8_valid("", 0));
+    assert(come_utf8_count("\xe2\x82\xac", 3, NULL) == 1);
+
+    mem_talloc_free(ctx);
+    printf("UTF-8 tests passed\n");
+}
+
+void test_case() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+
+    // ASCII, long enough for the SIMD kernels; non-letters untouched
+    come_string_t* a = come_string_new(ctx, "Content-Type: text/HTML; charset=UTF-8 [@`{~]");
+    assert(strcmp(come_string_upper(a)->data, "CONTENT-TYPE: TEXT/HTML; CHARSET=UTF-8 [@`{~]") == 0);
+    assert(strcmp(come_string_lower(a)->data, "content-type: text/html; charset=utf-8 [@`{~]") == 0);
+
+    // Unicode simple mappings, including ones that change UTF-8 length
+    come_string_t* u = come_string_new(ctx, "stra\xc3\x9f\x65 \xc3\xa9t\xc3\xa9 \xce\xa3\xcf\x83\xcf\x82 \xc4\xb1 \xc9\x90");
+    come_string_t* up = come_string_upper(u);
+    assert(strcmp(up->data, "STRA\xc3\x9f\x45 \xc3\x89T\xc3\x89 \xce\xa3\xce\xa3\xce\xa3 I \xe2\xb1\xaf") == 0);
+    assert(come_string_len(up) == come_string_len(u));
+    come_string_t* low = come_string_lower(come_string_new(ctx, "\xc3\x89" "COLE \xd0\x9c\xd0\x98\xd0\xa0"));
+    assert(strcmp(low->data, "\xc3\xa9\x63ole \xd0\xbc\xd0\xb8\xd1\x80") == 0);
+
+    // In place: same-length mappings only
+    come_string_t* m = come_string_new(ctx, "Hello \xc3\xa9\xc4\xb1 World");
+    come_string_upper_inplace(m);
+    assert(strcmp(m->data, "HELLO \xc3\x89\xc4\xb1 WORLD") == 0);
+    come_string_lower_inplace(m);
+    assert(strcmp(m->data, "hello \xc3\xa9\xc4\xb1 world") == 0);
+
+    // casecmp folds Unicode; n counts characters
+    assert(come_string_casecmp(come_string_new(ctx, "\xc3\x89T\xc3\x89"), come_string_new(ctx, "\xc3\xa9t\xc3\xa9"), 0) == 0);
+    assert(come_string_casecmp(come_string_new(ctx, "\xce\xa3"), come_string_new(ctx, "\xcf\x82"), 0) == 0);
+    assert(come_string_casecmp(come_string_new(ctx, "ABCx"), come_string_new(ctx, "abcy"), 3) == 0);
+    assert(come_string_casecmp(come_string_new(ctx, "abc"), come_string_new(ctx, "ABCD"), 0) < 0);
+    assert(come_string_casecmp(come_string_new(ctx, "b"), come_string_new(ctx, "A"), 0) > 0);
+
+    // HTTP header style equality and hashing
+    come_string_t* h1 = come_string_new(ctx, "Access-Control-Allow-Origin");
+    come_string_t* h2 = come_string_new(ctx, "access-control-allow-ORIGIN");
+    come_string_t* h3 = come_string_new(ctx, "access-control-allow-origim");
+    assert(come_string_caseeq(h1, h2));
+    assert(!come_string_caseeq(h1, h3));
+    assert(!come_string_caseeq(h1, come_string_new(ctx, "Access")));
+    assert(!come_string_caseeq(come_string_new(ctx, "["), come_string_new(ctx, "{")));
+    assert(come_string_casehash(h1) == come_string_casehash(h2));
+    assert(come_string_casehash(h1) != come_string_casehash(h3));
+
+    mem_talloc_free(ctx);
+    printf("Case mapping tests passed\n");
+}
+
+void test_hash_intern() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+
+    // Equal content hashes equally at every length class (0-3, 4-16, 17-48, >48)
+    const char* text = "The quick brown fox jumps over the lazy dog, then naps in the sun.";
+    for (size_t n = 0; n <= strlen(text); n++) {
+        come_string_t* a = come_string_new_len(ctx, text, n);
+        come_string_t* b = come_string_new_len(ctx, text, n);
+        assert(come_string_hash(a) == come_string_hash(b));
+        assert(a->flags & COME_STRING_HASHED);
+        assert(come_hash_bytes(text, n, 1) != come_hash_bytes(text, n, 2));
+        if (n) assert(come_string_hash(a) != come_string_hash(come_string_new_len(ctx, text, n - 1)));
+    }
+
+    // Writers drop the cached hash
+    come_string_t* s = come_string_new(ctx, "Header");
+    uint64_t h = come_string_hash(s);
+    come_string_t* upper = come_string_upper(s);
+    assert(!(upper->flags & COME_STRING_HASHED));
+    come_string_lower_inplace(s);
+    assert(come_string_hash(s) != h);
+    assert(come_string_hash(s) == come_hash_bytes("header", 6, come_hash_seed()));
+    come_string_t* sb = come_string_append(come_string_builder(ctx, 0), "head", 4);
+    h = come_string_hash(sb);
+    sb = come_string_append(sb, "er", 2);
+    assert(come_string_hash(sb) == come_string_hash(s) && come_string_hash(sb) != h);
+
+    // Interning: one pointer per content, across growth
+    come_string_interner_t* t = come_string_interner_new(ctx);
+    come_string_t* k1 = come_string_interner_get(t, "content-type", 12);
+    come_string_t* k2 = come_string_interner_add(t, come_string_new(ctx, "content-type"));
+    assert(k1 == k2);
+    // Published fully scanned, so readers on other threads never fill a cache
+    uint32_t all = COME_STRING_SCANNED | COME_STRING_UTF8_KNOWN | COME_STRING_HASHED;
+    assert((k1->flags & all) == all && k1->nchars == 12 && (k1->flags & COME_STRING_UTF8));
+    come_string_t* k3 = come_string_interner_add(come_string_interner_new(ctx), come_string_new(ctx, "caf\xc3\xa9"));
+    assert((k3->flags & all) == all && k3->nchars == 4 && !(k3->flags & COME_STRING_ASCII));
+    assert(come_string_interner_find(t, "content-length", 14) == NULL);
+    char name[32];
+    for (int i = 0; i < 1000; i++) {
+        int n = snprintf(name, sizeof(name), "label-%d", i);
+        come_string_interner_get(t, name, (size_t)n);
+    }
+    assert(come_string_interner_count(t) == 1001);
+    assert(come_string_interner_find(t, "content-type", 12) == k1);
+    assert(come_string_interner_find(t, "label-777", 9) == come_string_interner_get(t, "label-777", 9));
+    assert(come_string_interner_count(t) == 1001);
+
+    come_string_t* g = come_string_intern(come_string_new(ctx, "shared"));
+    assert(g == come_string_intern(come_string_new(ctx, "shared")));
+    assert(g != come_string_intern(come_string_new(ctx, "Shared")));
+
+    mem_talloc_free(ctx);
+    printf("Hash/intern tests passed\n");
+}
+
+static int share_freed = 0;
+
+static int share_destructor(void* p) {
+    (void)p;
+    share_freed = 1;
+    return 0;
+}
+
+void test_share() {
+    TALLOC_CTX* owner = mem_talloc_new_ctx(NULL);
+
+    // Read-only fan-out of a 1 MiB payload: one buffer, many owners
+    come_string_t* payload = come_string_new_len(owner, NULL, 1 << 20);
+    memset(payload->data, 'x', payload->count);
+    mem_talloc_set_destructor(payload, share_destructor);
+    assert(!come_string_shared(payload));
+
+    TALLOC_CTX* consumers[16];
+    for (int i = 0; i < 16; i++) {
+        consumers[i] = mem_talloc_new_ctx(NULL);
+        assert(come_string_share(payload, consumers[i]) == payload);
+    }
+    assert(come_string_shared(payload));
+
+    // The original owner going away leaves the consumers' view intact
+    mem_talloc_free(owner);
+    assert(!share_freed);
+    assert(payload->data[12345] == 'x');
+    for (int i = 0; i < 15; i++) mem_talloc_free(consumers[i]);
+    assert(!share_freed);
+    assert(!come_string_shared(payload));
+    mem_talloc_free(consumers[15]);
+    assert(share_freed);
+
+    // Writers copy only while shared
+    TALLOC_CTX* a = mem_talloc_new_ctx(NULL);
+    TALLOC_CTX* b = mem_talloc_new_ctx(NULL);
+    come_string_t* s = come_string_new(a, "Shared Text");
+    assert(come_string_cow(s, a) == s);
+    come_string_share(s, b);
+    come_string_t* w = come_string_cow(s, b);
+    assert(w != s && !come_string_shared(w));
+    come_string_upper_inplace(w);
+    assert(strcmp(w->data, "SHARED TEXT") == 0);
+    assert(strcmp(s->data, "Shared Text") == 0);
+
+    // A shared builder keeps building on its own copy
+    come_string_t* sb = come_string_append(come_string_builder(a, 64), "log:", 4);
+    come_string_share(sb, b);
+    come_string_t* grown = come_string_append(sb, " more", 5);
+    assert(grown != sb);
+    assert(strcmp(sb->data, "log:") == 0);
+    assert(strcmp(grown->data, "log: more") == 0);
+
+    // Freeing a shared string drops only the parent's hold
+    come_string_free(s);
+    assert(strcmp(s->data, "Shared Text") == 0);
+    assert(!come_string_shared(s));
+
+    mem_talloc_free(a);
+    mem_talloc_free(b);
+    printf("Shared string tests passed\n");
+}
+
+static bool rope_equals(const come_rope_t* r, const char* expect, size_t n) {
+    come_string_t* flat = come_rope_flatten(r);
+    bool ok = flat && flat->count == n && memcmp(flat->data, expect, n) == 0;
+    come_string_free(flat);
+    return ok;
+}
+
+void test_rope() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+
+    come_rope_t* r = come_rope_new(ctx, come_string_new(ctx, "Hello World"));
+    assert(come_rope_len(r) == 11);
+    come_rope_insert(r, 5, come_string_new(ctx, ","));
+    come_rope_append(r, come_string_new(ctx, "!"));
+    come_rope_delete(r, 6, 6);
+    assert(rope_equals(r, "Hello,!", 7));
+
+    // Random edits against a flat reference
+    static char ref[1 << 16];
+    size_t n = 0;
+    come_rope_t* doc = come_rope_new(ctx, NULL);
+    unsigned seed = 12345;
+    for (int i = 0; i < 4000; i++) {
+        seed = seed * 1103515245 + 12345;
+        size_t pos = n ? (seed >> 8) % (n + 1) : 0;
+        if (n < 30000 && (seed & 3) != 0) {
+            char piece[40];
+            size_t k = 1 + (seed >> 20) % 39;
+            for (size_t j = 0; j < k; j++) piece[j] = 'a' + (i + j) % 26;
+            come_string_t* s = come_string_new_len(ctx, piece, k);
+            memmove(ref + pos + k, ref + pos, n - pos);
+            memcpy(ref + pos, piece, k);
+            n += k;
+            come_rope_insert(doc, pos, s);
+            come_string_free(s);
+        } else {
+            size_t k = (seed >> 16) % 64;
+            if (k > n - pos) k = n - pos;
+            memmove(ref + pos, ref + pos + k, n - pos - k);
+            n -= k;
+            come_rope_delete(doc, pos, k);
+        }
+        assert(come_rope_len(doc) == n);
+    }
+    assert(rope_equals(doc, ref, n));
+
+    // substr shares subtrees and survives further edits of its source
+    come_rope_t* mid = come_rope_substr(doc, 1000, 9000);
+    assert(rope_equals(mid, ref + 1000, 8000));
+    come_rope_delete(doc, 0, n);
+    assert(come_rope_len(doc) == 0);
+    assert(rope_equals(mid, ref + 1000, 8000));
+
+    // Large strings become leaves without a copy; the chunk is the string itself
+    come_string_t* big = come_string_new_len(ctx, NULL, 100000);
+    memset(big->data, 'z', big->count);
+    come_rope_t* page = come_rope_new(ctx, come_string_new(ctx, "<p>"));
+    come_rope_append(page, big);
+    come_rope_append(page, come_string_new(ctx, "</p>"));
+    assert(come_string_shared(big));
+    come_rope_iter_t it;
+    come_rope_iter_init(&it, page);
+    size_t chunks = 0, total = 0;
+    bool zero_copy = false;
+    while (come_rope_iter_next(&it)) {
+        if (it.chunk == big && it.data == big->data) zero_copy = true;
+        chunks++;
+        total += it.len;
+    }
+    assert(zero_copy && chunks == 3 && total == 100007);
+
+    // Nodes concatenated from another rope outlive it
+    TALLOC_CTX* other = mem_talloc_new_ctx(NULL);
+    come_rope_t* tail = come_rope_new(other, big);
+    come_rope_concat(page, tail);
+    mem_talloc_free(other);
+    come_string_free(big);
+    assert(come_rope_len(page) == 200007);
+    come_string_t* flat = come_rope_flatten(page);
+    assert(memcmp(flat->data, "<p>zz", 5) == 0 && flat->data[100003] == '<' && flat->data[200006] == 'z');
+
+    // Streaming write with writev()
+    FILE* tmp = tmpfile();
+    assert(come_rope_write(page, fileno(tmp)) == 200007);
+    rewind(tmp);
+    static char back[200007];
+    assert(fread(back, 1, sizeof(back), tmp) == sizeof(back));
+    assert(memcmp(back, flat->data, sizeof(back)) == 0);
+    fclose(tmp);
+
+    mem_talloc_free(ctx);
+    printf("Rope tests passed\n");
+}
+
 int main() {
     test_basic();
     test_search();
@@ -173,5 +658,13 @@ int main() {
     test_trim();
     test_split_join();
     test_regex();
+    test_regex_compiled();
+    test_regex_dfa();
+    test_multi_search();
+    test_utf8();
+    test_case();
+    test_hash_intern();
+    test_share();
+    test_rope();
     return 0;
 }